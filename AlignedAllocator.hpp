@@ -0,0 +1,109 @@
+   /** Aligned allocator.
+   <P>
+   A standard allocator returning storage aligned on an arbitrary power of
+   two, 64 bytes by default (one cache line, and the width of an AVX-512
+   register).  It can be plugged into the storage policy of the
+   decompositions, for example
+<pre>
+   typedef unbounded_array<double, aligned_allocator<double> > AlignedStorage;
+   SingularValueDecomposition<double, row_major, AlignedStorage> SVD(A);
+</pre>
+   so that the columns or rows of the internal matrices start on aligned
+   addresses (for the leading element of the storage; the alignment of
+   the other rows depends on the dimensions).
+   */
+
+#ifndef _BOOST_UBLAS_ALIGNEDALLOCATOR_
+#define _BOOST_UBLAS_ALIGNEDALLOCATOR_
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <limits>
+
+namespace boost { namespace numeric { namespace ublas {
+
+namespace detail {
+
+   /** Allocate bytes aligned on alignment (a power of two at least as large
+       as a pointer).  The address returned by malloc is stored just before
+       the aligned block so that it can be released with aligned_free.
+   */
+   inline void* aligned_malloc (std::size_t bytes, std::size_t alignment) {
+      void* raw = std::malloc(bytes + alignment);
+      if (raw == 0) {
+         throw std::bad_alloc();
+      }
+      std::size_t addr = reinterpret_cast<std::size_t>(raw) + alignment;
+      void* aligned = reinterpret_cast<void*>(addr & ~(alignment - 1));
+      reinterpret_cast<void**>(aligned)[-1] = raw;
+      return aligned;
+   }
+
+   inline void aligned_free (void* p) {
+      if (p != 0) {
+         std::free(reinterpret_cast<void**>(p)[-1]);
+      }
+   }
+
+}
+
+template <class T, std::size_t Alignment = 64>
+class aligned_allocator {
+public:
+   typedef T value_type;
+   typedef T* pointer;
+   typedef const T* const_pointer;
+   typedef T& reference;
+   typedef const T& const_reference;
+   typedef std::size_t size_type;
+   typedef std::ptrdiff_t difference_type;
+
+   template <class U>
+   struct rebind {
+      typedef aligned_allocator<U, Alignment> other;
+   };
+
+   aligned_allocator () {}
+   template <class U>
+   aligned_allocator (const aligned_allocator<U, Alignment>&) {}
+
+   pointer address (reference x) const { return &x; }
+   const_pointer address (const_reference x) const { return &x; }
+
+   pointer allocate (size_type n, const void* /*hint*/ = 0) {
+      if (n > max_size()) {
+         throw std::bad_alloc();
+      }
+      return static_cast<pointer>(detail::aligned_malloc(n * sizeof(T), Alignment));
+   }
+
+   void deallocate (pointer p, size_type /*n*/) {
+      detail::aligned_free(p);
+   }
+
+   size_type max_size () const {
+      return (std::numeric_limits<size_type>::max)() / sizeof(T) - Alignment;
+   }
+
+   void construct (pointer p, const T& value) {
+      new (static_cast<void*>(p)) T(value);
+   }
+
+   void destroy (pointer p) {
+      p->~T();
+   }
+};
+
+template <class T, class U, std::size_t Alignment>
+inline bool operator== (const aligned_allocator<T, Alignment>&, const aligned_allocator<U, Alignment>&) {
+   return true;
+}
+
+template <class T, class U, std::size_t Alignment>
+inline bool operator!= (const aligned_allocator<T, Alignment>&, const aligned_allocator<U, Alignment>&) {
+   return false;
+}
+
+}}}
+#endif
@@ -0,0 +1,228 @@
+   /** Arena allocation for decomposition storage.
+   <P>
+   A MonotonicArena hands out aligned storage from large blocks and never
+   frees individual allocations: everything is released at once by
+   release() or by the destructor.  An ArenaScope makes an arena current
+   for the calling thread, and arena_allocator, when used as the storage
+   policy of the decompositions, draws from the current arena:
+<pre>
+   typedef unbounded_array<double, arena_allocator<double> > ArenaStorage;
+   MonotonicArena arena;
+   {
+      ArenaScope scope(arena);
+      for (...) {
+         EigenvalueDecomposition<double, row_major, ArenaStorage> Eig(A);
+         ...
+      }
+   }
+   arena.release();
+</pre>
+   Every object allocated from an arena must be destroyed before the arena
+   is released.  When no arena is current, arena_allocator falls back to
+   aligned heap storage, so that objects outliving the scope remain valid.
+   Arenas are not thread-safe: each thread should use its own.
+   */
+
+#ifndef _BOOST_UBLAS_ARENAALLOCATOR_
+#define _BOOST_UBLAS_ARENAALLOCATOR_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <limits>
+#include <vector>
+#include "AlignedAllocator.hpp"
+
+namespace boost { namespace numeric { namespace ublas {
+
+class MonotonicArena {
+
+   /** Blocks of storage owned by the arena, the last one being in use.
+   */
+   std::vector<void*> blocks;
+
+   /** Free space in the current block.
+   */
+   char* cur;
+   char* end;
+
+   /** Minimum size of a block.
+   */
+   std::size_t blockSize;
+
+   /** Total number of bytes handed out since the last release.
+   */
+   std::size_t used;
+
+   MonotonicArena (const MonotonicArena&);
+   MonotonicArena& operator= (const MonotonicArena&);
+
+public:
+   /** Create an empty arena.
+   @param blockSize  Minimum size of the blocks requested from the heap.
+   */
+
+   explicit MonotonicArena (std::size_t blockSize = 1 << 20)
+   : cur(0), end(0), blockSize(blockSize), used(0) {}
+
+   ~MonotonicArena () {
+      release();
+   }
+
+   /** Allocate aligned storage from the arena.
+   @param bytes      Size of the storage.
+   @param alignment  Alignment, a power of two.
+   @return           Pointer to the storage, valid until release().
+   */
+
+   void* allocate (std::size_t bytes, std::size_t alignment) {
+      std::size_t addr = (reinterpret_cast<std::size_t>(cur) + alignment - 1) & ~(alignment - 1);
+      if (cur == 0 || addr + bytes > reinterpret_cast<std::size_t>(end)) {
+         std::size_t size = std::max(blockSize, bytes + alignment);
+         void* block = detail::aligned_malloc(size, alignment);
+         blocks.push_back(block);
+         cur = static_cast<char*>(block);
+         end = cur + size;
+         addr = reinterpret_cast<std::size_t>(cur);
+      }
+      cur = reinterpret_cast<char*>(addr + bytes);
+      used += bytes;
+      return reinterpret_cast<void*>(addr);
+   }
+
+   /** Release all the storage allocated from the arena.
+   */
+
+   void release () {
+      for (std::size_t i = 0; i < blocks.size(); ++i) {
+         detail::aligned_free(blocks[i]);
+      }
+      blocks.clear();
+      cur = end = 0;
+      used = 0;
+   }
+
+   /** Number of bytes handed out since the last release.
+   */
+
+   std::size_t bytesUsed () const {
+      return used;
+   }
+
+   /** Arena used by arena_allocator in the calling thread, or 0.
+   */
+
+   static MonotonicArena*& current () {
+      static thread_local MonotonicArena* arena = 0;
+      return arena;
+   }
+};
+
+/** Make an arena current for the calling thread during the lifetime of the scope.
+*/
+
+class ArenaScope {
+   MonotonicArena* previous;
+
+   ArenaScope (const ArenaScope&);
+   ArenaScope& operator= (const ArenaScope&);
+
+public:
+   explicit ArenaScope (MonotonicArena& arena)
+   : previous(MonotonicArena::current()) {
+      MonotonicArena::current() = &arena;
+   }
+
+   ~ArenaScope () {
+      MonotonicArena::current() = previous;
+   }
+};
+
+/** Allocator drawing from the current arena.
+    Each block starts with a header, Alignment bytes long, recording where
+    the storage comes from.  ublas storage arrays do not exchange their
+    allocators when they are swapped, so the origin has to be stored with
+    the block rather than in the allocator.
+*/
+
+template <class T, std::size_t Alignment = 64>
+class arena_allocator {
+public:
+   typedef T value_type;
+   typedef T* pointer;
+   typedef const T* const_pointer;
+   typedef T& reference;
+   typedef const T& const_reference;
+   typedef std::size_t size_type;
+   typedef std::ptrdiff_t difference_type;
+
+   template <class U>
+   struct rebind {
+      typedef arena_allocator<U, Alignment> other;
+   };
+
+   arena_allocator () {}
+   template <class U>
+   arena_allocator (const arena_allocator<U, Alignment>&) {}
+
+   pointer address (reference x) const { return &x; }
+   const_pointer address (const_reference x) const { return &x; }
+
+   pointer allocate (size_type n, const void* /*hint*/ = 0) {
+      if (n > max_size()) {
+         throw std::bad_alloc();
+      }
+      std::size_t bytes = n * sizeof(T) + Alignment;
+      MonotonicArena* arena = MonotonicArena::current();
+      char* block;
+      if (arena != 0) {
+         block = static_cast<char*>(arena->allocate(bytes, Alignment));
+      } else {
+         block = static_cast<char*>(detail::aligned_malloc(bytes, Alignment));
+      }
+      char* p = block + Alignment;
+      reinterpret_cast<MonotonicArena**>(p)[-1] = arena;
+      reinterpret_cast<void**>(p)[-2] = block;
+      return reinterpret_cast<pointer>(p);
+   }
+
+   void deallocate (pointer p, size_type /*n*/) {
+      if (p == 0) {
+         return;
+      }
+      // Arena storage is released in bulk by the arena itself.
+      if (reinterpret_cast<MonotonicArena**>(p)[-1] == 0) {
+         detail::aligned_free(reinterpret_cast<void**>(p)[-2]);
+      }
+   }
+
+   size_type max_size () const {
+      return ((std::numeric_limits<size_type>::max)() - 2 * Alignment) / sizeof(T);
+   }
+
+   void construct (pointer p, const T& value) {
+      new (static_cast<void*>(p)) T(value);
+   }
+
+   void destroy (pointer p) {
+      p->~T();
+   }
+
+private:
+   // The header must be able to hold two pointers.
+   typedef char header_fits[(Alignment >= 2 * sizeof(void*)) ? 1 : -1];
+};
+
+template <class T, class U, std::size_t Alignment>
+inline bool operator== (const arena_allocator<T, Alignment>&, const arena_allocator<U, Alignment>&) {
+   return true;
+}
+
+template <class T, class U, std::size_t Alignment>
+inline bool operator!= (const arena_allocator<T, Alignment>&, const arena_allocator<U, Alignment>&) {
+   return false;
+}
+
+}}}
+#endif
@@ -11,17 +11,26 @@
 #ifndef _BOOST_UBLAS_CHOLESKYDECOMPOSITION_
 #define _BOOST_UBLAS_CHOLESKYDECOMPOSITION_
 
+#include <algorithm>
+#include <cmath>
 #include <boost/numeric/ublas/vector.hpp>
 #include <boost/numeric/ublas/matrix.hpp>
 #include <boost/numeric/ublas/exception.hpp>
 #include <boost/numeric/ublas/matrix_proxy.hpp>
+#include "SimdKernels.hpp"
+#include "ConditionEstimate.hpp"
+#include "Instrumentation.hpp"
+#include "Serialization.hpp"
 
 namespace boost { namespace numeric { namespace ublas {
     
+// T: type, F: layout (row_major/column_major),
+// ST: storage array of the internal matrices and vectors (e.g. unbounded_array<T, aligned_allocator<T> >)
+template<class T, class F = row_major, class ST = unbounded_array<T> >
 class CholeskyDecomposition {
 
-    typedef vector<double> Vector;
-    typedef matrix<double> Matrix;
+    typedef vector<T,ST> Vector;
+    typedef matrix<T,F,ST> Matrix;
 
 /* ------------------------
    Class variables
@@ -42,11 +51,25 @@ class CholeskyDecomposition {
    */
    bool isspd;
 
+   /** 1-norm of A, for rcond() (estimated for a loaded decomposition).
+   */
+   T anorm;
+
+   /** Instrumentation counters of the last compute().
+   */
+   instrumentation::Stats stats;
+
 public:
 /* ------------------------
    Constructor
  * ------------------------ */
 
+   /** Construct an empty decomposition, to be computed with compute()
+       or read with load().
+   */
+
+   CholeskyDecomposition () : n(0), isspd(false), anorm(0) {}
+
    /** Cholesky algorithm for symmetric and positive definite matrix.
        Structure to access L and isspd flag.
    @param  Arg   Square, symmetric matrix.
@@ -54,6 +77,15 @@ public:
 
    CholeskyDecomposition (const Matrix& A);
 
+   /** Recompute the decomposition for a new matrix.
+       The storage of the previous decomposition is reused when the
+       dimensions of A match, so that refactoring same-sized matrices
+       does not allocate.
+   @param  A   Square, symmetric matrix.
+   */
+
+   void compute (const Matrix& A);
+
 /* ------------------------
    Temporary, experimental code.
  * ------------------------ *\
@@ -111,6 +143,23 @@ public:
       return L;
    }
 
+   /** Return the instrumentation counters of the last compute()
+       (zero unless compiled with UBLASJAMA_INSTRUMENTATION).
+   @return     stats
+   */
+
+   const instrumentation::Stats& getStats () const {
+      return stats;
+   }
+
+   /** Reciprocal condition number in the 1-norm, estimated in O(n^2)
+       from L (see ConditionEstimate.hpp)
+   @return     about 1/(norm1(A)*norm1(inverse(A))), 0 if A is not
+               positive definite.
+   */
+
+   T rcond () const;
+
    /** Solve A*X = B
    @param  B   A Matrix with as many rows as A and any number of columns.
    @return     X so that L*L'*X = B
@@ -119,7 +168,449 @@ public:
    */
 
    Matrix solve (const Matrix& B) const;
+
+   /** Solve A*x = b
+   @param  b   A vector with as many elements as A has rows.
+   @return     x so that L*L'*x = b
+   @exception  bad_size  Matrix row dimensions must agree.
+   @exception  singular  Matrix is not symmetric positive definite.
+   */
+
+   Vector solve (const Vector& b) const;
+
+   /** Solve A*x = b in place, with contiguous triangular solves.
+   @param  b   Right hand side, replaced by x.
+   @exception  bad_size  Matrix row dimensions must agree.
+   @exception  singular  Matrix is not symmetric positive definite.
+   */
+
+   void solveInPlace (Vector& b) const;
+
+   /** Solve A*X = B in place: the rows of B (row major) or its columns
+       (column major) are updated with contiguous kernels.
+   @param  B   Right hand sides, replaced by X.
+   @exception  bad_size  Matrix row dimensions must agree.
+   @exception  singular  Matrix is not symmetric positive definite.
+   */
+
+   void solveInPlace (Matrix& B) const;
+
+   /** Write the decomposition to a binary stream (see Serialization.hpp).
+   @param os   Output stream, opened in binary mode.
+   @param alignment  Alignment of the matrix elements (0: none;
+                     serialization::pageAlignment for a file to be mapped).
+   */
+
+   void save (std::ostream& os, std::size_t alignment = 0) const;
+
+   /** Replace the decomposition by one written by save().
+   @param is   Input stream, opened in binary mode.
+   @exception  external_logic  Not a Cholesky decomposition of this scalar type, or truncated.
+   */
+
+   void load (std::istream& is);
+
+   /** Replace the decomposition by one saved at the start of a mapped
+       file, binding its matrices to the file if ST is mapped_array.
+   @param file  Mapped file (see MappedStorage.hpp).
+   @exception  external_logic  As load(is).
+   */
+
+   void load (const MappedFile& file);
+
+private:
+   void restore (serialization::Reader<T,F>& in);
+
+   // x = inv(L)*x and x = inv(L')*x, for a contiguous x.
+   void lowerSolve (T* x) const;
+   void transposeSolve (T* x) const;
+
+   // x = L*x and x = L'*x.
+   void lowerMultiply (T* x) const;
+   void transposeMultiply (T* x) const;
 };
 
+    
+/* ------------------------
+   Constructor
+ * ------------------------ */
+
+   /** Cholesky algorithm for symmetric and positive definite matrix.
+       Structure to access L and isspd flag.
+   @param  Arg   Square, symmetric matrix.
+   */
+
+template<class T, class F, class ST>
+CholeskyDecomposition<T,F,ST>::CholeskyDecomposition (const Matrix& A) {
+      compute(A);
+   }
+
+   /** Recompute the decomposition for a new matrix.
+   @param  A   Square, symmetric matrix.
+   */
+
+template<class T, class F, class ST>
+void CholeskyDecomposition<T,F,ST>::compute (const Matrix& A) {
+
+      stats.clear();
+      instrumentation::PhaseTimer phase(stats, instrumentation::CholeskyFactor);
+      const double storage = instrumentation::storageBytes(L);
+
+     // Initialize.
+      n = A.size1();
+      // Only reallocates if the dimension changes (every element is set below).
+      L.resize(n,n,false);
+      phase.allocated(storage, instrumentation::storageBytes(L));
+      isspd = ((int)A.size2() == n);
+      // Main loop.  The column sums of |A|, for rcond(), are accumulated
+      // from the elements read by the symmetry check: the sum of column
+      // k < n-1 in L(0,k+1), above the diagonal, until it is complete.
+      anorm = 0.0;
+      const int rs = kernels::rowStride(L);
+      for (int j = 0; j < n; j++) {
+         T d = 0.0;
+         T colsum = std::abs(A(j,j));
+         for (int k = 0; k < j; k++) {
+            T s = kernels::dot(k, kernels::address(L,k,0), rs, kernels::address(L,j,0), rs);
+            L(j,k) = s = (A(j,k) - s)/L(k,k);
+            d = d + s*s;
+            isspd = isspd && (A(k,j) == A(j,k)); 
+            colsum += std::abs(A(k,j));
+            L(0,k+1) += std::abs(A(j,k));
+         }
+         d = A(j,j) - d;
+         isspd = isspd && (d > 0.0);
+         L(j,j) = std::sqrt(std::max(d,T(0)));
+         for (int k = j+1; k < n; k++) {
+            L(j,k) = 0.0;
+         }
+         if (j < n-1) {
+            L(0,j+1) = colsum;
+         } else {
+            anorm = std::max(anorm, colsum);
+         }
+
+         // Dot products of k terms, and 4 flops per element of row j.
+         phase.iterations();
+         phase.flops(double(j)*(j-1) + 4.0*j + 2);
+      }
+      for (int k = 1; k < n; k++) {
+         anorm = std::max(anorm, L(0,k));
+         L(0,k) = 0.0;
+      }
+   }
+
+/* ------------------------
+   Temporary, experimental code.
+ * ------------------------ *\
+
+   \** Right Triangular Cholesky Decomposition.
+   <P>
+   For a symmetric, positive definite matrix A, the Right Cholesky
+   decomposition is an upper triangular matrix R so that A = R'*R.
+   This constructor computes R with the Fortran inspired column oriented
+   algorithm used in LINPACK and MATLAB.  In Java, we suspect a row oriented,
+   lower triangular decomposition is faster.  We have temporarily included
+   this constructor here until timing experiments confirm this suspicion.
+   *\
+
+   \** Array for internal storage of right triangular decomposition. **\
+   private transient double(,) R;
+
+   \** Cholesky algorithm for symmetric and positive definite matrix.
+   @param  A           Square, symmetric matrix.
+   @param  rightflag   Actual value ignored.
+   @return             Structure to access R and isspd flag.
+   *\
+
+   CholeskyDecomposition::CholeskyDecomposition (Matrix Arg, int rightflag) {
+      // Initialize.
+      double(,) A = Arg.getArray();
+      n = Arg.size2();
+      R = new double(n,n);
+      isspd = (Arg.size2() == n);
+      // Main loop.
+      for (int j = 0; j < n; j++) {
+         T d = 0.0;
+         for (int k = 0; k < j; k++) {
+            T s = A(k,j);
+            for (int i = 0; i < k; i++) {
+               s = s - R(i,k)*R(i,j);
+            }
+            R(k,j) = s = s/R(k,k);
+            d = d + s*s;
+            isspd = isspd && (A(k,j) == A(j,k)); 
+         }
+         d = A(j,j) - d;
+         isspd = isspd && (d > 0.0);
+         R(j,j) = std::sqrt(std::max(d,0.0));
+         for (int k = j+1; k < n; k++) {
+            R(k,j) = 0.0;
+         }
+      }
+   }
+
+   \** Return upper triangular factor.
+   @return     R
+   *\
+
+   public Matrix getR () {
+      return new Matrix(R,n,n);
+   }
+
+\* ------------------------
+   End of temporary code.
+ * ------------------------ */
+
+/* ------------------------
+   Public Methods
+ * ------------------------ */
+
+   /** Solve A*X = B
+   @param  B   A Matrix with as many rows as A and any number of columns.
+   @return     X so that L*L'*X = B
+   @exception  bad_size  Matrix row dimensions must agree.
+   @exception  singular  Matrix is not symmetric positive definite.
+   */
+
+template<class T, class F, class ST>
+typename CholeskyDecomposition<T,F,ST>::Matrix CholeskyDecomposition<T,F,ST>::solve (const Matrix& B) const {
+      BOOST_UBLAS_CHECK((int)B.size1() == n, bad_size("Matrix row dimensions must agree."));
+      BOOST_UBLAS_CHECK((int)B.size1() == n, singular("Matrix is not symmetric positive definite."));
+
+      // Copy right hand side.
+      Matrix X(B);
+      int nx = B.size2();
+
+	      // Solve L*Y = B;
+	      for (int k = 0; k < n; k++) {
+	        for (int j = 0; j < nx; j++) {
+	           for (int i = 0; i < k ; i++) {
+	               X(k,j) -= X(i,j)*L(k,i);
+	           }
+	           X(k,j) /= L(k,k);
+	        }
+	      }
+	
+	      // Solve L'*X = Y;
+	      for (int k = n-1; k >= 0; k--) {
+	        for (int j = 0; j < nx; j++) {
+	           for (int i = k+1; i < n ; i++) {
+	               X(k,j) -= X(i,j)*L(i,k);
+	           }
+	           X(k,j) /= L(k,k);
+	        }
+	      }
+      
+      
+      return X;
+   }
+
+   /** Solve A*x = b
+   @param  b   A vector with as many elements as A has rows.
+   @return     x so that L*L'*x = b
+   */
+
+template<class T, class F, class ST>
+typename CholeskyDecomposition<T,F,ST>::Vector CholeskyDecomposition<T,F,ST>::solve (const Vector& b) const {
+      Vector x(b);
+      solveInPlace(x);
+      return x;
+   }
+
+   /** Solve A*x = b in place.
+   @param  b   Right hand side, replaced by x.
+   */
+
+template<class T, class F, class ST>
+void CholeskyDecomposition<T,F,ST>::solveInPlace (Vector& b) const {
+      BOOST_UBLAS_CHECK((int)b.size() == n, bad_size("Matrix row dimensions must agree."));
+      BOOST_UBLAS_CHECK(isspd, singular("Matrix is not symmetric positive definite."));
+      if (n == 0) {
+         return;
+      }
+      lowerSolve(&b(0));
+      transposeSolve(&b(0));
+   }
+
+   /** Solve A*X = B in place.
+   @param  B   Right hand sides, replaced by X.
+   */
+
+template<class T, class F, class ST>
+void CholeskyDecomposition<T,F,ST>::solveInPlace (Matrix& B) const {
+      BOOST_UBLAS_CHECK((int)B.size1() == n, bad_size("Matrix row dimensions must agree."));
+      BOOST_UBLAS_CHECK(isspd, singular("Matrix is not symmetric positive definite."));
+      const int nx = B.size2();
+      if (n == 0 || nx == 0) {
+         return;
+      }
+      if (kernels::rowStride(B) == 1) {
+         // Solve L*Y = B, each row of Y from the rows above it (gemv).
+         for (int k = 0; k < n; k++) {
+            T* x = kernels::address(B,k,0);
+            kernels::subtractProduct(nx, k, kernels::address(B,0,0), nx, kernels::address(L,k,0), x);
+            for (int j = 0; j < nx; j++) {
+               x[j] /= L(k,k);
+            }
+         }
+         // Solve L'*X = Y, each row of X being subtracted from the rows above it.
+         for (int k = n-1; k >= 0; k--) {
+            T* x = kernels::address(B,k,0);
+            for (int j = 0; j < nx; j++) {
+               x[j] /= L(k,k);
+            }
+            for (int i = 0; i < k; i++) {
+               kernels::axpy(nx, -L(k,i), x, 1, kernels::address(B,i,0), 1);
+            }
+         }
+      } else {
+         for (int j = 0; j < nx; j++) {
+            lowerSolve(kernels::address(B,0,j));
+            transposeSolve(kernels::address(B,0,j));
+         }
+      }
+   }
+
+   // x = inv(L)*x, by rows or by columns of L.
+
+template<class T, class F, class ST>
+void CholeskyDecomposition<T,F,ST>::lowerSolve (T* x) const {
+      if (kernels::rowStride(L) == 1) {
+         for (int k = 0; k < n; k++) {
+            x[k] = (x[k] - kernels::dot(k, kernels::address(L,k,0), 1, x, 1))/L(k,k);
+         }
+      } else {
+         for (int k = 0; k < n; k++) {
+            x[k] /= L(k,k);
+            kernels::axpy(n-k-1, -x[k], kernels::address(L,k+1,k), 1, x+k+1, 1);
+         }
+      }
+   }
+
+   // x = inv(L')*x.
+
+template<class T, class F, class ST>
+void CholeskyDecomposition<T,F,ST>::transposeSolve (T* x) const {
+      if (kernels::rowStride(L) == 1) {
+         for (int k = n-1; k >= 0; k--) {
+            x[k] /= L(k,k);
+            kernels::axpy(k, -x[k], kernels::address(L,k,0), 1, x, 1);
+         }
+      } else {
+         for (int k = n-1; k >= 0; k--) {
+            x[k] = (x[k] - kernels::dot(n-k-1, kernels::address(L,k+1,k), 1, x+k+1, 1))/L(k,k);
+         }
+      }
+   }
+
+   // x = L*x.
+
+template<class T, class F, class ST>
+void CholeskyDecomposition<T,F,ST>::lowerMultiply (T* x) const {
+      if (kernels::rowStride(L) == 1) {
+         for (int i = n-1; i >= 0; i--) {
+            x[i] = kernels::dot(i+1, kernels::address(L,i,0), 1, x, 1);
+         }
+      } else {
+         for (int k = n-1; k >= 0; k--) {
+            kernels::axpy(n-k-1, x[k], kernels::address(L,k+1,k), 1, x+k+1, 1);
+            x[k] *= L(k,k);
+         }
+      }
+   }
+
+   // x = L'*x.
+
+template<class T, class F, class ST>
+void CholeskyDecomposition<T,F,ST>::transposeMultiply (T* x) const {
+      if (kernels::rowStride(L) == 1) {
+         for (int k = 0; k < n; k++) {
+            kernels::axpy(k, x[k], kernels::address(L,k,0), 1, x, 1);
+            x[k] *= L(k,k);
+         }
+      } else {
+         for (int i = 0; i < n; i++) {
+            x[i] = kernels::dot(n-i, kernels::address(L,i,i), 1, x+i, 1);
+         }
+      }
+   }
+
+   /** Reciprocal condition number in the 1-norm, as LAPACK's dpocon.
+   @return     1/(norm1(A)*estimate of norm1(inverse(A))).
+   */
+
+template<class T, class F, class ST>
+T CholeskyDecomposition<T,F,ST>::rcond () const {
+      if (n == 0) {
+         return 1.0;
+      }
+      if (anorm == 0.0 || !isspd) {
+         return 0.0;
+      }
+      // inv(A) is symmetric: the same solves give its products with x and x'.
+      auto apply = [this] (T* x) { lowerSolve(x); transposeSolve(x); };
+      T ainvnorm = condition::normEstimate<T>(n, apply, apply);
+      return ainvnorm == 0.0 ? T(0) : (1/ainvnorm)/anorm;
+   }
+
+   /** Write the decomposition to a binary stream.
+   @param os   Output stream, opened in binary mode.
+   */
+
+template<class T, class F, class ST>
+void CholeskyDecomposition<T,F,ST>::save (std::ostream& os, std::size_t alignment) const {
+      serialization::Writer<T,F> out(os, serialization::Cholesky, alignment);
+      out.integer(n);
+      out.integer(isspd);
+      out.write(L);
+   }
+
+   /** Replace the decomposition by one written by save().
+   @param is   Input stream, opened in binary mode.
+   */
+
+template<class T, class F, class ST>
+void CholeskyDecomposition<T,F,ST>::load (std::istream& is) {
+      serialization::Reader<T,F> in(is, serialization::Cholesky);
+      restore(in);
+   }
+
+   /** Replace the decomposition by one saved at the start of a mapped file.
+   @param file  Mapped file.
+   */
+
+template<class T, class F, class ST>
+void CholeskyDecomposition<T,F,ST>::load (const MappedFile& file) {
+      serialization::Reader<T,F> in(file, serialization::Cholesky);
+      restore(in);
+   }
+
+   // Read the members of the decomposition.
+
+template<class T, class F, class ST>
+void CholeskyDecomposition<T,F,ST>::restore (serialization::Reader<T,F>& in) {
+      stats.clear();
+      n = in.size();
+      isspd = in.integer() != 0;
+      in.read(L);
+      if ((int) L.size1() != n || (int) L.size2() != n) {
+         external_logic("serialization: inconsistent Cholesky decomposition").raise();
+      }
+
+      // The norm of A is not saved: estimate it from products with L.
+      auto apply = [this] (T* x) { transposeMultiply(x); lowerMultiply(x); };
+      anorm = condition::normEstimate<T>(n, apply, apply);
+   }
+
+// The common instantiations are prebuilt in libublasJama.a; define
+// UBLASJAMA_NO_EXTERN_TEMPLATES to use this header without the library.
+#ifndef UBLASJAMA_NO_EXTERN_TEMPLATES
+extern template class CholeskyDecomposition<float>;
+extern template class CholeskyDecomposition<double>;
+extern template class CholeskyDecomposition<float,column_major>;
+extern template class CholeskyDecomposition<double,column_major>;
+#endif
+
 }}}
 #endif
@@ -0,0 +1,137 @@
+   /** Iteration limits and convergence status of the iterative decompositions.
+   <P>
+   The QR iterations of EigenvalueDecomposition (tql2, hqr2) and of
+   SingularValueDecomposition stop when
+<pre>
+   - a single eigenvalue or singular value has taken more than
+     perValue iterations (0: 30*max(10,n), as the LAPACK limit),
+   - all the values together have taken more than total iterations (0: no limit),
+   - more than seconds have elapsed since the start of compute() (0: no limit),
+   - or the deadline has passed (if hasDeadline),
+</pre>
+   instead of iterating forever on a pathological input.  The decomposition
+   is then incomplete: getConvergence() reports why, and how many values
+   did not converge.  The limits are set with setIterationLimits() and
+   apply to the following calls of compute().
+   */
+
+#ifndef _BOOST_UBLAS_CONVERGENCE_
+#define _BOOST_UBLAS_CONVERGENCE_
+
+#include <algorithm>
+#include <chrono>
+
+namespace boost { namespace numeric { namespace ublas {
+
+struct IterationLimits {
+   typedef std::chrono::steady_clock Clock;
+
+   int perValue;
+   long total;
+   double seconds;
+   bool hasDeadline;
+   Clock::time_point deadline;
+
+   IterationLimits () : perValue(0), total(0), seconds(0), hasDeadline(false) {}
+
+   /** Limits with a deadline.
+   */
+
+   static IterationLimits until (Clock::time_point deadline) {
+      IterationLimits l;
+      l.hasDeadline = true;
+      l.deadline = deadline;
+      return l;
+   }
+};
+
+enum ConvergenceStatus {
+   Converged, PerValueLimitReached, TotalLimitReached, TimeLimitReached
+};
+
+/** Convergence of the last compute().
+*/
+
+struct ConvergenceInfo {
+   /** Why the iteration stopped.
+   */
+   ConvergenceStatus status;
+
+   /** Total iterations, and largest number of iterations of a single value.
+   */
+   long iterations;
+   int maxPerValue;
+
+   /** Exceptional (ad hoc) shifts applied to break a stall (hqr2 only).
+   */
+   long exceptionalShifts;
+
+   /** Number of values that had not converged when the iteration stopped.
+   */
+   int unconverged;
+
+   ConvergenceInfo () : status(Converged), iterations(0), maxPerValue(0), exceptionalShifts(0), unconverged(0) {}
+
+   bool converged () const {
+      return status == Converged;
+   }
+};
+
+/** Enforces the limits in an iteration over n values, updating the info.
+*/
+
+class IterationGuard {
+   typedef IterationLimits::Clock Clock;
+
+   ConvergenceInfo& info;
+   int perValue;
+   long total;
+   bool timed;
+   Clock::time_point end;
+
+public:
+   IterationGuard (const IterationLimits& limits, ConvergenceInfo& info, int n)
+      : info(info), perValue(limits.perValue > 0 ? limits.perValue : 30*std::max(10,n)),
+        total(limits.total), timed(limits.hasDeadline || limits.seconds > 0) {
+      info = ConvergenceInfo();
+      if (limits.seconds > 0) {
+         end = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(limits.seconds));
+         if (limits.hasDeadline && limits.deadline < end) {
+            end = limits.deadline;
+         }
+      } else if (limits.hasDeadline) {
+         end = limits.deadline;
+      }
+   }
+
+   /** Count an iteration, the iter-th of the current value.
+   @return     false if a limit is reached (the status is then set).
+   */
+
+   bool next (int iter) {
+      ++info.iterations;
+      info.maxPerValue = std::max(info.maxPerValue, iter);
+      if (iter > perValue) {
+         info.status = PerValueLimitReached;
+      } else if (total > 0 && info.iterations > total) {
+         info.status = TotalLimitReached;
+      } else if (timed && Clock::now() > end) {
+         info.status = TimeLimitReached;
+      }
+      return info.status == Converged;
+   }
+
+   void exceptionalShift () {
+      ++info.exceptionalShifts;
+   }
+
+   /** Stop with unconverged values.
+   */
+
+   void fail (int unconverged) {
+      info.unconverged = unconverged;
+   }
+};
+
+}}}
+#endif
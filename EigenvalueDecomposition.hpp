@@ -47,20 +47,27 @@
 #include <cmath>
 #include <limits>
 #include <complex>
+#include <vector>
 #include <boost/math/special_functions/hypot.hpp>
 #include <boost/numeric/ublas/vector.hpp>
 #include <boost/numeric/ublas/matrix.hpp>
 #include <boost/numeric/ublas/symmetric.hpp>
 #include <boost/numeric/ublas/exception.hpp>
 #include <boost/numeric/ublas/matrix_proxy.hpp>
+#include "SimdKernels.hpp"
+#include "Instrumentation.hpp"
+#include "Convergence.hpp"
+#include "Serialization.hpp"
+#include "Parallel.hpp"
 
 namespace boost { namespace numeric { namespace ublas {
-// T: type, TRI: type of triangular matrix (lower/upper), L: layout (row_major/column_major)
-template<class T, class L = row_major>
+// T: type, TRI: type of triangular matrix (lower/upper), L: layout (row_major/column_major),
+// ST: storage array of the internal matrices and vectors (e.g. unbounded_array<T, aligned_allocator<T> >)
+template<class T, class L = row_major, class ST = unbounded_array<T> >
 class EigenvalueDecomposition {
 
-    typedef vector<T> Vector;
-    typedef matrix<T,L> Matrix;
+    typedef vector<T,ST> Vector;
+    typedef matrix<T,L,ST> Matrix;
 
 /* ------------------------
    Class variables
@@ -96,31 +103,165 @@ class EigenvalueDecomposition {
    */
    Vector ort;
 
+   /** Balancing of the nonsymmetric algorithm: rows and columns outside
+       low..high isolate eigenvalues, scale holds the permutations (outside
+       low..high) and the scaling factors (inside).
+   */
+   bool balance;
+   int low, high;
+   Vector scale;
+
+   /** Blocking of the Hessenberg and tridiagonal reductions: panels of
+       blockSize columns while more than crossover columns remain, and
+       working storage for the panel (reflectors, Y = -A*V*T or the W of
+       the symmetric update, the product V'*A, T, and two columns).
+   */
+   int blockSize, crossover;
+   Vector work;
+
+   /** Compute the eigenvectors (symmetric matrices).
+   */
+   bool vectors;
+
+   /** Stop at the real Schur form (nonsymmetric matrices).
+   */
+   bool schurOnly;
+
+   /** Mode of the last compute(): eigenvectors in V, Schur form in H.
+       V keeps its storage without eigenvectors, for the next compute().
+   */
+   bool computedVectors, computedSchur;
+
+   /** Smallest matrix reduced to Schur form by the multishift iteration
+       (0: never), and its working storage (in work).
+   */
+   int multishiftMin;
+
+   /** Instrumentation counters of the last compute().
+   */
+   instrumentation::Stats stats;
+
+   /** Iteration limits of tql2 and hqr2, and convergence of the last compute().
+   */
+   IterationLimits limits;
+   ConvergenceInfo convergence;
+
 /* ------------------------
    Private Methods
  * ------------------------ */
 
    // Symmetric Householder reduction to tridiagonal form.
 
-   void tred2 ();
+   void tridiagonalize (instrumentation::PhaseTimer& phase);
+   void tred2 (instrumentation::PhaseTimer& phase);
+   void tridiagonalPanel (int p, int ib, instrumentation::PhaseTimer& phase);
 
    // Symmetric tridiagonal QL algorithm.
    
-   void tql2 ();
+   void tql2 (instrumentation::PhaseTimer& phase);
+
+   // Nonsymmetric balancing, and back transformation of the eigenvectors.
+
+   void balanc ();
+   void exchange (int j, int m);
+   void balbak ();
 
    // Nonsymmetric reduction to Hessenberg form.
 
-   void orthes ();
+   void orthes (instrumentation::PhaseTimer& phase);
+   void hessenbergPanel (int p, int ib, instrumentation::PhaseTimer& phase);
+
+   // Blocked reductions: storage, reflectors, and accumulation of the
+   // reflectors of a panel into V.
+
+   bool blocked () const {
+      return blockSize > 1 && n > crossover + blockSize;
+   }
+
+   int workSize () const {
+      return 3*n*blockSize + blockSize*blockSize + 2*blockSize;
+   }
+
+   static T householder (int len, T* x, int inc, T& beta);
+   void triangularFactor (int j, int m, T tau);
+   void accumulatePanel (const Matrix& R, int p, int ib, instrumentation::PhaseTimer& phase);
 
    // Nonsymmetric reduction from Hessenberg to real Schur form.
 
-   void hqr2 ();
+   void hqr2 (instrumentation::PhaseTimer& phase);
+
+   // Diagonal Schur form of a symmetric matrix, in Schur-only mode.
+
+   void diagonalSchurForm ();
+
+   // Parts updated by the QR iteration on a diagonal window of H: the
+   // rows rowBegin.. above the window and the columns ..colEnd-1 right of
+   // it, and rows zlo..zhi of the columns Z + (k-zoff)*ldz, k in the
+   // window, of the accumulated transformations.
+
+   struct Updates {
+      int rowBegin, colEnd;
+      T* Z;
+      int ldz, zlo, zhi, zoff;
+   };
+
+   int francis (int ilo, int ihi, const Updates& u, T norm, IterationGuard& guard, instrumentation::PhaseTimer& phase);
+   void splitPair (int n, T exshift, const Updates& u, instrumentation::PhaseTimer& phase);
+   static void pairEigenvalues (T a, T b, T c, T d, T* re, T* im);
+
+   // Multishift QR iteration with aggressive early deflation (LAPACK's
+   // dlaqr0, dlaqr3 and dlaqr5), for large matrices.
+
+   bool multishifted () const {
+      return multishiftMin > 0 && n >= multishiftMin;
+   }
+
+   static int shiftCount (int nh);
+
+   int windowMax () const {
+      int ns = n < 150 ? 10 : n < 3000 ? 64 : n < 6000 ? 128 : 256;
+      ns = std::min(ns, std::max(2, (n+6)/9));
+      return 3*ns + 4;
+   }
+
+   int multishiftWorkSize () const {
+      const int w = windowMax();
+      return 3*w*w + n*w + 3*n;
+   }
+
+   int multishift (T* Vcol, T norm, IterationGuard& guard, instrumentation::PhaseTimer& phase);
+   int selectShifts (int ktop, int kbot, int ns, bool exceptional, T* sr, T* si, int ls);
+   int earlyDeflation (int ktop, int kbot, int nw, T norm, T* Vcol, T* sr, T* si, int& ls, instrumentation::PhaseTimer& phase);
+   bool moveBlock (int ifst, int ilst, int wlo, int whi, T* Q, int ldq);
+   bool swapBlocks (int j1, int n1, int n2, int wlo, int whi, T* Q, int ldq);
+   void standardizePair (int j, int wlo, int whi, T* Q, int ldq);
+   static void sylvester (int n1, int n2, const T* D, T* X);
+   void reflectRows (int r0, int r1, int c0, int c1, const T* v, T tau);
+   void reflectColumns (int r0, int r1, int c0, int c1, const T* v, T tau);
+   void sweep (int ktop, int kbot, int ns, const T* sr, const T* si, T* Vcol, instrumentation::PhaseTimer& phase);
+   void applyWindow (int wtop, int w, const T* U, T* Vcol, instrumentation::PhaseTimer& phase);
+
+   // Bytes of the internal storage, for the instrumentation.
+
+   double storageBytes () const {
+      return instrumentation::storageBytes(d) + instrumentation::storageBytes(e)
+           + instrumentation::storageBytes(V) + instrumentation::storageBytes(H)
+           + instrumentation::storageBytes(ort) + instrumentation::storageBytes(scale)
+           + instrumentation::storageBytes(work);
+   }
 
 public:
 /* ------------------------
    Constructor
  * ------------------------ */
 
+   /** Construct an empty decomposition, to be configured with the set
+       methods and computed with compute().
+   */
+
+   EigenvalueDecomposition ()
+      : n(0), issymmetric(true), balance(true), low(0), high(-1), blockSize(32), crossover(128), vectors(true), schurOnly(false), computedVectors(true), computedSchur(false), multishiftMin(400) {}
+
    /** Check for symmetry, then construct the eigenvalue decomposition
    @param A    Square matrix
    @param force_symmetric If true, A is considered symmetric and only the upper triangular par of A is used
@@ -130,8 +271,22 @@ public:
    template <class E>
    EigenvalueDecomposition (const matrix_expression<E>& A, bool force_symmetric = false);
    
-   template <class TRI>
-   EigenvalueDecomposition (const symmetric_matrix<T,TRI,L>& A);
+   template <class TRI, class SA>
+   EigenvalueDecomposition (const symmetric_matrix<T,TRI,L,SA>& A);
+
+   /** Recompute the eigenvalue decomposition for a new matrix.
+       The storage of the previous decomposition is reused when the
+       dimension of A matches, so that decomposing same-sized matrices
+       does not allocate.
+   @param A    Square matrix
+   @param force_symmetric If true, A is considered symmetric and only the upper triangular par of A is used
+   */
+
+   template <class E>
+   void compute (const matrix_expression<E>& A, bool force_symmetric = false);
+
+   template <class TRI, class SA>
+   void compute (const symmetric_matrix<T,TRI,L,SA>& A);
 
 /* ------------------------
    Public Methods
@@ -149,7 +304,8 @@ public:
    */
 
    const Matrix& getV () const {
-      return V;
+      static const Matrix none;
+      return computedVectors ? V : none;
    }
 
    /** Return the real parts of the eigenvalues
@@ -175,6 +331,256 @@ public:
       return e;
    }
 
+   /** Return the instrumentation counters of the last compute()
+       (zero unless compiled with UBLASJAMA_INSTRUMENTATION).
+   @return     stats
+   */
+
+   const instrumentation::Stats& getStats () const {
+      return stats;
+   }
+
+   /** Set the iteration limits of the following calls of compute()
+       (see Convergence.hpp).
+   @param l    limits
+   */
+
+   void setIterationLimits (const IterationLimits& l) {
+      limits = l;
+   }
+
+   const IterationLimits& getIterationLimits () const {
+      return limits;
+   }
+
+   /** Balance nonsymmetric matrices in the following calls of compute()
+       (default).  Balancing permutes the rows and columns to isolate
+       eigenvalues, which hqr2 then does not iterate on, and scales them
+       by powers of 2 to equilibrate their norms, which speeds up the
+       convergence and improves the accuracy for badly scaled matrices.
+   @param b    If false, the matrix is reduced as is, as in Jama.
+   */
+
+   void setBalancing (bool b) {
+      balance = b;
+   }
+
+   /** Return the range low..high of the rows and columns left after the
+       permutations of the balancing (0..n-1 without balancing).
+   */
+
+   int getLow () const {
+      return low;
+   }
+
+   int getHigh () const {
+      return high;
+   }
+
+   /** Set the blocking of the Hessenberg and tridiagonal reductions in
+       the following calls of compute().  The reductions factor panels of
+       blockSize columns and apply each panel to the rest of the matrix,
+       and later to V, with matrix-matrix products split among
+       parallel::threads() threads (see Parallel.hpp), while more than
+       crossover columns remain; the last columns are reduced one at a
+       time.  Matrices of crossover+blockSize rows or less are reduced
+       as in Jama.  The default is 32 and 128.
+   @param blockSize  Columns per panel; 1 for the unblocked reduction.
+   @param crossover  Columns reduced one at a time.
+   */
+
+   void setBlocking (int blockSize, int crossover = 128) {
+      this->blockSize = std::max(1, blockSize);
+      this->crossover = std::max(0, crossover);
+   }
+
+   int getBlockSize () const {
+      return blockSize;
+   }
+
+   /** Compute the eigenvectors of symmetric matrices in the following
+       calls of compute() (default).  Without them, the orthogonal
+       transformations of the reduction are not accumulated and the QL
+       iteration only updates the eigenvalues, which takes a fraction of
+       the time; getV() then returns an empty matrix.  The eigenvectors
+       of nonsymmetric matrices are always computed.
+   @param b    If false, only the eigenvalues of symmetric matrices are computed.
+   */
+
+   void setEigenvectors (bool b) {
+      vectors = b;
+   }
+
+   /** Did the last compute() compute the eigenvectors?
+   */
+
+   bool hasEigenvectors () const {
+      return computedVectors;
+   }
+
+   /** Reduce nonsymmetric matrices of at least minSize rows (left by the
+       balancing) to Schur form with the multishift QR iteration, in the
+       following calls of compute().  Instead of the double shift steps of
+       Jama, each iteration deflates the converged eigenvalues of a window
+       at the bottom of the active block (aggressive early deflation) and
+       chases a chain of small bulges with the other eigenvalues of the
+       window as shifts, applying the transformations to the rest of the
+       matrix by blocks.  This takes far fewer iterations on large
+       matrices, and gives the same d, e and V.  The default is 400.
+   @param minSize  Smallest size of the multishift iteration; 0 to always use Jama's.
+   */
+
+   void setMultishift (int minSize) {
+      multishiftMin = std::max(0, minSize);
+   }
+
+   int getMultishift () const {
+      return multishiftMin;
+   }
+
+   /** Stop the following calls of compute() at the real Schur form
+       A = Z*T*Z' of nonsymmetric matrices, skipping the back
+       substitution of the eigenvectors: T is quasi upper triangular,
+       with the real eigenvalues on its diagonal and the complex pairs in
+       2-by-2 blocks, and Z is orthogonal.  The first k columns of Z span
+       the invariant subspace of the first k eigenvalues (not splitting a
+       pair).  To keep Z orthogonal, the balancing then only permutes, and
+       getV() returns Z instead of eigenvectors.  For symmetric matrices,
+       T is the diagonal of the eigenvalues and Z = V.
+   @param b    If true, compute the Schur form instead of the eigenvectors.
+   */
+
+   void setSchurOnly (bool b) {
+      schurOnly = b;
+   }
+
+   bool isSchurOnly () const {
+      return schurOnly;
+   }
+
+   /** Was the last compute() in Schur-only mode?
+   */
+
+   bool hasSchurForm () const {
+      return computedSchur;
+   }
+
+   /** Return the real Schur form T of the last compute() in Schur-only mode
+   @return     T
+   */
+
+   const Matrix& getSchurForm () const {
+      BOOST_UBLAS_CHECK(computedSchur, external_logic());
+      return H;
+   }
+
+   /** Return the Schur vectors Z of the last compute() in Schur-only mode
+   @return     Z
+   */
+
+   const Matrix& getSchurVectors () const {
+      BOOST_UBLAS_CHECK(computedSchur, external_logic());
+      return getV();
+   }
+
+   /** Reorder the Schur form of the last compute() in Schur-only mode so
+       that the selected eigenvalues lead its diagonal, updating T, Z and
+       the eigenvalues (LAPACK's dtrsen, without the condition numbers).
+       The first columns of Z then span the invariant subspace of the
+       selected eigenvalues, and the 2x2 blocks of T are in standard
+       form: equal diagonal elements, off-diagonal elements of opposite
+       signs.
+   @param select  select[j] selects d(j) + i*e(j); selecting either value
+                  of a complex pair selects both.
+   @return        Number of leading eigenvalues that are selected, smaller
+                  than the number selected if a swap was rejected as too
+                  ill-conditioned (the reordering then stops there).
+   */
+
+   int reorderSchur (const std::vector<bool>& select);
+
+   /** Complex eigenvectors, read from the real and imaginary parts
+       stored in V without copying: column j of the view is the
+       eigenvector of d(j) + i*e(j).  The view refers to the
+       decomposition, and follows its next compute().
+   */
+
+   class ComplexEigenvectors {
+      const Matrix& V;
+      const Vector& e;
+
+   public:
+      typedef std::complex<T> value_type;
+
+      ComplexEigenvectors (const Matrix& V, const Vector& e) : V(V), e(e) {}
+
+      int size1 () const {
+         return V.size1();
+      }
+
+      int size2 () const {
+         return V.size2();
+      }
+
+      /** Element i of eigenvector j.
+      */
+
+      value_type operator() (int i, int j) const {
+         if (e(j) > 0) {
+            return value_type(V(i,j), V(i,j+1));
+         } else if (e(j) < 0) {
+            return value_type(V(i,j-1), -V(i,j));
+         }
+         return value_type(V(i,j));
+      }
+
+      /** Copy eigenvector j into x (of size size1()).
+      */
+
+      template<class VC>
+      void column (int j, VC& x) const {
+         for (int i = 0; i < size1(); ++i) {
+            x(i) = (*this)(i,j);
+         }
+      }
+   };
+
+   /** Return the complex eigenvectors (not in Schur-only mode)
+   @return     view of the columns of V as complex vectors
+   */
+
+   ComplexEigenvectors getComplexEigenvectors () const {
+      BOOST_UBLAS_CHECK(!computedSchur, external_logic());
+      return ComplexEigenvectors(getV(), e);
+   }
+
+   /** Return eigenvalue j
+   @return     d(j) + i*e(j)
+   */
+
+   std::complex<T> getEigenvalue (int j) const {
+      return std::complex<T>(d(j), e(j));
+   }
+
+   /** Did the last compute() converge?
+       If not, the eigenvalues that had not converged are replaced by the
+       diagonal of the unfinished (tridiagonal or Schur) form, and V is
+       not an eigenvector matrix.
+   @return     true if all the eigenvalues converged.
+   */
+
+   bool isConverged () const {
+      return convergence.converged();
+   }
+
+   /** Return the convergence of the last compute()
+   @return     status, iteration counts and exceptional shifts
+   */
+
+   const ConvergenceInfo& getConvergence () const {
+      return convergence;
+   }
+
    /** Return the block diagonal eigenvalue matrix
    @param     D
    */
@@ -185,6 +591,35 @@ public:
       getD(D);
       return D;
    }
+
+   /** Write the decomposition to a binary stream (see Serialization.hpp):
+       the eigenvalues, V, the Schur form in Schur-only mode, and the
+       convergence.
+   @param os   Output stream, opened in binary mode.
+   @param alignment  Alignment of the matrix elements (0: none;
+                     serialization::pageAlignment for a file to be mapped).
+   */
+
+   void save (std::ostream& os, std::size_t alignment = 0) const;
+
+   /** Replace the decomposition by one written by save(), with its
+       symmetry, eigenvector and Schur-only settings.
+   @param is   Input stream, opened in binary mode.
+   @exception  external_logic  Not an eigenvalue decomposition of this scalar type, or truncated.
+   */
+
+   void load (std::istream& is);
+
+   /** Replace the decomposition by one saved at the start of a mapped
+       file, binding its matrices to the file if ST is mapped_array.
+   @param file  Mapped file (see MappedStorage.hpp).
+   @exception  external_logic  As load(is).
+   */
+
+   void load (const MappedFile& file);
+
+private:
+   void restore (serialization::Reader<T,L>& in);
 };
 
    /** sqrt(a^2 + b^2) without under/overflow. **/
@@ -211,8 +646,142 @@ public:
 
    // Symmetric Householder reduction to tridiagonal form.
 
-template<class T, class L>
-void EigenvalueDecomposition<T,L>::tred2 () {
+template<class T, class L, class ST>
+void EigenvalueDecomposition<T,L,ST>::tridiagonalize (instrumentation::PhaseTimer& phase) {
+
+      //  Small matrices are reduced by tred2, as in Jama.  Larger ones are
+      //  reduced from the first column, as in LAPACK's dsytrd with uplo =
+      //  'L': panels of blockSize columns (tridiagonalPanel) while more than
+      //  crossover columns remain, then one column at a time.  The
+      //  reflector of column k is stored below the subdiagonal of V, with
+      //  tau in ort(k+1); V then accumulates the reflectors if the
+      //  eigenvectors are wanted.  d and e are left as by tred2.
+
+      if (!blocked()) {
+         tred2(phase);
+         return;
+      }
+      int mb = 0;
+      for (; mb + blockSize < n - crossover; mb += blockSize) {
+         tridiagonalPanel(mb, blockSize, phase);
+      }
+      for (int p = mb; p < n-1; ++p) {
+         tridiagonalPanel(p, 1, phase);
+      }
+      d(n-1) = V(n-1,n-1);
+      e(0) = 0.0;
+      if (vectors) {
+         for (int p = n-2; p >= mb; --p) {
+            accumulatePanel(V, p, 1, phase);
+         }
+         for (int p = mb - blockSize; p >= 0; p -= blockSize) {
+            accumulatePanel(V, p, blockSize, phase);
+         }
+         for (int i = 0; i < n; ++i) {
+            V(i,0) = (i == 0) ? 1.0 : 0.0;
+         }
+      }
+
+      // Reverse the order of the rows and columns of the tridiagonal
+      // matrix, which tql2 then deflates from the same end as after tred2.
+
+      std::reverse(d.begin(), d.end());
+      std::reverse(e.begin()+1, e.end());
+      if (vectors) {
+         for (int j = 0; j < n/2; ++j) {
+            column(V,j).swap(column(V,n-1-j));
+         }
+      }
+   }
+
+   // Reduce the columns p..p+ib-1 of the lower triangle of V, and apply
+   // the panel to the rest of it.
+
+template<class T, class L, class ST>
+void EigenvalueDecomposition<T,L,ST>::tridiagonalPanel (int p, int ib, instrumentation::PhaseTimer& phase) {
+
+      //  This is LAPACK's dlatrd followed by the update of dsytrd.  With A
+      //  the matrix at the start of the panel, the reflectors 0..j-1 have
+      //  turned it into A - V*W' - W*V', with w_l = tau*A_l*v_l corrected
+      //  as in dsytd2 (A_l being the matrix before reflector l).  Column
+      //  k = p+j is updated with this rank 2j correction just before it is
+      //  reduced, and the rest of the lower triangle after the panel.
+
+      const int nb = blockSize;
+      T* Wp = &work(0);
+      T* Vp = Wp + n*nb;
+      T* z = Vp + 2*n*nb + nb*nb;
+      T* z2 = z + nb;
+      const int cs = kernels::columnStride(V);
+      std::fill(Vp, Vp + ib*n, T(0));
+      std::fill(Wp, Wp + ib*n, T(0));
+
+      for (int j = 0; j < ib; ++j) {
+         const int k = p+j;
+         const int len = n-k-1;
+         T* a = kernels::address(V,k,k);
+         for (int l = 0; l < j; ++l) {
+            kernels::axpy(len+1, -Wp[l*n+k], Vp+l*n+k, 1, a, cs);
+            kernels::axpy(len+1, -Vp[l*n+k], Wp+l*n+k, 1, a, cs);
+         }
+         d(k) = a[0];
+
+         // Householder transformation of column k.
+
+         T beta;
+         T tau = householder(len, a+cs, cs, beta);
+         e(k+1) = beta;
+         ort(k+1) = tau;
+         T* v = Vp+j*n;
+         v[k+1] = 1.0;
+         for (int i = k+2; i < n; ++i) {
+            v[i] = a[(i-k)*cs];
+         }
+
+         // w = tau*(A - V*W' - W*V')*v, then w -= (tau/2)*(w'*v)*v.
+
+         T* w = Wp+j*n;
+         if (tau != 0.0) {
+            kernels::symmetricProduct(V, k+1, n, v, w);
+            for (int l = 0; l < j; ++l) {
+               z[l] = kernels::dot(len, Wp+l*n+k+1, 1, v+k+1, 1);
+               z2[l] = kernels::dot(len, Vp+l*n+k+1, 1, v+k+1, 1);
+            }
+            for (int l = 0; l < j; ++l) {
+               kernels::axpy(len, -z[l], Vp+l*n+k+1, 1, w+k+1, 1);
+               kernels::axpy(len, -z2[l], Wp+l*n+k+1, 1, w+k+1, 1);
+            }
+            for (int i = k+1; i < n; ++i) {
+               w[i] *= tau;
+            }
+            T alpha = -0.5*tau*kernels::dot(len, w+k+1, 1, v+k+1, 1);
+            kernels::axpy(len, alpha, v+k+1, 1, w+k+1, 1);
+         }
+
+         phase.flops(8.0*(len+1)*j + 2.0*len*len + 8.0*len*j + 9.0*len);
+         phase.iterations();
+      }
+
+      // Rank 2*ib update of the rest of the lower triangle, by pairs of a
+      // short and a long line for an even split among the threads.
+
+      const int lo = p+ib;
+      const int count = n-lo;
+      parallel::parallelFor(0, (count+1)/2, 16, [&](int b, int e) {
+         for (int q = b; q < e; ++q) {
+            kernels::symmetricRank2kUpdate(V, lo, n, lo+q, lo+q+1, ib, Vp, n, Wp, n);
+            if (n-1-q != lo+q) {
+               kernels::symmetricRank2kUpdate(V, lo, n, n-1-q, n-q, ib, Vp, n, Wp, n);
+            }
+         }
+      });
+      phase.flops(2.0*ib*count*(count+1));
+   }
+
+   // Jama's reduction, from the last row.
+
+template<class T, class L, class ST>
+void EigenvalueDecomposition<T,L,ST>::tred2 (instrumentation::PhaseTimer& phase) {
 
    //  This is derived from the Algol procedures tred2 by
    //  Bowdler, Martin, Reinsch, and Wilkinson, Handbook for
@@ -291,7 +860,11 @@ void EigenvalueDecomposition<T,L>::tred2 () {
                d(j) = V(i-1,j);
                V(i,j) = 0.0;
             }
+
+            // Product with the lower triangle, and rank-2 update of it.
+            phase.flops(4.0*i*i + 10.0*i);
          }
+         phase.iterations();
          d(i) = h;
       }
    
@@ -301,7 +874,7 @@ void EigenvalueDecomposition<T,L>::tred2 () {
          V(n-1,i) = V(i,i);
          V(i,i) = 1.0;
          T h = d(i+1);
-         if (h != 0.0) {
+         if (h != 0.0 && vectors) {
             for (int k = 0; k <= i; ++k) {
                d(k) = V(k,i+1) / h;
             }
@@ -314,6 +887,7 @@ void EigenvalueDecomposition<T,L>::tred2 () {
                   V(k,j) -= g * d(k);
                }
             }
+            phase.flops(4.0*(i+1)*(i+1) + (i+1));
          }
          for (int k = 0; k <= i; ++k) {
             V(k,i+1) = 0.0;
@@ -329,8 +903,8 @@ void EigenvalueDecomposition<T,L>::tred2 () {
 
    // Symmetric tridiagonal QL algorithm.
    
-template<class T, class L>
-void EigenvalueDecomposition<T,L>::tql2 () {
+template<class T, class L, class ST>
+void EigenvalueDecomposition<T,L,ST>::tql2 (instrumentation::PhaseTimer& phase) {
 
    //  This is derived from the Algol procedures tql2, by
    //  Bowdler, Martin, Reinsch, and Wilkinson, Handbook for
@@ -341,11 +915,23 @@ void EigenvalueDecomposition<T,L>::tql2 () {
          e(i-1) = e(i);
       }
       e(n-1) = 0.0;
+
+      // The rotations are applied to columns of V, which are made
+      // contiguous by transposing a row-major V in the meantime:
+      // column j of V then starts at Vcol + j*n in both layouts.
+
+      const bool rowmajor = vectors && kernels::rowStride(V) == 1 && n > 1;
+      T* Vcol = V.data().begin();
+      if (rowmajor) {
+         kernels::transpose(n, Vcol);
+      }
    
       T f = 0.0;
       T tst1 = 0.0;
       T eps = std::numeric_limits<T>::epsilon();
-      for (int l = 0; l < n; ++l) {
+      IterationGuard guard(limits, convergence, n);
+      bool stopped = false;
+      for (int l = 0; l < n && !stopped; ++l) {
 
          // Find small subdiagonal element
    
@@ -364,7 +950,13 @@ void EigenvalueDecomposition<T,L>::tql2 () {
          if (m > l) {
             int iter = 0;
             do {
-               ++iter;  // (Could check iteration count here.)
+               ++iter;
+               if (!guard.next(iter)) {
+                  guard.fail(n-l);
+                  stopped = true;
+                  break;
+               }
+               phase.iterations();
    
                // Compute implicit shift
    
@@ -407,27 +999,38 @@ void EigenvalueDecomposition<T,L>::tql2 () {
    
                   // Accumulate transformation.
    
-                  for (int k = 0; k < n; ++k) {
-                     h = V(k,i+1);
-                     V(k,i+1) = s * V(k,i) + c * h;
-                     V(k,i) = c * V(k,i) - s * h;
+                  if (vectors) {
+                     kernels::rot(n, Vcol + (i+1)*n, 1, Vcol + i*n, 1, c, s);
                   }
                }
                p = -s * s2 * c3 * el1 * e(l) / dl1;
                e(l) = s * p;
                d(l) = c * p;
+
+               // Shift, and a rotation of V per step of the transformation.
+               phase.flops((n-l) + 15 + (m-l)*((vectors ? 6.0*n : 0.0) + 20));
    
                // Check for convergence.
    
             } while (std::abs(e(l)) > eps*tst1);
          }
-         d(l) += f;
-         e(l) = 0.0;
+         if (stopped) {
+
+            // Report the diagonal of the unfinished tridiagonal form.
+
+            for (int i = l; i < n; ++i) {
+               d(i) += f;
+               e(i) = 0.0;
+            }
+         } else {
+            d(l) += f;
+            e(l) = 0.0;
+         }
       }
      
       // Sort eigenvalues and corresponding vectors.
    
-      for (int i = 0; i < n-1; ++i) {
+      for (int i = 0; i < n-1 && !stopped; ++i) {
          int k = i;
          T p = d(i);
          for (int j = i+1; j < n; ++j) {
@@ -439,61 +1042,223 @@ void EigenvalueDecomposition<T,L>::tql2 () {
          if (k != i) {
             d(k) = d(i);
             d(i) = p;
-            for (int j = 0; j < n; ++j) {
-               p = V(j,i);
-               V(j,i) = V(j,k);
-               V(j,k) = p;
+            if (vectors) {
+               std::swap_ranges(Vcol + i*n, Vcol + (i+1)*n, Vcol + k*n);
             }
          }
       }
+
+      if (rowmajor) {
+         kernels::transpose(n, Vcol);
+      }
    }
 
-   // Nonsymmetric reduction to Hessenberg form.
+   // Nonsymmetric balancing.
 
-template<class T, class L>
-void EigenvalueDecomposition<T,L>::orthes () {
-   
-      //  This is derived from the Algol procedures orthes and ortran,
-      //  by Martin and Wilkinson, Handbook for Auto. Comp.,
-      //  Vol.ii-Linear Algebra, and the corresponding
-      //  Fortran subroutines in EISPACK.
-   
-      int low = 0;
-      int high = n-1;
-   
-      for (int m = low+1; m <= high-1; ++m) {
-   
-         // Scale column.
-   
-         T scale = 0.0;
-         for (int i = m; i <= high; ++i) {
-            scale += std::abs(H(i,m-1));
+template<class T, class L, class ST>
+void EigenvalueDecomposition<T,L,ST>::balanc () {
+
+      //  This is derived from the Algol procedure balance, by Parlett
+      //  and Reinsch, Handbook for Auto. Comp., Vol.ii-Linear Algebra,
+      //  and the corresponding Fortran subroutine in EISPACK.
+
+      low = 0;
+      high = n-1;
+      if (!balance) {
+         for (int i = 0; i < n; ++i) {
+            scale(i) = 1.0;
          }
-         if (scale != 0.0) {
-   
-            // Compute Householder transformation.
-   
-            T h = 0.0;
-            for (int i = high; i >= m; --i) {
-               ort(i) = H(i,m-1)/scale;
-               h += ort(i) * ort(i);
+         return;
+      }
+
+      // Search for rows isolating an eigenvalue and push them down.
+
+      bool found = true;
+      while (found && high > 0) {
+         found = false;
+         for (int j = high; j >= 0 && !found; --j) {
+            found = true;
+            for (int i = 0; i <= high && found; ++i) {
+               found = (i == j || H(j,i) == 0.0);
             }
-            T g = std::sqrt(h);
-            if (ort(m) > 0) {
-               g = -g;
+            if (found) {
+               exchange(j, high);
+               --high;
             }
-            h = h - ort(m) * g;
-            ort(m) = ort(m) - g;
-   
-            // Apply Householder similarity transformation
-            // H = (I-u*u'/h)*H*(I-u*u')/h)
-   
-            for (int j = m; j < n; ++j) {
-               T f = 0.0;
-               for (int i = high; i >= m; --i) {
-                  f += ort(i)*H(i,j);
+         }
+      }
+
+      // Search for columns isolating an eigenvalue and push them left.
+
+      found = true;
+      while (found && low < high) {
+         found = false;
+         for (int j = low; j <= high && !found; ++j) {
+            found = true;
+            for (int i = low; i <= high && found; ++i) {
+               found = (i == j || H(i,j) == 0.0);
+            }
+            if (found) {
+               exchange(j, low);
+               ++low;
+            }
+         }
+      }
+
+      // Balance the submatrix in rows low to high by powers of 2.
+
+      for (int i = low; i <= high; ++i) {
+         scale(i) = 1.0;
+      }
+      // Scaling would make the Schur vectors non-orthogonal.
+
+      const T radix = 2.0;
+      const T b2 = radix*radix;
+      bool noconv = !schurOnly;
+      while (noconv) {
+         noconv = false;
+         for (int i = low; i <= high; ++i) {
+            T c = 0.0;
+            T r = 0.0;
+            for (int j = low; j <= high; ++j) {
+               if (j != i) {
+                  c += std::abs(H(j,i));
+                  r += std::abs(H(i,j));
                }
-               f = f/h;
+            }
+
+            // Guard against zero c or r due to underflow.
+
+            if (c == 0.0 || r == 0.0) {
+               continue;
+            }
+            T g = r / radix;
+            T f = 1.0;
+            T s = c + r;
+            while (c < g) {
+               f *= radix;
+               c *= b2;
+            }
+            g = r * radix;
+            while (c >= g) {
+               f /= radix;
+               c /= b2;
+            }
+
+            // Now balance.
+
+            if ((c + r) / f < 0.95 * s) {
+               g = 1.0 / f;
+               scale(i) *= f;
+               noconv = true;
+               for (int j = low; j < n; ++j) {
+                  H(i,j) *= g;
+               }
+               for (int j = 0; j <= high; ++j) {
+                  H(j,i) *= f;
+               }
+            }
+         }
+      }
+   }
+
+   // Exchange row and column j with m in the active part of H, recording j in scale(m).
+
+template<class T, class L, class ST>
+void EigenvalueDecomposition<T,L,ST>::exchange (int j, int m) {
+      scale(m) = j;
+      if (j != m) {
+         for (int i = 0; i <= high; ++i) {
+            std::swap(H(i,j), H(i,m));
+         }
+         for (int i = low; i < n; ++i) {
+            std::swap(H(j,i), H(m,i));
+         }
+      }
+   }
+
+   // Back transformation of the eigenvectors of the balanced matrix.
+
+template<class T, class L, class ST>
+void EigenvalueDecomposition<T,L,ST>::balbak () {
+
+      //  This is derived from the Fortran subroutine balbak in EISPACK.
+
+      if (!balance) {
+         return;
+      }
+      for (int i = low; i <= high; ++i) {
+         row(V,i) *= scale(i);
+      }
+      for (int ii = 0; ii < n; ++ii) {
+         int i = ii;
+         if (i >= low && i <= high) {
+            continue;
+         }
+         if (i < low) {
+            i = low - 1 - ii;
+         }
+         int k = (int) scale(i);
+         if (k != i) {
+            row(V,i).swap(row(V,k));
+         }
+      }
+   }
+
+   // Nonsymmetric reduction to Hessenberg form.
+
+template<class T, class L, class ST>
+void EigenvalueDecomposition<T,L,ST>::orthes (instrumentation::PhaseTimer& phase) {
+   
+      //  This is derived from the Algol procedures orthes and ortran,
+      //  by Martin and Wilkinson, Handbook for Auto. Comp.,
+      //  Vol.ii-Linear Algebra, and the corresponding
+      //  Fortran subroutines in EISPACK.
+      //  The rows and columns outside low..high are those isolated by balanc.
+      //  While more than crossover columns remain, the reduction is blocked
+      //  as in LAPACK's dgehrd (hessenbergPanel); the columns low..mb-1 are then
+      //  reduced by panels, and their reflectors are stored as in LAPACK.
+
+      int mb = low;
+      if (blockSize > 1) {
+         for (; mb + blockSize < high - crossover; mb += blockSize) {
+            hessenbergPanel(mb, blockSize, phase);
+         }
+      }
+   
+      for (int m = mb+1; m <= high-1; ++m) {
+   
+         // Scale column.
+   
+         T scale = 0.0;
+         for (int i = m; i <= high; ++i) {
+            scale += std::abs(H(i,m-1));
+         }
+         if (scale != 0.0) {
+   
+            // Compute Householder transformation.
+   
+            T h = 0.0;
+            for (int i = high; i >= m; --i) {
+               ort(i) = H(i,m-1)/scale;
+               h += ort(i) * ort(i);
+            }
+            T g = std::sqrt(h);
+            if (ort(m) > 0) {
+               g = -g;
+            }
+            h = h - ort(m) * g;
+            ort(m) = ort(m) - g;
+   
+            // Apply Householder similarity transformation
+            // H = (I-u*u'/h)*H*(I-u*u')/h)
+   
+            for (int j = m; j < n; ++j) {
+               T f = 0.0;
+               for (int i = high; i >= m; --i) {
+                  f += ort(i)*H(i,j);
+               }
+               f = f/h;
                for (int i = m; i <= high; ++i) {
                   H(i,j) -= f*ort(i);
                }
@@ -511,7 +1276,12 @@ void EigenvalueDecomposition<T,L>::orthes () {
             }
             ort(m) = scale*ort(m);
             H(m,m-1) = scale*g;
+
+            // Reflector, and its application from the left and right.
+            const double len = high-m+1;
+            phase.flops(4.0*len + 4.0*len*(n-m) + 4.0*len*(high+1));
          }
+         phase.iterations();
       }
    
       // Accumulate transformations (Algol's ortran).
@@ -521,9 +1291,9 @@ void EigenvalueDecomposition<T,L>::orthes () {
       //      V(i,j) = (i == j ? 1.0 : 0.0);
       //   }
       //}
-      V = identity_matrix<T>(n);
+      noalias(V) = identity_matrix<T>(n);
 
-      for (int m = high-1; m >= low+1; --m) {
+      for (int m = high-1; m >= mb+1; --m) {
          if (H(m,m-1) != 0.0) {
             for (int i = m+1; i <= high; ++i) {
                ort(i) = H(i,m-1);
@@ -539,15 +1309,240 @@ void EigenvalueDecomposition<T,L>::orthes () {
                   V(i,j) += g * ort(i);
                }
             }
+            phase.flops(4.0*(high-m+1)*(high-m+1));
          }
       }
+      for (int p = mb - blockSize; p >= low; p -= blockSize) {
+         accumulatePanel(H, p, blockSize, phase);
+      }
+   }
+
+   // Reduce the columns p..p+ib-1 of H, and apply the panel to the rest of H.
+
+template<class T, class L, class ST>
+void EigenvalueDecomposition<T,L,ST>::hessenbergPanel (int p, int ib, instrumentation::PhaseTimer& phase) {
+
+      //  This is LAPACK's dlahr2 followed by the trailing update of dgehrd.
+      //  The reflector of column c = p+j is I - tau*v*v', with v(c+1) = 1
+      //  and v(c+2:high) stored below the subdiagonal of H, and tau in
+      //  ort(c+1).  The panel is Q = I - V*T*V', with V = [v_0 ... v_ib-1]
+      //  and T upper triangular.  With A the matrix at the start of the
+      //  panel and Y = -A*V*T, A*Q = A + Y*V', and the columns of the panel
+      //  are updated by the previous reflectors just before they are
+      //  reduced.  The rest of H then becomes Q'*(A + Y*V'), with
+      //  matrix-matrix products.
+
+      const int nb = blockSize;
+      T* Y = &work(0);
+      T* Vp = Y + n*nb;
+      T* W = Vp + n*nb;
+      T* Tm = W + n*nb;
+      T* z = Tm + nb*nb;
+      const int cs = kernels::columnStride(H);
+      const int len = high+1;
+      std::fill(Vp, Vp + ib*n, T(0));
+
+      for (int j = 0; j < ib; ++j) {
+         const int c = p+j;
+         const int m = c+1;
+         T* b = kernels::address(H,0,c);
+
+         // Right and left updates of column c by the reflectors 0..j-1.
+
+         for (int l = 0; l < j; ++l) {
+            kernels::axpy(len, Vp[l*n+c], Y+l*n, 1, b, cs);
+         }
+         for (int l = 0; l < j; ++l) {
+            z[l] = kernels::dot(high-p, Vp+l*n+p+1, 1, b+(p+1)*cs, cs);
+         }
+         for (int i = j-1; i >= 0; --i) {
+            T s = 0.0;
+            for (int l = 0; l <= i; ++l) {
+               s += Tm[l*nb+i]*z[l];
+            }
+            z[i] = s;
+         }
+         for (int l = 0; l < j; ++l) {
+            kernels::axpy(high-p, -z[l], Vp+l*n+p+1, 1, b+(p+1)*cs, cs);
+         }
+
+         // Householder transformation of column c.
+
+         T* v = Vp+j*n;
+         T beta;
+         T tau = householder(high-m+1, b+m*cs, cs, beta);
+         b[m*cs] = beta;
+         v[m] = 1.0;
+         for (int i = m+1; i <= high; ++i) {
+            v[i] = b[i*cs];
+         }
+         ort(m) = tau;
+         triangularFactor(j, m, tau);
+
+         // Y(:,j) = -tau*(A*v + Y(:,0:j-1)*z), with z = V(:,0:j-1)'*v
+         // left by triangularFactor.
+
+         T* y = Y+j*n;
+         std::fill(y, y+n, T(0));
+         if (cs == 1) {
+            for (int i = m; i <= high; ++i) {
+               kernels::axpy(len, -tau*v[i], kernels::address(H,0,i), 1, y, 1);
+            }
+         } else {
+            for (int r = 0; r <= high; ++r) {
+               y[r] = -tau*kernels::dot(high-m+1, kernels::address(H,r,m), 1, v+m, 1);
+            }
+         }
+         for (int l = 0; l < j; ++l) {
+            kernels::axpy(len, -tau*z[l], Y+l*n, 1, y, 1);
+         }
+
+         phase.flops(4.0*len*j + 4.0*(high-p)*j + 2.0*j*j + 5.0*(high-m+1)*(j+1) + 2.0*len*(high-m+1));
+         phase.iterations();
+      }
+
+      // Trailing update, split by columns: H(0:high,c) += Y*V(c,:)' for
+      // the columns c up to high, then H(p+1:high,c) -= V*T'*V'*H(p+1:high,c).
+
+      const int c0 = p+ib;
+      const int r0 = p+1;
+      parallel::parallelFor(c0, n, 32, [&](int b, int e) {
+         kernels::rankKUpdate(H, 0, len, b, std::min(e, len), ib, Y, n, Vp+b, n);
+         T* w = W+b;
+         const int nc = e-b;
+         kernels::transposeProduct(H, r0, len, b, e, ib, Vp+r0, n, w, n);
+         for (int i = ib-1; i >= 0; --i) {
+            T* wi = w+i*n;
+            const T d = -Tm[i*nb+i];
+            for (int k = 0; k < nc; ++k) {
+               wi[k] *= d;
+            }
+            for (int l = 0; l < i; ++l) {
+               kernels::axpy(nc, -Tm[l*nb+i], w+l*n, 1, wi, 1);
+            }
+         }
+         kernels::rankKUpdate(H, r0, len, b, e, ib, Vp+r0, n, w, n);
+      });
+      phase.flops(2.0*len*ib*std::max(len-c0, 0) + (4.0*(high-p) + ib)*ib*(n-c0));
+   }
+
+   // Accumulate into V the reflectors of the panel p..p+ib-1, stored in
+   // the columns p..p+ib-1 of R below the subdiagonal (R may be V): the
+   // columns p+1..p+ib of V become unit columns, then V = Q*V.  Applied
+   // from the last panel to the first one, starting from the identity
+   // (or from unit columns p+1..high), this forms Q as LAPACK's dorghr
+   // and dorgtr do.
+
+template<class T, class L, class ST>
+void EigenvalueDecomposition<T,L,ST>::accumulatePanel (const Matrix& R, int p, int ib, instrumentation::PhaseTimer& phase) {
+      const int nb = blockSize;
+      T* Vp = &work(0) + n*nb;
+      T* W = Vp + n*nb;
+      T* Tm = W + n*nb;
+      const int len = high+1;
+      std::fill(Vp, Vp + ib*n, T(0));
+      for (int j = 0; j < ib; ++j) {
+         const int m = p+j+1;
+         T* v = Vp+j*n;
+         v[m] = 1.0;
+         for (int i = m+1; i <= high; ++i) {
+            v[i] = R(i,m-1);
+         }
+         triangularFactor(j, m, ort(m));
+      }
+      // (element by element: assigning a unit_vector allocates temporaries)
+      for (int c = p+1; c <= p+ib; ++c) {
+         for (int i = 0; i < n; ++i) {
+            V(i,c) = (i == c) ? 1.0 : 0.0;
+         }
+      }
+
+      // Rows and columns p+1..high of V, with (I - V*T*V') applied as
+      // W = V'*V(p+1:high,c), W = -T*W, V(p+1:high,c) += V*W.
+
+      const int r0 = p+1;
+      parallel::parallelFor(r0, len, 32, [&](int b, int e) {
+         T* w = W+b;
+         const int nc = e-b;
+         kernels::transposeProduct(V, r0, len, b, e, ib, Vp+r0, n, w, n);
+         for (int i = 0; i < ib; ++i) {
+            T* wi = w+i*n;
+            const T d = -Tm[i*nb+i];
+            for (int k = 0; k < nc; ++k) {
+               wi[k] *= d;
+            }
+            for (int l = i+1; l < ib; ++l) {
+               kernels::axpy(nc, -Tm[i*nb+l], w+l*n, 1, wi, 1);
+            }
+         }
+         kernels::rankKUpdate(V, r0, len, b, e, ib, Vp+r0, n, w, n);
+      });
+      phase.flops((4.0*(high-p) + ib)*ib*(high-p));
+   }
+
+   // Householder reflector I - tau*v*v', with v(0) = 1, such that
+   // (I - tau*v*v')*x = beta*e_0 (LAPACK's dlarfg), scaled as in orthes;
+   // x(1:len-1) is overwritten by v(1:len-1).  tau is 0 if x(1:len-1) = 0.
+
+template<class T, class L, class ST>
+T EigenvalueDecomposition<T,L,ST>::householder (int len, T* x, int inc, T& beta) {
+      T scale = 0.0;
+      for (int i = 1; i < len; ++i) {
+         scale += std::abs(x[i*inc]);
+      }
+      if (scale == 0.0) {
+         beta = x[0];
+         return 0.0;
+      }
+      scale += std::abs(x[0]);
+      T h = 0.0;
+      for (int i = 0; i < len; ++i) {
+         T xi = x[i*inc]/scale;
+         h += xi * xi;
+      }
+      T f = x[0]/scale;
+      T g = std::sqrt(h);
+      if (f > 0) {
+         g = -g;
+      }
+      h -= f * g;
+      T u = f - g;
+      for (int i = 1; i < len; ++i) {
+         x[i*inc] = (x[i*inc]/scale)/u;
+      }
+      beta = scale*g;
+      return u*u/h;
+   }
+
+   // Column j of the triangular factor T of the panel (LAPACK's dlarft):
+   // T(0:j-1,j) = -tau*T(0:j-1,0:j-1)*V(:,0:j-1)'*v_j, T(j,j) = tau,
+   // with v_j nonzero from row m.
+
+template<class T, class L, class ST>
+void EigenvalueDecomposition<T,L,ST>::triangularFactor (int j, int m, T tau) {
+      const int nb = blockSize;
+      T* Vp = &work(0) + n*nb;
+      T* Tm = Vp + 2*n*nb;
+      T* z = Tm + nb*nb;
+      const T* v = Vp+j*n;
+      for (int l = 0; l < j; ++l) {
+         z[l] = kernels::dot(high-m+1, Vp+l*n+m, 1, v+m, 1);
+      }
+      for (int i = 0; i < j; ++i) {
+         T s = 0.0;
+         for (int l = i; l < j; ++l) {
+            s += Tm[i*nb+l]*z[l];
+         }
+         Tm[i*nb+j] = -tau*s;
+      }
+      Tm[j*nb+j] = tau;
    }
 
 
    // Nonsymmetric reduction from Hessenberg to real Schur form.
 
-template<class T, class L>
-void EigenvalueDecomposition<T,L>::hqr2 () {
+template<class T, class L, class ST>
+void EigenvalueDecomposition<T,L,ST>::hqr2 (instrumentation::PhaseTimer& phase) {
    
       //  This is derived from the Algol procedure hqr2,
       //  by Martin and Wilkinson, Handbook for Auto. Comp.,
@@ -557,12 +1552,18 @@ void EigenvalueDecomposition<T,L>::hqr2 () {
       // Initialize
    
       int nn = this->n;
-      int n = nn-1;
-      int low = 0;
-      int high = nn-1;
+      int n = high;
       T eps = std::numeric_limits<T>::epsilon();
-      T exshift = 0.0;
       T p=0,q=0,r=0,s=0,z=0,t,w,x,y;
+
+      // As in tql2, a row-major V is transposed while the transformations
+      // are accumulated, so that column j of V starts at Vcol + j*nn.
+
+      const bool rowmajor = kernels::rowStride(V) == 1 && nn > 1;
+      T* Vcol = V.data().begin();
+      if (rowmajor) {
+         kernels::transpose(nn, Vcol);
+      }
    
       // Store roots isolated by balanc and compute matrix norm
    
@@ -577,113 +1578,292 @@ void EigenvalueDecomposition<T,L>::hqr2 () {
          }
       }
    
+      // Reduce to real Schur form, with Jama's double shift iteration,
+      // or for large matrices the multishift iteration, and compute the
+      // eigenvalues.  Without convergence, the diagonal of the unfinished
+      // Schur form is reported in d and the vectors are not computed.
+
+      IterationGuard guard(limits, convergence, nn);
+      if (multishiftMin > 0 && high-low+1 >= multishiftMin) {
+         n = multishift(Vcol, norm, guard, phase);
+         const Updates all = { 0, nn, Vcol, nn, low, high, 0 };
+         for (int i = high; i > n; ) {
+            if (i-1 > n && H(i,i-1) != 0.0) {
+               splitPair(i, 0.0, all, phase);
+               i -= 2;
+            } else {
+               d(i) = H(i,i);
+               e(i) = 0.0;
+               --i;
+            }
+         }
+      } else {
+         const Updates all = { 0, nn, Vcol, nn, low, high, 0 };
+         n = francis(low, high, all, norm, guard, phase);
+      }
+
+      if (rowmajor) {
+         kernels::transpose(nn, Vcol);
+      }
+
+      // In Schur-only mode, clear what the reduction left below the
+      // sub-diagonal and stop at the Schur form.
+
+      if (schurOnly) {
+         for (int i = 2; i < nn; ++i) {
+            for (int j = 0; j < i-1; ++j) {
+               H(i,j) = 0.0;
+            }
+         }
+         return;
+      }
+      if (!convergence.converged()) {
+         return;
+      }
+
+      // Backsubstitute to find vectors of upper triangular form
+
+      if (norm == 0.0) {
+         return;
+      }
+   
+      for (n = nn-1; n >= 0; --n) {
+         p = d(n);
+         q = e(n);
+   
+         // Real vector
+   
+         if (q == 0) {
+            int l = n;
+            H(n,n) = 1.0;
+            for (int i = n-1; i >= 0; --i) {
+               w = H(i,i) - p;
+               r = 0.0;
+               for (int j = l; j <= n; ++j) {
+                  r = r + H(i,j) * H(j,n);
+               }
+               phase.flops(2.0*(n-l+1));
+               if (e(i) < 0.0) {
+                  z = w;
+                  s = r;
+               } else {
+                  l = i;
+                  if (e(i) == 0.0) {
+                     if (w != 0.0) {
+                        H(i,n) = -r / w;
+                     } else {
+                        H(i,n) = -r / (eps * norm);
+                     }
+   
+                  // Solve real equations
+   
+                  } else {
+                     x = H(i,i+1);
+                     y = H(i+1,i);
+                     q = (d(i) - p) * (d(i) - p) + e(i) * e(i);
+                     t = (x * s - z * r) / q;
+                     H(i,n) = t;
+                     if (std::abs(x) > std::abs(z)) {
+                        H(i+1,n) = (-r - w * t) / x;
+                     } else {
+                        H(i+1,n) = (-s - y * t) / z;
+                     }
+                  }
+   
+                  // Overflow control
+   
+                  t = std::abs(H(i,n));
+                  if ((eps * t) * t > 1) {
+                     for (int j = i; j <= n; ++j) {
+                        H(j,n) /= t;
+                     }
+                  }
+               }
+            }
+   
+         // Complex vector
+   
+         } else if (q < 0) {
+            int l = n-1;
+
+            // Last vector component imaginary so matrix is triangular
+   
+            if (std::abs(H(n,n-1)) > std::abs(H(n-1,n))) {
+               H(n-1,n-1) = q / H(n,n-1);
+               H(n-1,n) = -(H(n,n) - p) / H(n,n-1);
+            } else {
+               std::complex<T> ctmp(0.0,-H(n-1,n));
+               std::complex<T> ctmp2(H(n-1,n-1)-p,q);
+               ctmp /= ctmp2;
+               H(n-1,n-1) = ctmp.real();
+               H(n-1,n) = ctmp.imag();
+            }
+            H(n,n-1) = 0.0;
+            H(n,n) = 1.0;
+            for (int i = n-2; i >= 0; --i) {
+               T ra,sa,vr,vi;
+               ra = 0.0;
+               sa = 0.0;
+               for (int j = l; j <= n; ++j) {
+                  ra += H(i,j) * H(j,n-1);
+                  sa += H(i,j) * H(j,n);
+               }
+               phase.flops(4.0*(n-l+1));
+               w = H(i,i) - p;
+   
+               if (e(i) < 0.0) {
+                  z = w;
+                  r = ra;
+                  s = sa;
+               } else {
+                  l = i;
+                  if (e(i) == 0) {
+                     std::complex<T> ctmp(-ra,-sa);
+                     std::complex<T> ctmp2(w,q);
+                     ctmp /= ctmp2;
+                     H(i,n-1) = ctmp.real();
+                     H(i,n) = ctmp.imag();
+                  } else {
+   
+                     // Solve complex equations
+   
+                     x = H(i,i+1);
+                     y = H(i+1,i);
+                     vr = (d(i) - p) * (d(i) - p) + e(i) * e(i) - q * q;
+                     vi = (d(i) - p) * 2.0 * q;
+                     if (vr == 0.0 && vi == 0.0) {
+                        vr = eps * norm * (std::abs(w) + std::abs(q) +
+                        std::abs(x) + std::abs(y) + std::abs(z));
+                     }
+                     std::complex<T> ctmp(x*r-z*ra+q*sa,x*s-z*sa-q*ra);
+                     std::complex<T> ctmp2(vr,vi);
+                     ctmp /= ctmp2;
+                     H(i,n-1) = ctmp.real();
+                     H(i,n) = ctmp.imag();
+                     if (std::abs(x) > (std::abs(z) + std::abs(q))) {
+                        H(i+1,n-1) = (-ra - w * H(i,n-1) + q * H(i,n)) / x;
+                        H(i+1,n) = (-sa - w * H(i,n) - q * H(i,n-1)) / x;
+                     } else {
+                        std::complex<T> ctmp(-r-y*H(i,n-1),-s-y*H(i,n));
+                        std::complex<T> ctmp2(z,q);
+                        ctmp /= ctmp2;
+                        H(i+1,n-1) = ctmp.real();
+                        H(i+1,n) = ctmp.imag();
+                     }
+                  }
+   
+                  // Overflow control
+
+                  t = std::max(std::abs(H(i,n-1)),std::abs(H(i,n)));
+                  if ((eps * t) * t > 1) {
+                     for (int j = i; j <= n; ++j) {
+                        H(j,n-1) /= t;
+                        H(j,n) /= t;
+                     }
+                  }
+               }
+            }
+         }
+      }
+   
+      // Vectors of isolated roots
+   
+      for (int i = 0; i < nn; ++i) {
+         if (i < low || i > high) {
+            for (int j = i; j < nn; ++j) {
+               V(i,j) = H(i,j);
+            }
+         }
+      }
+   
+      // Back transformation to get eigenvectors of original matrix
+   
+      for (int j = nn-1; j >= low; --j) {
+         for (int i = low; i <= high; ++i) {
+            z = 0.0;
+            for (int k = low; k <= std::min(j,high); ++k) {
+               z += V(i,k) * H(k,j);
+            }
+            V(i,j) = z;
+         }
+         phase.flops(2.0*(high-low+1)*(std::min(j,high)-low+1));
+      }
+   }
+
+template<class T, class L, class ST>
+void EigenvalueDecomposition<T,L,ST>::diagonalSchurForm () {
+      if (schurOnly) {
+         H.resize(n,n,false);
+         H.clear();
+         for (int i = 0; i < n; ++i) {
+            H(i,i) = d(i);
+         }
+      }
+   }
+
+   // Jama's double shift QR iteration on rows and columns ilo..ihi of H,
+   // storing the eigenvalues in d and e as they converge, and applying
+   // the transformations to the parts of H and Z given by u.  Returns the
+   // last row that did not converge, ilo-1 if all did.
+
+template<class T, class L, class ST>
+int EigenvalueDecomposition<T,L,ST>::francis (int ilo, int ihi, const Updates& u, T norm,
+                                             IterationGuard& guard, instrumentation::PhaseTimer& phase) {
+      int n = ihi;
+      T eps = std::numeric_limits<T>::epsilon();
+      T exshift = 0.0;
+      T p=0,q=0,r=0,s=0,z=0,w,x,y;
+
+      // Rows of H are rows of the storage, columns of H are hs apart.
+
+      const int hs = kernels::columnStride(H);
+      const int rs = kernels::rowStride(H);
+      const int nz = u.zhi - u.zlo + 1;
+
       // Outer loop over eigenvalue index
-   
+
       int iter = 0;
-      while (n >= low) {
-   
-         // Look for single small sub-diagonal element
-   
+      while (n >= ilo) {
+
+         // Look for single small sub-diagonal element, and set it to
+         // zero so that the blocks of the Schur form can be told apart
+
          int l = n;
-         while (l > low) {
+         while (l > ilo) {
             s = std::abs(H(l-1,l-1)) + std::abs(H(l,l));
             if (s == 0.0) {
                s = norm;
             }
             if (std::abs(H(l,l-1)) < eps * s) {
+               H(l,l-1) = 0.0;
                break;
             }
             --l;
          }
-       
+
          // Check for convergence
          // One root found
-   
+
          if (l == n) {
             H(n,n) = H(n,n) + exshift;
             d(n) = H(n,n);
             e(n) = 0.0;
             --n;
             iter = 0;
-   
+
          // Two roots found
-   
+
          } else if (l == n-1) {
-            w = H(n,n-1) * H(n-1,n);
-            p = (H(n-1,n-1) - H(n,n)) / 2.0;
-            q = p * p + w;
-            z = std::sqrt(std::abs(q));
-            H(n,n) += exshift;
-            H(n-1,n-1) += exshift;
-            x = H(n,n);
-   
-            // Real pair
-   
-            if (q >= 0) {
-               if (p >= 0) {
-                  z = p + z;
-               } else {
-                  z = p - z;
-               }
-               d(n-1) = x + z;
-               d(n) = d(n-1);
-               if (z != 0.0) {
-                  d(n) = x - w / z;
-               }
-               e(n-1) = 0.0;
-               e(n) = 0.0;
-               x = H(n,n-1);
-               s = std::abs(x) + std::abs(z);
-               p = x / s;
-               q = z / s;
-               r = std::sqrt(p * p+q * q);
-               p /= r;
-               q /= r;
-   
-               // Row modification
-   
-               for (int j = n-1; j < nn; ++j) {
-                  z = H(n-1,j);
-                  H(n-1,j) = q * z + p * H(n,j);
-                  H(n,j) *= q;
-                  H(n,j) -= p * z;
-               }
-   
-               // Column modification
-   
-               for (int i = 0; i <= n; ++i) {
-                  z = H(i,n-1);
-                  H(i,n-1) = q * z + p * H(i,n);
-                  H(i,n) *= q;
-                  H(i,n) -= p * z;
-               }
-   
-               // Accumulate transformations
-   
-               for (int i = low; i <= high; ++i) {
-                  z = V(i,n-1);
-                  V(i,n-1) = q * z + p * V(i,n);
-                  V(i,n) *= q;
-                  V(i,n) -= p * z;
-               }
-   
-            // Complex pair
-   
-            } else {
-               d(n-1) = x + p;
-               d(n) = x + p;
-               e(n-1) = z;
-               e(n) = -z;
-            }
+            splitPair(n, exshift, u, phase);
             n = n - 2;
             iter = 0;
-   
+
          // No convergence yet
-   
+
          } else {
-   
+
             // Form shift
-   
+
             x = H(n,n);
             y = 0.0;
             w = 0.0;
@@ -691,12 +1871,14 @@ void EigenvalueDecomposition<T,L>::hqr2 () {
                y = H(n-1,n-1);
                w = H(n,n-1) * H(n-1,n);
             }
-   
-            // Wilkinson's original ad hoc shift
-   
-            if (iter == 10) {
+
+            // Wilkinson's original ad hoc shift, repeated every 10
+            // iterations after the 30th if the iteration still stalls
+
+            if (iter == 10 || (iter > 30 && iter % 10 == 0)) {
+               guard.exceptionalShift();
                exshift += x;
-               for (int i = low; i <= n; ++i) {
+               for (int i = ilo; i <= n; ++i) {
                   H(i,i) -= x;
                }
                s = std::abs(H(n,n-1)) + std::abs(H(n-1,n-2));
@@ -716,18 +1898,24 @@ void EigenvalueDecomposition<T,L>::hqr2 () {
                        s = -s;
                     }
                     s = x - w / ((y - x) / 2.0 + s);
-                    for (int i = low; i <= n; ++i) {
+                    for (int i = ilo; i <= n; ++i) {
                        H(i,i) -= s;
                     }
                     exshift += s;
                     x = y = w = 0.964;
+                    guard.exceptionalShift();
                 }
             }
-   
-            ++iter;   // (Could check iteration count here.)
-   
+
+            ++iter;
+            if (!guard.next(iter)) {
+               guard.fail(n-ilo+1);
+               break;
+            }
+            phase.iterations();
+
             // Look for two consecutive small sub-diagonal elements
-   
+
             int m = n-2;
             while (m >= l) {
                z = H(m,m);
@@ -750,16 +1938,15 @@ void EigenvalueDecomposition<T,L>::hqr2 () {
                }
                --m;
             }
-   
+
             for (int i = m+2; i <= n; ++i) {
                H(i,i-2) = 0.0;
                if (i > m+2) {
                   H(i,i-3) = 0.0;
                }
             }
-   
+
             // Double QR step involving rows l:n and columns m:n
-   
 
             for (int k = m; k <= n-1; ++k) {
                bool notlast = (k != n-1);
@@ -776,227 +1963,1090 @@ void EigenvalueDecomposition<T,L>::hqr2 () {
                   r /= x;
                }
 
-               s = std::sqrt(p * p + q * q + r * r);
-               if (p < 0) {
-                  s = -s;
+               s = std::sqrt(p * p + q * q + r * r);
+               if (p < 0) {
+                  s = -s;
+               }
+               if (s != 0) {
+                  if (k != m) {
+                     H(k,k-1) = -s * x;
+                  } else if (l != m) {
+                     H(k,k-1) = -H(k,k-1);
+                  }
+                  p += s;
+                  x = p / s;
+                  y = q / s;
+                  z = r / s;
+                  q /= p;
+                  r /= p;
+
+                  // Row modification
+                  // p = H(k,j) + q * H(k+1,j) + r * H(k+2,j),
+                  // H(k,j) -= p * x, H(k+1,j) -= p * y, H(k+2,j) -= p * z
+
+                  T* Hk = &H(k,k);
+                  if (notlast) {
+                     kernels::refl3(u.colEnd-k, Hk, Hk + hs, Hk + 2*hs, rs, T(1), q, r, x, y, z);
+                  } else {
+                     kernels::refl2(u.colEnd-k, Hk, Hk + hs, rs, T(1), q, x, y);
+                  }
+
+                  // Column modification
+                  // p = x * H(i,k) + y * H(i,k+1) + z * H(i,k+2),
+                  // H(i,k) -= p, H(i,k+1) -= p * q, H(i,k+2) -= p * r
+
+                  int ni = std::min(n,k+3) + 1 - u.rowBegin;
+                  T* H0 = &H(u.rowBegin,k);
+                  if (notlast) {
+                     kernels::refl3(ni, H0, H0 + rs, H0 + 2*rs, hs, x, y, z, T(1), q, r);
+                  } else {
+                     kernels::refl2(ni, H0, H0 + rs, hs, x, y, T(1), q);
+                  }
+
+                  // Accumulate transformations
+
+                  T* V0 = u.Z + (k-u.zoff)*u.ldz + u.zlo;
+                  if (notlast) {
+                     kernels::refl3(nz, V0, V0 + u.ldz, V0 + 2*u.ldz, 1, x, y, z, T(1), q, r);
+                  } else {
+                     kernels::refl2(nz, V0, V0 + u.ldz, 1, x, y, T(1), q);
+                  }
+                  phase.flops((notlast ? 11.0 : 7.0)*((u.colEnd-k) + ni + nz));
+               }  // (s != 0)
+            }  // k loop
+         }  // check convergence
+      }  // while (n >= ilo)
+
+      for (int i = ilo; i <= n; ++i) {
+         d(i) = H(i,i) + exshift;
+         e(i) = 0.0;
+      }
+      return n;
+   }
+
+   // Eigenvalues of the 2x2 block in rows and columns n-1..n of H, after
+   // adding exshift to its diagonal.  A real pair is split by a rotation,
+   // applied to the parts of H and Z given by u.
+
+template<class T, class L, class ST>
+void EigenvalueDecomposition<T,L,ST>::splitPair (int n, T exshift, const Updates& u, instrumentation::PhaseTimer& phase) {
+      T w = H(n,n-1) * H(n-1,n);
+      T p = (H(n-1,n-1) - H(n,n)) / 2.0;
+      T q = p * p + w;
+      T z = std::sqrt(std::abs(q));
+      H(n,n) += exshift;
+      H(n-1,n-1) += exshift;
+      T x = H(n,n);
+
+      // Real pair
+
+      if (q >= 0) {
+         if (p >= 0) {
+            z = p + z;
+         } else {
+            z = p - z;
+         }
+         d(n-1) = x + z;
+         d(n) = d(n-1);
+         if (z != 0.0) {
+            d(n) = x - w / z;
+         }
+         e(n-1) = 0.0;
+         e(n) = 0.0;
+         x = H(n,n-1);
+         T s = std::abs(x) + std::abs(z);
+         p = x / s;
+         q = z / s;
+         T r = std::sqrt(p * p+q * q);
+         p /= r;
+         q /= r;
+
+         // Row modification
+
+         const int rs = kernels::rowStride(H);
+         const int hs = kernels::columnStride(H);
+         kernels::rot(u.colEnd-n+1, &H(n-1,n-1), rs, &H(n,n-1), rs, q, p);
+
+         // Column modification
+
+         kernels::rot(n+1-u.rowBegin, &H(u.rowBegin,n-1), hs, &H(u.rowBegin,n), hs, q, p);
+         H(n,n-1) = 0.0;
+
+         // Accumulate transformations
+
+         const int nz = u.zhi - u.zlo + 1;
+         kernels::rot(nz, u.Z + (n-1-u.zoff)*u.ldz + u.zlo, 1, u.Z + (n-u.zoff)*u.ldz + u.zlo, 1, q, p);
+         phase.flops(6.0*((u.colEnd-n+1) + (n+1-u.rowBegin) + nz));
+
+      // Complex pair
+
+      } else {
+         d(n-1) = x + p;
+         d(n) = x + p;
+         e(n-1) = z;
+         e(n) = -z;
+      }
+   }
+
+   // Eigenvalues of the 2x2 matrix [a b; c d], as in splitPair.
+
+template<class T, class L, class ST>
+void EigenvalueDecomposition<T,L,ST>::pairEigenvalues (T a, T b, T c, T d, T* re, T* im) {
+      T w = b * c;
+      T p = (a - d) / 2.0;
+      T q = p * p + w;
+      T z = std::sqrt(std::abs(q));
+      if (q >= 0) {
+         z = (p >= 0) ? p + z : p - z;
+         re[0] = d + z;
+         re[1] = (z != 0.0) ? d - w / z : re[0];
+         im[0] = im[1] = 0.0;
+      } else {
+         re[0] = re[1] = d + p;
+         im[0] = z;
+         im[1] = -z;
+      }
+   }
+   // Number of shifts of a multishift sweep on an active block of nh rows
+   // (LAPACK's iparmq).
+
+template<class T, class L, class ST>
+int EigenvalueDecomposition<T,L,ST>::shiftCount (int nh) {
+      int ns;
+      if (nh < 30) {
+         ns = 2;
+      } else if (nh < 60) {
+         ns = 4;
+      } else if (nh < 150) {
+         ns = 10;
+      } else if (nh < 590) {
+         ns = std::max(10, (int) (nh / std::floor(std::log((double) nh)/std::log(2.0) + 0.5)));
+      } else if (nh < 3000) {
+         ns = 64;
+      } else if (nh < 6000) {
+         ns = 128;
+      } else {
+         ns = 256;
+      }
+      return std::max(2, ns - ns % 2);
+   }
+
+   // Multishift QR iteration on rows and columns low..high of H (LAPACK's
+   // dlaqr0).  Each iteration deflates what it can from a window at the
+   // bottom of the active block, then chases a chain of bulges with the
+   // undeflated eigenvalues of the window as shifts.  Active blocks of
+   // less than 75 rows are finished with the double shift iteration.
+   // Returns the last row that did not converge, low-1 if all did; the
+   // eigenvalues of the converged rows are computed by the caller.
+
+template<class T, class L, class ST>
+int EigenvalueDecomposition<T,L,ST>::multishift (T* Vcol, T norm, IterationGuard& guard,
+                                                instrumentation::PhaseTimer& phase) {
+      const int nn = this->n;
+      const int nh = high - low + 1;
+      const int nmin = 75;
+      const T eps = std::numeric_limits<T>::epsilon();
+      const Updates all = { 0, nn, Vcol, nn, low, high, 0 };
+
+      // Shifts per sweep, and size of the deflation window: ns, or 3*ns/2
+      // for large matrices, doubled while nothing deflates.
+
+      int nsmax = std::min(shiftCount(nh), std::max(2, (nh+6)/9));
+      nsmax -= nsmax % 2;
+      const int nwr = nh <= 500 ? nsmax : 3*nsmax/2;
+      const int nwmax = std::min((nh-1)/3, 2*nwr);
+
+      const int wm = windowMax();
+      T* sr = &work(0) + 3*wm*wm + nn*wm;
+      T* si = sr + nn;
+
+      // orthes leaves its reflectors below the sub-diagonal
+
+      for (int i = low+2; i <= high; ++i) {
+         for (int j = low; j < i-1; ++j) {
+            H(i,j) = 0.0;
+         }
+      }
+
+      int kbot = high;
+      int ndfl = 1;
+      int nw = nwr;
+      while (kbot >= low) {
+
+         // Look for a small sub-diagonal element above kbot
+
+         int ktop = kbot;
+         while (ktop > low && H(ktop,ktop-1) != 0.0) {
+            T s = std::abs(H(ktop-1,ktop-1)) + std::abs(H(ktop,ktop));
+            if (s == 0.0) {
+               s = norm;
+            }
+            if (std::abs(H(ktop,ktop-1)) < eps * s) {
+               H(ktop,ktop-1) = 0.0;
+               break;
+            }
+            --ktop;
+         }
+
+         // Finish small blocks with the double shift iteration
+
+         if (kbot-ktop+1 < nmin) {
+            int m = francis(ktop, kbot, all, norm, guard, phase);
+            if (m >= ktop) {
+               for (int i = low; i < ktop; ++i) {
+                  d(i) = H(i,i);
+                  e(i) = 0.0;
+               }
+               guard.fail(m-low+1);
+               return m;
+            }
+            kbot = ktop-1;
+            ndfl = 1;
+            continue;
+         }
+
+         // Aggressive early deflation
+
+         const int nwupbd = std::min(kbot-ktop+1, nwmax);
+         nw = (ndfl < 5) ? std::min(nwupbd, nwr) : std::min(nwupbd, 2*nw);
+         int ls = 0;
+         const int ld = earlyDeflation(ktop, kbot, nw, norm, Vcol, sr, si, ls, phase);
+         kbot -= ld;
+
+         // Sweep, unless the window deflated enough to try again
+
+         if (ld == 0 || (100*ld <= 14*nw && kbot-ktop+1 > std::min(nmin, nwmax))) {
+            int ns = std::min(nsmax, std::max(2, kbot-ktop));
+            ns -= ns % 2;
+            const bool exceptional = (ndfl % 6 == 0);
+            if (exceptional) {
+               guard.exceptionalShift();
+            }
+            ns = selectShifts(ktop, kbot, ns, exceptional, sr, si, ls);
+            sweep(ktop, kbot, ns, sr, si, Vcol, phase);
+         }
+
+         ndfl = (ld > 0) ? 1 : ndfl+1;
+         phase.iterations();
+         if (!guard.next(ndfl)) {
+            for (int i = low; i <= kbot; ++i) {
+               d(i) = H(i,i);
+               e(i) = 0.0;
+            }
+            guard.fail(kbot-low+1);
+            return kbot;
+         }
+      }
+      return low-1;
+   }
+
+   // Shifts of a sweep on rows ktop..kbot, at most ns, stored at the start
+   // of sr and si as complex conjugate pairs and pairs of real shifts:
+   // the last of the ls eigenvalues left by the deflation window, or ad
+   // hoc values from the last sub-diagonal elements if exceptional.
+   // Returns their number.
+
+template<class T, class L, class ST>
+int EigenvalueDecomposition<T,L,ST>::selectShifts (int ktop, int kbot, int ns, bool exceptional,
+                                                  T* sr, T* si, int ls) {
+      int count = 0;
+      if (exceptional) {
+         for (int i = kbot; i >= ktop+2 && count < ns; i -= 2) {
+            T s = std::abs(H(i,i-1)) + std::abs(H(i-1,i-2));
+            sr[count] = sr[count+1] = 0.75 * s + H(i,i);
+            si[count] = std::sqrt(0.4375) * s;
+            si[count+1] = -si[count];
+            count += 2;
+         }
+      } else {
+
+         // Complex pairs first, then the real shifts, dropping the
+         // first one if their number is odd
+
+         int first = std::max(0, ls-ns);
+         if (first > 0 && si[first] < 0) {
+            ++first;
+         }
+         T* real = si + this->n;
+         int nreal = 0;
+         for (int i = first; i < ls; ++i) {
+            if (si[i] != 0.0) {
+               sr[count] = sr[i];
+               si[count] = si[i];
+               ++count;
+            } else {
+               real[nreal++] = sr[i];
+            }
+         }
+         for (int i = nreal % 2; i < nreal; ++i) {
+            sr[count] = real[i];
+            si[count] = 0.0;
+            ++count;
+         }
+      }
+
+      // Without shifts, the eigenvalues of the last 2x2 block
+
+      if (count < 2) {
+         pairEigenvalues(H(kbot-1,kbot-1), H(kbot-1,kbot), H(kbot,kbot-1), H(kbot,kbot), sr, si);
+         count = 2;
+      }
+
+      // Two real shifts: use twice the one closer to H(kbot,kbot)
+
+      if (count == 2 && si[0] == 0.0) {
+         if (std::abs(sr[0] - H(kbot,kbot)) < std::abs(sr[1] - H(kbot,kbot))) {
+            sr[1] = sr[0];
+         } else {
+            sr[0] = sr[1];
+         }
+      }
+      return count;
+   }
+
+   // Aggressive early deflation on the window of the last nw rows of the
+   // active block ktop..kbot (LAPACK's dlaqr3).  The window is reduced to
+   // Schur form by the double shift iteration, with the transformations
+   // accumulated in Q; its eigenvalues whose component in the spike
+   // s*Q(0,:), s = H(kwtop,kwtop-1), is negligible deflate, and the
+   // others are moved to the top of the window.  The window is then
+   // returned to Hessenberg form and Q applied to the rest of H and to V.
+   // Returns the number of deflated rows, and the ls undeflated
+   // eigenvalues in sr and si.
+
+template<class T, class L, class ST>
+int EigenvalueDecomposition<T,L,ST>::earlyDeflation (int ktop, int kbot, int nw, T norm, T* Vcol,
+                                                    T* sr, T* si, int& ls, instrumentation::PhaseTimer& phase) {
+      const T eps = std::numeric_limits<T>::epsilon();
+      const T small = std::numeric_limits<T>::min() * (T(nw) / eps);
+      const int hs = kernels::columnStride(H);
+      const int kwtop = kbot - nw + 1;
+      T s = (kwtop == ktop) ? T(0) : H(kwtop,kwtop-1);
+
+      const int wm = windowMax();
+      T* Q = &work(0);
+      T* B = Q + 2*wm*wm;
+      T* v = si + this->n;
+
+      // Copy of the window, restored if nothing deflates, and Q = I
+
+      for (int j = 0; j < nw; ++j) {
+         for (int i = 0; i < nw; ++i) {
+            B[j*nw+i] = H(kwtop+i,kwtop+j);
+            Q[j*nw+i] = (i == j) ? T(1) : T(0);
+         }
+      }
+
+      // Schur form of the window
+
+      ConvergenceInfo info;
+      IterationGuard windowGuard(IterationLimits(), info, nw);
+      const Updates window = { kwtop, kbot+1, Q, nw, 0, nw-1, kwtop };
+      const bool converged = francis(kwtop, kbot, window, norm, windowGuard, phase) < kwtop;
+      for (int i = kwtop+2; i <= kbot; ++i) {
+         for (int j = kwtop; j < i-1; ++j) {
+            H(i,j) = 0.0;
+         }
+      }
+
+      // Deflation checks, from the bottom of the window
+
+      int ns = nw;
+      if (converged) {
+         int ilst = 0;
+         while (ilst < ns) {
+            const int i = kwtop + ns - 1;
+            if (ns == 1 || H(i,i-1) == 0.0) {
+               T foo = std::abs(H(i,i));
+               if (foo == 0.0) {
+                  foo = std::abs(s);
+               }
+               if (std::abs(s * Q[(ns-1)*nw]) <= std::max(small, eps * foo)) {
+                  --ns;
+               } else {
+                  moveBlock(i, kwtop+ilst, kwtop, kbot, Q, nw);
+                  ++ilst;
+               }
+            } else {
+               T foo = std::abs(H(i,i)) + std::sqrt(std::abs(H(i,i-1))) * std::sqrt(std::abs(H(i-1,i)));
+               if (foo == 0.0) {
+                  foo = std::abs(s);
+               }
+               if (std::max(std::abs(s * Q[(ns-1)*nw]), std::abs(s * Q[(ns-2)*nw])) <= std::max(small, eps * foo)) {
+                  ns -= 2;
+               } else {
+                  moveBlock(i-1, kwtop+ilst, kwtop, kbot, Q, nw);
+                  ilst += 2;
+               }
+            }
+         }
+      }
+
+      // Undeflated eigenvalues, the shifts of the next sweep
+
+      ls = 0;
+      for (int i = kwtop; i < kwtop+ns; ) {
+         if (i+1 < kwtop+ns && H(i+1,i) != 0.0) {
+            pairEigenvalues(H(i,i), H(i,i+1), H(i+1,i), H(i+1,i+1), sr+ls, si+ls);
+            ls += 2;
+            i += 2;
+         } else {
+            sr[ls] = H(i,i);
+            si[ls] = 0.0;
+            ++ls;
+            ++i;
+         }
+      }
+
+      // Nothing deflated: restore the window
+
+      if (ns == nw && s != 0.0) {
+         for (int j = 0; j < nw; ++j) {
+            for (int i = 0; i < nw; ++i) {
+               H(kwtop+i,kwtop+j) = B[j*nw+i];
+            }
+         }
+         return 0;
+      }
+      if (ns == 0) {
+         s = 0.0;
+      }
+
+      // Reflect the spike back to s*beta*e_0, and reduce the undeflated
+      // part to Hessenberg form
+
+      if (ns > 1 && s != 0.0) {
+         for (int j = 0; j < ns; ++j) {
+            v[j] = Q[j*nw];
+         }
+         T beta;
+         T tau = householder(ns, v, 1, beta);
+         v[0] = 1.0;
+         if (tau != 0.0) {
+            reflectRows(kwtop, kwtop+ns-1, kwtop, kbot, v, tau);
+            reflectColumns(kwtop, kwtop+ns-1, kwtop, kwtop+ns-1, v, tau);
+            for (int i = 0; i < nw; ++i) {
+               T p = tau * kernels::dot(ns, v, 1, Q+i, nw);
+               kernels::axpy(ns, -p, v, 1, Q+i, nw);
+            }
+         }
+         for (int c = 0; c < ns-2; ++c) {
+            const int j = kwtop + c;
+            const int len = ns - c - 1;
+            T* x = &H(j+1,j);
+            tau = householder(len, x, hs, beta);
+            v[0] = 1.0;
+            for (int i = 1; i < len; ++i) {
+               v[i] = x[i*hs];
+               x[i*hs] = 0.0;
+            }
+            x[0] = beta;
+            if (tau != 0.0) {
+               reflectRows(j+1, kwtop+ns-1, j+1, kbot, v, tau);
+               reflectColumns(kwtop, kwtop+ns-1, j+1, kwtop+ns-1, v, tau);
+               for (int i = 0; i < nw; ++i) {
+                  T p = tau * kernels::dot(len, v, 1, Q+(c+1)*nw+i, nw);
+                  kernels::axpy(len, -p, v, 1, Q+(c+1)*nw+i, nw);
+               }
+            }
+         }
+         phase.flops(4.0*ns*ns*(nw + ns + nw));
+      }
+      if (kwtop > ktop) {
+         H(kwtop,kwtop-1) = s * Q[0];
+      }
+
+      // Apply Q to the rest of H and to V
+
+      applyWindow(kwtop, nw, Q, Vcol, phase);
+      return nw - ns;
+   }
+
+template<class T, class L, class ST>
+int EigenvalueDecomposition<T,L,ST>::reorderSchur (const std::vector<bool>& select) {
+      BOOST_UBLAS_CHECK(computedSchur && computedVectors, external_logic());
+      BOOST_UBLAS_CHECK((int) select.size() == n, bad_size());
+      matrix<T,column_major> Q = identity_matrix<T>(n);
+
+      // Select both values of the complex pairs, then bring their blocks
+      // to standard form, which splits the pairs that are in fact real.
+
+      std::vector<bool> selected(select);
+      for (int k = 0; k+1 < n; ++k) {
+         if (H(k+1,k) != 0.0) {
+            selected[k] = selected[k+1] = selected[k] || selected[k+1];
+            standardizePair(k, 0, n-1, &Q(0,0), n);
+            ++k;
+         }
+      }
+      int ks = 0;
+      for (int k = 0; k < n; ) {
+         const int nb = (k+1 < n && H(k+1,k) != 0.0) ? 2 : 1;
+         if (selected[k]) {
+            if (k != ks && !moveBlock(k, ks, 0, n-1, &Q(0,0), n)) {
+               break;
+            }
+            ks += nb;
+         }
+         k += nb;
+      }
+      if (n > 0) {
+         V = prod(V, Q);
+      }
+      for (int i = 0; i < n; ) {
+         if (i+1 < n && H(i+1,i) != 0.0) {
+            T re[2], im[2];
+            pairEigenvalues(H(i,i), H(i,i+1), H(i+1,i), H(i+1,i+1), re, im);
+            d(i) = re[0];
+            d(i+1) = re[1];
+            e(i) = im[0];
+            e(i+1) = im[1];
+            i += 2;
+         } else {
+            d(i) = H(i,i);
+            e(i) = 0.0;
+            ++i;
+         }
+      }
+      return ks;
+   }
+
+   // Move the diagonal block of the Schur form of the window wlo..whi
+   // starting at row ifst up to row ilst, by swapping it with the blocks
+   // above (LAPACK's dtrexc), accumulating the transformations in Q.
+   // Returns false if a swap was rejected as too ill-conditioned.
+
+template<class T, class L, class ST>
+bool EigenvalueDecomposition<T,L,ST>::moveBlock (int ifst, int ilst, int wlo, int whi, T* Q, int ldq) {
+      if (ilst > wlo && H(ilst,ilst-1) != 0.0) {
+         --ilst;
+      }
+      // nb is 3 once a 2x2 block has split into two 1x1 blocks, which
+      // are then moved one after the other.
+      int nb = (ifst < whi && H(ifst+1,ifst) != 0.0) ? 2 : 1;
+      int here = ifst;
+      while (here > ilst) {
+         int nbnext = (here-2 >= wlo && H(here-1,here-2) != 0.0) ? 2 : 1;
+         if (nb < 3) {
+            if (!swapBlocks(here-nbnext, nbnext, nb, wlo, whi, Q, ldq)) {
+               return false;
+            }
+            here -= nbnext;
+            if (nb == 2 && H(here+1,here) == 0.0) {
+               nb = 3;
+            }
+            continue;
+         }
+         if (!swapBlocks(here-nbnext, nbnext, 1, wlo, whi, Q, ldq)) {
+            return false;
+         }
+         if (nbnext == 1) {
+            swapBlocks(here, 1, 1, wlo, whi, Q, ldq);
+            --here;
+            continue;
+         }
+         // The 2x2 block passed over may have split too
+         if (H(here,here-1) == 0.0) {
+            swapBlocks(here, 1, 1, wlo, whi, Q, ldq);
+            swapBlocks(here-1, 1, 1, wlo, whi, Q, ldq);
+         } else if (!swapBlocks(here-1, 2, 1, wlo, whi, Q, ldq)) {
+            return false;
+         }
+         here -= 2;
+      }
+      return true;
+   }
+
+   // Swap the adjacent diagonal blocks of orders n1 and n2 starting at row
+   // j1 of the Schur form of the window wlo..whi (LAPACK's dlaexc), by an
+   // orthogonal similarity applied to the window and accumulated in Q
+   // (ldq rows, column 0 for row wlo).  The swap is rejected, leaving
+   // everything unchanged, if it would perturb the blocks too much.
+
+template<class T, class L, class ST>
+bool EigenvalueDecomposition<T,L,ST>::swapBlocks (int j1, int n1, int n2, int wlo, int whi, T* Q, int ldq) {
+      const int rs = kernels::rowStride(H);
+      const int hs = kernels::columnStride(H);
+      const int j2 = j1+1, j3 = j1+2, j4 = j1+3;
+
+      // Two 1x1 blocks: a rotation
+
+      if (n1 == 1 && n2 == 1) {
+         const T t11 = H(j1,j1);
+         const T t22 = H(j2,j2);
+         const T f = H(j1,j2);
+         const T g = t22 - t11;
+         const T r = boost::math::hypot(f, g);
+         const T c = (r == 0.0) ? T(1) : f / r;
+         const T sn = (r == 0.0) ? T(0) : g / r;
+         if (j3 <= whi) {
+            kernels::rot(whi-j3+1, &H(j1,j3), rs, &H(j2,j3), rs, c, sn);
+         }
+         kernels::rot(j1-wlo, &H(wlo,j1), hs, &H(wlo,j2), hs, c, sn);
+         H(j1,j1) = t22;
+         H(j2,j2) = t11;
+         kernels::rot(ldq, Q + (j1-wlo)*ldq, 1, Q + (j2-wlo)*ldq, 1, c, sn);
+         return true;
+      }
+
+      // Otherwise reflectors from the solution X of T11*X - X*T22 = T12,
+      // tried first on a copy D of the blocks
+
+      const int nd = n1 + n2;
+      T D[16];
+      T dnorm = 0.0;
+      for (int i = 0; i < nd; ++i) {
+         for (int j = 0; j < nd; ++j) {
+            D[i*4+j] = H(j1+i,j1+j);
+            dnorm = std::max(dnorm, std::abs(D[i*4+j]));
+         }
+      }
+      const T eps = std::numeric_limits<T>::epsilon();
+      const T thresh = std::max(T(10) * eps * dnorm, std::numeric_limits<T>::min() / eps);
+      T X[4];
+      sylvester(n1, n2, D, X);
+
+      // (I - tau*u*u') applied to rows r..r+2 or columns c..c+2
+
+      struct Reflector {
+         T u[3], tau;
+         void rows (int m, T* a, T* b, T* c, int inc) const {
+            kernels::refl3(m, a, b, c, inc, u[0], u[1], u[2], tau*u[0], tau*u[1], tau*u[2]);
+         }
+      };
+      Reflector h1, h2;
+      T beta;
+      if (n1 == 1) {
+         h1.u[0] = 1.0;
+         h1.u[1] = X[0];
+         h1.u[2] = X[1];
+         h1.tau = householder(3, h1.u+2, -1, beta);
+         h1.u[2] = 1.0;
+         const T t11 = H(j1,j1);
+         h1.rows(nd, D, D+4, D+8, 1);
+         h1.rows(nd, D, D+1, D+2, 4);
+         if (std::max(std::max(std::abs(D[8]), std::abs(D[9])), std::abs(D[10] - t11)) > thresh) {
+            return false;
+         }
+         h1.rows(whi-j1+1, &H(j1,j1), &H(j2,j1), &H(j3,j1), rs);
+         h1.rows(j2-wlo+1, &H(wlo,j1), &H(wlo,j2), &H(wlo,j3), hs);
+         H(j3,j1) = 0.0;
+         H(j3,j2) = 0.0;
+         H(j3,j3) = t11;
+         T* q = Q + (j1-wlo)*ldq;
+         h1.rows(ldq, q, q+ldq, q+2*ldq, 1);
+      } else if (n2 == 1) {
+         h1.u[0] = -X[0];
+         h1.u[1] = -X[1];
+         h1.u[2] = 1.0;
+         h1.tau = householder(3, h1.u, 1, beta);
+         h1.u[0] = 1.0;
+         const T t33 = H(j3,j3);
+         h1.rows(nd, D, D+4, D+8, 1);
+         h1.rows(nd, D, D+1, D+2, 4);
+         if (std::max(std::max(std::abs(D[4]), std::abs(D[8])), std::abs(D[0] - t33)) > thresh) {
+            return false;
+         }
+         h1.rows(j3-wlo+1, &H(wlo,j1), &H(wlo,j2), &H(wlo,j3), hs);
+         h1.rows(whi-j2+1, &H(j1,j2), &H(j2,j2), &H(j3,j2), rs);
+         H(j1,j1) = t33;
+         H(j2,j1) = 0.0;
+         H(j3,j1) = 0.0;
+         T* q = Q + (j1-wlo)*ldq;
+         h1.rows(ldq, q, q+ldq, q+2*ldq, 1);
+      } else {
+         h1.u[0] = -X[0];
+         h1.u[1] = -X[2];
+         h1.u[2] = 1.0;
+         h1.tau = householder(3, h1.u, 1, beta);
+         h1.u[0] = 1.0;
+         const T temp = -h1.tau * (X[1] + h1.u[1] * X[3]);
+         h2.u[0] = -temp * h1.u[1] - X[3];
+         h2.u[1] = -temp * h1.u[2];
+         h2.u[2] = 1.0;
+         h2.tau = householder(3, h2.u, 1, beta);
+         h2.u[0] = 1.0;
+         h1.rows(nd, D, D+4, D+8, 1);
+         h1.rows(nd, D, D+1, D+2, 4);
+         h2.rows(nd, D+4, D+8, D+12, 1);
+         h2.rows(nd, D+1, D+2, D+3, 4);
+         if (std::max(std::max(std::abs(D[8]), std::abs(D[9])), std::max(std::abs(D[12]), std::abs(D[13]))) > thresh) {
+            return false;
+         }
+         h1.rows(whi-j1+1, &H(j1,j1), &H(j2,j1), &H(j3,j1), rs);
+         h1.rows(j4-wlo+1, &H(wlo,j1), &H(wlo,j2), &H(wlo,j3), hs);
+         h2.rows(whi-j1+1, &H(j2,j1), &H(j3,j1), &H(j4,j1), rs);
+         h2.rows(j4-wlo+1, &H(wlo,j2), &H(wlo,j3), &H(wlo,j4), hs);
+         H(j3,j1) = 0.0;
+         H(j3,j2) = 0.0;
+         H(j4,j1) = 0.0;
+         H(j4,j2) = 0.0;
+         T* q = Q + (j1-wlo)*ldq;
+         h1.rows(ldq, q, q+ldq, q+2*ldq, 1);
+         h2.rows(ldq, q+ldq, q+2*ldq, q+3*ldq, 1);
+      }
+
+      // Standardize the new 2x2 blocks
+
+      if (n2 == 2) {
+         standardizePair(j1, wlo, whi, Q, ldq);
+      }
+      if (n1 == 2) {
+         standardizePair(j1+n2, wlo, whi, Q, ldq);
+      }
+      return true;
+   }
+
+   // Standardize the 2x2 diagonal block at row j of the Schur form of the
+   // window wlo..whi (LAPACK's dlanv2): equal diagonal elements and
+   // off-diagonal elements of opposite signs if its eigenvalues are
+   // complex, upper triangular otherwise.  The rotation is applied to the
+   // window and accumulated in Q.
+
+template<class T, class L, class ST>
+void EigenvalueDecomposition<T,L,ST>::standardizePair (int j, int wlo, int whi, T* Q, int ldq) {
+      T a = H(j,j), b = H(j,j+1), c = H(j+1,j), dd = H(j+1,j+1);
+      T cs = 1.0, sn = 0.0;
+      const T eps = std::numeric_limits<T>::epsilon();
+      if (c != 0.0 && b == 0.0) {
+
+         // Swap rows and columns
+
+         cs = 0.0;
+         sn = 1.0;
+         std::swap(a, dd);
+         b = -c;
+         c = 0.0;
+      } else if (c != 0.0 && (a - dd != 0.0 || (b < 0) == (c < 0))) {
+         const T temp = a - dd;
+         T p = temp / 2.0;
+         const T bcmax = std::max(std::abs(b), std::abs(c));
+         const T bcmis = std::min(std::abs(b), std::abs(c)) * (b < 0 ? -1 : 1) * (c < 0 ? -1 : 1);
+         const T scale = std::max(std::abs(p), bcmax);
+         T z = (p / scale) * p + (bcmax / scale) * bcmis;
+         if (z >= 4.0 * eps) {
+
+            // Real eigenvalues: upper triangular
+
+            z = p + (p < 0 ? -1 : 1) * std::sqrt(scale) * std::sqrt(z);
+            a = dd + z;
+            dd -= (bcmax / z) * bcmis;
+            const T tau = boost::math::hypot(c, z);
+            cs = z / tau;
+            sn = c / tau;
+            b -= c;
+            c = 0.0;
+         } else {
+
+            // Complex or nearly equal real eigenvalues: equal diagonal
+
+            const T sigma = b + c;
+            const T tau = boost::math::hypot(sigma, temp);
+            cs = std::sqrt((1.0 + std::abs(sigma) / tau) / 2.0);
+            sn = -(p / (tau * cs)) * (sigma < 0 ? -1 : 1);
+            const T aa = a * cs + b * sn;
+            const T bb = -a * sn + b * cs;
+            const T cc = c * cs + dd * sn;
+            const T d2 = -c * sn + dd * cs;
+            b = bb * cs + d2 * sn;
+            c = -aa * sn + cc * cs;
+            a = dd = ((aa * cs + cc * sn) + (-bb * sn + d2 * cs)) / 2.0;
+            if (c != 0.0) {
+               if (b == 0.0) {
+                  b = -c;
+                  c = 0.0;
+                  const T t = cs;
+                  cs = -sn;
+                  sn = t;
+               } else if ((b < 0) == (c < 0)) {
+
+                  // Real eigenvalues after all: upper triangular
+
+                  const T sab = std::sqrt(std::abs(b));
+                  const T sac = std::sqrt(std::abs(c));
+                  p = (c < 0) ? -sab * sac : sab * sac;
+                  const T t = 1.0 / std::sqrt(std::abs(b + c));
+                  a += p;
+                  dd -= p;
+                  b -= c;
+                  c = 0.0;
+                  const T cs1 = sab * t;
+                  const T sn1 = sac * t;
+                  const T r = cs * cs1 - sn * sn1;
+                  sn = cs * sn1 + sn * cs1;
+                  cs = r;
                }
-               if (s != 0) {
-                  if (k != m) {
-                     H(k,k-1) = -s * x;
-                  } else if (l != m) {
-                     H(k,k-1) = -H(k,k-1);
-                  }
-                  p += s;
-                  x = p / s;
-                  y = q / s;
-                  z = r / s;
-                  q /= p;
-                  r /= p;
-   
-                  // Row modification
-   
-                  for (int j = k; j < nn; ++j) {
-                     p = H(k,j) + q * H(k+1,j);
-                     if (notlast) {
-                        p += r * H(k+2,j);
-                        H(k+2,j) -= p * z;
-                     }
-                     H(k,j) -= p * x;
-                     H(k+1,j) -= p * y;
-                  }
-   
-                  // Column modification
-   
-                  for (int i = 0; i <= std::min(n,k+3); ++i) {
-                     p = x * H(i,k) + y * H(i,k+1);
-                     if (notlast) {
-                        p += z * H(i,k+2);
-                        H(i,k+2) -= p * r;
-                     }
-                     H(i,k) -= p;
-                     H(i,k+1) -= p * q;
-                  }
-   
-                  // Accumulate transformations
-   
-                  for (int i = low; i <= high; ++i) {
-                     p = x * V(i,k) + y * V(i,k+1);
-                     if (notlast) {
-                        p += z * V(i,k+2);
-                        V(i,k+2) -= p * r;
-                     }
-                     V(i,k) -= p;
-                     V(i,k+1) -= p * q;
-                  }
-               }  // (s != 0)
-            }  // k loop
-         }  // check convergence
-      }  // while (n >= low)
-      
-      // Backsubstitute to find vectors of upper triangular form
+            }
+         }
+      }
+      H(j,j) = a;
+      H(j,j+1) = b;
+      H(j+1,j) = c;
+      H(j+1,j+1) = dd;
+      if (j+2 <= whi) {
+         kernels::rot(whi-j-1, &H(j,j+2), kernels::rowStride(H), &H(j+1,j+2), kernels::rowStride(H), cs, sn);
+      }
+      kernels::rot(j-wlo, &H(wlo,j), kernels::columnStride(H), &H(wlo,j+1), kernels::columnStride(H), cs, sn);
+      kernels::rot(ldq, Q + (j-wlo)*ldq, 1, Q + (j+1-wlo)*ldq, 1, cs, sn);
+   }
 
-      if (norm == 0.0) {
-         return;
+   // Solve T11*X - X*T22 = T12 (X n1 x n2, row-major) for the diagonal
+   // blocks of orders n1 and n2 of D (4x4, row-major), by Gaussian
+   // elimination with complete pivoting, small pivots being perturbed
+   // (LAPACK's dlasy2).
+
+template<class T, class L, class ST>
+void EigenvalueDecomposition<T,L,ST>::sylvester (int n1, int n2, const T* D, T* X) {
+      const int m = n1*n2;
+      T A[16], b[4], y[4];
+      int perm[4];
+      T smin = 0.0;
+      for (int i = 0; i < 4; ++i) {
+         for (int j = 0; j < 4; ++j) {
+            smin = std::max(smin, std::abs(D[i*4+j]));
+         }
       }
-   
-      for (n = nn-1; n >= 0; --n) {
-         p = d(n);
-         q = e(n);
-   
-         // Real vector
-   
-         if (q == 0) {
-            int l = n;
-            H(n,n) = 1.0;
-            for (int i = n-1; i >= 0; --i) {
-               w = H(i,i) - p;
-               r = 0.0;
-               for (int j = l; j <= n; ++j) {
-                  r = r + H(i,j) * H(j,n);
+      smin = std::max(std::numeric_limits<T>::epsilon() * smin, std::numeric_limits<T>::min());
+
+      // Unknown r = i*n2+j is X(i,j)
+
+      for (int i = 0; i < n1; ++i) {
+         for (int j = 0; j < n2; ++j) {
+            const int r = i*n2+j;
+            b[r] = D[i*4+n1+j];
+            perm[r] = r;
+            for (int k = 0; k < n1; ++k) {
+               for (int l = 0; l < n2; ++l) {
+                  A[r*4+k*n2+l] = (j == l ? D[i*4+k] : T(0)) - (i == k ? D[(n1+l)*4+n1+j] : T(0));
                }
-               if (e(i) < 0.0) {
-                  z = w;
-                  s = r;
-               } else {
-                  l = i;
-                  if (e(i) == 0.0) {
-                     if (w != 0.0) {
-                        H(i,n) = -r / w;
-                     } else {
-                        H(i,n) = -r / (eps * norm);
-                     }
-   
-                  // Solve real equations
-   
-                  } else {
-                     x = H(i,i+1);
-                     y = H(i+1,i);
-                     q = (d(i) - p) * (d(i) - p) + e(i) * e(i);
-                     t = (x * s - z * r) / q;
-                     H(i,n) = t;
-                     if (std::abs(x) > std::abs(z)) {
-                        H(i+1,n) = (-r - w * t) / x;
-                     } else {
-                        H(i+1,n) = (-s - y * t) / z;
-                     }
-                  }
-   
-                  // Overflow control
-   
-                  t = std::abs(H(i,n));
-                  if ((eps * t) * t > 1) {
-                     for (int j = i; j <= n; ++j) {
-                        H(j,n) /= t;
-                     }
-                  }
+            }
+         }
+      }
+      for (int c = 0; c < m; ++c) {
+         int pi = c, pj = c;
+         for (int i = c; i < m; ++i) {
+            for (int j = c; j < m; ++j) {
+               if (std::abs(A[i*4+j]) > std::abs(A[pi*4+pj])) {
+                  pi = i;
+                  pj = j;
                }
             }
-   
-         // Complex vector
-   
-         } else if (q < 0) {
-            int l = n-1;
+         }
+         for (int j = 0; j < m; ++j) {
+            std::swap(A[c*4+j], A[pi*4+j]);
+         }
+         std::swap(b[c], b[pi]);
+         for (int i = 0; i < m; ++i) {
+            std::swap(A[i*4+c], A[i*4+pj]);
+         }
+         std::swap(perm[c], perm[pj]);
+         if (std::abs(A[c*4+c]) < smin) {
+            A[c*4+c] = smin;
+         }
+         for (int i = c+1; i < m; ++i) {
+            const T f = A[i*4+c] / A[c*4+c];
+            for (int j = c; j < m; ++j) {
+               A[i*4+j] -= f * A[c*4+j];
+            }
+            b[i] -= f * b[c];
+         }
+      }
+      for (int c = m-1; c >= 0; --c) {
+         T t = b[c];
+         for (int j = c+1; j < m; ++j) {
+            t -= A[c*4+j] * y[j];
+         }
+         y[c] = t / A[c*4+c];
+      }
+      for (int c = 0; c < m; ++c) {
+         X[perm[c]] = y[c];
+      }
+   }
 
-            // Last vector component imaginary so matrix is triangular
-   
-            if (std::abs(H(n,n-1)) > std::abs(H(n-1,n))) {
-               H(n-1,n-1) = q / H(n,n-1);
-               H(n-1,n) = -(H(n,n) - p) / H(n,n-1);
-            } else {
-               std::complex<T> ctmp(0.0,-H(n-1,n));
-               std::complex<T> ctmp2(H(n-1,n-1)-p,q);
-               ctmp /= ctmp2;
-               H(n-1,n-1) = ctmp.real();
-               H(n-1,n) = ctmp.imag();
+   // H(r0:r1,c0:c1) = (I - tau*v*v')*H(r0:r1,c0:c1), and
+   // H(r0:r1,c0:c1) = H(r0:r1,c0:c1)*(I - tau*v*v').
+
+template<class T, class L, class ST>
+void EigenvalueDecomposition<T,L,ST>::reflectRows (int r0, int r1, int c0, int c1, const T* v, T tau) {
+      const int hs = kernels::columnStride(H);
+      const int len = r1-r0+1;
+      for (int c = c0; c <= c1; ++c) {
+         T* h = &H(r0,c);
+         T p = tau * kernels::dot(len, v, 1, h, hs);
+         kernels::axpy(len, -p, v, 1, h, hs);
+      }
+   }
+
+template<class T, class L, class ST>
+void EigenvalueDecomposition<T,L,ST>::reflectColumns (int r0, int r1, int c0, int c1, const T* v, T tau) {
+      const int rs = kernels::rowStride(H);
+      const int len = c1-c0+1;
+      for (int r = r0; r <= r1; ++r) {
+         T* h = &H(r,c0);
+         T p = tau * kernels::dot(len, v, 1, h, rs);
+         kernels::axpy(len, -p, v, 1, h, rs);
+      }
+   }
+
+   // Multishift sweep on rows ktop..kbot (LAPACK's dlaqr5): a chain of
+   // ns/2 bulges, each from a pair of shifts, introduced at the top one
+   // after the other and chased down three rows apart.  The chain moves
+   // by 3*ns/2 rows at a time, inside a window where the reflectors are
+   // applied directly and accumulated in U; U is then applied to the
+   // rest of H and to V by matrix-matrix products.
+
+template<class T, class L, class ST>
+void EigenvalueDecomposition<T,L,ST>::sweep (int ktop, int kbot, int ns, const T* sr, const T* si, T* Vcol,
+                                            instrumentation::PhaseTimer& phase) {
+      const int rs = kernels::rowStride(H);
+      const int hs = kernels::columnStride(H);
+      const int nbmps = ns/2;
+      const int last = kbot-1;
+      const int steps = last - ktop + 1 + 3*(nbmps-1);
+      const int nstep = 3*nbmps;
+      T* U = &work(0);
+
+      for (int t0 = 0; t0 < steps; t0 += nstep) {
+         const int t1 = std::min(t0 + nstep, steps);
+         const int kmin = std::max(ktop, ktop + t0 - 3*(nbmps-1));
+         const int kmax = std::min(last, ktop + t1 - 1);
+         const int wtop = std::max(ktop, kmin-1);
+         const int wbot = std::min(kbot, kmax+3);
+         const int w = wbot - wtop + 1;
+         for (int j = 0; j < w; ++j) {
+            for (int i = 0; i < w; ++i) {
+               U[j*w+i] = (i == j) ? T(1) : T(0);
             }
-            H(n,n-1) = 0.0;
-            H(n,n) = 1.0;
-            for (int i = n-2; i >= 0; --i) {
-               T ra,sa,vr,vi;
-               ra = 0.0;
-               sa = 0.0;
-               for (int j = l; j <= n; ++j) {
-                  ra += H(i,j) * H(j,n-1);
-                  sa += H(i,j) * H(j,n);
+         }
+
+         // At step t, bulge b is at row ktop + t - 3*b; the lower bulges
+         // move first.
+
+         for (int t = t0; t < t1; ++t) {
+            for (int b = 0; b < nbmps; ++b) {
+               const int k = ktop + t - 3*b;
+               if (k < ktop || k > last) {
+                  continue;
                }
-               w = H(i,i) - p;
-   
-               if (e(i) < 0.0) {
-                  z = w;
-                  r = ra;
-                  s = sa;
-               } else {
-                  l = i;
-                  if (e(i) == 0) {
-                     std::complex<T> ctmp(-ra,-sa);
-                     std::complex<T> ctmp2(w,q);
-                     ctmp /= ctmp2;
-                     H(i,n-1) = ctmp.real();
-                     H(i,n) = ctmp.imag();
-                  } else {
-   
-                     // Solve complex equations
-   
-                     x = H(i,i+1);
-                     y = H(i+1,i);
-                     vr = (d(i) - p) * (d(i) - p) + e(i) * e(i) - q * q;
-                     vi = (d(i) - p) * 2.0 * q;
-                     if (vr == 0.0 && vi == 0.0) {
-                        vr = eps * norm * (std::abs(w) + std::abs(q) +
-                        std::abs(x) + std::abs(y) + std::abs(z));
-                     }
-                     std::complex<T> ctmp(x*r-z*ra+q*sa,x*s-z*sa-q*ra);
-                     std::complex<T> ctmp2(vr,vi);
-                     ctmp /= ctmp2;
-                     H(i,n-1) = ctmp.real();
-                     H(i,n) = ctmp.imag();
-                     if (std::abs(x) > (std::abs(z) + std::abs(q))) {
-                        H(i+1,n-1) = (-ra - w * H(i,n-1) + q * H(i,n)) / x;
-                        H(i+1,n) = (-sa - w * H(i,n) - q * H(i,n-1)) / x;
-                     } else {
-                        std::complex<T> ctmp(-r-y*H(i,n-1),-s-y*H(i,n));
-                        std::complex<T> ctmp2(z,q);
-                        ctmp /= ctmp2;
-                        H(i+1,n-1) = ctmp.real();
-                        H(i+1,n) = ctmp.imag();
-                     }
+               const bool notlast = (k != last);
+               T v[3];
+               if (k == ktop) {
+
+                  // First column of (H - s1*I)*(H - s2*I), scaled
+                  // (LAPACK's dlaqr1)
+
+                  const T sr1 = sr[2*b], si1 = si[2*b], sr2 = sr[2*b+1], si2 = si[2*b+1];
+                  const T h21 = H(k+1,k);
+                  const T s = std::abs(H(k,k) - sr2) + std::abs(si2) + std::abs(h21);
+                  if (s == 0.0) {
+                     continue;
                   }
-   
-                  // Overflow control
-
-                  t = std::max(std::abs(H(i,n-1)),std::abs(H(i,n)));
-                  if ((eps * t) * t > 1) {
-                     for (int j = i; j <= n; ++j) {
-                        H(j,n-1) /= t;
-                        H(j,n) /= t;
-                     }
+                  const T h21s = h21 / s;
+                  v[0] = h21s * H(k,k+1) + (H(k,k) - sr1) * ((H(k,k) - sr2) / s) - si1 * (si2 / s);
+                  v[1] = h21s * (H(k,k) + H(k+1,k+1) - sr1 - sr2);
+                  v[2] = h21s * H(k+2,k+1);
+               } else {
+                  v[0] = H(k,k-1);
+                  v[1] = H(k+1,k-1);
+                  v[2] = notlast ? H(k+2,k-1) : T(0);
+               }
+               T beta;
+               const T tau = householder(notlast ? 3 : 2, v, 1, beta);
+               if (k > ktop) {
+                  H(k,k-1) = beta;
+                  H(k+1,k-1) = 0.0;
+                  if (notlast) {
+                     H(k+2,k-1) = 0.0;
                   }
                }
+               if (tau == 0.0) {
+                  continue;
+               }
+               const T v1 = v[1], v2 = v[2];
+               const int r1 = std::min(k+3, kbot);
+               T* Hk = &H(k,k);
+               T* H0 = &H(wtop,k);
+               T* U0 = U + (k-wtop)*w;
+               if (notlast) {
+                  kernels::refl3(wbot-k+1, Hk, Hk + hs, Hk + 2*hs, rs, T(1), v1, v2, tau, tau*v1, tau*v2);
+                  kernels::refl3(r1-wtop+1, H0, H0 + rs, H0 + 2*rs, hs, T(1), v1, v2, tau, tau*v1, tau*v2);
+                  kernels::refl3(w, U0, U0 + w, U0 + 2*w, 1, T(1), v1, v2, tau, tau*v1, tau*v2);
+               } else {
+                  kernels::refl2(wbot-k+1, Hk, Hk + hs, rs, T(1), v1, tau, tau*v1);
+                  kernels::refl2(r1-wtop+1, H0, H0 + rs, hs, T(1), v1, tau, tau*v1);
+                  kernels::refl2(w, U0, U0 + w, 1, T(1), v1, tau, tau*v1);
+               }
+               phase.flops((notlast ? 11.0 : 7.0)*((wbot-k+1) + (r1-wtop+1) + w));
             }
          }
+         applyWindow(wtop, w, U, Vcol, phase);
       }
-   
-      // Vectors of isolated roots
-   
-      for (int i = 0; i < nn; ++i) {
-         if (i < low || i > high) {
-            for (int j = i; j < nn; ++j) {
-               V(i,j) = H(i,j);
-            }
+   }
+
+   // Apply the orthogonal w x w matrix U (column-major), accumulated on
+   // the window of rows and columns wtop..wtop+w-1, to the rest of H
+   // (H(0:wtop-1,window)*U and U'*H(window,wtop+w:n-1)) and to
+   // V(low:high,window), by matrix-matrix products split among threads.
+
+template<class T, class L, class ST>
+void EigenvalueDecomposition<T,L,ST>::applyWindow (int wtop, int w, const T* U, T* Vcol,
+                                                  instrumentation::PhaseTimer& phase) {
+      const int nn = this->n;
+      const int wm = windowMax();
+      const int wend = wtop + w;
+      T* Ut = &work(0) + wm*wm;
+      T* X = &work(0) + 3*wm*wm;
+      for (int l = 0; l < w; ++l) {
+         for (int j = 0; j < w; ++j) {
+            Ut[l*w+j] = U[j*w+l];
          }
       }
-   
-      // Back transformation to get eigenvectors of original matrix
-   
-      for (int j = nn-1; j >= low; --j) {
-         for (int i = low; i <= high; ++i) {
-            z = 0.0;
-            for (int k = low; k <= std::min(j,high); ++k) {
-               z += V(i,k) * H(k,j);
+
+      // Rows above the window
+
+      const int m = wtop;
+      parallel::parallelFor(0, m, 32, [&](int b, int e) {
+         for (int l = 0; l < w; ++l) {
+            for (int i = b; i < e; ++i) {
+               X[l*m+i] = H(i,wtop+l);
+               H(i,wtop+l) = 0.0;
             }
-            V(i,j) = z;
          }
+         kernels::rankKUpdate(H, b, e, wtop, wend, w, X+b, m, Ut, w);
+      });
+
+      // Columns right of the window
+
+      const int nc = nn - wend;
+      parallel::parallelFor(wend, nn, 32, [&](int b, int e) {
+         for (int l = 0; l < w; ++l) {
+            for (int j = b; j < e; ++j) {
+               X[l*nc+j-wend] = H(wtop+l,j);
+               H(wtop+l,j) = 0.0;
+            }
+         }
+         for (int c = b; c < e; c += 128) {
+            kernels::rankKUpdate(H, wtop, wend, c, std::min(c+128, e), w, Ut, w, X+c-wend, nc);
+         }
+      });
+
+      // Columns of V
+
+      const int mz = high - low + 1;
+      for (int l = 0; l < w; ++l) {
+         std::copy(Vcol + (wtop+l)*nn + low, Vcol + (wtop+l)*nn + high + 1, X + l*mz);
       }
+      parallel::parallelFor(0, mz, 32, [&](int b, int e) {
+         for (int r = b; r < e; r += 128) {
+            const int nr = std::min(r+128, e) - r;
+            for (int j = 0; j < w; ++j) {
+               T* col = Vcol + (wtop+j)*nn + low + r;
+               std::fill(col, col + nr, T(0));
+               kernels::gemv(nr, w, X + r, mz, U + j*w, col);
+            }
+         }
+      });
+      phase.flops(2.0*w*w*(m + nc + mz));
    }
 
 /* ------------------------
@@ -1008,10 +3058,31 @@ void EigenvalueDecomposition<T,L>::hqr2 () {
    @param Arg    Square matrix
    */
 
-template<class T, class L> template <class E>
-EigenvalueDecomposition<T,L>::EigenvalueDecomposition (const matrix_expression<E>& A, bool force_symmetric) {
+template<class T, class L, class ST> template <class E>
+EigenvalueDecomposition<T,L,ST>::EigenvalueDecomposition (const matrix_expression<E>& A, bool force_symmetric)
+   : balance(true), low(0), high(-1), blockSize(32), crossover(128), vectors(true), schurOnly(false), computedVectors(true), computedSchur(false), multishiftMin(400) {
+      compute(A, force_symmetric);
+   }
+
+template<class T, class L, class ST> template <class TRI, class SA>
+EigenvalueDecomposition<T,L,ST>::EigenvalueDecomposition (const symmetric_matrix<T,TRI,L,SA>& A)
+   : balance(true), low(0), high(-1), blockSize(32), crossover(128), vectors(true), schurOnly(false), computedVectors(true), computedSchur(false), multishiftMin(400) {
+      compute(A);
+   }
+
+   /** Recompute the eigenvalue decomposition for a new matrix.
+   @param A    Square matrix
+   @param force_symmetric If true, A is considered symmetric
+   */
+
+template<class T, class L, class ST> template <class E>
+void EigenvalueDecomposition<T,L,ST>::compute (const matrix_expression<E>& A, bool force_symmetric) {
       BOOST_UBLAS_CHECK(A().size1() == A().size2(), bad_size());
+      stats.clear();
+      const double storage = storageBytes();
       n = A().size2();
+      low = 0;
+      high = n-1;
       V.resize(n,n,false);
       d.resize(n,false);
       e.resize(n,false);
@@ -1023,46 +3094,83 @@ EigenvalueDecomposition<T,L>::EigenvalueDecomposition (const matrix_expression<E
       //   }
       //}
       issymmetric = force_symmetric || boost::numeric::ublas::is_symmetric(A());
+      computedVectors = vectors || !issymmetric;
+      computedSchur = schurOnly;
 
+      // resize() does not reallocate if the dimension is unchanged,
+      // and noalias() avoids the temporary of the matrix assignment.
       if (issymmetric) {
-         V = A();
+         noalias(V) = A();
+         if (blocked()) {
+            ort.resize(n,false);
+            work.resize(workSize(),false);
+         }
    
          // Tridiagonalize.
-         tred2();
+         instrumentation::PhaseTimer reduction(stats, instrumentation::Tred2);
+         reduction.allocated(storage, storageBytes());
+         tridiagonalize(reduction);
+         reduction.finish();
    
          // Diagonalize.
-         tql2();
+         instrumentation::PhaseTimer iteration(stats, instrumentation::Tql2);
+         tql2(iteration);
+         diagonalSchurForm();
 
       } else {
-         //H.resize(n,n,false);
          ort.resize(n,false);
-         
-         H = A();
-   
-         // Reduce to Hessenberg form.
-         orthes();
-   
-         // Reduce Hessenberg to real Schur form.
-         hqr2();
+         H.resize(n,n,false);
+         scale.resize(n,false);
+         if (blocked() || multishifted()) {
+            work.resize(std::max(blocked() ? workSize() : 0, multishifted() ? multishiftWorkSize() : 0),false);
+         }
+         noalias(H) = A();
+   
+         // Balance, and reduce to Hessenberg form.
+         instrumentation::PhaseTimer reduction(stats, instrumentation::Orthes);
+         reduction.allocated(storage, storageBytes());
+         balanc();
+         orthes(reduction);
+         reduction.finish();
+   
+         // Reduce Hessenberg to real Schur form, and undo the balancing.
+         instrumentation::PhaseTimer iteration(stats, instrumentation::Hqr2);
+         hqr2(iteration);
+         balbak();
       }
    }
 
-template<class T, class L> template <class TRI>
-EigenvalueDecomposition<T,L>::EigenvalueDecomposition (const symmetric_matrix<T,TRI,L>& A) {
+template<class T, class L, class ST> template <class TRI, class SA>
+void EigenvalueDecomposition<T,L,ST>::compute (const symmetric_matrix<T,TRI,L,SA>& A) {
       BOOST_UBLAS_CHECK(A.size1() == A.size2(), bad_size());
+      stats.clear();
+      const double storage = storageBytes();
       n = A.size2();
+      low = 0;
+      high = n-1;
       V.resize(n,n,false);
       d.resize(n,false);
       e.resize(n,false);
 
       issymmetric = true;
-      V = A;
+      computedVectors = vectors;
+      computedSchur = schurOnly;
+      noalias(V) = A;
+      if (blocked()) {
+         ort.resize(n,false);
+         work.resize(workSize(),false);
+      }
    
       // Tridiagonalize.
-      tred2();
+      instrumentation::PhaseTimer reduction(stats, instrumentation::Tred2);
+      reduction.allocated(storage, storageBytes());
+      tridiagonalize(reduction);
+      reduction.finish();
    
       // Diagonalize.
-      tql2();
+      instrumentation::PhaseTimer iteration(stats, instrumentation::Tql2);
+      tql2(iteration);
+      diagonalSchurForm();
   }
 
 /* ------------------------
@@ -1102,8 +3210,8 @@ EigenvalueDecomposition<T,L>::EigenvalueDecomposition (const symmetric_matrix<T,
 	
 */
 
-template<class T, class L>
-void EigenvalueDecomposition<T,L>::getD (Matrix &D) const {
+template<class T, class L, class ST>
+void EigenvalueDecomposition<T,L,ST>::getD (Matrix &D) const {
       D.resize(n,n,false);
       D.clear();
       for (int i = 0; i < n; ++i) {
@@ -1117,5 +3225,71 @@ void EigenvalueDecomposition<T,L>::getD (Matrix &D) const {
 
    }
 
+   /** Write the decomposition to a binary stream.
+   @param os   Output stream, opened in binary mode.
+   */
+
+template<class T, class L, class ST>
+void EigenvalueDecomposition<T,L,ST>::save (std::ostream& os, std::size_t alignment) const {
+      serialization::Writer<T,L> out(os, serialization::Eigenvalue, alignment);
+      out.integer(n);
+      out.integer(issymmetric);
+      out.integer(computedVectors);
+      out.integer(computedSchur);
+      out.integer(low);
+      out.integer(high);
+      out.write(convergence);
+      out.write(d);
+      out.write(e);
+      out.write(getV());
+      out.write(computedSchur ? H : Matrix());
+   }
+
+   /** Replace the decomposition by one written by save().
+   @param is   Input stream, opened in binary mode.
+   */
+
+template<class T, class L, class ST>
+void EigenvalueDecomposition<T,L,ST>::load (std::istream& is) {
+      serialization::Reader<T,L> in(is, serialization::Eigenvalue);
+      restore(in);
+   }
+
+   /** Replace the decomposition by one saved at the start of a mapped file.
+   @param file  Mapped file.
+   */
+
+template<class T, class L, class ST>
+void EigenvalueDecomposition<T,L,ST>::load (const MappedFile& file) {
+      serialization::Reader<T,L> in(file, serialization::Eigenvalue);
+      restore(in);
+   }
+
+   // Read the members of the decomposition.
+
+template<class T, class L, class ST>
+void EigenvalueDecomposition<T,L,ST>::restore (serialization::Reader<T,L>& in) {
+      stats.clear();
+      n = in.size();
+      issymmetric = in.integer() != 0;
+      vectors = in.integer() != 0;
+      computedVectors = vectors || !issymmetric;
+      schurOnly = computedSchur = in.integer() != 0;
+      low = in.integer();
+      high = in.integer();
+      in.read(convergence);
+      in.read(d);
+      in.read(e);
+      in.read(V);
+      in.read(H);
+      const int nv = hasEigenvectors() ? n : 0;
+      const int nh = computedSchur ? n : 0;
+      const bool balanced = n == 0 ? low == 0 && high == -1 : 0 <= low && low <= high && high < n;
+      if ((int) d.size() != n || (int) e.size() != n || (int) V.size1() != nv || (int) V.size2() != nv
+          || (int) H.size1() != nh || (int) H.size2() != nh || !balanced) {
+         external_logic("serialization: inconsistent eigenvalue decomposition").raise();
+      }
+   }
+
 }}}
 #endif
@@ -0,0 +1,250 @@
+   /** Generalized symmetric-definite eigenvalue decomposition.
+   <P>
+   For a symmetric matrix A and a symmetric positive definite matrix B,
+   the eigenvalues lambda and eigenvectors x of A*x = lambda*B*x are those
+   of the standard symmetric problem C*y = lambda*y, with B = L*L' (the
+   Cholesky decomposition), C = inv(L)*A*inv(L)' and x = inv(L)'*y, as in
+   LAPACK's dsygv.  The decomposition is A*X = B*X*D with D diagonal and
+   X'*B*X = I.
+   <P>
+   C is formed in place by triangular solves, without inverting L, and
+   the eigenvectors are back-transformed in the same storage, so that the
+   decomposition holds L, C (then X) and the storage of the symmetric
+   EigenvalueDecomposition of C.
+   <P>
+   If B is not symmetric positive definite, isSPD() is false and the
+   eigenvalues are not computed.
+   */
+
+#ifndef _BOOST_UBLAS_GENERALIZEDEIGENVALUEDECOMPOSITION_
+#define _BOOST_UBLAS_GENERALIZEDEIGENVALUEDECOMPOSITION_
+
+#include <boost/numeric/ublas/vector.hpp>
+#include <boost/numeric/ublas/matrix.hpp>
+#include <boost/numeric/ublas/exception.hpp>
+#include "CholeskyDecomposition.hpp"
+#include "EigenvalueDecomposition.hpp"
+#include "SimdKernels.hpp"
+
+namespace boost { namespace numeric { namespace ublas {
+
+// T: type, L: layout (row_major/column_major),
+// ST: storage array of the internal matrices and vectors (e.g. unbounded_array<T, aligned_allocator<T> >)
+template<class T, class L = row_major, class ST = unbounded_array<T> >
+class GeneralizedEigenvalueDecomposition {
+
+    typedef vector<T,ST> Vector;
+    typedef matrix<T,L,ST> Matrix;
+
+/* ------------------------
+   Class variables
+ * ------------------------ */
+
+   /** Cholesky decomposition of B.
+   */
+   CholeskyDecomposition<T,L,ST> chol;
+
+   /** Symmetric eigenvalue decomposition of C = inv(L)*A*inv(L)'.
+   */
+   EigenvalueDecomposition<T,L,ST> eig;
+
+   /** C, then the eigenvectors X.
+   */
+   Matrix X;
+
+   /** Working storage of the triangular solves.
+   */
+   Vector work;
+
+   /** Matrix dimension.
+   */
+   int n;
+
+/* ------------------------
+   Private Methods
+ * ------------------------ */
+
+   // C = inv(L)*C, by rows or by columns of C, whichever are contiguous.
+
+   void lowerSolve (Matrix& C) {
+      const Matrix& F = chol.getL();
+      if (kernels::rowStride(C) == 1) {
+         for (int k = 0; k < n; ++k) {
+            for (int i = 0; i < k; ++i) {
+               work(i) = -F(k,i);
+            }
+            T* c = kernels::address(C,k,0);
+            kernels::gemv(n, k, kernels::address(C,0,0), n, &work(0), c);
+            const T f = 1.0/F(k,k);
+            for (int j = 0; j < n; ++j) {
+               c[j] *= f;
+            }
+         }
+      } else {
+         for (int j = 0; j < n; ++j) {
+            T* c = kernels::address(C,0,j);
+            for (int k = 0; k < n; ++k) {
+               c[k] /= F(k,k);
+               kernels::axpy(n-k-1, -c[k], kernels::address(F,k+1,k), 1, c+k+1, 1);
+            }
+         }
+      }
+   }
+
+   // C = inv(L)'*C.
+
+   void upperSolve (Matrix& C) {
+      const Matrix& F = chol.getL();
+      if (kernels::rowStride(C) == 1) {
+         for (int k = n-1; k >= 0; --k) {
+            for (int i = k+1; i < n; ++i) {
+               work(i-k-1) = -F(i,k);
+            }
+            T* c = kernels::address(C,k,0);
+            kernels::gemv(n, n-k-1, kernels::address(C,k+1,0), n, &work(0), c);
+            const T f = 1.0/F(k,k);
+            for (int j = 0; j < n; ++j) {
+               c[j] *= f;
+            }
+         }
+      } else {
+         for (int j = 0; j < n; ++j) {
+            T* c = kernels::address(C,0,j);
+            for (int k = n-1; k >= 0; --k) {
+               c[k] = (c[k] - kernels::dot(n-k-1, kernels::address(F,k+1,k), 1, c+k+1, 1))/F(k,k);
+            }
+         }
+      }
+   }
+
+public:
+/* ------------------------
+   Constructor
+ * ------------------------ */
+
+   /** Construct an empty decomposition, to be configured with the set
+       methods and computed with compute().
+   */
+
+   GeneralizedEigenvalueDecomposition () : n(0) {}
+
+   /** Generalized symmetric-definite eigenvalue decomposition
+   @param A    Square, symmetric matrix
+   @param B    Square, symmetric positive definite matrix of the same size
+   */
+
+   GeneralizedEigenvalueDecomposition (const Matrix& A, const Matrix& B) : n(0) {
+      compute(A, B);
+   }
+
+   /** Recompute the decomposition for new matrices.
+       The storage of the previous decomposition is reused when the
+       dimension matches.
+   @param A    Square, symmetric matrix
+   @param B    Square, symmetric positive definite matrix of the same size
+   @exception  bad_size  Matrix dimensions must agree.
+   */
+
+   void compute (const Matrix& A, const Matrix& B) {
+      BOOST_UBLAS_CHECK(A.size1() == A.size2(), bad_size("Matrix must be square."));
+      BOOST_UBLAS_CHECK(B.size1() == A.size1() && B.size2() == A.size2(), bad_size("Matrix dimensions must agree."));
+      n = A.size1();
+      chol.compute(B);
+      if (!chol.isSPD()) {
+         return;
+      }
+      work.resize(n,false);
+
+      // C = inv(L)*A*inv(L)' = inv(L)*(inv(L)*A)', A being symmetric.
+      X.resize(n,n,false);
+      noalias(X) = A;
+      if (n > 0) {
+         lowerSolve(X);
+         kernels::transpose(n, X.data().begin());
+         lowerSolve(X);
+      }
+      eig.compute(X, true);
+
+      // X = inv(L)'*Y.
+      if (eig.hasEigenvectors()) {
+         noalias(X) = eig.getV();
+         if (n > 0) {
+            upperSolve(X);
+         }
+      } else {
+         X.resize(0,0,false);
+      }
+   }
+
+/* ------------------------
+   Public Methods
+ * ------------------------ */
+
+   /** Is B symmetric and positive definite?
+   @return     true if the decomposition was computed.
+   */
+
+   bool isSPD () const {
+      return chol.isSPD();
+   }
+
+   /** Compute the eigenvectors in the following calls of compute() (default).
+   @param b    If false, only the eigenvalues are computed.
+   */
+
+   void setEigenvectors (bool b) {
+      eig.setEigenvectors(b);
+   }
+
+   bool hasEigenvectors () const {
+      return eig.hasEigenvectors();
+   }
+
+   /** Return the eigenvector matrix, normalized so that X'*B*X = I
+   @return     X
+   @exception  singular  B is not symmetric positive definite.
+   */
+
+   const Matrix& getV () const {
+      BOOST_UBLAS_CHECK(isSPD(), singular("Matrix is not symmetric positive definite."));
+      return X;
+   }
+
+   /** Return the eigenvalues, in ascending order
+   @return     diag(D)
+   @exception  singular  B is not symmetric positive definite.
+   */
+
+   const Vector& getRealEigenvalues () const {
+      BOOST_UBLAS_CHECK(isSPD(), singular("Matrix is not symmetric positive definite."));
+      return eig.getRealEigenvalues();
+   }
+
+   /** Return the diagonal eigenvalue matrix
+   @return     D
+   */
+
+   const Matrix getD () const {
+      BOOST_UBLAS_CHECK(isSPD(), singular("Matrix is not symmetric positive definite."));
+      return eig.getD();
+   }
+
+   /** Return the Cholesky decomposition of B
+   @return     chol(B)
+   */
+
+   const CholeskyDecomposition<T,L,ST>& getCholesky () const {
+      return chol;
+   }
+
+   /** Did the QL iteration converge?
+   @return     true if all the eigenvalues converged.
+   */
+
+   bool isConverged () const {
+      return eig.isConverged();
+   }
+};
+
+}}}
+#endif
@@ -0,0 +1,250 @@
+   /** Instrumentation of the decompositions.
+   <P>
+   When the library and the programs using it are compiled with
+   UBLASJAMA_INSTRUMENTATION defined (make INSTRUMENTATION=-DUBLASJAMA_INSTRUMENTATION),
+   each decomposition records, for each phase of its algorithm, the wall
+   time, the number of floating point operations, the number of
+   iterations and the bytes of storage allocated.  The counters of the last
+   compute() are returned by getStats() of the decomposition, and the
+   counters of all the decompositions are summed in a global registry:
+<pre>
+   EigenvalueDecomposition<double> E(A);
+   const instrumentation::Stats& s = E.getStats();
+   s[instrumentation::Hqr2].iterations      // QR iterations of hqr2()
+   instrumentation::registry().snapshot()   // all phases of all decompositions
+</pre>
+   Without UBLASJAMA_INSTRUMENTATION the counters stay zero and the
+   recording compiles to nothing.
+   <P>
+   The phases are:
+<pre>
+   LUPanels               Crout LU, one panel (column) per iteration
+   QRReflectors           Householder QR, one reflector per iteration
+   CholeskyFactor         Cholesky, one row per iteration
+   Tred2                  symmetric tridiagonalization, one reflector per iteration
+   Tql2                   symmetric tridiagonal QL, one implicit shift per iteration
+   Orthes                 Hessenberg reduction, one reflector per iteration
+   Hqr2                   Hessenberg QR, one double shift step per iteration,
+                          including the back substitution of the eigenvectors
+   SVDBidiagonalization   reduction to bidiagonal form, one column/row reflector per iteration
+   SVDVectors             generation of U and V from the reflectors
+   SVDSweeps              bidiagonal QR, one sweep (QR step) per iteration
+</pre>
+   The flops are those of the arithmetic of the algorithm as implemented
+   (a multiply-add counts 2); the bytes are those of the internal storage
+   that is reallocated because its size changed.
+   */
+
+#ifndef _BOOST_UBLAS_INSTRUMENTATION_
+#define _BOOST_UBLAS_INSTRUMENTATION_
+
+#include <cstddef>
+#ifdef UBLASJAMA_INSTRUMENTATION
+#include <chrono>
+#include <mutex>
+#endif
+
+namespace boost { namespace numeric { namespace ublas { namespace instrumentation {
+
+enum Phase {
+   LUPanels, QRReflectors, CholeskyFactor,
+   Tred2, Tql2, Orthes, Hqr2,
+   SVDBidiagonalization, SVDVectors, SVDSweeps,
+   numPhases
+};
+
+/** Name of a phase.
+*/
+
+inline const char* phaseName (Phase p) {
+   static const char* names[numPhases] = {
+      "lu-panels", "qr-reflectors", "cholesky-factor",
+      "tred2", "tql2", "orthes", "hqr2",
+      "svd-bidiagonalization", "svd-vectors", "svd-sweeps"
+   };
+   return names[p];
+}
+
+/** Counters of a phase.
+*/
+
+struct PhaseStats {
+   long calls;
+   long iterations;
+   double seconds;
+   double flops;
+   double bytes;
+
+   PhaseStats () : calls(0), iterations(0), seconds(0), flops(0), bytes(0) {}
+
+   PhaseStats& operator+= (const PhaseStats& s) {
+      calls += s.calls;
+      iterations += s.iterations;
+      seconds += s.seconds;
+      flops += s.flops;
+      bytes += s.bytes;
+      return *this;
+   }
+};
+
+/** Counters of all the phases.
+*/
+
+class Stats {
+   PhaseStats phases[numPhases];
+
+public:
+   const PhaseStats& operator[] (Phase p) const {
+      return phases[p];
+   }
+
+   PhaseStats& operator[] (Phase p) {
+      return phases[p];
+   }
+
+   /** Sum of the counters of all the phases.
+   */
+
+   PhaseStats total () const {
+      PhaseStats t;
+      for (int p = 0; p < numPhases; ++p) {
+         t += phases[p];
+      }
+      return t;
+   }
+
+   void clear () {
+      *this = Stats();
+   }
+
+   Stats& operator+= (const Stats& s) {
+      for (int p = 0; p < numPhases; ++p) {
+         phases[p] += s.phases[p];
+      }
+      return *this;
+   }
+};
+
+/** Global registry summing the counters of all the decompositions.
+    Thread-safe.
+*/
+
+class Registry {
+#ifdef UBLASJAMA_INSTRUMENTATION
+   mutable std::mutex mutex;
+#endif
+   Stats totals;
+
+public:
+   void add (Phase p, const PhaseStats& s) {
+#ifdef UBLASJAMA_INSTRUMENTATION
+      std::lock_guard<std::mutex> lock(mutex);
+      totals[p] += s;
+#else
+      (void) p; (void) s;
+#endif
+   }
+
+   /** Copy of the current totals.
+   */
+
+   Stats snapshot () const {
+#ifdef UBLASJAMA_INSTRUMENTATION
+      std::lock_guard<std::mutex> lock(mutex);
+#endif
+      return totals;
+   }
+
+   void reset () {
+#ifdef UBLASJAMA_INSTRUMENTATION
+      std::lock_guard<std::mutex> lock(mutex);
+#endif
+      totals.clear();
+   }
+};
+
+/** The global registry.
+*/
+
+inline Registry& registry () {
+   static Registry r;
+   return r;
+}
+
+/** Bytes of the storage of a matrix or vector.
+*/
+
+template<class C>
+double storageBytes (const C& c) {
+   return double(c.data().size()) * sizeof(*c.data().begin());
+}
+
+/** Records one call of a phase: the time from construction to finish()
+    or destruction, and the flops, iterations and allocations reported in
+    between.  The counters are added to the stats of the decomposition
+    and to the registry when the phase ends.
+*/
+
+class PhaseTimer {
+#ifdef UBLASJAMA_INSTRUMENTATION
+   typedef std::chrono::steady_clock Clock;
+
+   Stats& stats;
+   Phase phase;
+   PhaseStats counters;
+   Clock::time_point start;
+   bool running;
+
+public:
+   PhaseTimer (Stats& stats, Phase phase) : stats(stats), phase(phase), start(Clock::now()), running(true) {
+      counters.calls = 1;
+   }
+
+   ~PhaseTimer () {
+      finish();
+   }
+
+   /** End the phase before the destruction of the timer.
+   */
+
+   void finish () {
+      if (running) {
+         running = false;
+         counters.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+         stats[phase] += counters;
+         registry().add(phase, counters);
+      }
+   }
+
+   void flops (double f) {
+      counters.flops += f;
+   }
+
+   void iterations (long k = 1) {
+      counters.iterations += k;
+   }
+
+   /** Storage resized from before to after bytes (reallocated if the size changed).
+   */
+
+   void allocated (double before, double after) {
+      if (after != before) {
+         counters.bytes += after;
+      }
+   }
+
+private:
+   PhaseTimer (const PhaseTimer&);
+   PhaseTimer& operator= (const PhaseTimer&);
+#else
+public:
+   PhaseTimer (Stats&, Phase) {}
+   void finish () {}
+   void flops (double) {}
+   void iterations (long = 1) {}
+   void allocated (double, double) {}
+#endif
+};
+
+}}}}
+#endif
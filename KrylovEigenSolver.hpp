@@ -0,0 +1,707 @@
+   /** Krylov eigensolvers.
+   <P>
+   LanczosEigenSolver (A symmetric) and ArnoldiEigenSolver (A general)
+   compute k eigenpairs of an n-by-n matrix A that is only known by its
+   products y = A*x (LinearOperator.hpp), such as the graph Laplacian of
+   a network too large to store densely.  Both build an orthonormal basis
+   V of ncv vectors of the Krylov space of A with full reorthogonalization,
+   so that A*V = V*H + v*b' with H small, and solve the projected problem
+   H*y = theta*y with EigenvalueDecomposition.  When the wanted Ritz
+   values theta are not accurate enough, the iteration is restarted
+   implicitly: the basis is contracted to the invariant subspace of H for
+   its wanted eigenvalues, spanned by the leading Schur vectors of H once
+   its Schur form is reordered to put them first (its eigenvectors for
+   Lanczos), and expanded again from there.  This is the
+   Krylov-Schur restart of Stewart (the thick restart of Wu and Simon for
+   Lanczos), mathematically equivalent to ARPACK's implicit QR restart with
+   exact shifts, and more stable.
+   <P>
+   The Ritz pair (theta, x) is converged when the norm of its residual
+   A*x - theta*x, known from b without a product, is at most tol times the
+   largest |theta| (an estimate of the norm of A, so that this is a
+   backward error), tol being 1000 times the machine precision by default.
+   The restarts are limited by setIterationLimits() (Convergence.hpp):
+   a restart counts as an iteration of every value, so that perValue is
+   the maximum number of restarts (30*max(10,k) by default, 300 for
+   k <= 10).  The Ritz values of highly nonnormal matrices converge
+   slowly, and may need a larger ncv than the default: the 4 eigenvalues
+   of largest modulus of the Grcar matrix of order 200 take ncv = 40 to
+   converge within the default 300 restarts.
+   The eigenvalues closest to sigma are the largest of inv(A - sigma*I),
+   whose products a factorization gives (for instance
+   SparseCholeskyDecomposition):
+<pre>
+   SparseCholeskyDecomposition<double> chol(A);    // sigma = 0
+   LanczosEigenSolver<double> eig(6);
+   eig.compute([&] (const vector<double>& x, vector<double>& y) { y = chol.solve(x); }, n);
+   // 1/eig.getEigenvalues()(j) are the 6 smallest eigenvalues of A
+</pre>
+   */
+
+#ifndef _BOOST_UBLAS_KRYLOVEIGENSOLVER_
+#define _BOOST_UBLAS_KRYLOVEIGENSOLVER_
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <limits>
+#include <utility>
+#include <vector>
+#include <boost/numeric/ublas/vector.hpp>
+#include <boost/numeric/ublas/matrix.hpp>
+#include <boost/numeric/ublas/exception.hpp>
+#include <boost/numeric/ublas/matrix_proxy.hpp>
+#include "EigenvalueDecomposition.hpp"
+#include "Convergence.hpp"
+#include "LinearOperator.hpp"
+#include "SimdKernels.hpp"
+
+namespace boost { namespace numeric { namespace ublas {
+
+/** Eigenvalues computed by the Krylov eigensolvers: of largest or
+    smallest modulus, or of largest or smallest real part.
+*/
+
+enum KrylovTarget {
+   LargestMagnitude, SmallestMagnitude, LargestReal, SmallestReal
+};
+
+namespace detail {
+
+// Krylov-Schur iteration of LanczosEigenSolver and ArnoldiEigenSolver.
+// T: type, L: layout of the eigenvectors (row_major/column_major)
+template<class T, class L>
+class KrylovSchur {
+public:
+    typedef vector<T> Vector;
+    typedef matrix<T,L> Matrix;
+
+protected:
+    typedef matrix<T,column_major> Basis;
+    typedef matrix<T> Small;
+
+/* ------------------------
+   Class variables
+ * ------------------------ */
+
+   /** Number of wanted eigenvalues, and of basis vectors (0: default).
+   */
+   int nev, ncv;
+
+   /** Wanted part of the spectrum.
+   */
+   KrylovTarget which;
+
+   /** Relative tolerance of the residuals.
+   */
+   T tol;
+
+   /** Limits of the restarts.
+   */
+   IterationLimits limits;
+
+   /** Start vector (empty: a fixed pseudo-random one).
+   */
+   Vector start;
+
+   /** Real and imaginary parts of the Ritz values, their residual norms,
+       and the Ritz vectors (Jama's real form for the complex pairs).
+   */
+   Vector wr, wi, residuals;
+   Matrix X;
+
+   /** Convergence of the last compute(), and number of products with A.
+   */
+   ConvergenceInfo info;
+   long products;
+
+   KrylovSchur (int nev, KrylovTarget which, int ncv)
+   : nev(nev), ncv(ncv), which(which), tol(1000*std::numeric_limits<T>::epsilon()), products(0) {
+      BOOST_UBLAS_CHECK(nev > 0, bad_argument());
+   }
+
+/* ------------------------
+   Private Methods
+ * ------------------------ */
+
+   // Groups of columns of the eigenvalues d+i*e (two for a complex pair),
+   // by their first column, the wanted ones first.
+
+   std::vector<std::pair<T,int> > sortGroups (const Vector& d, const Vector& e, int m) const {
+      std::vector<std::pair<T,int> > groups;
+      for (int j = 0; j < m; ++j) {
+         groups.push_back(std::make_pair(key(d(j), e(j)), j));
+         if (e(j) != 0.0 && j+1 < m) {
+            ++j;
+         }
+      }
+      std::stable_sort(groups.begin(), groups.end());
+      return groups;
+   }
+
+   // Columns of the first groups, about target of them but less than m,
+   // not splitting a pair.
+
+   static std::vector<int> leadingColumns (const std::vector<std::pair<T,int> >& groups, const Vector& e,
+                                           int target, int m) {
+      std::vector<int> cols;
+      for (int g = 0; (int) cols.size() < target && g < (int) groups.size(); ++g) {
+         const int j = groups[g].second;
+         const int w = (e(j) != 0.0 && j+1 < m) ? 2 : 1;
+         if ((int) cols.size() + w >= m) {
+            break;
+         }
+         for (int t = 0; t < w; ++t) {
+            cols.push_back(j+t);
+         }
+      }
+      return cols;
+   }
+
+   // Sort key of an eigenvalue: the wanted ones first.
+
+   T key (T re, T im) const {
+      switch (which) {
+      case LargestMagnitude:  return -std::hypot(re, im);
+      case SmallestMagnitude: return std::hypot(re, im);
+      case LargestReal:       return -re;
+      default:                return re;
+      }
+   }
+
+   // Fixed pseudo-random vector, for the start and after a breakdown.
+
+   static void random (T* v, int n, unsigned long seed) {
+      for (int i = 0; i < n; ++i) {
+         seed = (seed*1103515245UL + 12345UL) & 0x7fffffffUL;
+         v[i] = T(seed)/T(0x40000000UL) - 1;
+      }
+   }
+
+   // y -= V(:,0:j)*(V(:,0:j)'*y), twice (classical Gram-Schmidt with
+   // reorthogonalization); h += the coefficients.
+
+   static void orthogonalize (const Basis& V, int j, T* y, T* h) {
+      const int n = V.size1();
+      std::vector<T> c(j+1);
+      for (int pass = 0; pass < 2; ++pass) {
+         for (int l = 0; l <= j; ++l) {
+            c[l] = kernels::dot(n, kernels::address(V,0,l), 1, y, 1);
+            h[l] += c[l];
+         }
+         kernels::subtractProduct(n, j+1, kernels::address(V,0,0), n, &c[0], y);
+      }
+   }
+
+   // W(:,0:p-1) = V(:,0:m-1)*Q, by blocks of rows, so that W may be V.
+
+   template<class M>
+   static void combine (const Basis& V, int m, const Small& Q, int p, M& W) {
+      const int n = V.size1(), rb = 256;
+      matrix<T,column_major> buffer(rb, p);
+      for (int i0 = 0; i0 < n; i0 += rb) {
+         const int r = std::min(rb, n-i0);
+         buffer.clear();
+         for (int c = 0; c < p; ++c) {
+            for (int l = 0; l < m; ++l) {
+               kernels::axpy(r, Q(l,c), kernels::address(V,i0,l), 1, kernels::address(buffer,0,c), 1);
+            }
+         }
+         for (int c = 0; c < p; ++c) {
+            for (int i = 0; i < r; ++i) {
+               W(i0+i,c) = buffer(i,c);
+            }
+         }
+      }
+   }
+
+   // Refine the eigenvector of H for re+i*im (its real form in the columns
+   // j, and j+1 for a complex pair, of Y) by inverse iteration in complex
+   // arithmetic: the back substitution of hqr2 loses accuracy once some
+   // Ritz values have converged and H is nearly reducible.
+
+   static void refine (const Small& H, T re, T im, T anorm, Small& Y, int j) {
+      typedef std::complex<T> Complex;
+      const int m = H.size1();
+      const bool pair = im != 0.0;
+      matrix<Complex> M(m, m);
+      for (int r = 0; r < m; ++r) {
+         for (int c = 0; c < m; ++c) {
+            M(r,c) = H(r,c);
+         }
+         M(r,r) -= Complex(re + std::numeric_limits<T>::epsilon()*anorm, im);
+      }
+      // Gaussian elimination with partial pivoting (M is nearly singular,
+      // which is the point of inverse iteration).
+      std::vector<int> piv(m);
+      for (int c = 0; c < m; ++c) {
+         int p = c;
+         for (int r = c+1; r < m; ++r) {
+            if (std::abs(M(r,c)) > std::abs(M(p,c))) {
+               p = r;
+            }
+         }
+         piv[c] = p;
+         row(M,c).swap(row(M,p));
+         if (M(c,c) == Complex(0)) {
+            return;
+         }
+         for (int r = c+1; r < m; ++r) {
+            M(r,c) /= M(c,c);
+            for (int l = c+1; l < m; ++l) {
+               M(r,l) -= M(r,c)*M(c,l);
+            }
+         }
+      }
+      vector<Complex> y(m);
+      for (int l = 0; l < m; ++l) {
+         y(l) = Complex(Y(l,j), pair ? Y(l,j+1) : T(0));
+      }
+      for (int iter = 0; iter < 2; ++iter) {
+         y /= norm_2(y);
+         for (int c = 0; c < m; ++c) {
+            std::swap(y(c), y(piv[c]));
+            for (int r = c+1; r < m; ++r) {
+               y(r) -= M(r,c)*y(c);
+            }
+         }
+         for (int c = m-1; c >= 0; --c) {
+            y(c) /= M(c,c);
+            for (int r = 0; r < c; ++r) {
+               y(r) -= M(r,c)*y(c);
+            }
+         }
+      }
+      y /= norm_2(y);
+      for (int l = 0; l < m; ++l) {
+         Y(l,j) = y(l).real();
+         if (pair) {
+            Y(l,j+1) = y(l).imag();
+         }
+      }
+   }
+
+   // Extend the Krylov decomposition from j to j+1 vectors.
+
+   template<class Op>
+   void expand (const Op& A, Basis& V, Small& H, int j, Vector& x, Vector& y) {
+      const int n = V.size1();
+      const T eps = std::numeric_limits<T>::epsilon();
+      std::copy(kernels::address(V,0,j), kernels::address(V,0,j+1), x.begin());
+      A(x, y);
+      ++products;
+      const T ynorm = norm_2(y);
+      std::vector<T> h(j+1, T(0));
+      orthogonalize(V, j, &y(0), &h[0]);
+      for (int l = 0; l <= j; ++l) {
+         H(l,j) = h[l];
+      }
+      const T beta = norm_2(y);
+      T* v = kernels::address(V,0,j+1);
+      if (beta > 10*eps*ynorm) {
+         H(j+1,j) = beta;
+         for (int i = 0; i < n; ++i) {
+            v[i] = y(i)/beta;
+         }
+         return;
+      }
+
+      // Invariant subspace: continue with any vector orthogonal to it.
+      H(j+1,j) = 0.0;
+      std::fill(v, v+n, T(0));
+      if (j+1 < n) {
+         random(v, n, products);
+         std::fill(h.begin(), h.end(), T(0));
+         orthogonalize(V, j, v, &h[0]);
+         const T s = kernels::dot(n, v, 1, v, 1);
+         for (int i = 0; i < n; ++i) {
+            v[i] /= std::sqrt(s);
+         }
+      }
+   }
+
+   template<class Op>
+   void run (const Op& A, int n, bool symmetric) {
+      const int k = std::min(nev, n);
+      const int m = std::min(std::max(ncv > 0 ? ncv : std::max(2*k+1, 20), k+3), n);
+      products = 0;
+      wr.resize(0);
+      wi.resize(0);
+      residuals.resize(0);
+      X.resize(n, 0);
+      info = ConvergenceInfo();
+      if (n == 0) {
+         return;
+      }
+
+      Basis V(n, m+1);
+      Small H(m+1, m);
+      H.clear();
+      Vector x(n), y(n);
+      if ((int) start.size() == n) {
+         x = start;
+      } else {
+         random(&x(0), n, 1);
+      }
+      const T s = norm_2(x);
+      for (int i = 0; i < n; ++i) {
+         V(i,0) = x(i)/s;
+      }
+
+      IterationGuard guard(limits, info, k);
+      for (int p = 0, restart = 1; ; ++restart) {
+         for (int j = p; j < m; ++j) {
+            expand(A, V, H, j, x, y);
+         }
+
+         // Projected problem, and its eigenvalues in the wanted order
+         // (a complex pair is a group of two columns of its real form).
+         // For Arnoldi, the Schur form of H is reordered to put the first
+         // groups first, about halfway between k and m of them: its leading
+         // Schur vectors Z span their invariant subspace, and the Ritz
+         // vectors are Z times the eigenvectors of the leading block T11,
+         // which stay accurate even when H is nearly defective.
+         Small Hm = subrange(H, 0, m, 0, m);
+         const int target = k + (m-k)/2;
+         Small Y, Z;
+         Vector d, e;
+         T anorm = 0.0;
+         if (symmetric) {
+            Hm = (Hm + trans(Hm))/2;
+            const EigenvalueDecomposition<T> E(Hm, true);
+            d = E.getRealEigenvalues();
+            e = zero_vector<T>(m);
+            Y = E.getV();
+            for (int j = 0; j < m; ++j) {
+               anorm = std::max(anorm, std::abs(d(j)));
+            }
+         } else {
+            EigenvalueDecomposition<T> S;
+            S.setSchurOnly(true);
+            S.compute(Hm);
+            const Vector& ds = S.getRealEigenvalues();
+            const Vector& es = S.getImagEigenvalues();
+            for (int j = 0; j < m; ++j) {
+               anorm = std::max(anorm, std::hypot(ds(j), es(j)));
+            }
+            const std::vector<int> cols = leadingColumns(sortGroups(ds, es, m), es, target, m);
+            std::vector<bool> select(m, false);
+            for (std::size_t c = 0; c < cols.size(); ++c) {
+               select[cols[c]] = true;
+            }
+            const int kept = S.reorderSchur(select);
+            Z = subrange(S.getSchurVectors(), 0, m, 0, kept);
+            const Small T11 = subrange(S.getSchurForm(), 0, kept, 0, kept);
+            const EigenvalueDecomposition<T> E(T11);
+            d = E.getRealEigenvalues();
+            e = E.getImagEigenvalues();
+            Y = E.getV();
+            for (int j = 0; j < kept; ++j) {
+               refine(T11, d(j), e(j), anorm, Y, j);
+               if (e(j) != 0.0) {
+                  ++j;
+               }
+            }
+            Y = prod(Z, Y);
+         }
+         const int nr = d.size();
+         const std::vector<std::pair<T,int> > groups = sortGroups(d, e, nr);
+
+         // Residual norms |b'*y|/|y| of the wanted Ritz pairs.
+         int wanted = 0, size = 0, unconverged = 0;
+         std::vector<T> r;
+         for (; size < k && wanted < (int) groups.size(); ++wanted) {
+            const int j = groups[wanted].second;
+            const bool pair = e(j) != 0.0 && j+1 < nr;
+            T br = 0.0, bi = 0.0, ny = 0.0;
+            for (int l = 0; l < m; ++l) {
+               br += H(m,l)*Y(l,j);
+               ny += Y(l,j)*Y(l,j);
+               if (pair) {
+                  bi += H(m,l)*Y(l,j+1);
+                  ny += Y(l,j+1)*Y(l,j+1);
+               }
+            }
+            const T res = std::hypot(br, bi)/std::sqrt(ny);
+            for (int c = 0; c < (pair ? 2 : 1); ++c) {
+               r.push_back(res);
+               unconverged += res > tol*anorm;
+            }
+            size += pair ? 2 : 1;
+         }
+
+         if (unconverged == 0 || m == n || !guard.next(restart)) {
+            guard.fail(unconverged);
+            Small Q(m, size);
+            wr.resize(size);
+            wi.resize(size);
+            residuals.resize(size);
+            for (int g = 0, c = 0; g < wanted; ++g) {
+               const int j = groups[g].second;
+               const int w = (e(j) != 0.0 && j+1 < nr) ? 2 : 1;
+               T ny = 0.0;
+               for (int l = 0; l < m; ++l) {
+                  for (int t = 0; t < w; ++t) {
+                     Q(l,c+t) = Y(l,j+t);
+                     ny += Y(l,j+t)*Y(l,j+t);
+                  }
+               }
+               for (int t = 0; t < w; ++t) {
+                  column(Q,c+t) /= std::sqrt(ny);
+                  wr(c+t) = d(j+t);
+                  wi(c+t) = e(j+t);
+                  residuals(c+t) = r[c+t];
+               }
+               c += w;
+            }
+            X.resize(n, size, false);
+            combine(V, m, Q, size, X);
+            return;
+         }
+
+         // Restart: keep the invariant subspace of H of the first groups,
+         // with an orthonormal basis Q: the eigenvectors of the symmetric
+         // H, or else the leading Schur vectors Z, which keep the subspace
+         // invariant even when the eigenvectors are nearly dependent.
+         Small Q;
+         if (symmetric) {
+            const std::vector<int> cols = leadingColumns(groups, e, target, m);
+            Q.resize(m, cols.size(), false);
+            for (std::size_t c = 0; c < cols.size(); ++c) {
+               column(Q,c) = column(Y,cols[c]);
+            }
+         } else {
+            Q = Z;
+         }
+         p = Q.size2();
+         const Small Hp = prod(trans(Q), Small(prod(Hm, Q)));
+         const Vector b = prod(row(H,m), Q);
+         H.clear();
+         subrange(H, 0, p, 0, p) = Hp;
+         for (int c = 0; c < p; ++c) {
+            H(p,c) = b(c);
+         }
+         combine(V, m, Q, p, V);
+         std::copy(kernels::address(V,0,m), kernels::address(V,0,m+1), kernels::address(V,0,p));
+      }
+   }
+
+public:
+/* ------------------------
+   Public Methods
+ * ------------------------ */
+
+   /** Set the tolerance of the residuals, relative to the norm of A
+       (default: 1000 times the machine precision), for the following
+       calls of compute().
+   */
+
+   void setTolerance (T t) {
+      tol = t;
+   }
+
+   /** Set the limits of the restarts, for the following calls of compute().
+   */
+
+   void setIterationLimits (const IterationLimits& l) {
+      limits = l;
+   }
+
+   /** Set the start vector of the Krylov space, for the following calls
+       of compute() (an empty vector restores the default).
+   */
+
+   void setStartVector (const Vector& v) {
+      start = v;
+   }
+
+   /** Return the eigenvectors, of norm 1
+   @return     n-by-k matrix X, so that A*X = X*D
+   */
+
+   const Matrix& getV () const {
+      return X;
+   }
+
+   /** Return the residual norms |A*x-theta*x| of the Ritz pairs
+   @return     residuals
+   */
+
+   const Vector& getResidualNorms () const {
+      return residuals;
+   }
+
+   /** Return the convergence of the last compute(): the restarts, and the
+       number of wanted eigenvalues not converged.
+   @return     info
+   */
+
+   const ConvergenceInfo& getConvergence () const {
+      return info;
+   }
+
+   /** Did all the wanted eigenvalues converge?
+   */
+
+   bool isConverged () const {
+      return info.converged() && info.unconverged == 0;
+   }
+
+   /** Number of products with A of the last compute().
+   */
+
+   long getProducts () const {
+      return products;
+   }
+};
+
+}
+
+/** Implicitly restarted Lanczos eigensolver of a symmetric operator.
+*/
+
+// T: type, L: layout of the eigenvectors (row_major/column_major)
+template<class T = double, class L = row_major>
+class LanczosEigenSolver : public detail::KrylovSchur<T,L> {
+   typedef detail::KrylovSchur<T,L> Base;
+
+public:
+   typedef typename Base::Vector Vector;
+   typedef typename Base::Matrix Matrix;
+
+/* ------------------------
+   Constructor
+ * ------------------------ */
+
+   /** Solver of k eigenpairs.
+   @param k      Number of eigenvalues.
+   @param which  Wanted part of the spectrum (the real parts are the
+                 algebraic values).
+   @param ncv    Number of basis vectors, more than k (0: max(2k+1,20)).
+   */
+
+   explicit LanczosEigenSolver (int k, KrylovTarget which = LargestMagnitude, int ncv = 0)
+   : Base(k, which, ncv) {}
+
+/* ------------------------
+   Public Methods
+ * ------------------------ */
+
+   /** Compute the eigenpairs of a symmetric operator.
+   @param A    Function object, A(x, y) computing y = A*x.
+   @param n    Order of A.
+   */
+
+   template<class Op>
+   void compute (const Op& A, int n) {
+      this->run(A, n, true);
+   }
+
+   /** Compute the eigenpairs of a symmetric matrix, dense or sparse.
+   */
+
+   template<class M>
+   void compute (const matrix_expression<M>& A) {
+      BOOST_UBLAS_CHECK(A().size1() == A().size2(), bad_size("Matrix must be square."));
+      compute(linearOperator(A), A().size1());
+   }
+
+   /** Return the eigenvalues, the wanted ones first.
+   @return     k eigenvalues
+   */
+
+   const Vector& getEigenvalues () const {
+      return this->wr;
+   }
+};
+
+/** Implicitly restarted Arnoldi eigensolver of a general operator.
+    The eigenvalues and eigenvectors are given as by EigenvalueDecomposition:
+    a complex pair is returned with its real and imaginary parts in two
+    consecutive columns of V and the 2-by-2 block [a b; -b a] of D, so
+    that k+1 values are returned when the k-th is the first of a pair.
+*/
+
+// T: type, L: layout of the eigenvectors (row_major/column_major)
+template<class T = double, class L = row_major>
+class ArnoldiEigenSolver : public detail::KrylovSchur<T,L> {
+   typedef detail::KrylovSchur<T,L> Base;
+
+public:
+   typedef typename Base::Vector Vector;
+   typedef typename Base::Matrix Matrix;
+
+/* ------------------------
+   Constructor
+ * ------------------------ */
+
+   /** Solver of k eigenpairs.
+   @param k      Number of eigenvalues.
+   @param which  Wanted part of the spectrum.
+   @param ncv    Number of basis vectors, more than k (0: max(2k+1,20)).
+   */
+
+   explicit ArnoldiEigenSolver (int k, KrylovTarget which = LargestMagnitude, int ncv = 0)
+   : Base(k, which, ncv) {}
+
+/* ------------------------
+   Public Methods
+ * ------------------------ */
+
+   /** Compute the eigenpairs of an operator.
+   @param A    Function object, A(x, y) computing y = A*x.
+   @param n    Order of A.
+   */
+
+   template<class Op>
+   void compute (const Op& A, int n) {
+      this->run(A, n, false);
+   }
+
+   /** Compute the eigenpairs of a matrix, dense or sparse.
+   */
+
+   template<class M>
+   void compute (const matrix_expression<M>& A) {
+      BOOST_UBLAS_CHECK(A().size1() == A().size2(), bad_size("Matrix must be square."));
+      compute(linearOperator(A), A().size1());
+   }
+
+   /** Return the real parts of the eigenvalues, the wanted ones first.
+   @return     real(diag(D))
+   */
+
+   const Vector& getRealEigenvalues () const {
+      return this->wr;
+   }
+
+   /** Return the imaginary parts of the eigenvalues.
+   @return     imag(diag(D))
+   */
+
+   const Vector& getImagEigenvalues () const {
+      return this->wi;
+   }
+
+   /** Return the block diagonal eigenvalue matrix
+   @return     D
+   */
+
+   Matrix getD () const {
+      const int k = this->wr.size();
+      Matrix D(k, k);
+      D.clear();
+      for (int i = 0; i < k; ++i) {
+         D(i,i) = this->wr(i);
+         if (this->wi(i) > 0) {
+            D(i,i+1) = this->wi(i);
+         } else if (this->wi(i) < 0) {
+            D(i,i-1) = this->wi(i);
+         }
+      }
+      return D;
+   }
+};
+
+}}}
+#endif
@@ -0,0 +1,567 @@
+   /** Krylov linear solvers.
+   <P>
+   ConjugateGradientSolver (A symmetric positive definite), MinresSolver
+   (A symmetric, possibly indefinite) and GmresSolver (A general, with
+   restarts) solve A*x = b for an n-by-n A that is only used through its
+   products y = A*x: a matrix, dense or sparse, or a function object
+   (LinearOperator.hpp).  When only a few digits are needed, or A is
+   large and sparse, a few dozen products are much cheaper than an LU or
+   Cholesky factorization, and A need not even be stored.
+   <P>
+   Each solver takes a preconditioner M (Preconditioner.hpp), a function
+   object computing z = inv(M)*r, applied on the left by conjugate
+   gradients and MINRES (which need M symmetric positive definite) and
+   on the right by GMRES, so that its residual is the one of A*x = b:
+<pre>
+   ConjugateGradientSolver<double> cg;
+   cg.setTolerance(1e-10);
+   BlockJacobiPreconditioner<double> M(A, 50);
+   vector<double> x;                    // empty: start from 0
+   if (!cg.solve(A, b, x, M)) ...       // cg.getResidualHistory()
+</pre>
+   The iteration stops when the norm of the residual b - A*x is at most
+   tol times the norm of b (for MINRES, in the norm defined by inv(M),
+   |r|^2 = r'*inv(M)*r), tol being the square root of the machine
+   precision by default.  The norms are the ones of the recurrences, not
+   recomputed from x, and getResidualHistory() gives them for each
+   iteration, relative to b, to tune the tolerance, the preconditioner or
+   the restart length.  The iterations are limited by setIterationLimits()
+   (Convergence.hpp), the solve being a single value: perValue is the
+   maximum number of iterations (30*max(10,n) by default).
+   */
+
+#ifndef _BOOST_UBLAS_KRYLOVLINEARSOLVER_
+#define _BOOST_UBLAS_KRYLOVLINEARSOLVER_
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <boost/numeric/ublas/vector.hpp>
+#include <boost/numeric/ublas/matrix.hpp>
+#include <boost/numeric/ublas/exception.hpp>
+#include "Convergence.hpp"
+#include "LinearOperator.hpp"
+#include "Preconditioner.hpp"
+#include "SimdKernels.hpp"
+
+namespace boost { namespace numeric { namespace ublas {
+
+namespace detail {
+
+// Tolerance, limits and convergence history of the Krylov linear solvers.
+// T: type
+template<class T>
+class KrylovLinearSolver {
+public:
+    typedef vector<T> Vector;
+
+protected:
+/* ------------------------
+   Class variables
+ * ------------------------ */
+
+   /** Relative tolerance of the residual.
+   */
+   T tol;
+
+   /** Limits of the iterations.
+   */
+   IterationLimits limits;
+
+   /** Residual norms relative to b: initial, and after each iteration.
+   */
+   std::vector<T> history;
+
+   /** Convergence of the last solve(), and number of products with A.
+   */
+   ConvergenceInfo info;
+   long products;
+
+   KrylovLinearSolver ()
+   : tol(std::sqrt(std::numeric_limits<T>::epsilon())), products(0) {}
+
+/* ------------------------
+   Private Methods
+ * ------------------------ */
+
+   // Reset the results, and x to 0 if it is not of size n.
+
+   void start (int n, Vector& x) {
+      history.clear();
+      info = ConvergenceInfo();
+      products = 0;
+      if ((int) x.size() != n) {
+         x.resize(n, false);
+         x.clear();
+      }
+   }
+
+   // Record a relative residual norm.
+   // @return     true if it satisfies the tolerance.
+
+   bool record (T rnorm) {
+      history.push_back(rnorm);
+      return rnorm <= tol;
+   }
+
+   static T dot (const Vector& x, const Vector& y) {
+      return kernels::dot((int) x.size(), &x(0), 1, &y(0), 1);
+   }
+
+   static void axpy (T a, const Vector& x, Vector& y) {
+      kernels::axpy((int) x.size(), a, &x(0), 1, &y(0), 1);
+   }
+
+public:
+/* ------------------------
+   Public Methods
+ * ------------------------ */
+
+   /** Set the tolerance of the residual, relative to the norm of b
+       (default: the square root of the machine precision), for the
+       following calls of solve().
+   */
+
+   void setTolerance (T t) {
+      tol = t;
+   }
+
+   /** Set the limits of the iterations, for the following calls of solve().
+   */
+
+   void setIterationLimits (const IterationLimits& l) {
+      limits = l;
+   }
+
+   /** Return the residual norms relative to the norm of b, of the initial
+       guess and after each iteration
+   @return     iterations+1 norms
+   */
+
+   const std::vector<T>& getResidualHistory () const {
+      return history;
+   }
+
+   /** Return the convergence of the last solve(): the iterations, and
+       unconverged = 1 if the tolerance was not reached (iteration limit,
+       or breakdown on a matrix or preconditioner without the required
+       definiteness).
+   @return     info
+   */
+
+   const ConvergenceInfo& getConvergence () const {
+      return info;
+   }
+
+   /** Did the last solve() reach the tolerance?
+   */
+
+   bool isConverged () const {
+      return info.converged() && info.unconverged == 0;
+   }
+
+   /** Number of products with A of the last solve().
+   */
+
+   long getProducts () const {
+      return products;
+   }
+};
+
+}
+
+/** Preconditioned conjugate gradient solver of a symmetric positive
+    definite system.
+*/
+
+// T: type
+template<class T = double>
+class ConjugateGradientSolver : public detail::KrylovLinearSolver<T> {
+   typedef detail::KrylovLinearSolver<T> Base;
+
+public:
+   typedef typename Base::Vector Vector;
+
+private:
+   template<class Op, class P>
+   void run (const Op& A, const Vector& b, Vector& x, const P& M) {
+      const int n = b.size();
+      this->start(n, x);
+      IterationGuard guard(this->limits, this->info, n);
+      const T bnorm = norm_2(b);
+      if (bnorm == 0.0) {
+         x.clear();
+         this->record(0);
+         return;
+      }
+      Vector r(n), z(n), p(n), q(n);
+      A(x, q);
+      ++this->products;
+      noalias(r) = b - q;
+      if (this->record(norm_2(r)/bnorm)) {
+         return;
+      }
+      M(r, z);
+      p = z;
+      T rz = this->dot(r, z);
+      for (int iter = 1; ; ++iter) {
+         if (!(rz > 0.0) || !guard.next(iter)) {
+            break;
+         }
+         A(p, q);
+         ++this->products;
+         const T pq = this->dot(p, q);
+         if (!(pq > 0.0)) {
+            break;
+         }
+         const T alpha = rz/pq;
+         this->axpy(alpha, p, x);
+         this->axpy(-alpha, q, r);
+         if (this->record(norm_2(r)/bnorm)) {
+            return;
+         }
+         M(r, z);
+         const T rz1 = this->dot(r, z);
+         noalias(p) = z + (rz1/rz)*p;
+         rz = rz1;
+      }
+      guard.fail(1);
+   }
+
+public:
+/* ------------------------
+   Public Methods
+ * ------------------------ */
+
+   /** Solve A*x = b with a preconditioner.
+   @param A    Symmetric positive definite matrix, or function object
+               A(x, y) computing y = A*x.
+   @param b    Right hand side.
+   @param x    Initial guess (empty: 0), replaced by the solution.
+   @param M    Symmetric positive definite preconditioner, M(r, z)
+               computing z = inv(M)*r.
+   @return     true if the tolerance was reached
+   */
+
+   template<class Op, class P>
+   bool solve (const Op& A, const Vector& b, Vector& x, const P& M) {
+      run(detail::operatorOf(A), b, x, M);
+      return this->isConverged();
+   }
+
+   /** Solve A*x = b.
+   */
+
+   template<class Op>
+   bool solve (const Op& A, const Vector& b, Vector& x) {
+      return solve(A, b, x, IdentityPreconditioner());
+   }
+};
+
+/** Preconditioned MINRES solver of a symmetric system (Paige and
+    Saunders): x minimizes the residual, in the norm of inv(M), over the
+    Krylov space, so that A may be indefinite.  A singular A gives a
+    least squares solution if b is in its range.
+*/
+
+// T: type
+template<class T = double>
+class MinresSolver : public detail::KrylovLinearSolver<T> {
+   typedef detail::KrylovLinearSolver<T> Base;
+
+public:
+   typedef typename Base::Vector Vector;
+
+private:
+   template<class Op, class P>
+   void run (const Op& A, const Vector& b, Vector& x, const P& M) {
+      const T eps = std::numeric_limits<T>::epsilon();
+      const int n = b.size();
+      this->start(n, x);
+      IterationGuard guard(this->limits, this->info, n);
+      Vector r1(n), r2(n), y(n), v(n), w(n), w1(n), w2(n);
+      M(b, y);
+      const T bb = this->dot(b, y);
+      if (bb < 0.0) {
+         guard.fail(1);
+         return;
+      }
+      const T bnorm = std::sqrt(bb);
+      if (bnorm == 0.0) {
+         x.clear();
+         this->record(0);
+         return;
+      }
+
+      // Lanczos process on inv(M)*A from r1 = b - A*x, with the QR
+      // factorization of its tridiagonal matrix by Givens rotations.
+      A(x, y);
+      ++this->products;
+      noalias(r1) = b - y;
+      M(r1, y);
+      const T rr = this->dot(r1, y);
+      if (rr < 0.0) {
+         guard.fail(1);
+         return;
+      }
+      T beta = std::sqrt(rr);
+      if (this->record(beta/bnorm)) {
+         return;
+      }
+      r2 = r1;
+      w.clear();
+      w2.clear();
+      T oldb = 0.0, dbar = 0.0, epsln = 0.0, phibar = beta, cs = -1.0, sn = 0.0;
+      for (int iter = 1; ; ++iter) {
+         if (!(beta > 0.0) || !guard.next(iter)) {
+            break;
+         }
+         noalias(v) = y/beta;
+         A(v, y);
+         ++this->products;
+         if (iter >= 2) {
+            this->axpy(-beta/oldb, r1, y);
+         }
+         const T alpha = this->dot(v, y);
+         this->axpy(-alpha/beta, r2, y);
+         r1.swap(r2);
+         r2.swap(y);
+         M(r2, y);
+         oldb = beta;
+         beta = this->dot(r2, y);
+         if (beta < 0.0) {
+            break;
+         }
+         beta = std::sqrt(beta);
+
+         const T oldeps = epsln;
+         const T delta = cs*dbar + sn*alpha;
+         const T gbar = sn*dbar - cs*alpha;
+         epsln = sn*beta;
+         dbar = -cs*beta;
+         const T gamma = std::max(std::hypot(gbar, beta), eps);
+         cs = gbar/gamma;
+         sn = beta/gamma;
+         const T phi = cs*phibar;
+         phibar *= sn;
+
+         w1.swap(w2);
+         w2.swap(w);
+         noalias(w) = (v - oldeps*w1 - delta*w2)/gamma;
+         this->axpy(phi, w, x);
+         if (this->record(std::abs(phibar)/bnorm)) {
+            return;
+         }
+      }
+      guard.fail(1);
+   }
+
+public:
+/* ------------------------
+   Public Methods
+ * ------------------------ */
+
+   /** Solve A*x = b with a preconditioner.
+   @param A    Symmetric matrix, or function object A(x, y) computing y = A*x.
+   @param b    Right hand side.
+   @param x    Initial guess (empty: 0), replaced by the solution.
+   @param M    Symmetric positive definite preconditioner, M(r, z)
+               computing z = inv(M)*r.
+   @return     true if the tolerance was reached
+   */
+
+   template<class Op, class P>
+   bool solve (const Op& A, const Vector& b, Vector& x, const P& M) {
+      run(detail::operatorOf(A), b, x, M);
+      return this->isConverged();
+   }
+
+   /** Solve A*x = b.
+   */
+
+   template<class Op>
+   bool solve (const Op& A, const Vector& b, Vector& x) {
+      return solve(A, b, x, IdentityPreconditioner());
+   }
+};
+
+/** Restarted GMRES solver of a general system (Saad and Schultz), right
+    preconditioned: each cycle of at most restart iterations minimizes
+    |b - A*x| over x0 + inv(M)*K, K the Krylov space of A*inv(M), with an
+    orthonormal basis of K (Gram-Schmidt with reorthogonalization) and
+    the QR factorization of its Hessenberg matrix by Givens rotations.
+*/
+
+// T: type
+template<class T = double>
+class GmresSolver : public detail::KrylovLinearSolver<T> {
+   typedef detail::KrylovLinearSolver<T> Base;
+
+public:
+   typedef typename Base::Vector Vector;
+
+private:
+   typedef matrix<T,column_major> Basis;
+
+   /** Maximum number of iterations between restarts.
+   */
+   int restart;
+
+   template<class Op, class P>
+   void run (const Op& A, const Vector& b, Vector& x, const P& M) {
+      const int n = b.size();
+      this->start(n, x);
+      IterationGuard guard(this->limits, this->info, n);
+      const T bnorm = norm_2(b);
+      if (bnorm == 0.0) {
+         x.clear();
+         this->record(0);
+         return;
+      }
+      const int m = std::max(1, std::min(restart, n));
+      Basis V(n, m+1);
+      matrix<T> H(m+1, m);
+      std::vector<T> c(m), s(m), g(m+1), h(m+1);
+      Vector r(n), u(n), z(n);
+
+      A(x, z);
+      ++this->products;
+      noalias(r) = b - z;
+      T beta = norm_2(r);
+      if (this->record(beta/bnorm)) {
+         return;
+      }
+      for (int iter = 0; ; ) {
+         std::fill(g.begin(), g.end(), T(0));
+         g[0] = beta;
+         for (int i = 0; i < n; ++i) {
+            V(i,0) = r(i)/beta;
+         }
+         int j = 0;
+         bool converged = false, stopped = false;
+         while (j < m) {
+            if (!guard.next(++iter)) {
+               stopped = true;
+               break;
+            }
+            std::copy(kernels::address(V,0,j), kernels::address(V,0,j+1), u.begin());
+            M(u, z);
+            A(z, r);
+            ++this->products;
+
+            // r -= V(:,0:j)*(V(:,0:j)'*r), twice.
+            std::fill(h.begin(), h.end(), T(0));
+            for (int pass = 0; pass < 2; ++pass) {
+               for (int l = 0; l <= j; ++l) {
+                  u(l) = kernels::dot(n, kernels::address(V,0,l), 1, &r(0), 1);
+                  h[l] += u(l);
+               }
+               kernels::subtractProduct(n, j+1, kernels::address(V,0,0), n, &u(0), &r(0));
+            }
+            h[j+1] = norm_2(r);
+
+            // Previous rotations, and a new one to annihilate h[j+1].
+            for (int l = 0; l < j; ++l) {
+               const T t = c[l]*h[l] + s[l]*h[l+1];
+               h[l+1] = -s[l]*h[l] + c[l]*h[l+1];
+               h[l] = t;
+            }
+            const T d = std::hypot(h[j], h[j+1]);
+            c[j] = d == 0.0 ? T(1) : h[j]/d;
+            s[j] = d == 0.0 ? T(0) : h[j+1]/d;
+            g[j+1] = -s[j]*g[j];
+            g[j] *= c[j];
+            for (int l = 0; l < j; ++l) {
+               H(l,j) = h[l];
+            }
+            H(j,j) = d;
+            const T hnext = h[j+1];
+            ++j;
+            if (this->record(std::abs(g[j])/bnorm)) {
+               converged = true;
+               break;
+            }
+            if (hnext == 0.0) {
+               break;
+            }
+            for (int i = 0; i < n; ++i) {
+               V(i,j) = r(i)/hnext;
+            }
+         }
+
+         // x += inv(M)*V(:,0:j-1)*y, H(0:j-1,0:j-1)*y = g(0:j-1).
+         for (int l = j-1; l >= 0; --l) {
+            for (int t = l+1; t < j; ++t) {
+               g[l] -= H(l,t)*g[t];
+            }
+            g[l] = H(l,l) == 0.0 ? T(0) : g[l]/H(l,l);
+         }
+         if (j > 0) {
+            u.clear();
+            kernels::gemv(n, j, kernels::address(V,0,0), n, &g[0], &u(0));
+            M(u, z);
+            this->axpy(T(1), z, x);
+         }
+         if (converged) {
+            return;
+         }
+         if (stopped) {
+            guard.fail(1);
+            return;
+         }
+
+         // Restart from the true residual.
+         A(x, z);
+         ++this->products;
+         noalias(r) = b - z;
+         beta = norm_2(r);
+         if (beta <= this->tol*bnorm) {
+            return;
+         }
+      }
+   }
+
+public:
+/* ------------------------
+   Constructor
+ * ------------------------ */
+
+   /** GMRES solver.
+   @param restart   Maximum number of iterations (and basis vectors)
+                    between restarts.
+   */
+
+   explicit GmresSolver (int restart = 30) : restart(restart) {
+      BOOST_UBLAS_CHECK(restart > 0, bad_argument());
+   }
+
+/* ------------------------
+   Public Methods
+ * ------------------------ */
+
+   /** Solve A*x = b with a preconditioner.
+   @param A    Square matrix, or function object A(x, y) computing y = A*x.
+   @param b    Right hand side.
+   @param x    Initial guess (empty: 0), replaced by the solution.
+   @param M    Preconditioner, M(r, z) computing z = inv(M)*r.
+   @return     true if the tolerance was reached
+   */
+
+   template<class Op, class P>
+   bool solve (const Op& A, const Vector& b, Vector& x, const P& M) {
+      run(detail::operatorOf(A), b, x, M);
+      return this->isConverged();
+   }
+
+   /** Solve A*x = b.
+   */
+
+   template<class Op>
+   bool solve (const Op& A, const Vector& b, Vector& x) {
+      return solve(A, b, x, IdentityPreconditioner());
+   }
+};
+
+}}}
+#endif
@@ -14,18 +14,27 @@
 #ifndef _BOOST_UBLAS_LUDECOMPOSITION_
 #define _BOOST_UBLAS_LUDECOMPOSITION_
 
+#include <algorithm>
+#include <cmath>
 #include <boost/numeric/ublas/vector.hpp>
 #include <boost/numeric/ublas/matrix.hpp>
 #include <boost/numeric/ublas/exception.hpp>
 #include <boost/numeric/ublas/matrix_proxy.hpp>
+#include "SimdKernels.hpp"
+#include "ConditionEstimate.hpp"
+#include "Instrumentation.hpp"
+#include "Serialization.hpp"
 
 namespace boost { namespace numeric { namespace ublas {
     
+// T: type, F: layout (row_major/column_major),
+// ST: storage array of the internal matrices and vectors (e.g. unbounded_array<T, aligned_allocator<T> >)
+template<class T, class F = row_major, class ST = unbounded_array<T> >
 class LUDecomposition {
 
-    typedef vector<double> Vector;
+    typedef vector<T,ST> Vector;
     typedef vector<std::size_t> PivotVector;
-    typedef matrix<double> Matrix;
+    typedef matrix<T,F,ST> Matrix;
 
 /* ------------------------
    Class variables
@@ -48,11 +57,32 @@ class LUDecomposition {
    */
    PivotVector piv;
 
+   /** Row interchanged with row j at step j, which applies piv in place.
+   */
+   PivotVector swaps;
+
+   /** 1-norm of A, for rcond() (estimated for a loaded decomposition).
+   */
+   T anorm;
+
+   /** Working storage for the current column of the Crout algorithm.
+   */
+   Vector LUcolj;
+
+   /** Instrumentation counters of the last compute().
+   */
+   instrumentation::Stats stats;
+
 public:
 /* ------------------------
    Constructor
  * ------------------------ */
 
+   /** Empty LU Decomposition, to be computed later with compute() or load().
+   */
+
+   LUDecomposition () : m(0), n(0), pivsign(1), anorm(0) {}
+
    /** LU Decomposition
        Structure to access L, U and piv.
    @param  A Rectangular matrix
@@ -60,6 +90,15 @@ public:
 
    LUDecomposition (const Matrix& A);
 
+   /** Recompute the decomposition for a new matrix.
+       The storage of the previous decomposition is reused when the
+       dimensions of A match, so that refactoring same-sized matrices
+       does not allocate.
+   @param  A Rectangular matrix
+   */
+
+   void compute (const Matrix& A);
+
 /* ------------------------
    Temporary, experimental code.
    ------------------------ *\
@@ -118,12 +157,21 @@ public:
       return piv;
    }
 
+   /** Return the instrumentation counters of the last compute()
+       (zero unless compiled with UBLASJAMA_INSTRUMENTATION).
+   @return     stats
+   */
+
+   const instrumentation::Stats& getStats () const {
+      return stats;
+   }
+
    /** Return pivot permutation vector as a one-dimensional double array
    @return     (double) piv
    */
 
-   Vector getDoublePivot () const {
-      Vector vals(m);
+   vector<double> getDoublePivot () const {
+      vector<double> vals(m);
       for (int i = 0; i < m; i++) {
          vals(i) = (double) piv(i);
       }
@@ -135,15 +183,23 @@ public:
    @exception  bad_size  Matrix must be square
    */
 
-   double det () {
+   T det () const {
       BOOST_UBLAS_CHECK(m == n, bad_size("Matrix must be square."));
-      double d = (double) pivsign;
+      T d = (T) pivsign;
       for (int j = 0; j < n; j++) {
          d *= LU(j,j);
       }
       return d;
    }
 
+   /** Reciprocal condition number in the 1-norm, estimated in O(n^2)
+       from the factors (see ConditionEstimate.hpp)
+   @return     about 1/(norm1(A)*norm1(inverse(A))), 0 if A is singular.
+   @exception  bad_size  Matrix must be square.
+   */
+
+   T rcond () const;
+
    /** Solve A*X = B
    @param  B   A Matrix with as many rows as A and any number of columns.
    @return     X so that L*U*X = B(piv,:)
@@ -153,15 +209,733 @@ public:
 
    Matrix solve (const Matrix& B) const;
 
+   /** Solve A*x = b
+   @param  b   A vector with as many elements as A has rows.
+   @return     x so that L*U*x = b(piv)
+   @exception  bad_size  Matrix must be square, and dimensions must agree.
+   @exception  singular  Matrix is singular.
+   */
+
+   Vector solve (const Vector& b) const;
+
+   /** Solve A*x = b in place, with contiguous triangular solves.
+   @param  b   Right hand side, replaced by x.
+   @exception  bad_size  Matrix must be square, and dimensions must agree.
+   @exception  singular  Matrix is singular.
+   */
+
+   void solveInPlace (Vector& b) const;
+
+   /** Solve A*X = B in place: the rows of B (row major) or its columns
+       (column major) are updated with contiguous kernels.
+   @param  B   Right hand sides, replaced by X.
+   @exception  bad_size  Matrix must be square, and dimensions must agree.
+   @exception  singular  Matrix is singular.
+   */
+
+   void solveInPlace (Matrix& B) const;
+
+   /** Solve A'*X = B with the factors of A
+   @param  B   A Matrix with as many rows as A and any number of columns.
+   @return     X so that U'*L'*X(piv,:) = B
+   @exception  bad_size  Matrix must be square, and dimensions must agree.
+   @exception  singular  Matrix is singular.
+   */
+
+   Matrix solveTranspose (const Matrix& B) const;
+
+   /** Solve A'*x = b with the factors of A
+   @param  b   A vector with as many elements as A has rows.
+   @return     x so that U'*L'*x(piv) = b
+   @exception  bad_size  Matrix must be square, and dimensions must agree.
+   @exception  singular  Matrix is singular.
+   */
+
+   Vector solveTranspose (const Vector& b) const;
 
    /** Matrix pseudoinverse
    @return     pseudoinverse(A).
    */
 
-   Matrix pseudoinverse () {
-       return solve(identity_matrix<double>(m,m));
+   Matrix pseudoinverse () const {
+       return solve(identity_matrix<T>(m,m));
    }
+
+   /** Write the decomposition to a binary stream (see Serialization.hpp).
+   @param os   Output stream, opened in binary mode.
+   @param alignment  Alignment of the matrix elements (0: none;
+                     serialization::pageAlignment for a file to be mapped).
+   */
+
+   void save (std::ostream& os, std::size_t alignment = 0) const;
+
+   /** Replace the decomposition by one written by save().
+   @param is   Input stream, opened in binary mode.
+   @exception  external_logic  Not a LU decomposition of this scalar type, or truncated.
+   */
+
+   void load (std::istream& is);
+
+   /** Replace the decomposition by one saved at the start of a mapped
+       file, binding its matrices to the file if ST is mapped_array.
+   @param file  Mapped file (see MappedStorage.hpp).
+   @exception  external_logic  As load(is).
+   */
+
+   void load (const MappedFile& file);
+
+private:
+   void restore (serialization::Reader<T,F>& in);
+
+   // x = inv(L)*x and x = inv(U)*x, for a contiguous x.
+   void lowerSolve (T* x) const;
+   void upperSolve (T* x) const;
+
+   // x = inv(U')*x and x = inv(L')*x, and x(piv) = x.
+   void transposeUpperSolve (T* x) const;
+   void transposeLowerSolve (T* x) const;
+   void unpivot (T* x) const;
+
+   // x = x(piv), and the products x = U*x, L*x, U'*x and L'*x.
+   void pivot (T* x) const;
+   void upperMultiply (T* x) const;
+   void lowerMultiply (T* x) const;
+   void transposeUpperMultiply (T* x) const;
+   void transposeLowerMultiply (T* x) const;
 };
 
+/* ------------------------
+   Constructor
+ * ------------------------ */
+
+   /** LU Decomposition
+       Structure to access L, U and piv.
+   @param  A Rectangular matrix
+   */
+
+template<class T, class F, class ST>
+LUDecomposition<T,F,ST>::LUDecomposition (const Matrix& A) {
+      compute(A);
+   }
+
+   /** Recompute the decomposition for a new matrix.
+   @param  A Rectangular matrix
+   */
+
+template<class T, class F, class ST>
+void LUDecomposition<T,F,ST>::compute (const Matrix& A) {
+
+   // Use a "left-looking", dot-product, Crout/Doolittle algorithm.
+
+      stats.clear();
+      instrumentation::PhaseTimer phase(stats, instrumentation::LUPanels);
+      const double storage = instrumentation::storageBytes(LU) + instrumentation::storageBytes(piv)
+                           + instrumentation::storageBytes(swaps) + instrumentation::storageBytes(LUcolj);
+
+      // The assignments below only reallocate if the dimensions change.
+      LU = A;
+      m = A.size1();
+      n = A.size2();
+      anorm = 0.0;
+      piv.resize(m,false);
+      swaps.resize(m,false);
+      for (int i = 0; i < m; i++) {
+         piv(i) = i;
+         swaps(i) = i;
+      }
+      pivsign = 1;
+      LUcolj.resize(m,false);
+      phase.allocated(storage, instrumentation::storageBytes(LU) + instrumentation::storageBytes(piv)
+                               + instrumentation::storageBytes(swaps) + instrumentation::storageBytes(LUcolj));
+
+      // Outer loop.
+
+      const int rs = kernels::rowStride(LU);
+      for (int j = 0; j < n; j++) {
+
+         // Make a copy of the j-th column to localize references, and
+         // take its 1-norm for rcond() (the row exchanges do not change it).
+
+         T colsum = 0.0;
+         for (int i = 0; i < m; i++) {
+            LUcolj(i) = LU(i,j);
+            colsum += std::abs(LUcolj(i));
+         }
+         anorm = std::max(anorm, colsum);
+
+         // Apply previous transformations.
+
+         for (int i = 0; i < m; i++) {
+
+            // Most of the time is spent in the following dot product.
+
+            int kmax = std::min(i,j);
+            T s = kernels::dot(kmax, kernels::address(LU,i,0), rs, LUcolj.data().begin(), 1);
+
+            LU(i,j) = LUcolj(i) -= s;
+         }
+   
+         // Find pivot and exchange if necessary.
+
+         int p = j;
+         for (int i = j+1; i < m; i++) {
+            if (std::abs(LUcolj(i)) > std::abs(LUcolj(p))) {
+               p = i;
+            }
+         }
+
+         if (p != j) {
+            for (int k = 0; k < n; k++) {
+               T t = LU(p,k); LU(p,k) = LU(j,k); LU(j,k) = t;
+            }
+            int k = piv(p); piv(p) = piv(j); piv(j) = k;
+            swaps(j) = p;
+            pivsign = -pivsign;
+         }
+         // Compute multipliers.
+        
+         if (j < m && LU(j,j) != 0.0) {
+            for (int i = j+1; i < m; i++) {
+               LU(i,j) /= LU(j,j);
+            }
+         }
+
+         // Dot products of rows i with kmax = min(i,j) terms, and multipliers.
+
+         phase.iterations();
+         phase.flops(double(j)*(j-1) + 2.0*j*std::max(m-j,0) + std::max(m-j-1,0));
+      }
+   }
+
+/* ------------------------
+   Temporary, experimental code.
+   ------------------------ *\
+
+   \** LU Decomposition, computed by Gaussian elimination.
+   <P>
+   This constructor computes L and U with the "daxpy"-based elimination
+   algorithm used in LINPACK and MATLAB.  In Java, we suspect the dot-product,
+   Crout algorithm will be faster.  We have temporarily included this
+   constructor until timing experiments confirm this suspicion.
+   <P>
+   @param  A             Rectangular matrix
+   @param  linpackflag   Use Gaussian elimination.  Actual value ignored.
+   @return               Structure to access L, U and piv.
+   *\
+
+   public LUDecomposition (Matrix A, int linpackflag) {
+      // Initialize.
+      LU = A.getArrayCopy();
+      m = A.size1();
+      n = A.size2();
+      piv = new int(m);
+      for (int i = 0; i < m; i++) {
+         piv(i) = i;
+      }
+      pivsign = 1;
+      // Main loop.
+      for (int k = 0; k < n; k++) {
+         // Find pivot.
+         int p = k;
+         for (int i = k+1; i < m; i++) {
+            if (std::abs(LU(i,k)) > std::abs(LU(p,k))) {
+               p = i;
+            }
+         }
+         // Exchange if necessary.
+         if (p != k) {
+            for (int j = 0; j < n; j++) {
+               T t = LU(p,j); LU(p,j) = LU(k,j); LU(k,j) = t;
+            }
+            int t = piv(p); piv(p) = piv(k); piv(k) = t;
+            pivsign = -pivsign;
+         }
+         // Compute multipliers and eliminate k-th column.
+         if (LU(k,k) != 0.0) {
+            for (int i = k+1; i < m; i++) {
+               LU(i,k) /= LU(k,k);
+               for (int j = k+1; j < n; j++) {
+                  LU(i,j) -= LU(i,k)*LU(k,j);
+               }
+            }
+         }
+      }
+   }
+
+\* ------------------------
+   End of temporary code.
+ * ------------------------ */
+
+/* ------------------------
+   Public Methods
+ * ------------------------ */
+
+   /** Return lower triangular factor
+   @return     L
+   */
+
+template<class T, class F, class ST>
+typename LUDecomposition<T,F,ST>::Matrix LUDecomposition<T,F,ST>::getL () const {
+      int d = std::min(m,n);
+      Matrix L(m,d);
+      for (int i = 0; i < m; i++) {
+         for (int j = 0; j < d; j++) {
+            if (i > j) {
+               L(i,j) = LU(i,j);
+            } else if (i == j) {
+               L(i,j) = 1.0;
+            } else {
+               L(i,j) = 0.0;
+            }
+         }
+      }
+      return L;
+   }
+
+   /** Return upper triangular factor
+   @return     U
+   */
+
+template<class T, class F, class ST>
+typename LUDecomposition<T,F,ST>::Matrix LUDecomposition<T,F,ST>::getU () const {
+      int d = std::min(m,n);
+      Matrix U(d,n);
+      for (int i = 0; i < d; i++) {
+         for (int j = 0; j < n; j++) {
+            if (i <= j) {
+               U(i,j) = LU(i,j);
+            } else {
+               U(i,j) = 0.0;
+            }
+         }
+      }
+      return U;
+   }
+
+
+   /** Solve A*X = B
+   @param  B   A Matrix with as many rows as A and any number of columns.
+   @return     X so that L*U*X = B(piv,:)
+   @exception  bad_size Matrix row dimensions must agree.
+   @exception  singular  Matrix is singular.
+   */
+
+template<class T, class F, class ST>
+typename LUDecomposition<T,F,ST>::Matrix LUDecomposition<T,F,ST>::solve (const Matrix& B) const {
+      BOOST_UBLAS_CHECK((int)B.size1() == m, bad_size("Matrix row dimensions must agree."));
+      BOOST_UBLAS_CHECK(isNonsingular(), singular("Matrix is singular."));
+
+      // Copy right hand side with pivoting
+      int nx = B.size2();
+      Matrix X(m,nx);
+      for (int i = 0; i < m; i++) {
+          row(X,i) = row(B, piv(i));
+      }
+
+      // Solve L*Y = B(piv,:)
+      for (int k = 0; k < n; k++) {
+         for (int i = k+1; i < n; i++) {
+            for (int j = 0; j < nx; j++) {
+               X(i,j) -= X(k,j)*LU(i,k);
+            }
+         }
+      }
+      // Solve U*X = Y;
+      for (int k = n-1; k >= 0; k--) {
+         for (int j = 0; j < nx; j++) {
+            X(k,j) /= LU(k,k);
+         }
+         for (int i = 0; i < k; i++) {
+            for (int j = 0; j < nx; j++) {
+               X(i,j) -= X(k,j)*LU(i,k);
+            }
+         }
+      }
+      return X;
+   }
+
+   /** Solve A*x = b
+   @param  b   A vector with as many elements as A has rows.
+   @return     x so that L*U*x = b(piv)
+   */
+
+template<class T, class F, class ST>
+typename LUDecomposition<T,F,ST>::Vector LUDecomposition<T,F,ST>::solve (const Vector& b) const {
+      Vector x(b);
+      solveInPlace(x);
+      return x;
+   }
+
+   /** Solve A*x = b in place.
+   @param  b   Right hand side, replaced by x.
+   */
+
+template<class T, class F, class ST>
+void LUDecomposition<T,F,ST>::solveInPlace (Vector& b) const {
+      BOOST_UBLAS_CHECK(m == n, bad_size("Matrix must be square."));
+      BOOST_UBLAS_CHECK((int)b.size() == m, bad_size("Matrix row dimensions must agree."));
+      BOOST_UBLAS_CHECK(isNonsingular(), singular("Matrix is singular."));
+      if (n == 0) {
+         return;
+      }
+      T* x = &b(0);
+      pivot(x);
+      lowerSolve(x);
+      upperSolve(x);
+   }
+
+   /** Solve A*X = B in place.
+   @param  B   Right hand sides, replaced by X.
+   */
+
+template<class T, class F, class ST>
+void LUDecomposition<T,F,ST>::solveInPlace (Matrix& B) const {
+      BOOST_UBLAS_CHECK(m == n, bad_size("Matrix must be square."));
+      BOOST_UBLAS_CHECK((int)B.size1() == m, bad_size("Matrix row dimensions must agree."));
+      BOOST_UBLAS_CHECK(isNonsingular(), singular("Matrix is singular."));
+      const int nx = B.size2();
+      if (n == 0 || nx == 0) {
+         return;
+      }
+      if (kernels::rowStride(B) == 1) {
+         // Rows of B and LU are contiguous: each row of X is a row of B
+         // minus a combination of the rows already solved (gemv).
+         for (int i = 0; i < m; i++) {
+            if ((int) swaps(i) != i) {
+               std::swap_ranges(kernels::address(B,i,0), kernels::address(B,i,nx), kernels::address(B,swaps(i),0));
+            }
+         }
+         for (int i = 1; i < n; i++) {
+            kernels::subtractProduct(nx, i, kernels::address(B,0,0), nx, kernels::address(LU,i,0), kernels::address(B,i,0));
+         }
+         for (int i = n-1; i >= 0; i--) {
+            T* x = kernels::address(B,i,0);
+            kernels::subtractProduct(nx, n-i-1, kernels::address(B,i+1,0), nx, kernels::address(LU,i,i+1), x);
+            for (int j = 0; j < nx; j++) {
+               x[j] /= LU(i,i);
+            }
+         }
+      } else {
+         for (int j = 0; j < nx; j++) {
+            T* x = kernels::address(B,0,j);
+            pivot(x);
+            lowerSolve(x);
+            upperSolve(x);
+         }
+      }
+   }
+
+   // x = inv(L)*x, L unit lower triangular, by rows or by columns of LU.
+
+template<class T, class F, class ST>
+void LUDecomposition<T,F,ST>::lowerSolve (T* x) const {
+      if (kernels::rowStride(LU) == 1) {
+         for (int i = 1; i < n; i++) {
+            x[i] -= kernels::dot(i, kernels::address(LU,i,0), 1, x, 1);
+         }
+      } else {
+         for (int k = 0; k < n; k++) {
+            kernels::axpy(n-k-1, -x[k], kernels::address(LU,k+1,k), 1, x+k+1, 1);
+         }
+      }
+   }
+
+   // x = inv(U)*x.
+
+template<class T, class F, class ST>
+void LUDecomposition<T,F,ST>::upperSolve (T* x) const {
+      if (kernels::rowStride(LU) == 1) {
+         for (int i = n-1; i >= 0; i--) {
+            x[i] = (x[i] - kernels::dot(n-i-1, kernels::address(LU,i,i+1), 1, x+i+1, 1))/LU(i,i);
+         }
+      } else {
+         for (int k = n-1; k >= 0; k--) {
+            x[k] /= LU(k,k);
+            kernels::axpy(k, -x[k], kernels::address(LU,0,k), 1, x, 1);
+         }
+      }
+   }
+
+   /** Solve A'*X = B with the factors of A
+   @param  B   A Matrix with as many rows as A and any number of columns.
+   @return     X so that U'*L'*X(piv,:) = B
+   */
+
+template<class T, class F, class ST>
+typename LUDecomposition<T,F,ST>::Matrix LUDecomposition<T,F,ST>::solveTranspose (const Matrix& B) const {
+      BOOST_UBLAS_CHECK(m == n, bad_size("Matrix must be square."));
+      BOOST_UBLAS_CHECK((int)B.size1() == m, bad_size("Matrix row dimensions must agree."));
+      BOOST_UBLAS_CHECK(isNonsingular(), singular("Matrix is singular."));
+      Matrix X(B);
+      const int nx = B.size2();
+      if (n == 0 || nx == 0) {
+         return X;
+      }
+      if (kernels::rowStride(X) == 1) {
+         // Solve U'*Y = B and L'*Z = Y, subtracting each solved row of X
+         // from the rows still to solve, with the rows of U and L.
+         for (int k = 0; k < n; k++) {
+            T* x = kernels::address(X,k,0);
+            for (int j = 0; j < nx; j++) {
+               x[j] /= LU(k,k);
+            }
+            for (int i = k+1; i < n; i++) {
+               kernels::axpy(nx, -LU(k,i), x, 1, kernels::address(X,i,0), 1);
+            }
+         }
+         for (int k = n-1; k > 0; k--) {
+            const T* x = kernels::address(X,k,0);
+            for (int i = 0; i < k; i++) {
+               kernels::axpy(nx, -LU(k,i), x, 1, kernels::address(X,i,0), 1);
+            }
+         }
+         for (int i = m-1; i >= 0; i--) {
+            if ((int) swaps(i) != i) {
+               std::swap_ranges(kernels::address(X,i,0), kernels::address(X,i,nx), kernels::address(X,swaps(i),0));
+            }
+         }
+      } else {
+         for (int j = 0; j < nx; j++) {
+            T* x = kernels::address(X,0,j);
+            transposeUpperSolve(x);
+            transposeLowerSolve(x);
+            unpivot(x);
+         }
+      }
+      return X;
+   }
+
+   /** Solve A'*x = b with the factors of A
+   @param  b   A vector with as many elements as A has rows.
+   @return     x so that U'*L'*x(piv) = b
+   */
+
+template<class T, class F, class ST>
+typename LUDecomposition<T,F,ST>::Vector LUDecomposition<T,F,ST>::solveTranspose (const Vector& b) const {
+      BOOST_UBLAS_CHECK(m == n, bad_size("Matrix must be square."));
+      BOOST_UBLAS_CHECK((int)b.size() == m, bad_size("Matrix row dimensions must agree."));
+      BOOST_UBLAS_CHECK(isNonsingular(), singular("Matrix is singular."));
+      Vector x(b);
+      if (n > 0) {
+         transposeUpperSolve(&x(0));
+         transposeLowerSolve(&x(0));
+         unpivot(&x(0));
+      }
+      return x;
+   }
+
+   // x = inv(U')*x, by columns (column major) or rows of U.
+
+template<class T, class F, class ST>
+void LUDecomposition<T,F,ST>::transposeUpperSolve (T* x) const {
+      if (kernels::rowStride(LU) == 1) {
+         for (int k = 0; k < n; k++) {
+            x[k] /= LU(k,k);
+            kernels::axpy(n-k-1, -x[k], kernels::address(LU,k,k+1), 1, x+k+1, 1);
+         }
+      } else {
+         for (int k = 0; k < n; k++) {
+            x[k] = (x[k] - kernels::dot(k, kernels::address(LU,0,k), 1, x, 1))/LU(k,k);
+         }
+      }
+   }
+
+   // x = inv(L')*x, L unit lower triangular.
+
+template<class T, class F, class ST>
+void LUDecomposition<T,F,ST>::transposeLowerSolve (T* x) const {
+      if (kernels::rowStride(LU) == 1) {
+         for (int k = n-1; k > 0; k--) {
+            kernels::axpy(k, -x[k], kernels::address(LU,k,0), 1, x, 1);
+         }
+      } else {
+         for (int k = n-1; k >= 0; k--) {
+            x[k] -= kernels::dot(n-k-1, kernels::address(LU,k+1,k), 1, x+k+1, 1);
+         }
+      }
+   }
+
+   // x(piv) = x: the interchanges in reverse order.
+
+template<class T, class F, class ST>
+void LUDecomposition<T,F,ST>::unpivot (T* x) const {
+      for (int i = m-1; i >= 0; i--) {
+         std::swap(x[i], x[swaps(i)]);
+      }
+   }
+
+   // x = x(piv): the interchanges in order.
+
+template<class T, class F, class ST>
+void LUDecomposition<T,F,ST>::pivot (T* x) const {
+      for (int i = 0; i < m; i++) {
+         std::swap(x[i], x[swaps(i)]);
+      }
+   }
+
+   // x = U*x, by rows or by columns of U.
+
+template<class T, class F, class ST>
+void LUDecomposition<T,F,ST>::upperMultiply (T* x) const {
+      if (kernels::rowStride(LU) == 1) {
+         for (int i = 0; i < n; i++) {
+            x[i] = kernels::dot(n-i, kernels::address(LU,i,i), 1, x+i, 1);
+         }
+      } else {
+         for (int k = 0; k < n; k++) {
+            kernels::axpy(k, x[k], kernels::address(LU,0,k), 1, x, 1);
+            x[k] *= LU(k,k);
+         }
+      }
+   }
+
+   // x = L*x, L unit lower triangular.
+
+template<class T, class F, class ST>
+void LUDecomposition<T,F,ST>::lowerMultiply (T* x) const {
+      if (kernels::rowStride(LU) == 1) {
+         for (int i = n-1; i > 0; i--) {
+            x[i] += kernels::dot(i, kernels::address(LU,i,0), 1, x, 1);
+         }
+      } else {
+         for (int k = n-1; k >= 0; k--) {
+            kernels::axpy(n-k-1, x[k], kernels::address(LU,k+1,k), 1, x+k+1, 1);
+         }
+      }
+   }
+
+   // x = U'*x.
+
+template<class T, class F, class ST>
+void LUDecomposition<T,F,ST>::transposeUpperMultiply (T* x) const {
+      if (kernels::rowStride(LU) == 1) {
+         for (int k = n-1; k >= 0; k--) {
+            kernels::axpy(n-k-1, x[k], kernels::address(LU,k,k+1), 1, x+k+1, 1);
+            x[k] *= LU(k,k);
+         }
+      } else {
+         for (int i = n-1; i >= 0; i--) {
+            x[i] = kernels::dot(i+1, kernels::address(LU,0,i), 1, x, 1);
+         }
+      }
+   }
+
+   // x = L'*x.
+
+template<class T, class F, class ST>
+void LUDecomposition<T,F,ST>::transposeLowerMultiply (T* x) const {
+      if (kernels::rowStride(LU) == 1) {
+         for (int k = 0; k < n; k++) {
+            kernels::axpy(k, x[k], kernels::address(LU,k,0), 1, x, 1);
+         }
+      } else {
+         for (int i = 0; i < n; i++) {
+            x[i] += kernels::dot(n-i-1, kernels::address(LU,i+1,i), 1, x+i+1, 1);
+         }
+      }
+   }
+
+   /** Reciprocal condition number in the 1-norm, as LAPACK's dgecon.
+   @return     1/(norm1(A)*estimate of norm1(inverse(A))).
+   */
+
+template<class T, class F, class ST>
+T LUDecomposition<T,F,ST>::rcond () const {
+      BOOST_UBLAS_CHECK(m == n, bad_size("Matrix must be square."));
+      if (n == 0) {
+         return 1.0;
+      }
+      if (anorm == 0.0 || !isNonsingular()) {
+         return 0.0;
+      }
+      T ainvnorm = condition::normEstimate<T>(n,
+         [this] (T* x) { pivot(x); lowerSolve(x); upperSolve(x); },
+         [this] (T* x) { transposeUpperSolve(x); transposeLowerSolve(x); unpivot(x); });
+      return ainvnorm == 0.0 ? T(0) : (1/ainvnorm)/anorm;
+   }
+
+   /** Write the decomposition to a binary stream.
+   @param os   Output stream, opened in binary mode.
+   */
+
+template<class T, class F, class ST>
+void LUDecomposition<T,F,ST>::save (std::ostream& os, std::size_t alignment) const {
+      serialization::Writer<T,F> out(os, serialization::LU, alignment);
+      out.integer(m);
+      out.integer(n);
+      out.integer(pivsign);
+      out.write(piv);
+      out.write(LU);
+   }
+
+   /** Replace the decomposition by one written by save().
+   @param is   Input stream, opened in binary mode.
+   */
+
+template<class T, class F, class ST>
+void LUDecomposition<T,F,ST>::load (std::istream& is) {
+      serialization::Reader<T,F> in(is, serialization::LU);
+      restore(in);
+   }
+
+   /** Replace the decomposition by one saved at the start of a mapped file.
+   @param file  Mapped file.
+   */
+
+template<class T, class F, class ST>
+void LUDecomposition<T,F,ST>::load (const MappedFile& file) {
+      serialization::Reader<T,F> in(file, serialization::LU);
+      restore(in);
+   }
+
+   // Read the members of the decomposition.
+
+template<class T, class F, class ST>
+void LUDecomposition<T,F,ST>::restore (serialization::Reader<T,F>& in) {
+      stats.clear();
+      m = in.size();
+      n = in.size();
+      pivsign = in.integer();
+      in.read(piv);
+      in.read(LU);
+      if ((int) piv.size() != m || (int) LU.size1() != m || (int) LU.size2() != n) {
+         external_logic("serialization: inconsistent LU decomposition").raise();
+      }
+      for (int i = 0; i < m; ++i) {
+         if ((int) piv(i) >= m) {
+            external_logic("serialization: inconsistent LU decomposition").raise();
+         }
+      }
+
+      // Interchanges of piv: where(r) is the position of row r of A, and
+      // order(i) the row of A at position i, after the first j interchanges.
+      PivotVector where(m), order(m);
+      swaps.resize(m,false);
+      for (int i = 0; i < m; ++i) {
+         where(i) = order(i) = i;
+      }
+      for (int j = 0; j < m; ++j) {
+         int p = where(piv(j));
+         swaps(j) = p;
+         where(order(j)) = p;
+         where(order(p)) = j;
+         std::swap(order(j), order(p));
+      }
+
+      // The norm of A is not saved: estimate it from products with the factors.
+      anorm = m != n ? T(0) : condition::normEstimate<T>(n,
+         [this] (T* x) { upperMultiply(x); lowerMultiply(x); unpivot(x); },
+         [this] (T* x) { pivot(x); transposeLowerMultiply(x); transposeUpperMultiply(x); });
+   }
+
+// The common instantiations are prebuilt in libublasJama.a; define
+// UBLASJAMA_NO_EXTERN_TEMPLATES to use this header without the library.
+#ifndef UBLASJAMA_NO_EXTERN_TEMPLATES
+extern template class LUDecomposition<float>;
+extern template class LUDecomposition<double>;
+extern template class LUDecomposition<float,column_major>;
+extern template class LUDecomposition<double,column_major>;
+#endif
+
 }}}
 #endif
@@ -0,0 +1,75 @@
+   /** Linear operators.
+   <P>
+   The iterative solvers (KrylovEigenSolver.hpp, KrylovLinearSolver.hpp)
+   only use a matrix A through the products y = A*x, given by a function
+   object called as
+<pre>
+   op(x, y);        // const vector<T>& x, vector<T>& y (size n): y = A*x
+</pre>
+   so that A may be a graph or a stencil that is never stored.
+   linearOperator() makes such an operator of any ublas matrix, dense or
+   sparse (compressed_matrix), which must outlive it:
+<pre>
+   LanczosEigenSolver<double> eig(6);
+   eig.compute(linearOperator(A), A.size1());
+</pre>
+   */
+
+#ifndef _BOOST_UBLAS_LINEAROPERATOR_
+#define _BOOST_UBLAS_LINEAROPERATOR_
+
+#include <type_traits>
+#include <boost/numeric/ublas/vector.hpp>
+#include <boost/numeric/ublas/matrix.hpp>
+
+namespace boost { namespace numeric { namespace ublas {
+
+// M: matrix type
+template<class M>
+class MatrixOperator {
+   const M& A;
+
+public:
+   explicit MatrixOperator (const M& A) : A(A) {}
+
+   /** y = A*x
+   */
+
+   template<class V1, class V2>
+   void operator() (const V1& x, V2& y) const {
+      noalias(y) = prod(A, x);
+   }
+
+   int size1 () const { return A.size1(); }
+   int size2 () const { return A.size2(); }
+};
+
+/** Operator of the products with a matrix.
+@param A    Matrix, referenced by the operator.
+@return     Operator computing y = A*x.
+*/
+
+template<class M>
+MatrixOperator<M> linearOperator (const matrix_expression<M>& A) {
+   return MatrixOperator<M>(A());
+}
+
+namespace detail {
+
+// The operator of a solver argument: a matrix, or a function object.
+
+template<class Op>
+typename std::enable_if<!std::is_base_of<matrix_expression<Op>, Op>::value, const Op&>::type
+operatorOf (const Op& A) {
+   return A;
+}
+
+template<class M>
+MatrixOperator<M> operatorOf (const matrix_expression<M>& A) {
+   return MatrixOperator<M>(A());
+}
+
+}
+
+}}}
+#endif
@@ -0,0 +1,312 @@
+   /** Memory-mapped storage.
+   <P>
+   A MappedFile maps a whole file into memory, copy on write: the pages
+   are read from the file when first touched and shared by all the
+   processes mapping it, and a write only makes a private copy of its
+   page, so that the file itself is never modified.
+   <P>
+   mapped_array is a storage array for the ublas matrices and vectors,
+   and for the storage policy of the decompositions, that either owns its
+   elements, as unbounded_array, or refers to elements of a mapping.  The
+   load(const MappedFile&) functions of the decompositions and
+   serialization::loadMatrix bind their mapped_array matrices directly to
+   the file (see Serialization.hpp), without reading or copying it:
+<pre>
+   typedef mapped_array<double> MappedStorage;
+   MappedFile file("A.lu");
+   LUDecomposition<double, row_major, MappedStorage> LU;
+   LU.load(file);               // only the header and pivots are read
+   X = LU.solve(B);             // touches the pages of the factors
+</pre>
+   A copy of a mapped_array owns a copy of the elements, and resizing it
+   to another size replaces the mapping by owned storage.  The mapping
+   stays alive as long as a mapped_array refers to it.
+   */
+
+#ifndef _BOOST_UBLAS_MAPPEDSTORAGE_
+#define _BOOST_UBLAS_MAPPEDSTORAGE_
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <string>
+#include <boost/shared_ptr.hpp>
+#include <boost/checked_delete.hpp>
+#include <boost/numeric/ublas/storage.hpp>
+#include <boost/numeric/ublas/exception.hpp>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace boost { namespace numeric { namespace ublas {
+
+/** A file mapped into memory, copy on write.  Copies share the mapping,
+    which is unmapped with the last of them (or of the mapped_arrays
+    bound to it).
+*/
+
+class MappedFile {
+   struct Mapping {
+      char* base;
+      std::size_t size;
+
+      Mapping () : base(0), size(0) {}
+
+      ~Mapping () {
+         if (base != 0) {
+#ifdef _WIN32
+            UnmapViewOfFile(base);
+#else
+            munmap(base, size);
+#endif
+         }
+      }
+   };
+
+   boost::shared_ptr<Mapping> mapping;
+
+public:
+   MappedFile () {}
+
+   /** Map a file.
+   @param path  File name.
+   @exception   external_logic  The file cannot be opened or mapped.
+   */
+
+   explicit MappedFile (const std::string& path) : mapping(new Mapping) {
+#ifdef _WIN32
+      HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+      if (file == INVALID_HANDLE_VALUE) {
+         external_logic("MappedFile: cannot open file").raise();
+      }
+      LARGE_INTEGER size;
+      if (!GetFileSizeEx(file, &size)) {
+         CloseHandle(file);
+         external_logic("MappedFile: cannot get file size").raise();
+      }
+      mapping->size = (std::size_t) size.QuadPart;
+      if (mapping->size > 0) {
+         HANDLE view = CreateFileMappingA(file, 0, PAGE_WRITECOPY, 0, 0, 0);
+         if (view != 0) {
+            mapping->base = static_cast<char*>(MapViewOfFile(view, FILE_MAP_COPY, 0, 0, 0));
+            CloseHandle(view);
+         }
+      }
+      CloseHandle(file);
+#else
+      int fd = open(path.c_str(), O_RDONLY);
+      if (fd < 0) {
+         external_logic("MappedFile: cannot open file").raise();
+      }
+      struct stat st;
+      if (fstat(fd, &st) != 0) {
+         close(fd);
+         external_logic("MappedFile: cannot get file size").raise();
+      }
+      mapping->size = st.st_size;
+      if (mapping->size > 0) {
+         void* p = mmap(0, mapping->size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+         mapping->base = p == MAP_FAILED ? 0 : static_cast<char*>(p);
+      }
+      close(fd);
+#endif
+      if (mapping->size > 0 && mapping->base == 0) {
+         external_logic("MappedFile: cannot map file").raise();
+      }
+   }
+
+   /** Start of the mapping (page aligned).
+   */
+
+   char* data () const {
+      return mapping ? mapping->base : 0;
+   }
+
+   /** Size of the file in bytes.
+   */
+
+   std::size_t size () const {
+      return mapping ? mapping->size : 0;
+   }
+
+   /** Handle keeping the mapping alive.
+   */
+
+   boost::shared_ptr<void> owner () const {
+      return mapping;
+   }
+};
+
+/** Storage array owning its elements or referring to mapped ones.
+*/
+
+template<class T>
+class mapped_array : public storage_array<mapped_array<T> > {
+public:
+   typedef std::size_t size_type;
+   typedef std::ptrdiff_t difference_type;
+   typedef T value_type;
+   typedef const T& const_reference;
+   typedef T& reference;
+   typedef const T* const_pointer;
+   typedef T* pointer;
+   typedef const_pointer const_iterator;
+   typedef pointer iterator;
+   typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+   typedef std::reverse_iterator<iterator> reverse_iterator;
+
+   mapped_array () : size_(0), data_(0), mapped_(false) {}
+
+   explicit mapped_array (size_type size) : size_(0), data_(0), mapped_(false) {
+      allocate(size);
+   }
+
+   mapped_array (size_type size, const value_type& init) : size_(0), data_(0), mapped_(false) {
+      allocate(size);
+      std::fill(begin(), end(), init);
+   }
+
+   mapped_array (const mapped_array& a) : storage_array<mapped_array<T> >(), size_(0), data_(0), mapped_(false) {
+      allocate(a.size_);
+      std::copy(a.begin(), a.end(), begin());
+   }
+
+   mapped_array& operator= (const mapped_array& a) {
+      if (this != &a) {
+         resize(a.size_);
+         std::copy(a.begin(), a.end(), begin());
+      }
+      return *this;
+   }
+
+   mapped_array& assign_temporary (mapped_array& a) {
+      swap(a);
+      return *this;
+   }
+
+   /** Refer to the n elements at p, kept alive by owner, instead of the
+       current elements.
+   */
+
+   void map (pointer p, size_type n, const boost::shared_ptr<void>& owner) {
+      owner_ = owner;
+      data_ = p;
+      size_ = n;
+      mapped_ = true;
+   }
+
+   /** Does the array refer to mapped elements?
+   */
+
+   bool mapped () const {
+      return size_ > 0 && mapped_;
+   }
+
+   void resize (size_type size) {
+      if (size != size_) {
+         allocate(size);
+      }
+   }
+
+   void resize (size_type size, value_type init) {
+      if (size != size_) {
+         mapped_array a(size, init);
+         std::copy(begin(), begin() + std::min(size, size_), a.begin());
+         swap(a);
+      }
+   }
+
+   size_type max_size () const {
+      return std::size_t(-1)/sizeof(T);
+   }
+
+   bool empty () const {
+      return size_ == 0;
+   }
+
+   size_type size () const {
+      return size_;
+   }
+
+   const_reference operator[] (size_type i) const {
+      BOOST_UBLAS_CHECK(i < size_, bad_index());
+      return data_[i];
+   }
+
+   reference operator[] (size_type i) {
+      BOOST_UBLAS_CHECK(i < size_, bad_index());
+      return data_[i];
+   }
+
+   void swap (mapped_array& a) {
+      if (this != &a) {
+         std::swap(size_, a.size_);
+         std::swap(data_, a.data_);
+         std::swap(mapped_, a.mapped_);
+         owner_.swap(a.owner_);
+      }
+   }
+
+   friend void swap (mapped_array& a1, mapped_array& a2) {
+      a1.swap(a2);
+   }
+
+   const_iterator begin () const {
+      return data_;
+   }
+
+   const_iterator end () const {
+      return data_ + size_;
+   }
+
+   iterator begin () {
+      return data_;
+   }
+
+   iterator end () {
+      return data_ + size_;
+   }
+
+   const_reverse_iterator rbegin () const {
+      return const_reverse_iterator(end());
+   }
+
+   const_reverse_iterator rend () const {
+      return const_reverse_iterator(begin());
+   }
+
+   reverse_iterator rbegin () {
+      return reverse_iterator(end());
+   }
+
+   reverse_iterator rend () {
+      return reverse_iterator(begin());
+   }
+
+private:
+   // Replace the elements by size owned (uninitialized) elements.
+
+   void allocate (size_type size) {
+      owner_.reset();
+      data_ = 0;
+      if (size > 0) {
+         data_ = new T[size];
+         owner_ = boost::shared_ptr<T>(data_, boost::checked_array_deleter<T>());
+      }
+      size_ = size;
+      mapped_ = false;
+   }
+
+   size_type size_;
+   pointer data_;
+   bool mapped_;
+   boost::shared_ptr<void> owner_;
+};
+
+}}}
+#endif
@@ -0,0 +1,178 @@
+   /** Mixed precision LU Decomposition.
+   <P>
+   For a square matrix A, the O(n^3) LU factorization is computed in a
+   lower precision TL (float by default), and solutions are brought to the
+   working precision T (double by default) by iterative refinement: the
+   residual R = B - A*X is computed in precision T and the correction is
+   solved with the low precision factors.  This is the strategy of LAPACK's
+   dsgesv.
+   <P>
+   If the refinement does not converge within the iteration limit, or if A
+   cannot be represented in precision TL, the matrix is factored again in
+   precision T and all subsequent solves use the full precision factors.
+   getIterations() reports the number of refinement steps of the last solve.
+   */
+
+#ifndef _BOOST_UBLAS_MIXEDPRECISIONLUDECOMPOSITION_
+#define _BOOST_UBLAS_MIXEDPRECISIONLUDECOMPOSITION_
+
+#include <cmath>
+#include <limits>
+#include <boost/numeric/ublas/vector.hpp>
+#include <boost/numeric/ublas/matrix.hpp>
+#include <boost/numeric/ublas/exception.hpp>
+#include <boost/numeric/ublas/matrix_proxy.hpp>
+#include "LUDecomposition.hpp"
+
+namespace boost { namespace numeric { namespace ublas {
+
+// T: working type, TL: type of the factorization, F: layout (row_major/column_major)
+template<class T = double, class TL = float, class F = row_major>
+class MixedPrecisionLUDecomposition {
+
+    typedef matrix<T,F> Matrix;
+    typedef matrix<TL,F> LowMatrix;
+
+/* ------------------------
+   Class variables
+ * ------------------------ */
+
+   /** Copy of the matrix, for the residuals.
+   */
+   Matrix A;
+
+   /** Low precision factorization.
+   */
+   LUDecomposition<TL,F> LUlow;
+
+   /** Full precision factorization, only computed on fallback.
+   */
+   LUDecomposition<T,F> LUfull;
+
+   /** Matrix dimension.
+   */
+   int n;
+
+   /** Infinity norm of A.
+   */
+   T anorm;
+
+   /** Maximum number of refinement steps.
+   */
+   int maxiter;
+
+   /** Number of refinement steps of the last solve.
+   */
+   int iter;
+
+   /** Full precision fallback flag.
+   */
+   bool fallback;
+
+   /** Switch to the full precision factorization.
+   */
+
+   void factorFull () {
+      LUfull.compute(A);
+      fallback = true;
+   }
+
+public:
+/* ------------------------
+   Constructor
+ * ------------------------ */
+
+   /** Mixed precision LU Decomposition
+   @param  Arg            Square matrix
+   @param  maxIterations  Maximum number of refinement steps per solve.
+   */
+
+   MixedPrecisionLUDecomposition (const Matrix& Arg, int maxIterations = 30)
+   : A(Arg), n(Arg.size1()), maxiter(maxIterations), iter(0), fallback(false) {
+      BOOST_UBLAS_CHECK(Arg.size1() == Arg.size2(), bad_size("Matrix must be square."));
+      anorm = norm_inf(A);
+
+      // The matrix must be representable in low precision.
+      if (anorm > (std::numeric_limits<TL>::max)()) {
+         factorFull();
+         return;
+      }
+      LUlow.compute(LowMatrix(A));
+      if (!LUlow.isNonsingular()) {
+         factorFull();
+      }
+   }
+
+/* ------------------------
+   Public Methods
+ * ------------------------ */
+
+   /** Is the matrix nonsingular?
+   @return     true if the factors, and hence A, are nonsingular.
+   */
+
+   bool isNonsingular () const {
+      return fallback ? LUfull.isNonsingular() : LUlow.isNonsingular();
+   }
+
+   /** Are solves done with the full precision factorization?
+   @return     true if refinement failed and A was refactored in full precision.
+   */
+
+   bool isFallback () const {
+      return fallback;
+   }
+
+   /** Number of refinement steps of the last solve.
+       The count is that of the low precision attempt, even when the
+       solve had to fall back to full precision.
+   @return     number of corrections applied.
+   */
+
+   int getIterations () const {
+      return iter;
+   }
+
+   /** Solve A*X = B
+   @param  B   A Matrix with as many rows as A and any number of columns.
+   @return     X so that A*X = B to working precision.
+   @exception  bad_size Matrix row dimensions must agree.
+   @exception  singular  Matrix is singular.
+   */
+
+   Matrix solve (const Matrix& B) {
+      BOOST_UBLAS_CHECK((int)B.size1() == n, bad_size("Matrix row dimensions must agree."));
+      iter = 0;
+      if (!fallback) {
+         int nx = B.size2();
+         T cte = anorm * std::numeric_limits<T>::epsilon() * std::sqrt((T)n);
+         Matrix X = LUlow.solve(LowMatrix(B));
+         Matrix R(n,nx);
+         for (;;) {
+            // Residual in working precision.
+            noalias(R) = B - prod(A,X);
+
+            // Converged if every column satisfies ||r|| <= ||x||*||A||*eps*sqrt(n).
+            bool converged = true;
+            for (int j = 0; j < nx && converged; j++) {
+               converged = norm_inf(column(R,j)) <= norm_inf(column(X,j)) * cte;
+            }
+            if (converged) {
+               return X;
+            }
+            if (iter == maxiter) {
+               break;
+            }
+
+            // Correction with the low precision factors.
+            X += LUlow.solve(LowMatrix(R));
+            ++iter;
+         }
+         factorFull();
+      }
+      return LUfull.solve(B);
+   }
+};
+
+}}}
+#endif
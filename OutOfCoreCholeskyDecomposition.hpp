@@ -0,0 +1,258 @@
+   /** Out-of-core Cholesky Decomposition.
+   <P>
+   For a symmetric, positive definite matrix A larger than the memory,
+   kept as tiles in a file (TiledMatrix), the lower triangular L so that
+   A = L*L' is computed in place, one tile column (panel) at a time: the
+   panel is read, updated by the tile columns of L on its left, which are
+   streamed through memory with the next tile read while the current one
+   is applied, factored, and written back.  The memory used is the panel
+   (n-by-b) and four tiles (Y, the current and prefetched tiles, and the
+   tile written back); TiledMatrix::tileSize() gives the tile size b for
+   a memory budget.
+   <P>
+   Only the lower triangle of A is read, as in LAPACK, so isSPD() reports
+   positive definiteness but not symmetry.  The tiles above the diagonal
+   are left untouched, and solve() streams the tiles of L again.  The
+   TiledMatrix is overwritten by L and must outlive the decomposition.
+   */
+
+#ifndef _BOOST_UBLAS_OUTOFCORECHOLESKYDECOMPOSITION_
+#define _BOOST_UBLAS_OUTOFCORECHOLESKYDECOMPOSITION_
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <boost/numeric/ublas/vector.hpp>
+#include <boost/numeric/ublas/matrix.hpp>
+#include <boost/numeric/ublas/exception.hpp>
+#include <boost/numeric/ublas/matrix_proxy.hpp>
+#include "SimdKernels.hpp"
+#include "TiledMatrix.hpp"
+
+namespace boost { namespace numeric { namespace ublas {
+
+// T: type, F: layout of the right hand sides and solutions (row_major/column_major)
+template<class T, class F = row_major>
+class OutOfCoreCholeskyDecomposition {
+
+    typedef matrix<T,F> Matrix;
+    typedef typename TiledMatrix<T>::Tile Tile;
+    typedef typename TiledMatrix<T>::TileIndex TileIndex;
+
+/* ------------------------
+   Class variables
+ * ------------------------ */
+
+   /** Tiles of A, then of L.
+   */
+   TiledMatrix<T>* tiles;
+
+   /** Row and column dimension, tile size and number of tile columns.
+   */
+   int n, b, nt;
+
+   /** Symmetric (assumed) and positive definite flag.
+   */
+   bool isspd;
+
+/* ------------------------
+   Private Methods
+ * ------------------------ */
+
+   // Tile column J, from tile row I0 down (or up from the last tile row).
+
+   std::vector<TileIndex> column (int J, int I0, bool upward = false) const {
+      std::vector<TileIndex> list;
+      for (int I = I0; I < nt; ++I) {
+         list.push_back(TileIndex(I,J));
+      }
+      if (upward) {
+         std::reverse(list.begin(), list.end());
+      }
+      return list;
+   }
+
+public:
+/* ------------------------
+   Constructor
+ * ------------------------ */
+
+   /** Construct an empty decomposition, to be computed with compute().
+   */
+
+   OutOfCoreCholeskyDecomposition () : tiles(0), n(0), b(1), nt(0), isspd(false) {}
+
+   /** Out-of-core Cholesky algorithm for symmetric and positive definite matrix.
+   @param  A   Square, symmetric matrix, overwritten by L.
+   */
+
+   explicit OutOfCoreCholeskyDecomposition (TiledMatrix<T>& A) : tiles(0), n(0), b(1), nt(0), isspd(false) {
+      compute(A);
+   }
+
+   /** Factor a new matrix in place.
+   @param  A   Square, symmetric matrix, overwritten by L.
+   @exception  bad_size  Matrix must be square.
+   @exception  external_logic  I/O error of the tiles.
+   */
+
+   void compute (TiledMatrix<T>& A) {
+      BOOST_UBLAS_CHECK(A.size1() == A.size2(), bad_size("Matrix must be square."));
+      tiles = &A;
+      n = A.size1();
+      b = A.tileSize();
+      nt = A.tileCols();
+      isspd = true;
+
+      // Rows k0..n-1 of the tile column K, and -L(K,J)' of the updates.
+      matrix<T> panel, Y;
+      for (int K = 0; K < nt; ++K) {
+         const int k0 = K*b;
+         const int w = A.cols(K);
+         panel.resize(n-k0, w, false);
+         A.stream(column(K,K), [&] (int I, int, Tile& t) {
+            for (int i = 0; i < (int) t.size1(); ++i) {
+               for (int j = 0; j < w; ++j) {
+                  panel(I*b-k0+i,j) = t(i,j);
+               }
+            }
+         });
+
+         // Left-looking update by the tile columns of L.
+         for (int J = 0; J < K; ++J) {
+            const int wj = A.cols(J);
+            A.stream(column(J,K), [&] (int I, int, Tile& t) {
+               if (I == K) {
+                  Y.resize(wj, w, false);
+                  for (int l = 0; l < wj; ++l) {
+                     for (int j = 0; j < w; ++j) {
+                        Y(l,j) = -t(j,l);
+                     }
+                  }
+               }
+               kernels::rankKUpdate(panel, I*b-k0, I*b-k0+t.size1(), 0, w, wj,
+                                    t.data().begin(), t.size1(), Y.data().begin(), w);
+            });
+         }
+
+         // Factor the diagonal block, as Jama does, then the rows below it.
+         for (int j = 0; j < w; ++j) {
+            T* lj = kernels::address(panel,j,0);
+            T d = 0.0;
+            for (int k = 0; k < j; ++k) {
+               const T* lk = kernels::address(panel,k,0);
+               T s = lj[k] = (lj[k] - kernels::dot(k, lk, 1, lj, 1))/lk[k];
+               d = d + s*s;
+            }
+            d = lj[j] - d;
+            isspd = isspd && (d > 0.0);
+            lj[j] = std::sqrt(std::max(d,T(0)));
+            std::fill(lj+j+1, lj+w, T(0));
+         }
+         for (int i = w; i < n-k0; ++i) {
+            T* li = kernels::address(panel,i,0);
+            for (int k = 0; k < w; ++k) {
+               const T* lk = kernels::address(panel,k,0);
+               li[k] = (li[k] - kernels::dot(k, lk, 1, li, 1))/lk[k];
+            }
+         }
+
+         Tile t;
+         for (int I = K; I < nt; ++I) {
+            t.resize(A.rows(I), w, false);
+            for (int i = 0; i < (int) t.size1(); ++i) {
+               for (int j = 0; j < w; ++j) {
+                  t(i,j) = panel(I*b-k0+i,j);
+               }
+            }
+            A.setTile(I, K, t);
+         }
+         A.flush();
+      }
+   }
+
+/* ------------------------
+   Public Methods
+ * ------------------------ */
+
+   /** Is the matrix symmetric and positive definite?
+   @return     true if A is positive definite (its symmetry is not checked).
+   */
+
+   bool isSPD () const {
+      return isspd;
+   }
+
+   /** Return the tiles of the triangular factor.
+   @return     L, in the lower tiles
+   */
+
+   TiledMatrix<T>& getTiles () const {
+      return *tiles;
+   }
+
+   /** Solve A*X = B, streaming the tiles of L twice.
+   @param  B   A Matrix with as many rows as A and any number of columns.
+   @return     X so that L*L'*X = B
+   @exception  bad_size  Matrix row dimensions must agree.
+   @exception  singular  Matrix is not symmetric positive definite.
+   */
+
+   Matrix solve (const Matrix& B) const {
+      BOOST_UBLAS_CHECK((int) B.size1() == n, bad_size("Matrix row dimensions must agree."));
+      BOOST_UBLAS_CHECK(isspd, singular("Matrix is not symmetric positive definite."));
+
+      // Columns of X are contiguous.
+      matrix<T,column_major> X(B);
+      const int nx = B.size2();
+      std::vector<T> coef(b);
+
+      // Solve L*Y = B;
+      for (int J = 0; J < nt; ++J) {
+         const int j0 = J*b;
+         const int wj = tiles->cols(J);
+         tiles->stream(column(J,J), [&] (int I, int, Tile& t) {
+            for (int c = 0; c < nx; ++c) {
+               T* x = kernels::address(X,j0,c);
+               if (I == J) {
+                  for (int k = 0; k < wj; ++k) {
+                     x[k] /= t(k,k);
+                     kernels::axpy(wj-k-1, -x[k], &t(0,0) + k*wj + k+1, 1, x+k+1, 1);
+                  }
+               } else {
+                  for (int l = 0; l < wj; ++l) {
+                     coef[l] = -x[l];
+                  }
+                  kernels::gemv(t.size1(), wj, &t(0,0), t.size1(), &coef[0], kernels::address(X,I*b,c));
+               }
+            }
+         });
+      }
+
+      // Solve L'*X = Y;
+      for (int J = nt-1; J >= 0; --J) {
+         const int j0 = J*b;
+         const int wj = tiles->cols(J);
+         tiles->stream(column(J,J,true), [&] (int I, int, Tile& t) {
+            const int r = t.size1();
+            for (int c = 0; c < nx; ++c) {
+               T* x = kernels::address(X,j0,c);
+               if (I == J) {
+                  for (int k = wj-1; k >= 0; --k) {
+                     x[k] = (x[k] - kernels::dot(wj-k-1, &t(0,0) + k*wj + k+1, 1, x+k+1, 1))/t(k,k);
+                  }
+               } else {
+                  const T* y = kernels::address(X,I*b,c);
+                  for (int l = 0; l < wj; ++l) {
+                     x[l] -= kernels::dot(r, &t(0,0) + l*r, 1, y, 1);
+                  }
+               }
+            }
+         });
+      }
+      return Matrix(X);
+   }
+};
+
+}}}
+#endif
@@ -0,0 +1,332 @@
+   /** Out-of-core LU Decomposition.
+   <P>
+   For a square matrix A larger than the memory, kept as tiles in a file
+   (TiledMatrix), the LU decomposition with partial pivoting is computed
+   in place, one tile column (panel) at a time, left-looking: the panel
+   is read, the row interchanges and the tile columns of L on its left
+   are applied to it, streaming those tiles through memory with the next
+   tile read while the current one is applied, and the panel is factored
+   and written back.  The memory used is the panel (n-by-b), four tiles
+   (Y, the current and prefetched tiles, and the tile written back) and a
+   few vectors of length n; TiledMatrix::tileSize() gives the tile size b
+   for a memory budget.
+   <P>
+   The interchanges of a panel are not applied to the tile columns on its
+   left, which would rewrite them: each tile column of L stays in the row
+   order of its own factorization, and solve() applies the interchanges
+   of each tile column before its forward substitution step, as in
+   LINPACK's dgesl.  getPivot() is the permutation piv of the Jama
+   decomposition, A(piv,:) = L*U, but the stored L is only equal to it up
+   to these delayed interchanges.  The TiledMatrix is overwritten by the
+   factors and must outlive the decomposition.
+   */
+
+#ifndef _BOOST_UBLAS_OUTOFCORELUDECOMPOSITION_
+#define _BOOST_UBLAS_OUTOFCORELUDECOMPOSITION_
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <boost/numeric/ublas/vector.hpp>
+#include <boost/numeric/ublas/matrix.hpp>
+#include <boost/numeric/ublas/exception.hpp>
+#include <boost/numeric/ublas/matrix_proxy.hpp>
+#include "SimdKernels.hpp"
+#include "TiledMatrix.hpp"
+
+namespace boost { namespace numeric { namespace ublas {
+
+// T: type, F: layout of the right hand sides and solutions (row_major/column_major)
+template<class T, class F = row_major>
+class OutOfCoreLUDecomposition {
+
+    typedef vector<T> Vector;
+    typedef vector<std::size_t> PivotVector;
+    typedef matrix<T,F> Matrix;
+    typedef typename TiledMatrix<T>::Tile Tile;
+    typedef typename TiledMatrix<T>::TileIndex TileIndex;
+
+/* ------------------------
+   Class variables
+ * ------------------------ */
+
+   /** Tiles of A, then of L and U.
+   */
+   TiledMatrix<T>* tiles;
+
+   /** Row and column dimension, tile size, number of tile columns and
+       pivot sign.
+   */
+   int n, b, nt, pivsign;
+
+   /** Row interchanged with row j at step j (LAPACK's ipiv, from 0).
+   */
+   PivotVector swaps;
+
+   /** Pivot permutation vector.
+   */
+   PivotVector piv;
+
+   /** Diagonal of U.
+   */
+   Vector diagonal;
+
+/* ------------------------
+   Private Methods
+ * ------------------------ */
+
+   // Tile column J, from tile row I0 to I1 (excluded) in this order.
+
+   std::vector<TileIndex> column (int J, int I0, int I1) const {
+      std::vector<TileIndex> list;
+      for (int I = I0; I != I1; I += (I1 > I0 ? 1 : -1)) {
+         list.push_back(TileIndex(I,J));
+      }
+      return list;
+   }
+
+   // Interchange the rows of X as the steps j0..j1-1 did.
+
+   template<class M>
+   void interchange (M& X, int j0, int j1) const {
+      for (int j = j0; j < j1; ++j) {
+         if ((int) swaps(j) != j) {
+            row(X,j).swap(row(X,swaps(j)));
+         }
+      }
+   }
+
+public:
+/* ------------------------
+   Constructor
+ * ------------------------ */
+
+   /** Empty LU Decomposition, to be computed later with compute().
+   */
+
+   OutOfCoreLUDecomposition () : tiles(0), n(0), b(1), nt(0), pivsign(1) {}
+
+   /** Out-of-core LU Decomposition
+   @param  A   Square matrix, overwritten by L and U.
+   */
+
+   explicit OutOfCoreLUDecomposition (TiledMatrix<T>& A) : tiles(0), n(0), b(1), nt(0), pivsign(1) {
+      compute(A);
+   }
+
+   /** Factor a new matrix in place.
+   @param  A   Square matrix, overwritten by L and U.
+   @exception  bad_size  Matrix must be square.
+   @exception  external_logic  I/O error of the tiles.
+   */
+
+   void compute (TiledMatrix<T>& A) {
+      BOOST_UBLAS_CHECK(A.size1() == A.size2(), bad_size("Matrix must be square."));
+      tiles = &A;
+      n = A.size1();
+      b = A.tileSize();
+      nt = A.tileCols();
+      pivsign = 1;
+      swaps.resize(n,false);
+      diagonal.resize(n,false);
+
+      // All the rows of the tile column K, and -U(J,K) of the updates.
+      matrix<T> panel, Y;
+      std::vector<T> coef(b);
+      for (int K = 0; K < nt; ++K) {
+         const int k0 = K*b;
+         const int w = A.cols(K);
+         panel.resize(n, w, false);
+         A.stream(column(K,0,nt), [&] (int I, int, Tile& t) {
+            for (int i = 0; i < (int) t.size1(); ++i) {
+               for (int j = 0; j < w; ++j) {
+                  panel(I*b+i,j) = t(i,j);
+               }
+            }
+         });
+
+         // Left-looking update by the tile columns of L, each one after
+         // its interchanges.
+         for (int J = 0; J < K; ++J) {
+            const int j0 = J*b;
+            const int wj = A.cols(J);
+            interchange(panel, j0, j0+wj);
+            A.stream(column(J,J,nt), [&] (int I, int, Tile& t) {
+               if (I == J) {
+                  // U(J,K) = inv(L(J,J))*P(J), L(J,J) unit lower triangular.
+                  for (int r = 1; r < wj; ++r) {
+                     for (int l = 0; l < r; ++l) {
+                        coef[l] = -t(r,l);
+                     }
+                     kernels::gemv(w, r, kernels::address(panel,j0,0), w, &coef[0], kernels::address(panel,j0+r,0));
+                  }
+                  Y.resize(wj, w, false);
+                  for (int l = 0; l < wj; ++l) {
+                     for (int j = 0; j < w; ++j) {
+                        Y(l,j) = -panel(j0+l,j);
+                     }
+                  }
+               } else {
+                  kernels::rankKUpdate(panel, I*b, I*b+t.size1(), 0, w, wj,
+                                       t.data().begin(), t.size1(), Y.data().begin(), w);
+               }
+            });
+         }
+
+         // Factor the rows k0..n-1 of the panel with partial pivoting.
+         for (int j = 0; j < w; ++j) {
+            const int g = k0+j;
+            int p = g;
+            for (int i = g+1; i < n; ++i) {
+               if (std::abs(panel(i,j)) > std::abs(panel(p,j))) {
+                  p = i;
+               }
+            }
+            swaps(g) = p;
+            if (p != g) {
+               row(panel,p).swap(row(panel,g));
+               pivsign = -pivsign;
+            }
+            const T d = panel(g,j);
+            if (d != 0.0) {
+               const T* u = kernels::address(panel,g,j+1);
+               for (int i = g+1; i < n; ++i) {
+                  T& l = panel(i,j);
+                  l /= d;
+                  kernels::axpy(w-j-1, -l, u, 1, kernels::address(panel,i,j+1), 1);
+               }
+            }
+            diagonal(g) = d;
+         }
+
+         Tile t;
+         for (int I = 0; I < nt; ++I) {
+            t.resize(A.rows(I), w, false);
+            for (int i = 0; i < (int) t.size1(); ++i) {
+               for (int j = 0; j < w; ++j) {
+                  t(i,j) = panel(I*b+i,j);
+               }
+            }
+            A.setTile(I, K, t);
+         }
+         A.flush();
+      }
+
+      piv.resize(n,false);
+      for (int i = 0; i < n; ++i) {
+         piv(i) = i;
+      }
+      for (int j = 0; j < n; ++j) {
+         std::swap(piv(j), piv(swaps(j)));
+      }
+   }
+
+/* ------------------------
+   Public Methods
+ * ------------------------ */
+
+   /** Is the matrix nonsingular?
+   @return     true if U, and hence A, is nonsingular.
+   */
+
+   bool isNonsingular () const {
+      for (int j = 0; j < n; j++) {
+         if (diagonal(j) == 0.)
+            return false;
+      }
+      return true;
+   }
+
+   /** Return pivot permutation vector
+   @return     piv
+   */
+
+   const PivotVector& getPivot () const {
+      return piv;
+   }
+
+   /** Return the tiles of the factors.
+   @return     L (unit diagonal not stored, delayed interchanges) and U
+   */
+
+   TiledMatrix<T>& getTiles () const {
+      return *tiles;
+   }
+
+   /** Determinant
+   @return     det(A)
+   */
+
+   T det () const {
+      T d = (T) pivsign;
+      for (int j = 0; j < n; j++) {
+         d *= diagonal(j);
+      }
+      return d;
+   }
+
+   /** Solve A*X = B, streaming the tiles of L and U once.
+   @param  B   A Matrix with as many rows as A and any number of columns.
+   @return     X so that L*U*X = B(piv,:)
+   @exception  bad_size Matrix row dimensions must agree.
+   @exception  singular  Matrix is singular.
+   */
+
+   Matrix solve (const Matrix& B) const {
+      BOOST_UBLAS_CHECK((int) B.size1() == n, bad_size("Matrix row dimensions must agree."));
+      BOOST_UBLAS_CHECK(isNonsingular(), singular("Matrix is singular."));
+
+      // Columns of X are contiguous.
+      matrix<T,column_major> X(B);
+      const int nx = B.size2();
+      std::vector<T> coef(b);
+
+      // Solve L*Y = B(piv,:)
+      for (int J = 0; J < nt; ++J) {
+         const int j0 = J*b;
+         const int wj = tiles->cols(J);
+         interchange(X, j0, j0+wj);
+         tiles->stream(column(J,J,nt), [&] (int I, int, Tile& t) {
+            for (int c = 0; c < nx; ++c) {
+               T* x = kernels::address(X,j0,c);
+               if (I == J) {
+                  for (int k = 0; k < wj; ++k) {
+                     kernels::axpy(wj-k-1, -x[k], &t(0,0) + k*wj + k+1, 1, x+k+1, 1);
+                  }
+               } else {
+                  for (int l = 0; l < wj; ++l) {
+                     coef[l] = -x[l];
+                  }
+                  kernels::gemv(t.size1(), wj, &t(0,0), t.size1(), &coef[0], kernels::address(X,I*b,c));
+               }
+            }
+         });
+      }
+
+      // Solve U*X = Y;
+      for (int K = nt-1; K >= 0; --K) {
+         const int k0 = K*b;
+         const int w = tiles->cols(K);
+         tiles->stream(column(K,K,-1), [&] (int I, int, Tile& t) {
+            for (int c = 0; c < nx; ++c) {
+               T* x = kernels::address(X,k0,c);
+               if (I == K) {
+                  for (int k = w-1; k >= 0; --k) {
+                     x[k] /= t(k,k);
+                     kernels::axpy(k, -x[k], &t(0,0) + k*w, 1, x, 1);
+                  }
+               } else {
+                  for (int l = 0; l < w; ++l) {
+                     coef[l] = -x[l];
+                  }
+                  kernels::gemv(t.size1(), w, &t(0,0), t.size1(), &coef[0], kernels::address(X,I*b,c));
+               }
+            }
+         });
+      }
+      return Matrix(X);
+   }
+};
+
+}}}
+#endif
@@ -0,0 +1,266 @@
+   /** Threads of the blocked decompositions.
+   <P>
+   The matrix-matrix updates of the blocked reductions split their columns
+   among a number of threads, by default the number of hardware threads,
+   or UBLASJAMA_THREADS if this environment variable is set when the
+   program starts:
+<pre>
+   parallel::setThreads(4);        // at most 4 threads per update
+   parallel::setThreads(1);        // run everything in the calling thread
+</pre>
+   An update large enough to make it worthwhile (see the grain of
+   parallelFor below) is split into ranges run by a pool of threads,
+   started when first needed and kept until the program exits, the
+   calling thread running one of the ranges.  The update returns once
+   all its ranges are done, and the calls from several threads share the
+   pool, so that the decompositions stay usable from several threads at
+   once.  Once the pool has its threads, an update does not allocate.
+   <P>
+   Once computed (or loaded), a decomposition is only read by its const
+   methods (solve, det, inverse, the getters, save), which may therefore
+   be called concurrently on the same object without locking; compute(),
+   load() and the set methods must not run concurrently with anything
+   else on that object.  MixedPrecisionLUDecomposition::solve() is the
+   exception: it records its refinement steps and may refactor.
+   solve() below splits the right hand sides of one system among threads:
+<pre>
+   LUDecomposition<double> LU(A);
+   X = parallel::solve(LU, B);     // columns of B in parallel
+</pre>
+   */
+
+#ifndef _BOOST_UBLAS_PARALLEL_
+#define _BOOST_UBLAS_PARALLEL_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <boost/numeric/ublas/matrix.hpp>
+#include <boost/numeric/ublas/matrix_proxy.hpp>
+
+namespace boost { namespace numeric { namespace ublas { namespace parallel {
+
+namespace detail {
+
+inline int defaultThreads () {
+   if (const char* env = std::getenv("UBLASJAMA_THREADS")) {
+      int t = std::atoi(env);
+      if (t > 0) {
+         return t;
+      }
+   }
+   return std::max(1u, std::thread::hardware_concurrency());
+}
+
+inline std::atomic<int>& threadCount () {
+   static std::atomic<int> count(defaultThreads());
+   return count;
+}
+
+}
+
+/** Maximum number of threads of an update.
+*/
+
+inline int threads () {
+   return detail::threadCount().load(std::memory_order_relaxed);
+}
+
+/** Set the maximum number of threads of the following updates.
+@param t    Number of threads (at least 1).
+*/
+
+inline void setThreads (int t) {
+   detail::threadCount().store(std::max(1, t), std::memory_order_relaxed);
+}
+
+namespace detail {
+
+// The ranges of one parallelFor, on the stack of its caller.
+
+struct Job {
+   void (*call) (void* f, int b, int e);
+   void* f;
+   int pending;
+   std::exception_ptr error;
+};
+
+template<class F>
+void callRange (void* f, int b, int e) {
+   (*static_cast<F*>(f))(b, e);
+}
+
+struct Task {
+   Job* job;
+   int b, e;
+};
+
+// Threads waiting for the tasks of all the parallelFor calls.  A caller
+// queues all its ranges but one, runs that one, then runs queued tasks
+// (its own or others') until its ranges are done, so that it never waits
+// for a busy pool, nested calls included.  If no thread can be started,
+// the callers run all their ranges themselves.
+
+class Pool {
+   std::mutex lock;
+   std::condition_variable work, done;
+   std::vector<Task> tasks;
+   std::vector<std::thread> workers;
+   bool stopping;
+
+   Pool () : stopping(false) {}
+
+   ~Pool () {
+      {
+         std::lock_guard<std::mutex> guard(lock);
+         stopping = true;
+      }
+      work.notify_all();
+      for (std::size_t i = 0; i < workers.size(); ++i) {
+         workers[i].join();
+      }
+   }
+
+   // Run a task, with the lock released, and count it as done.
+
+   void execute (std::unique_lock<std::mutex>& guard, const Task& t) {
+      guard.unlock();
+      std::exception_ptr error;
+      try {
+         t.job->call(t.job->f, t.b, t.e);
+      } catch (...) {
+         error = std::current_exception();
+      }
+      guard.lock();
+      if (error && !t.job->error) {
+         t.job->error = error;
+      }
+      if (--t.job->pending == 0) {
+         done.notify_all();
+      }
+   }
+
+   void serve () {
+      std::unique_lock<std::mutex> guard(lock);
+      for (;;) {
+         work.wait(guard, [this] { return stopping || !tasks.empty(); });
+         if (tasks.empty()) {
+            return;
+         }
+         Task t = tasks.back();
+         tasks.pop_back();
+         execute(guard, t);
+      }
+   }
+
+public:
+   static Pool& instance () {
+      static Pool pool;
+      return pool;
+   }
+
+   // Run f on the t ranges of [begin,begin+count).
+
+   void run (Job& job, int begin, int count, int t) {
+      std::unique_lock<std::mutex> guard(lock);
+      while ((int) workers.size() < t-1) {
+         try {
+            workers.push_back(std::thread(&Pool::serve, this));
+         } catch (...) {
+            break;
+         }
+      }
+      job.pending = t-1;
+      int b = begin;
+      for (int i = 0; i < t-1; ++i) {
+         int e = begin + (int) ((long) count*(i+1)/t);
+         Task task = { &job, b, e };
+         tasks.push_back(task);
+         b = e;
+      }
+      guard.unlock();
+      work.notify_all();
+      try {
+         job.call(job.f, b, begin + count);
+      } catch (...) {
+         guard.lock();
+         if (!job.error) {
+            job.error = std::current_exception();
+         }
+         guard.unlock();
+      }
+      guard.lock();
+      while (job.pending > 0) {
+         if (tasks.empty()) {
+            done.wait(guard);
+         } else {
+            Task task = tasks.back();
+            tasks.pop_back();
+            execute(guard, task);
+         }
+      }
+   }
+};
+
+}
+
+/** Call f(b,e) on consecutive ranges [b,e) covering [begin,end), in
+    parallel, each range holding at least grain elements (except when
+    [begin,end) is smaller).  Returns when all the calls have returned;
+    if some of them threw, the first exception is then rethrown in the
+    calling thread.
+*/
+
+template<class F>
+void parallelFor (int begin, int end, int grain, F f) {
+   int count = end - begin;
+   if (count <= 0) {
+      return;
+   }
+   int t = std::min(threads(), count/std::max(1, grain));
+   if (t <= 1) {
+      f(begin, end);
+      return;
+   }
+   detail::Job job = { &detail::callRange<F>, &f, 0, std::exception_ptr() };
+   detail::Pool::instance().run(job, begin, count, t);
+   if (job.error) {
+      std::rethrow_exception(job.error);
+   }
+}
+
+/** Solve A*X = B with a decomposition of A, the columns of B being split
+    among the threads, each solving its columns with the const solve() of
+    the shared decomposition.
+@param  D      Decomposition (LU, QR, Cholesky, out-of-core...).
+@param  B      Right hand sides.
+@param  grain  Minimum number of columns per thread.
+@return        X, as D.solve(B).
+*/
+
+template<class Decomposition, class M>
+M solve (const Decomposition& D, const M& B, int grain = 8) {
+   const int nx = B.size2();
+   if (std::min(threads(), nx/std::max(1, grain)) <= 1) {
+      return D.solve(B);
+   }
+   M X;
+   std::mutex lock;
+   parallelFor(0, nx, grain, [&] (int b, int e) {
+      M part = D.solve(M(subrange(B, 0, B.size1(), b, e)));
+      std::lock_guard<std::mutex> guard(lock);
+      if ((int) X.size2() != nx) {
+         X.resize(part.size1(), nx, false);
+      }
+      noalias(subrange(X, 0, part.size1(), b, e)) = part;
+   });
+   return X;
+}
+
+}}}}
+#endif
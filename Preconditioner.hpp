@@ -0,0 +1,242 @@
+   /** Preconditioners of the Krylov linear solvers.
+   <P>
+   A preconditioner M of A is a function object called as
+<pre>
+   M(r, z);         // const vector<T>& r, vector<T>& z (size n): z = inv(M)*r
+</pre>
+   with M close to A in some sense, and inv(M)*r cheap, so that the solver
+   (KrylovLinearSolver.hpp) converges in fewer iterations on inv(M)*A than
+   on A.  Conjugate gradients and MINRES need a symmetric positive definite
+   M.  Three are given here:
+<pre>
+   - BlockJacobiPreconditioner: the CholeskyDecomposition of each diagonal
+     block of A (a symmetric positive definite A has positive definite
+     diagonal blocks), so that inv(M) is exact on the blocks;
+   - IncompleteLUPreconditioner: ILU(0), the LU factors of A restricted to
+     the pattern of A, for a general sparse A (compressed_matrix);
+   - factorizationPreconditioner(): the solve of any existing decomposition
+     with solveInPlace(Vector&), such as the LUDecomposition of a nearby
+     matrix or the SparseCholeskyDecomposition of a simplified operator.
+</pre>
+   */
+
+#ifndef _BOOST_UBLAS_PRECONDITIONER_
+#define _BOOST_UBLAS_PRECONDITIONER_
+
+#include <algorithm>
+#include <vector>
+#include <boost/numeric/ublas/vector.hpp>
+#include <boost/numeric/ublas/matrix.hpp>
+#include <boost/numeric/ublas/exception.hpp>
+#include <boost/numeric/ublas/matrix_proxy.hpp>
+#include <boost/numeric/ublas/vector_proxy.hpp>
+#include "CholeskyDecomposition.hpp"
+#include "SparseOrdering.hpp"
+
+namespace boost { namespace numeric { namespace ublas {
+
+/** No preconditioning: z = r.
+*/
+
+struct IdentityPreconditioner {
+   template<class V1, class V2>
+   void operator() (const V1& r, V2& z) const {
+      z = r;
+   }
+};
+
+/** Preconditioner of a decomposition, which must outlive it.
+*/
+
+// D: decomposition type (LUDecomposition, CholeskyDecomposition, ...)
+template<class D>
+class FactorizationPreconditioner {
+   const D& d;
+
+public:
+   explicit FactorizationPreconditioner (const D& d) : d(d) {}
+
+   /** z = inv(M)*r by the solve of the decomposition.
+   */
+
+   template<class V1, class V2>
+   void operator() (const V1& r, V2& z) const {
+      z = r;
+      d.solveInPlace(z);
+   }
+};
+
+/** Preconditioner of a decomposition.
+@param d    Decomposition of M, referenced by the preconditioner.
+@return     Preconditioner computing z = M\r.
+*/
+
+template<class D>
+FactorizationPreconditioner<D> factorizationPreconditioner (const D& d) {
+   return FactorizationPreconditioner<D>(d);
+}
+
+/** Block Jacobi preconditioner: M is the block diagonal part of A, with
+    blocks of blockSize rows and columns (the last one may be smaller),
+    each factored by CholeskyDecomposition.
+*/
+
+// T: type
+template<class T = double>
+class BlockJacobiPreconditioner {
+   typedef vector<T> Vector;
+   typedef matrix<T> Matrix;
+
+   /** First row of each block, and n.
+   */
+   std::vector<int> start;
+
+   /** Factors of the diagonal blocks.
+   */
+   std::vector<CholeskyDecomposition<T> > blocks;
+
+public:
+/* ------------------------
+   Constructor
+ * ------------------------ */
+
+   /** Factor the diagonal blocks of a symmetric positive definite matrix.
+   @param A          Square matrix, dense or sparse.
+   @param blockSize  Order of the diagonal blocks (1: Jacobi).
+   @exception  bad_argument  A diagonal block is not positive definite.
+   */
+
+   template<class M>
+   BlockJacobiPreconditioner (const matrix_expression<M>& A, int blockSize) {
+      BOOST_UBLAS_CHECK(A().size1() == A().size2(), bad_size("Matrix must be square."));
+      BOOST_UBLAS_CHECK(blockSize > 0, bad_argument());
+      const int n = A().size1();
+      for (int i0 = 0; i0 < n; i0 += blockSize) {
+         const int i1 = std::min(i0 + blockSize, n);
+         start.push_back(i0);
+         blocks.push_back(CholeskyDecomposition<T>(Matrix(project(A(), range(i0,i1), range(i0,i1)))));
+         if (!blocks.back().isSPD()) {
+            bad_argument("BlockJacobiPreconditioner: a diagonal block is not positive definite").raise();
+         }
+      }
+      start.push_back(n);
+   }
+
+/* ------------------------
+   Public Methods
+ * ------------------------ */
+
+   /** z = inv(M)*r, block by block.
+   */
+
+   template<class V1, class V2>
+   void operator() (const V1& r, V2& z) const {
+      BOOST_UBLAS_CHECK((int) r.size() == start.back(), bad_size("Matrix row dimensions must agree."));
+      z.resize(r.size(), false);
+      Vector x;
+      for (std::size_t b = 0; b < blocks.size(); ++b) {
+         const range rows(start[b], start[b+1]);
+         x = project(r, rows);
+         blocks[b].solveInPlace(x);
+         project(z, rows) = x;
+      }
+   }
+};
+
+/** Incomplete LU preconditioner ILU(0): M = L*U with L unit lower and U
+    upper triangular, zero outside the pattern of A, and equal to A on it.
+    The pivots are not exchanged: A should have a nonzero diagonal, and is
+    at best diagonally dominant or an M-matrix (for which ILU(0) exists).
+*/
+
+// T: type
+template<class T = double>
+class IncompleteLUPreconditioner {
+
+   /** L (below the diagonal) and U in the pattern of A, in compressed
+       columns, and the position of the diagonal of each column.
+   */
+   sparse::CompressedColumns<T> LU;
+   std::vector<int> diagonal;
+
+public:
+/* ------------------------
+   Constructor
+ * ------------------------ */
+
+   /** Incomplete factorization of a sparse matrix.
+   @param A    Square matrix (compressed_matrix), with a nonzero diagonal.
+   @exception  singular  A zero pivot (or a diagonal element outside the pattern).
+   */
+
+   template<class M>
+   explicit IncompleteLUPreconditioner (const matrix_expression<M>& A)
+   : LU(sparse::compressColumns(A())) {
+      BOOST_UBLAS_CHECK(A().size1() == A().size2(), bad_size("Matrix must be square."));
+      const int n = LU.n;
+      diagonal.assign(n, -1);
+      std::vector<int> position(n, -1);
+
+      // Left-looking, column by column: the elements of column j above
+      // the diagonal are final in increasing row order.
+      for (int j = 0; j < n; ++j) {
+         for (int q = LU.p[j]; q < LU.p[j+1]; ++q) {
+            position[LU.i[q]] = q;
+         }
+         for (int q = LU.p[j]; q < LU.p[j+1] && LU.i[q] < j; ++q) {
+            const int k = LU.i[q];
+            for (int t = diagonal[k]+1; t < LU.p[k+1]; ++t) {
+               if (position[LU.i[t]] >= 0) {
+                  LU.x[position[LU.i[t]]] -= LU.x[t]*LU.x[q];
+               }
+            }
+         }
+         diagonal[j] = position[j];
+         if (diagonal[j] < 0 || LU.x[diagonal[j]] == 0.0) {
+            singular("IncompleteLUPreconditioner: zero pivot").raise();
+         }
+         for (int q = diagonal[j]+1; q < LU.p[j+1]; ++q) {
+            LU.x[q] /= LU.x[diagonal[j]];
+         }
+         for (int q = LU.p[j]; q < LU.p[j+1]; ++q) {
+            position[LU.i[q]] = -1;
+         }
+      }
+   }
+
+/* ------------------------
+   Public Methods
+ * ------------------------ */
+
+   /** z = inv(U)*inv(L)*r
+   */
+
+   template<class V1, class V2>
+   void operator() (const V1& r, V2& z) const {
+      const int n = LU.n;
+      BOOST_UBLAS_CHECK((int) r.size() == n, bad_size("Matrix row dimensions must agree."));
+      z = r;
+      for (int j = 0; j < n; ++j) {
+         for (int q = diagonal[j]+1; q < LU.p[j+1]; ++q) {
+            z(LU.i[q]) -= LU.x[q]*z(j);
+         }
+      }
+      for (int j = n-1; j >= 0; --j) {
+         z(j) /= LU.x[diagonal[j]];
+         for (int q = LU.p[j]; q < diagonal[j]; ++q) {
+            z(LU.i[q]) -= LU.x[q]*z(j);
+         }
+      }
+   }
+
+   /** Return the factors, L (unit diagonal not stored) and U together.
+   @return     L+U-I, in compressed columns
+   */
+
+   const sparse::CompressedColumns<T>& getLU () const {
+      return LU;
+   }
+};
+
+}}}
+#endif
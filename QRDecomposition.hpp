@@ -14,17 +14,27 @@
 #ifndef _BOOST_UBLAS_QRDECOMPOSITION_
 #define _BOOST_UBLAS_QRDECOMPOSITION_
 
+#include <algorithm>
+#include <cmath>
 #include <boost/numeric/ublas/vector.hpp>
 #include <boost/numeric/ublas/matrix.hpp>
 #include <boost/numeric/ublas/exception.hpp>
 #include <boost/numeric/ublas/matrix_proxy.hpp>
+#include <boost/math/special_functions/hypot.hpp>
+#include "SimdKernels.hpp"
+#include "ConditionEstimate.hpp"
+#include "Instrumentation.hpp"
+#include "Serialization.hpp"
 
 namespace boost { namespace numeric { namespace ublas {
     
+// T: type, F: layout (row_major/column_major),
+// ST: storage array of the internal matrices and vectors (e.g. unbounded_array<T, aligned_allocator<T> >)
+template<class T, class F = row_major, class ST = unbounded_array<T> >
 class QRDecomposition {
 
-    typedef vector<double> Vector;
-    typedef matrix<double> Matrix;
+    typedef vector<T,ST> Vector;
+    typedef matrix<T,F,ST> Matrix;
         
 /* ------------------------
    Class variables
@@ -46,11 +56,25 @@ class QRDecomposition {
    */
    Vector Rdiag;
 
+   /** Working storage for the update of the trailing columns.
+   */
+   Vector QRwork;
+
+   /** Instrumentation counters of the last compute().
+   */
+   instrumentation::Stats stats;
+
 public:
 /* ------------------------
    Constructor
  * ------------------------ */
 
+   /** Construct an empty decomposition, to be computed with compute()
+       or read with load().
+   */
+
+   QRDecomposition () : m(0), n(0) {}
+
    /** QR Decomposition, computed by Householder reflections.
        Structure to access R and the Householder vectors and compute Q.
    @param A    Rectangular matrix
@@ -58,6 +82,15 @@ public:
 
    QRDecomposition (const Matrix &A);
 
+   /** Recompute the decomposition for a new matrix.
+       The storage of the previous decomposition is reused when the
+       dimensions of A match, so that refactoring same-sized matrices
+       does not allocate.
+   @param A    Rectangular matrix
+   */
+
+   void compute (const Matrix &A);
+
 /* ------------------------
    Public Methods
  * ------------------------ */
@@ -68,12 +101,29 @@ public:
 
    bool isFullRank () const;
 
+   /** Reciprocal condition number of R in the 1-norm, estimated in
+       O(n^2) (see ConditionEstimate.hpp).  It is within a factor n of
+       that of A, whose 2-norm condition R shares.
+   @return     about 1/(norm1(R)*norm1(inverse(R))), 0 if R is singular.
+   */
+
+   T rcond () const;
+
    /** Return the Householder vectors
    @return     Lower trapezoidal matrix whose columns define the reflections
    */
 
    Matrix getH () const;
 
+   /** Return the instrumentation counters of the last compute()
+       (zero unless compiled with UBLASJAMA_INSTRUMENTATION).
+   @return     stats
+   */
+
+   const instrumentation::Stats& getStats () const {
+      return stats;
+   }
+
    /** Return the upper triangular factor
    @return     R
    */
@@ -93,16 +143,591 @@ public:
    @exception  RuntimeException  Matrix is rank deficient.
    */
 
-   Matrix solve (const Matrix &B);
+   Matrix solve (const Matrix &B) const;
+
+   /** Least squares solution of A*x = b
+   @param b    A vector with as many elements as A has rows.
+   @return     x that minimizes the two norm of Q*R*x-b.
+   @exception  bad_size  Matrix row dimensions must agree.
+   @exception  singular  Matrix is rank deficient.
+   */
+
+   Vector solve (const Vector &b) const;
+
+   /** Least squares solution of A*x = b in place, as in LAPACK's dgels:
+       x replaces the first n elements of b, and the other m-n hold the
+       components of the residual along the columns of the full Q.
+   @param b    Right hand side, replaced by x (and the residual components).
+   @exception  bad_size  Matrix row dimensions must agree.
+   @exception  singular  Matrix is rank deficient.
+   */
+
+   void solveInPlace (Vector &b) const;
+
+   /** Least squares solution of A*X = B in place, in the first n rows of
+       B as in solveInPlace(b), with contiguous kernels on the rows (row
+       major, using one row of working storage) or the columns of B.
+   @param B    Right hand sides, replaced by X (and the residual components).
+   @exception  bad_size  Matrix row dimensions must agree.
+   @exception  singular  Matrix is rank deficient.
+   */
+
+   void solveInPlace (Matrix &B) const;
+
+   /** Minimum norm solution of A'*X = B, A having full rank, as in
+       LAPACK's dgels: X = Q*inv(R')*B.
+   @param B    A Matrix with as many rows as A has columns.
+   @return     X, with as many rows as A, of minimum two norm among the
+               solutions of the underdetermined system A'*X = B.
+   @exception  bad_size  Matrix dimensions must agree.
+   @exception  singular  Matrix is rank deficient.
+   */
+
+   Matrix solveTranspose (const Matrix &B) const;
+
+   /** Minimum norm solution of A'*x = b
+   @param b    A vector with as many elements as A has columns.
+   @return     x of minimum two norm so that A'*x = b.
+   @exception  bad_size  Matrix dimensions must agree.
+   @exception  singular  Matrix is rank deficient.
+   */
+
+   Vector solveTranspose (const Vector &b) const;
 
    /** Matrix inverse
    @return     inverse(A).
    */
 
-   Matrix inverse () {
-      return solve(identity_matrix<double>(m,m));
+   Matrix inverse () const {
+      return solve(identity_matrix<T>(m,m));
    }
+
+   /** Write the decomposition to a binary stream (see Serialization.hpp).
+   @param os   Output stream, opened in binary mode.
+   @param alignment  Alignment of the matrix elements (0: none;
+                     serialization::pageAlignment for a file to be mapped).
+   */
+
+   void save (std::ostream& os, std::size_t alignment = 0) const;
+
+   /** Replace the decomposition by one written by save().
+   @param is   Input stream, opened in binary mode.
+   @exception  external_logic  Not a QR decomposition of this scalar type, or truncated.
+   */
+
+   void load (std::istream& is);
+
+   /** Replace the decomposition by one saved at the start of a mapped
+       file, binding its matrices to the file if ST is mapped_array.
+   @param file  Mapped file (see MappedStorage.hpp).
+   @exception  external_logic  As load(is).
+   */
+
+   void load (const MappedFile& file);
+
+private:
+   void restore (serialization::Reader<T,F>& in);
+
+   // x = Q'*x and x(0:n-1) = inv(R)*x(0:n-1), for a contiguous x.
+   void transposeQ (T* x) const;
+   void upperSolve (T* x) const;
+
+   // x(0:n-1) = inv(R')*x(0:n-1) and x = Q*x.
+   void transposeUpperSolve (T* x) const;
+   void applyQ (T* x) const;
 };
 
+
+   /** sqrt(a^2 + b^2) without under/overflow. **/
+   /*
+   static inline T hypot(T a, T b) {
+      T r;
+      if (std::abs(a) > std::abs(b)) {
+         r = b/a;
+         r = std::abs(a)*std::sqrt(1+r*r);
+      } else if (b != 0) {
+         r = a/b;
+         r = std::abs(b)*std::sqrt(1+r*r);
+      } else {
+         r = 0.0;
+      }
+      return r;
+   }
+   */
+    
+    
+/* ------------------------
+   Constructor
+ * ------------------------ */
+
+   /** QR Decomposition, computed by Householder reflections.
+       Structure to access R and the Householder vectors and compute Q.
+   @param A    Rectangular matrix
+   */
+
+template<class T, class F, class ST>
+QRDecomposition<T,F,ST>::QRDecomposition (const Matrix &A) {
+      compute(A);
+   }
+
+   /** Recompute the decomposition for a new matrix.
+   @param A    Rectangular matrix
+   */
+
+template<class T, class F, class ST>
+void QRDecomposition<T,F,ST>::compute (const Matrix &A) {
+      stats.clear();
+      instrumentation::PhaseTimer phase(stats, instrumentation::QRReflectors);
+      const double storage = instrumentation::storageBytes(QR) + instrumentation::storageBytes(Rdiag)
+                           + instrumentation::storageBytes(QRwork);
+
+      // Initialize.
+      // The assignments below only reallocate if the dimensions change.
+      QR = A;
+      m = A.size1();
+      n = A.size2();
+      Rdiag.resize(n,false);
+      QRwork.resize(n,false);
+      phase.allocated(storage, instrumentation::storageBytes(QR) + instrumentation::storageBytes(Rdiag)
+                               + instrumentation::storageBytes(QRwork));
+
+      // Main loop.
+      for (int k = 0; k < n; k++) {
+         // Compute 2-norm of k-th column without under/overflow.
+         T nrm = 0;
+         for (int i = k; i < m; i++) {
+             nrm = boost::math::hypot(nrm,QR(i,k));
+         }
+
+         if (nrm != 0.0) {
+            // Form k-th Householder vector.
+            if (QR(k,k) < 0) {
+               nrm = -nrm;
+            }
+            for (int i = k; i < m; i++) {
+               QR(i,k) /= nrm;
+            }
+            QR(k,k) += 1.0;
+
+            // Apply transformation to remaining columns.
+            kernels::householderUpdate(QR, k, k, m, k+1, n, QRwork.data().begin());
+
+            // Norm, scaling, and a dot product and an axpy per remaining column.
+            phase.flops(3.0*(m-k) + 4.0*(m-k)*(n-k-1));
+         }
+         phase.iterations();
+         Rdiag[k] = -nrm;
+      }
+   }
+
+/* ------------------------
+   Public Methods
+ * ------------------------ */
+
+   /** Is the matrix full rank?
+   @return     true if R, and hence A, has full rank.
+   */
+
+template<class T, class F, class ST>
+bool QRDecomposition<T,F,ST>::isFullRank () const {
+      for (int j = 0; j < n; j++) {
+         if (Rdiag(j) == 0.)
+            return false;
+      }
+      return true;
+   }
+
+   /** Reciprocal condition number of R in the 1-norm, as LAPACK's dtrcon.
+   @return     1/(norm1(R)*estimate of norm1(inverse(R))).
+   */
+
+template<class T, class F, class ST>
+T QRDecomposition<T,F,ST>::rcond () const {
+      if (n == 0) {
+         return 1.0;
+      }
+      if (!isFullRank()) {
+         return 0.0;
+      }
+      T rnorm = 0.0;
+      for (int j = 0; j < n; j++) {
+         T s = std::abs(Rdiag(j));
+         for (int i = 0; i < j; i++) {
+            s += std::abs(QR(i,j));
+         }
+         rnorm = std::max(rnorm, s);
+      }
+      T rinvnorm = condition::normEstimate<T>(n,
+         [this] (T* x) { upperSolve(x); },
+         [this] (T* x) { transposeUpperSolve(x); });
+      return rinvnorm == 0.0 ? T(0) : (1/rinvnorm)/rnorm;
+   }
+
+   /** Return the Householder vectors
+   @return     Lower trapezoidal matrix whose columns define the reflections
+   */
+
+template<class T, class F, class ST>
+typename QRDecomposition<T,F,ST>::Matrix QRDecomposition<T,F,ST>::getH () const {
+      Matrix H(m,n);
+      for (int i = 0; i < m; i++) {
+         for (int j = 0; j < n; j++) {
+            if (i >= j) {
+               H(i,j) = QR(i,j);
+            } else {
+               H(i,j) = 0.0;
+            }
+         }
+      }
+      return H;
+   }
+
+   /** Return the upper triangular factor
+   @return     R
+   */
+
+template<class T, class F, class ST>
+typename QRDecomposition<T,F,ST>::Matrix QRDecomposition<T,F,ST>::getR () const {
+      Matrix R(n,n);
+      for (int i = 0; i < n; i++) {
+         for (int j = 0; j < n; j++) {
+            if (i < j) {
+               R(i,j) = QR(i,j);
+            } else if (i == j) {
+               R(i,j) = Rdiag(i);
+            } else {
+               R(i,j) = 0.0;
+            }
+         }
+      }
+      return R;
+   }
+
+   /** Generate and return the (economy-sized) orthogonal factor
+   @return     Q
+   */
+
+template<class T, class F, class ST>
+typename QRDecomposition<T,F,ST>::Matrix QRDecomposition<T,F,ST>::getQ () const {
+      Matrix Q(m,n);
+      for (int k = n-1; k >= 0; k--) {
+         for (int i = 0; i < m; i++) {
+            Q(i,k) = 0.0;
+         }
+         Q(k,k) = 1.0;
+         for (int j = k; j < n; j++) {
+            if (QR(k,k) != 0) {
+               T s = 0.0;
+               for (int i = k; i < m; i++) {
+                  s += QR(i,k)*Q(i,j);
+               }
+               s = -s/QR(k,k);
+               for (int i = k; i < m; i++) {
+                  Q(i,j) += s*QR(i,k);
+               }
+            }
+         }
+      }
+      return Q;
+   }
+            
+   /** Least squares solution of A*X = B
+   @param B    A Matrix with as many rows as A and any number of columns.
+   @return     X that minimizes the two norm of Q*R*X-B.
+   @exception  IllegalArgumentException  Matrix row dimensions must agree.
+   @exception  RuntimeException  Matrix is rank deficient.
+   */
+
+template<class T, class F, class ST>
+typename QRDecomposition<T,F,ST>::Matrix QRDecomposition<T,F,ST>::solve (const Matrix &B) const {
+      BOOST_UBLAS_CHECK ((int)B.size1() == m, bad_size ());
+      BOOST_UBLAS_CHECK (isFullRank(), singular ());
+      
+      // Copy right hand side
+      int nx = B.size2();
+      Matrix X(B);
+
+      // Compute Y = transpose(Q)*B
+      for (int k = 0; k < n; k++) {
+         for (int j = 0; j < nx; j++) {
+            T s = 0.0; 
+            for (int i = k; i < m; i++) {
+               s += QR(i,k)*X(i,j);
+            }
+            s = -s/QR(k,k);
+            for (int i = k; i < m; i++) {
+               X(i,j) += s*QR(i,k);
+            }
+         }
+      }
+      // Solve R*X = Y;
+      for (int k = n-1; k >= 0; k--) {
+         for (int j = 0; j < nx; j++) {
+            X(k,j) /= Rdiag(k);
+         }
+         for (int i = 0; i < k; i++) {
+            for (int j = 0; j < nx; j++) {
+               X(i,j) -= X(k,j)*QR(i,k);
+            }
+         }
+      }
+      Matrix subX = subrange(X,0,n,0,nx);
+      return subX;
+   }
+
+   /** Least squares solution of A*x = b
+   @param b    A vector with as many elements as A has rows.
+   @return     x that minimizes the two norm of Q*R*x-b.
+   */
+
+template<class T, class F, class ST>
+typename QRDecomposition<T,F,ST>::Vector QRDecomposition<T,F,ST>::solve (const Vector &b) const {
+      Vector x(b);
+      solveInPlace(x);
+      x.resize(n, true);
+      return x;
+   }
+
+   /** Least squares solution of A*x = b in place.
+   @param b    Right hand side, replaced by x.
+   */
+
+template<class T, class F, class ST>
+void QRDecomposition<T,F,ST>::solveInPlace (Vector &b) const {
+      BOOST_UBLAS_CHECK ((int)b.size() == m, bad_size ());
+      BOOST_UBLAS_CHECK (isFullRank(), singular ());
+      if (n == 0) {
+         return;
+      }
+      transposeQ(&b(0));
+      upperSolve(&b(0));
+   }
+
+   /** Least squares solution of A*X = B in place.
+   @param B    Right hand sides, replaced by X.
+   */
+
+template<class T, class F, class ST>
+void QRDecomposition<T,F,ST>::solveInPlace (Matrix &B) const {
+      BOOST_UBLAS_CHECK ((int)B.size1() == m, bad_size ());
+      BOOST_UBLAS_CHECK (isFullRank(), singular ());
+      const int nx = B.size2();
+      if (n == 0 || nx == 0) {
+         return;
+      }
+      if (kernels::rowStride(B) == 1) {
+         // Compute Y = transpose(Q)*B, w = v'*B(k:m-1,:) accumulated by rows.
+         Vector w(nx);
+         for (int k = 0; k < n; k++) {
+            std::fill(w.begin(), w.end(), T(0));
+            for (int i = k; i < m; i++) {
+               kernels::axpy(nx, QR(i,k), kernels::address(B,i,0), 1, &w(0), 1);
+            }
+            for (int j = 0; j < nx; j++) {
+               w(j) = -w(j)/QR(k,k);
+            }
+            for (int i = k; i < m; i++) {
+               kernels::axpy(nx, QR(i,k), &w(0), 1, kernels::address(B,i,0), 1);
+            }
+         }
+         // Solve R*X = Y, each row of X from the rows below it (gemv).
+         for (int k = n-1; k >= 0; k--) {
+            T* x = kernels::address(B,k,0);
+            kernels::subtractProduct(nx, n-k-1, kernels::address(B,k+1,0), nx, kernels::address(QR,k,k+1), x);
+            for (int j = 0; j < nx; j++) {
+               x[j] /= Rdiag(k);
+            }
+         }
+      } else {
+         for (int j = 0; j < nx; j++) {
+            transposeQ(kernels::address(B,0,j));
+            upperSolve(kernels::address(B,0,j));
+         }
+      }
+   }
+
+   // x = Q'*x, one Householder reflection at a time.
+
+template<class T, class F, class ST>
+void QRDecomposition<T,F,ST>::transposeQ (T* x) const {
+      const int cs = kernels::columnStride(QR);
+      for (int k = 0; k < n; k++) {
+         const T* v = kernels::address(QR,k,k);
+         T s = kernels::dot(m-k, v, cs, x+k, 1);
+         s = -s/QR(k,k);
+         kernels::axpy(m-k, s, v, cs, x+k, 1);
+      }
+   }
+
+   // x(0:n-1) = inv(R)*x(0:n-1), by rows or by columns of QR.
+
+template<class T, class F, class ST>
+void QRDecomposition<T,F,ST>::upperSolve (T* x) const {
+      if (kernels::rowStride(QR) == 1) {
+         for (int k = n-1; k >= 0; k--) {
+            x[k] = (x[k] - kernels::dot(n-k-1, kernels::address(QR,k,k+1), 1, x+k+1, 1))/Rdiag(k);
+         }
+      } else {
+         for (int k = n-1; k >= 0; k--) {
+            x[k] /= Rdiag(k);
+            kernels::axpy(k, -x[k], kernels::address(QR,0,k), 1, x, 1);
+         }
+      }
+   }
+
+   /** Minimum norm solution of A'*X = B
+   @param B    A Matrix with as many rows as A has columns.
+   @return     X = Q*inv(R')*B.
+   */
+
+template<class T, class F, class ST>
+typename QRDecomposition<T,F,ST>::Matrix QRDecomposition<T,F,ST>::solveTranspose (const Matrix &B) const {
+      BOOST_UBLAS_CHECK ((int)B.size1() == n, bad_size ());
+      BOOST_UBLAS_CHECK (isFullRank(), singular ());
+      const int nx = B.size2();
+      Matrix X(m,nx);
+      subrange(X,0,n,0,nx) = B;
+      subrange(X,n,m,0,nx) = zero_matrix<T>(m-n,nx);
+      if (n == 0 || nx == 0) {
+         return X;
+      }
+      if (kernels::rowStride(X) == 1) {
+         // Solve R'*Y = B, subtracting each solved row from the rows below.
+         for (int k = 0; k < n; k++) {
+            T* x = kernels::address(X,k,0);
+            for (int j = 0; j < nx; j++) {
+               x[j] /= Rdiag(k);
+            }
+            for (int i = k+1; i < n; i++) {
+               kernels::axpy(nx, -QR(k,i), x, 1, kernels::address(X,i,0), 1);
+            }
+         }
+         // Compute X = Q*Y, the reflections in reverse order.
+         Vector w(nx);
+         for (int k = n-1; k >= 0; k--) {
+            std::fill(w.begin(), w.end(), T(0));
+            for (int i = k; i < m; i++) {
+               kernels::axpy(nx, QR(i,k), kernels::address(X,i,0), 1, &w(0), 1);
+            }
+            for (int j = 0; j < nx; j++) {
+               w(j) = -w(j)/QR(k,k);
+            }
+            for (int i = k; i < m; i++) {
+               kernels::axpy(nx, QR(i,k), &w(0), 1, kernels::address(X,i,0), 1);
+            }
+         }
+      } else {
+         for (int j = 0; j < nx; j++) {
+            transposeUpperSolve(kernels::address(X,0,j));
+            applyQ(kernels::address(X,0,j));
+         }
+      }
+      return X;
+   }
+
+   /** Minimum norm solution of A'*x = b
+   @param b    A vector with as many elements as A has columns.
+   @return     x = Q*inv(R')*b.
+   */
+
+template<class T, class F, class ST>
+typename QRDecomposition<T,F,ST>::Vector QRDecomposition<T,F,ST>::solveTranspose (const Vector &b) const {
+      BOOST_UBLAS_CHECK ((int)b.size() == n, bad_size ());
+      BOOST_UBLAS_CHECK (isFullRank(), singular ());
+      Vector x(m);
+      std::copy(b.begin(), b.end(), x.begin());
+      std::fill(x.begin() + n, x.end(), T(0));
+      if (n > 0) {
+         transposeUpperSolve(&x(0));
+         applyQ(&x(0));
+      }
+      return x;
+   }
+
+   // x(0:n-1) = inv(R')*x(0:n-1), by columns (column major) or rows of R.
+
+template<class T, class F, class ST>
+void QRDecomposition<T,F,ST>::transposeUpperSolve (T* x) const {
+      if (kernels::rowStride(QR) == 1) {
+         for (int k = 0; k < n; k++) {
+            x[k] /= Rdiag(k);
+            kernels::axpy(n-k-1, -x[k], kernels::address(QR,k,k+1), 1, x+k+1, 1);
+         }
+      } else {
+         for (int k = 0; k < n; k++) {
+            x[k] = (x[k] - kernels::dot(k, kernels::address(QR,0,k), 1, x, 1))/Rdiag(k);
+         }
+      }
+   }
+
+   // x = Q*x, the reflections in reverse order.
+
+template<class T, class F, class ST>
+void QRDecomposition<T,F,ST>::applyQ (T* x) const {
+      const int cs = kernels::columnStride(QR);
+      for (int k = n-1; k >= 0; k--) {
+         const T* v = kernels::address(QR,k,k);
+         T s = kernels::dot(m-k, v, cs, x+k, 1);
+         s = -s/QR(k,k);
+         kernels::axpy(m-k, s, v, cs, x+k, 1);
+      }
+   }
+
+   /** Write the decomposition to a binary stream.
+   @param os   Output stream, opened in binary mode.
+   */
+
+template<class T, class F, class ST>
+void QRDecomposition<T,F,ST>::save (std::ostream& os, std::size_t alignment) const {
+      serialization::Writer<T,F> out(os, serialization::QR, alignment);
+      out.integer(m);
+      out.integer(n);
+      out.write(Rdiag);
+      out.write(QR);
+   }
+
+   /** Replace the decomposition by one written by save().
+   @param is   Input stream, opened in binary mode.
+   */
+
+template<class T, class F, class ST>
+void QRDecomposition<T,F,ST>::load (std::istream& is) {
+      serialization::Reader<T,F> in(is, serialization::QR);
+      restore(in);
+   }
+
+   /** Replace the decomposition by one saved at the start of a mapped file.
+   @param file  Mapped file.
+   */
+
+template<class T, class F, class ST>
+void QRDecomposition<T,F,ST>::load (const MappedFile& file) {
+      serialization::Reader<T,F> in(file, serialization::QR);
+      restore(in);
+   }
+
+   // Read the members of the decomposition.
+
+template<class T, class F, class ST>
+void QRDecomposition<T,F,ST>::restore (serialization::Reader<T,F>& in) {
+      stats.clear();
+      m = in.size();
+      n = in.size();
+      in.read(Rdiag);
+      in.read(QR);
+      if ((int) Rdiag.size() != n || (int) QR.size1() != m || (int) QR.size2() != n) {
+         external_logic("serialization: inconsistent QR decomposition").raise();
+      }
+   }
+
+// The common instantiations are prebuilt in libublasJama.a; define
+// UBLASJAMA_NO_EXTERN_TEMPLATES to use this header without the library.
+#ifndef UBLASJAMA_NO_EXTERN_TEMPLATES
+extern template class QRDecomposition<float>;
+extern template class QRDecomposition<double>;
+extern template class QRDecomposition<float,column_major>;
+extern template class QRDecomposition<double,column_major>;
+#endif
+
 }}}
 #endif
@@ -0,0 +1,420 @@
+   /** Binary serialization of the decompositions.
+   <P>
+   Each decomposition has save(os) and load(is), which write and read
+   its factors in a compact binary format, so that a program can cache a
+   factorization and skip it on restart:
+<pre>
+   std::ofstream out("A.lu", std::ios::binary);
+   LUDecomposition<double>(A).save(out);
+   ...
+   std::ifstream in("A.lu", std::ios::binary);
+   LUDecomposition<double> LU;
+   LU.load(in);                 // then LU.solve(B) as before
+</pre>
+   saveMatrix() and loadMatrix() do the same for a single matrix.  The
+   decompositions and matrices can also be loaded from a MappedFile,
+   which binds the matrices stored in a mapped_array directly to the
+   file (see MappedStorage.hpp); the elements of the other matrices and
+   of the vectors are copied.
+   <P>
+   The format (version 2) is a header of eight 32-bit words
+<pre>
+   magic "UBJM", format version, kind (decomposition or matrix),
+   sizeof(T), std::numeric_limits<T>::digits, layout (0: row major, 1: column major),
+   byte order mark 0x01020304, alignment
+</pre>
+   followed by the members of the decomposition: 64-bit integers, and
+   matrices and vectors given by their dimensions (64-bit) and their
+   elements in the order of the storage.  The elements of each matrix
+   start at a multiple of the alignment (0: none) from the start of the
+   header, padded with zeros: save with the page size (pageAlignment) for
+   matrices starting on pages of a file mapped from its first byte.
+   Version 1 is version 2 without alignment.  Files are read with the
+   byte order and scalar type that wrote them; a matrix written in the
+   other layout is transposed while it is read.  load() throws
+   external_logic for a file of another kind, version, scalar type or
+   byte order, and for a truncated or inconsistent file (the sizes are
+   checked against the remaining length of the file, or of the stream if
+   it can seek, before anything is allocated), and then leaves the
+   decomposition unspecified.
+   */
+
+#ifndef _BOOST_UBLAS_SERIALIZATION_
+#define _BOOST_UBLAS_SERIALIZATION_
+
+#include <cstring>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <boost/cstdint.hpp>
+#include <boost/type_traits/is_same.hpp>
+#include <boost/type_traits/alignment_of.hpp>
+#include <boost/numeric/ublas/vector.hpp>
+#include <boost/numeric/ublas/matrix.hpp>
+// The sparse containers name boost::serialization as serialization:: from
+// within ublas, which ublas::serialization below would hide if they were
+// included after this header.
+#include <boost/numeric/ublas/vector_sparse.hpp>
+#include <boost/numeric/ublas/matrix_sparse.hpp>
+#include <boost/numeric/ublas/exception.hpp>
+#include "Convergence.hpp"
+#include "MappedStorage.hpp"
+
+namespace boost { namespace numeric { namespace ublas { namespace serialization {
+
+enum Kind {
+   LU = 1, QR, Cholesky, Eigenvalue, SingularValue, Matrix
+};
+
+const boost::uint32_t version = 2;
+const boost::uint32_t byteOrderMark = 0x01020304;
+
+/** Alignment of the matrices of a file to be mapped (a multiple of the
+    page size of the usual systems).
+*/
+
+const std::size_t pageAlignment = 4096;
+
+/** Header of a file.
+*/
+
+struct Header {
+   char magic[4];
+   boost::uint32_t version, kind, scalarBytes, scalarDigits, columnMajor, byteOrder, alignment;
+
+   template<class T, class L>
+   static Header make (Kind k, std::size_t alignment = 0) {
+      Header h;
+      std::memcpy(h.magic, "UBJM", 4);
+      h.version = serialization::version;
+      h.kind = k;
+      h.scalarBytes = sizeof(T);
+      h.scalarDigits = std::numeric_limits<T>::digits;
+      h.columnMajor = boost::is_same<typename L::orientation_category, column_major_tag>::value;
+      h.byteOrder = byteOrderMark;
+      h.alignment = alignment;
+      return h;
+   }
+};
+
+/** Writes the members of a decomposition of scalar type T and layout L.
+*/
+
+template<class T, class L>
+class Writer {
+   std::ostream& os;
+   std::size_t alignment;
+   std::size_t offset;
+
+   void bytes (const void* p, std::size_t count) {
+      os.write(static_cast<const char*>(p), count);
+      if (!os) {
+         external_logic("serialization: write failed").raise();
+      }
+      offset += count;
+   }
+
+   void pad () {
+      if (alignment > 1) {
+         static const char zeros[64] = { 0 };
+         for (std::size_t count = (alignment - offset%alignment) % alignment; count > 0; ) {
+            std::size_t c = std::min(count, sizeof(zeros));
+            bytes(zeros, c);
+            count -= c;
+         }
+      }
+   }
+
+public:
+   /** Write the header.
+   @param alignment  Alignment of the elements of the matrices (0: none).
+   */
+
+   Writer (std::ostream& os, Kind k, std::size_t alignment = 0) : os(os), alignment(alignment), offset(0) {
+      Header h = Header::make<T,L>(k, alignment);
+      bytes(&h, sizeof(h));
+   }
+
+   void integer (boost::int64_t i) {
+      bytes(&i, sizeof(i));
+   }
+
+   template<class ML, class A>
+   void write (const matrix<T,ML,A>& M) {
+      integer(M.size1());
+      integer(M.size2());
+      pad();
+      bytes(M.data().begin(), M.data().size()*sizeof(T));
+   }
+
+   template<class A>
+   void write (const vector<T,A>& v) {
+      integer(v.size());
+      bytes(v.data().begin(), v.size()*sizeof(T));
+   }
+
+   void write (const ConvergenceInfo& c) {
+      integer(c.status);
+      integer(c.iterations);
+      integer(c.maxPerValue);
+      integer(c.exceptionalShifts);
+      integer(c.unconverged);
+   }
+
+   /** Indices (pivots) are written as 64-bit integers.
+   */
+
+   template<class A>
+   void write (const vector<std::size_t,A>& v) {
+      integer(v.size());
+      for (std::size_t i = 0; i < v.size(); ++i) {
+         integer(v(i));
+      }
+   }
+};
+
+/** Reads the members of a decomposition of scalar type T and layout L,
+    checking the header first.
+*/
+
+template<class T, class L>
+class Reader {
+   // A stream, or a mapped file read from its start.
+   std::istream* is;
+   const MappedFile* file;
+   bool columnMajor;
+   std::size_t alignment;
+   std::size_t offset;
+
+   void bytes (void* p, std::size_t count) {
+      if (is) {
+         is->read(static_cast<char*>(p), count);
+         if (!*is) {
+            external_logic("serialization: truncated file").raise();
+         }
+      } else {
+         std::memcpy(p, skip(count), count);
+      }
+      offset += count;
+   }
+
+   // Skip count bytes of a mapped file, returning their address.
+
+   const char* skip (std::size_t count) {
+      if (count > file->size() - offset) {
+         external_logic("serialization: truncated file").raise();
+      }
+      return file->data() + offset;
+   }
+
+   // Check that count elements of elementBytes bytes are left in the file
+   // before allocating them, so that a corrupt size is reported as such.
+   // The remaining length of a stream that cannot seek is unknown.
+
+   void available (std::size_t count, std::size_t elementBytes) {
+      if (count > 0 && elementBytes > std::numeric_limits<std::size_t>::max()/count) {
+         external_logic("serialization: invalid size").raise();
+      }
+      const std::size_t total = count*elementBytes;
+      if (!is) {
+         skip(total);
+         return;
+      }
+      const std::istream::pos_type here = is->tellg();
+      if (here == std::istream::pos_type(-1)) {
+         is->clear();
+         return;
+      }
+      is->seekg(0, std::ios::end);
+      const std::istream::pos_type end = is->tellg();
+      is->seekg(here);
+      if (!*is || end == std::istream::pos_type(-1)) {
+         external_logic("serialization: truncated file").raise();
+      }
+      if (total > std::size_t(end - here)) {
+         external_logic("serialization: truncated file").raise();
+      }
+   }
+
+   void unpad () {
+      if (alignment > 1) {
+         std::size_t count = (alignment - offset%alignment) % alignment;
+         if (is) {
+            is->ignore(count);
+            if (!*is) {
+               external_logic("serialization: truncated file").raise();
+            }
+         } else {
+            skip(count);
+         }
+         offset += count;
+      }
+   }
+
+   template<class ML, class A>
+   void elements (matrix<T,ML,A>& M, std::size_t rows, std::size_t cols) {
+      if (cols > 0 && rows > std::numeric_limits<std::size_t>::max()/cols) {
+         external_logic("serialization: invalid size").raise();
+      }
+      available(rows*cols, sizeof(T));
+      M.resize(rows, cols, false);
+      bytes(M.data().begin(), M.data().size()*sizeof(T));
+   }
+
+   void header (Kind k) {
+      Header expected = Header::make<T,L>(k);
+      Header h;
+      bytes(&h, sizeof(h));
+      if (std::memcmp(h.magic, expected.magic, 4) != 0 || h.byteOrder != byteOrderMark) {
+         external_logic("serialization: not a decomposition file, or another byte order").raise();
+      }
+      if (h.version < 1 || h.version > version || h.kind != expected.kind) {
+         external_logic("serialization: unsupported version or other decomposition").raise();
+      }
+      if (h.scalarBytes != expected.scalarBytes || h.scalarDigits != expected.scalarDigits) {
+         external_logic("serialization: other scalar type").raise();
+      }
+      columnMajor = h.columnMajor != 0;
+      alignment = h.version >= 2 ? h.alignment : 0;
+   }
+
+public:
+   Reader (std::istream& is, Kind k) : is(&is), file(0), offset(0) {
+      header(k);
+   }
+
+   Reader (const MappedFile& file, Kind k) : is(0), file(&file), offset(0) {
+      header(k);
+   }
+
+   boost::int64_t integer () {
+      boost::int64_t i;
+      bytes(&i, sizeof(i));
+      return i;
+   }
+
+   /** A dimension or an index, which must fit in an int.
+   */
+
+   std::size_t size () {
+      boost::int64_t i = integer();
+      if (i < 0 || i > std::numeric_limits<int>::max()) {
+         external_logic("serialization: invalid size").raise();
+      }
+      return i;
+   }
+
+   template<class ML, class A>
+   void read (matrix<T,ML,A>& M) {
+      std::size_t rows = size();
+      std::size_t cols = size();
+      unpad();
+      const bool same = columnMajor == boost::is_same<typename ML::orientation_category, column_major_tag>::value;
+      if (same) {
+         elements(M, rows, cols);
+      } else if (columnMajor) {
+         matrix<T,column_major> C;
+         elements(C, rows, cols);
+         M.resize(rows, cols, false);
+         noalias(M) = C;
+      } else {
+         matrix<T,row_major> R;
+         elements(R, rows, cols);
+         M.resize(rows, cols, false);
+         noalias(M) = R;
+      }
+   }
+
+   /** A matrix stored in a mapped_array, bound to the mapped file if
+       the layout and the alignment of its elements allow it.
+   */
+
+   template<class ML>
+   void read (matrix<T,ML,mapped_array<T> >& M) {
+      const bool same = columnMajor == boost::is_same<typename ML::orientation_category, column_major_tag>::value;
+      if (!file || !same) {
+         read<ML,mapped_array<T> >(M);
+         return;
+      }
+      std::size_t rows = size();
+      std::size_t cols = size();
+      unpad();
+      if (cols > 0 && rows > std::numeric_limits<std::size_t>::max()/sizeof(T)/cols) {
+         external_logic("serialization: invalid size").raise();
+      }
+      const std::size_t count = rows*cols;
+      const char* p = skip(count*sizeof(T));
+      if (count == 0 || reinterpret_cast<std::size_t>(p) % boost::alignment_of<T>::value != 0) {
+         elements(M, rows, cols);
+         return;
+      }
+      M.data().map(reinterpret_cast<T*>(const_cast<char*>(p)), count, file->owner());
+      M.resize(rows, cols, false);
+      offset += count*sizeof(T);
+   }
+
+   template<class A>
+   void read (vector<T,A>& v) {
+      const std::size_t count = size();
+      available(count, sizeof(T));
+      v.resize(count, false);
+      bytes(v.data().begin(), v.size()*sizeof(T));
+   }
+
+   void read (ConvergenceInfo& c) {
+      boost::int64_t status = integer();
+      if (status < Converged || status > TimeLimitReached) {
+         external_logic("serialization: invalid convergence status").raise();
+      }
+      c.status = ConvergenceStatus(status);
+      c.iterations = integer();
+      c.maxPerValue = integer();
+      c.exceptionalShifts = integer();
+      c.unconverged = integer();
+   }
+
+   template<class A>
+   void read (vector<std::size_t,A>& v) {
+      const std::size_t count = size();
+      available(count, sizeof(boost::int64_t));
+      v.resize(count, false);
+      for (std::size_t i = 0; i < v.size(); ++i) {
+         v(i) = size();
+      }
+   }
+};
+
+/** Write a matrix (see the format above).
+@param os         Output stream, opened in binary mode.
+@param alignment  Alignment of the elements, e.g. pageAlignment to map the file.
+*/
+
+template<class T, class L, class A>
+void saveMatrix (std::ostream& os, const matrix<T,L,A>& M, std::size_t alignment = 0) {
+   Writer<T,L> out(os, serialization::Matrix, alignment);
+   out.write(M);
+}
+
+/** Read a matrix written by saveMatrix.
+@exception  external_logic  Not a matrix of this scalar type, or truncated.
+*/
+
+template<class T, class L, class A>
+void loadMatrix (std::istream& is, matrix<T,L,A>& M) {
+   Reader<T,L> in(is, serialization::Matrix);
+   in.read(M);
+}
+
+/** Read a matrix written by saveMatrix from the start of a mapped file,
+    binding it to the file if stored in a mapped_array.
+@exception  external_logic  Not a matrix of this scalar type, or truncated.
+*/
+
+template<class T, class L, class A>
+void loadMatrix (const MappedFile& file, matrix<T,L,A>& M) {
+   Reader<T,L> in(file, serialization::Matrix);
+   in.read(M);
+}
+
+}}}}
+#endif
@@ -0,0 +1,208 @@
+/** SIMD kernels: scalar and SSE2 versions, and selection of the
+    instruction set when the library is loaded.
+*/
+
+#include <cstdlib>
+#include <cstring>
+#include "SimdKernelsImpl.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define UBLASJAMA_HAVE_SSE2
+#endif
+
+namespace boost { namespace numeric { namespace ublas { namespace kernels {
+
+namespace {
+
+template<class T> T scalarDot (int n, const T* x, const T* y) {
+   return dot<T>(n, x, 1, y, 1);
+}
+template<class T> void scalarAxpy (int n, T a, const T* x, T* y) {
+   axpy<T>(n, a, x, 1, y, 1);
+}
+template<class T> void scalarRot (int n, T* x, T* y, T c, T s) {
+   rot<T>(n, x, 1, y, 1, c, s);
+}
+template<class T> void scalarRefl2 (int n, T* u, T* v, T a, T b, T d, T e) {
+   refl2<T>(n, u, v, 1, a, b, d, e);
+}
+template<class T> void scalarRefl3 (int n, T* u, T* v, T* w, T a, T b, T c, T d, T e, T f) {
+   refl3<T>(n, u, v, w, 1, a, b, c, d, e, f);
+}
+template<class T> void scalarGemv (int n, int k, const T* x, int ldx, const T* a, T* y) {
+   gemv<T>(n, k, x, ldx, a, y);
+}
+
+template<class T> void scalarKernels (KernelTable<T>& k) {
+   k.dot = &scalarDot<T>;
+   k.axpy = &scalarAxpy<T>;
+   k.rot = &scalarRot<T>;
+   k.refl2 = &scalarRefl2<T>;
+   k.refl3 = &scalarRefl3<T>;
+   k.gemv = &scalarGemv<T>;
+}
+
+#ifdef UBLASJAMA_HAVE_SSE2
+
+// SSE2 has no fused multiply-add.
+
+struct SSE2Double {
+   typedef double T;
+   typedef __m128d R;
+   enum { width = 2 };
+   static R zero () { return _mm_setzero_pd(); }
+   static R set1 (T a) { return _mm_set1_pd(a); }
+   static R load (const T* p) { return _mm_loadu_pd(p); }
+   static void store (T* p, R x) { _mm_storeu_pd(p, x); }
+   static R add (R a, R b) { return _mm_add_pd(a, b); }
+   static R mul (R a, R b) { return _mm_mul_pd(a, b); }
+   static R fmadd (R a, R b, R c) { return _mm_add_pd(_mm_mul_pd(a, b), c); }
+   static R fnmadd (R a, R b, R c) { return _mm_sub_pd(c, _mm_mul_pd(a, b)); }
+   static T sum (R x) { return _mm_cvtsd_f64(_mm_add_sd(x, _mm_unpackhi_pd(x, x))); }
+};
+
+struct SSE2Float {
+   typedef float T;
+   typedef __m128 R;
+   enum { width = 4 };
+   static R zero () { return _mm_setzero_ps(); }
+   static R set1 (T a) { return _mm_set1_ps(a); }
+   static R load (const T* p) { return _mm_loadu_ps(p); }
+   static void store (T* p, R x) { _mm_storeu_ps(p, x); }
+   static R add (R a, R b) { return _mm_add_ps(a, b); }
+   static R mul (R a, R b) { return _mm_mul_ps(a, b); }
+   static R fmadd (R a, R b, R c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+   static R fnmadd (R a, R b, R c) { return _mm_sub_ps(c, _mm_mul_ps(a, b)); }
+   static T sum (R x) {
+      R s = _mm_add_ps(x, _mm_movehl_ps(x, x));
+      s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+      return _mm_cvtss_f32(s);
+   }
+};
+
+#endif
+
+bool sse2Kernels (KernelTable<float>& fk, KernelTable<double>& dk) {
+#ifdef UBLASJAMA_HAVE_SSE2
+   detail::fillTable<SSE2Float>(fk);
+   detail::fillTable<SSE2Double>(dk);
+   return true;
+#else
+   (void) fk; (void) dk;
+   return false;
+#endif
+}
+
+/** Does the CPU support the instruction set?
+*/
+
+bool cpuSupports (Isa i) {
+   switch (i) {
+   case Scalar:
+      return true;
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+   case SSE2:
+      return __builtin_cpu_supports("sse2");
+   case AVX2:
+      return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+   case AVX512:
+      return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("fma");
+#elif defined(_M_X64)
+   case SSE2:
+      return true;
+#endif
+   default:
+      return false;
+   }
+}
+
+/** Fill the tables for an instruction set, if both the CPU and the build support it.
+*/
+
+bool loadKernels (Isa i, KernelTable<float>& fk, KernelTable<double>& dk) {
+   if (!cpuSupports(i)) {
+      return false;
+   }
+   switch (i) {
+   case Scalar:
+      scalarKernels(fk);
+      scalarKernels(dk);
+      return true;
+   case SSE2:
+      return sse2Kernels(fk, dk);
+   case AVX2:
+      return avx2Kernels(fk, dk);
+   case AVX512:
+      return avx512Kernels(fk, dk);
+   }
+   return false;
+}
+
+Isa current = Scalar;
+
+/** Select the widest instruction set allowed by UBLASJAMA_SIMD at load time.
+*/
+
+struct Initializer {
+   Initializer () {
+      Isa limit = AVX512;
+      if (const char* env = std::getenv("UBLASJAMA_SIMD")) {
+         for (int i = Scalar; i <= AVX512; ++i) {
+            if (std::strcmp(env, isaName(Isa(i))) == 0) {
+               limit = Isa(i);
+            }
+         }
+      }
+      for (int i = limit; i > Scalar; --i) {
+         if (select(Isa(i))) {
+            break;
+         }
+      }
+   }
+} initializer;
+
+}
+
+// Constant-initialized, so that the scalar kernels are usable before the
+// dynamic initialization of the library has selected the best ones.
+KernelTable<float> floatKernels = {
+   &scalarDot<float>, &scalarAxpy<float>, &scalarRot<float>, &scalarRefl2<float>, &scalarRefl3<float>, &scalarGemv<float>
+};
+KernelTable<double> doubleKernels = {
+   &scalarDot<double>, &scalarAxpy<double>, &scalarRot<double>, &scalarRefl2<double>, &scalarRefl3<double>, &scalarGemv<double>
+};
+
+Isa isa () {
+   return current;
+}
+
+Isa supportedIsa () {
+   KernelTable<float> fk;
+   KernelTable<double> dk;
+   for (int i = AVX512; i > Scalar; --i) {
+      if (loadKernels(Isa(i), fk, dk)) {
+         return Isa(i);
+      }
+   }
+   return Scalar;
+}
+
+const char* isaName (Isa i) {
+   static const char* names[] = { "scalar", "sse2", "avx2", "avx512" };
+   return names[i];
+}
+
+bool select (Isa i) {
+   KernelTable<float> fk;
+   KernelTable<double> dk;
+   if (!loadKernels(i, fk, dk)) {
+      return false;
+   }
+   floatKernels = fk;
+   doubleKernels = dk;
+   current = i;
+   return true;
+}
+
+}}}}
@@ -0,0 +1,445 @@
+   /** SIMD kernels.
+   <P>
+   The inner loops of the decompositions (dot products, axpys, plane
+   rotations, the reflections of the double QR step of hqr2 and the
+   matrix-vector products of the blocked updates) are
+   written once with explicit SSE2, AVX2 and AVX-512 instructions.  The
+   instruction set is chosen when the library is loaded, from the
+   features of the CPU, so that the library itself can be built for the
+   baseline architecture and without -ffast-math.  The environment
+   variable UBLASJAMA_SIMD (scalar, sse2, avx2 or avx512) restricts the
+   choice, and select() changes it at run time, while no other thread
+   uses the kernels.
+   <P>
+   Vectors are given by a pointer and a stride.  Only contiguous float and
+   double vectors use the SIMD code; other strides and scalar types use the
+   generic loops below, which are also the reference implementation.
+   */
+
+#ifndef _BOOST_UBLAS_SIMDKERNELS_
+#define _BOOST_UBLAS_SIMDKERNELS_
+
+#include <algorithm>
+#include <boost/type_traits/is_same.hpp>
+#include <boost/numeric/ublas/fwd.hpp>
+#include <boost/numeric/ublas/functional.hpp>
+
+namespace boost { namespace numeric { namespace ublas { namespace kernels {
+
+/** Instruction sets, in increasing order of width.
+*/
+
+enum Isa { Scalar, SSE2, AVX2, AVX512 };
+
+/** Contiguous kernels of one instruction set, for one scalar type.
+    rot:   x = c*x + s*y, y = c*y - s*x
+    refl2: p = a*u + b*v, u -= p*d, v -= p*e
+    refl3: p = a*u + b*v + c*w, u -= p*d, v -= p*e, w -= p*f
+   gemv:  y += X*a, with the k columns of X at x, x+ldx, ..., x+(k-1)*ldx
+*/
+
+template<class T>
+struct KernelTable {
+   T (*dot) (int n, const T* x, const T* y);
+   void (*axpy) (int n, T a, const T* x, T* y);
+   void (*rot) (int n, T* x, T* y, T c, T s);
+   void (*refl2) (int n, T* u, T* v, T a, T b, T d, T e);
+   void (*refl3) (int n, T* u, T* v, T* w, T a, T b, T c, T d, T e, T f);
+   void (*gemv) (int n, int k, const T* x, int ldx, const T* a, T* y);
+};
+
+/** Kernels of the selected instruction set (defined in SimdKernels.cpp).
+*/
+
+extern KernelTable<float> floatKernels;
+extern KernelTable<double> doubleKernels;
+
+/** Selected instruction set.
+*/
+
+Isa isa ();
+
+/** Widest instruction set supported by the CPU (and by the build).
+*/
+
+Isa supportedIsa ();
+
+/** Name of an instruction set, as accepted by UBLASJAMA_SIMD.
+*/
+
+const char* isaName (Isa i);
+
+/** Select the kernels of an instruction set.  The kernel tables are
+    copied without synchronization: select() must not run concurrently
+    with any decomposition or kernel call, in any thread.
+@param i    Instruction set.
+@return     false, and no change, if the CPU does not support it.
+*/
+
+bool select (Isa i);
+
+/* ------------------------
+   Generic kernels
+ * ------------------------ */
+
+template<class T>
+inline T dot (int n, const T* x, int incx, const T* y, int incy) {
+   T s = 0.0;
+   for (int i = 0; i < n; ++i) {
+      s += x[i*incx]*y[i*incy];
+   }
+   return s;
+}
+
+template<class T>
+inline void axpy (int n, T a, const T* x, int incx, T* y, int incy) {
+   for (int i = 0; i < n; ++i) {
+      y[i*incy] += a*x[i*incx];
+   }
+}
+
+template<class T>
+inline void rot (int n, T* x, int incx, T* y, int incy, T c, T s) {
+   for (int i = 0; i < n; ++i) {
+      T h = x[i*incx];
+      x[i*incx] = c*h + s*y[i*incy];
+      y[i*incy] = c*y[i*incy] - s*h;
+   }
+}
+
+template<class T>
+inline void refl2 (int n, T* u, T* v, int inc, T a, T b, T d, T e) {
+   for (int i = 0; i < n; ++i) {
+      T p = a*u[i*inc] + b*v[i*inc];
+      u[i*inc] -= p*d;
+      v[i*inc] -= p*e;
+   }
+}
+
+template<class T>
+inline void refl3 (int n, T* u, T* v, T* w, int inc, T a, T b, T c, T d, T e, T f) {
+   for (int i = 0; i < n; ++i) {
+      T p = a*u[i*inc] + b*v[i*inc] + c*w[i*inc];
+      w[i*inc] -= p*f;
+      u[i*inc] -= p*d;
+      v[i*inc] -= p*e;
+   }
+}
+
+/** y(0:n-1) += X*a, with X(i,l) = x[l*ldx+i] (k contiguous columns).
+    Each element of y accumulates the k products in the order of the k
+    axpys, but is loaded and stored only once.
+*/
+
+template<class T>
+inline void gemv (int n, int k, const T* x, int ldx, const T* a, T* y) {
+   for (int l = 0; l < k; ++l) {
+      axpy<T>(n, a[l], x+l*ldx, 1, y, 1);
+   }
+}
+
+/* ------------------------
+   Dispatch for float and double
+ * ------------------------ */
+
+template<class T> struct Dispatch {
+   static const KernelTable<T>* table () { return 0; }
+};
+template<> struct Dispatch<float> {
+   static const KernelTable<float>* table () { return &floatKernels; }
+};
+template<> struct Dispatch<double> {
+   static const KernelTable<double>* table () { return &doubleKernels; }
+};
+
+#define UBLASJAMA_SIMD_DISPATCH(T) \
+inline T dot (int n, const T* x, int incx, const T* y, int incy) { \
+   if (incx == 1 && incy == 1) return Dispatch<T>::table()->dot(n,x,y); \
+   return dot<T>(n,x,incx,y,incy); \
+} \
+inline void axpy (int n, T a, const T* x, int incx, T* y, int incy) { \
+   if (incx == 1 && incy == 1) Dispatch<T>::table()->axpy(n,a,x,y); \
+   else axpy<T>(n,a,x,incx,y,incy); \
+} \
+inline void rot (int n, T* x, int incx, T* y, int incy, T c, T s) { \
+   if (incx == 1 && incy == 1) Dispatch<T>::table()->rot(n,x,y,c,s); \
+   else rot<T>(n,x,incx,y,incy,c,s); \
+} \
+inline void refl2 (int n, T* u, T* v, int inc, T a, T b, T d, T e) { \
+   if (inc == 1) Dispatch<T>::table()->refl2(n,u,v,a,b,d,e); \
+   else refl2<T>(n,u,v,inc,a,b,d,e); \
+} \
+inline void refl3 (int n, T* u, T* v, T* w, int inc, T a, T b, T c, T d, T e, T f) { \
+   if (inc == 1) Dispatch<T>::table()->refl3(n,u,v,w,a,b,c,d,e,f); \
+   else refl3<T>(n,u,v,w,inc,a,b,c,d,e,f); \
+} \
+inline void gemv (int n, int k, const T* x, int ldx, const T* a, T* y) { \
+   Dispatch<T>::table()->gemv(n,k,x,ldx,a,y); \
+}
+
+UBLASJAMA_SIMD_DISPATCH(float)
+UBLASJAMA_SIMD_DISPATCH(double)
+
+#undef UBLASJAMA_SIMD_DISPATCH
+
+/* ------------------------
+   Dense matrix helpers
+ * ------------------------ */
+
+/** Distance between A(i,j) and A(i,j+1) in the storage of a dense matrix.
+*/
+
+template<class M>
+inline int rowStride (const M& A) {
+   return boost::is_same<typename M::orientation_category, row_major_tag>::value ? 1 : A.size1();
+}
+
+/** Distance between A(i,j) and A(i+1,j) in the storage of a dense matrix.
+*/
+
+template<class M>
+inline int columnStride (const M& A) {
+   return boost::is_same<typename M::orientation_category, row_major_tag>::value ? A.size2() : 1;
+}
+
+/** Address of A(i,j); unlike &A(i,j), it may point one past the last row or column.
+*/
+
+template<class M>
+inline typename M::value_type* address (M& A, int i, int j) {
+   return A.data().begin() + i*columnStride(A) + j*rowStride(A);
+}
+
+template<class M>
+inline const typename M::value_type* address (const M& A, int i, int j) {
+   return A.data().begin() + i*columnStride(A) + j*rowStride(A);
+}
+
+/** Transpose a square n-by-n array in place.
+*/
+
+template<class T>
+inline void transpose (int n, T* a) {
+   for (int i = 0; i < n; ++i) {
+      for (int j = i+1; j < n; ++j) {
+         std::swap(a[i*n+j], a[j*n+i]);
+      }
+   }
+}
+
+/** y(0:n-1) -= X*a, with X(i,l) = x[l*ldx+i], by gemv on -y (the
+    negations are exact).
+*/
+
+template<class T>
+inline void subtractProduct (int n, int k, const T* x, int ldx, const T* a, T* y) {
+   if (k <= 0) {
+      return;
+   }
+   for (int i = 0; i < n; ++i) {
+      y[i] = -y[i];
+   }
+   gemv(n, k, x, ldx, a, y);
+   for (int i = 0; i < n; ++i) {
+      y[i] = -y[i];
+   }
+}
+
+/** Rank one update A(r0:r1-1,c0:c1-1) += x*y'.
+    The loop runs over the contiguous dimension of A.
+*/
+
+template<class M>
+void rank1Update (M& A, int r0, int r1, int c0, int c1,
+                  const typename M::value_type* x, const typename M::value_type* y) {
+   int nr = r1 - r0;
+   int nc = c1 - c0;
+   if (columnStride(A) == 1) {
+      for (int j = 0; j < nc; ++j) {
+         axpy(nr, y[j], x, 1, address(A,r0,c0+j), 1);
+      }
+   } else {
+      for (int i = 0; i < nr; ++i) {
+         axpy(nc, x[i], y, 1, address(A,r0+i,c0), 1);
+      }
+   }
+}
+
+/** Rank k update A(r0:r1-1,c0:c1-1) += X*Y, with X(i,l) = x[l*ldx+i]
+    and Y(l,j) = y[l*ldy+j].
+    Each row or column of A, whichever is contiguous, is loaded once for
+    each chunk of up to 64 products (gemv), with the coefficients of the
+    chunk gathered from X or Y.
+*/
+
+template<class M>
+void rankKUpdate (M& A, int r0, int r1, int c0, int c1, int k,
+                  const typename M::value_type* x, int ldx,
+                  const typename M::value_type* y, int ldy) {
+   typedef typename M::value_type T;
+   const int chunk = 64;
+   T coef[chunk];
+   int nr = r1 - r0;
+   int nc = c1 - c0;
+   if (nr <= 0 || nc <= 0) {
+      return;
+   }
+   if (columnStride(A) == 1) {
+      for (int j = 0; j < nc; ++j) {
+         T* a = address(A,r0,c0+j);
+         for (int l0 = 0; l0 < k; l0 += chunk) {
+            int kc = std::min(chunk, k-l0);
+            for (int l = 0; l < kc; ++l) {
+               coef[l] = y[(l0+l)*ldy+j];
+            }
+            gemv(nr, kc, x+l0*ldx, ldx, coef, a);
+         }
+      }
+   } else {
+      for (int i = 0; i < nr; ++i) {
+         T* a = address(A,r0+i,c0);
+         for (int l0 = 0; l0 < k; l0 += chunk) {
+            int kc = std::min(chunk, k-l0);
+            for (int l = 0; l < kc; ++l) {
+               coef[l] = x[(l0+l)*ldx+i];
+            }
+            gemv(nc, kc, y+l0*ldy, ldy, coef, a);
+         }
+      }
+   }
+}
+
+/** Product W = X'*A(r0:r1-1,c0:c1-1), with X(i,l) = x[l*ldx+i] (k columns)
+    and W(l,j) = w[l*ldw+j].
+*/
+
+template<class M>
+void transposeProduct (const M& A, int r0, int r1, int c0, int c1, int k,
+                       const typename M::value_type* x, int ldx,
+                       typename M::value_type* w, int ldw) {
+   typedef typename M::value_type T;
+   int nr = r1 - r0;
+   int nc = c1 - c0;
+   for (int l = 0; l < k; ++l) {
+      std::fill(w+l*ldw, w+l*ldw+nc, T(0));
+   }
+   if (nr <= 0 || nc <= 0) {
+      return;
+   }
+   if (columnStride(A) == 1) {
+      for (int j = 0; j < nc; ++j) {
+         const T* col = address(A,r0,c0+j);
+         for (int l = 0; l < k; ++l) {
+            w[l*ldw+j] = dot(nr, x+l*ldx, 1, col, 1);
+         }
+      }
+   } else {
+      for (int i = 0; i < nr; ++i) {
+         const T* row = address(A,r0+i,c0);
+         for (int l = 0; l < k; ++l) {
+            axpy(nc, x[l*ldx+i], row, 1, w+l*ldw, 1);
+         }
+      }
+   }
+}
+
+/** Symmetric product y(lo:hi-1) += A(lo:hi-1,lo:hi-1)*x(lo:hi-1), with
+    the lower triangle of A; x and y are indexed as the rows of A.
+*/
+
+template<class M>
+void symmetricProduct (const M& A, int lo, int hi,
+                       const typename M::value_type* x, typename M::value_type* y) {
+   typedef typename M::value_type T;
+   if (columnStride(A) == 1) {
+      for (int c = lo; c < hi; ++c) {
+         const T* a = address(A,c,c);
+         int len = hi-c-1;
+         y[c] += a[0]*x[c] + dot(len, a+1, 1, x+c+1, 1);
+         axpy(len, x[c], a+1, 1, y+c+1, 1);
+      }
+   } else {
+      for (int r = lo; r < hi; ++r) {
+         const T* a = address(A,r,lo);
+         int len = r-lo;
+         y[r] += a[len]*x[r] + dot(len, a, 1, x+lo, 1);
+         axpy(len, x[r], a, 1, y+lo, 1);
+      }
+   }
+}
+
+/** Symmetric rank 2k update A -= V*W' + W*V' of the lower triangle of
+    A(lo:hi-1,lo:hi-1), restricted to its contiguous lines (rows of a
+    row-major A, columns of a column-major one) line0..line1-1, with
+    V(i,l) = v[l*ldv+i] and W(i,l) = w[l*ldw+i] indexed as the rows of A.
+*/
+
+template<class M>
+void symmetricRank2kUpdate (M& A, int lo, int hi, int line0, int line1, int k,
+                            const typename M::value_type* v, int ldv,
+                            const typename M::value_type* w, int ldw) {
+   typedef typename M::value_type T;
+   if (columnStride(A) == 1) {
+      for (int c = line0; c < line1; ++c) {
+         T* a = address(A,c,c);
+         int len = hi-c;
+         for (int l = 0; l < k; ++l) {
+            axpy(len, -w[l*ldw+c], v+l*ldv+c, 1, a, 1);
+            axpy(len, -v[l*ldv+c], w+l*ldw+c, 1, a, 1);
+         }
+      }
+   } else {
+      for (int r = line0; r < line1; ++r) {
+         T* a = address(A,r,lo);
+         int len = r-lo+1;
+         for (int l = 0; l < k; ++l) {
+            axpy(len, -v[l*ldv+r], w+l*ldw+lo, 1, a, 1);
+            axpy(len, -w[l*ldw+r], v+l*ldv+lo, 1, a, 1);
+         }
+      }
+   }
+}
+
+/** Apply to the columns c0..c1-1 of A the Householder reflection stored in
+    the elements r0..r1-1 of column k, as in Jama: each column x becomes
+    x - (v'*x/v(0))*v, with v = A(r0:r1-1,k).
+@param work  Working storage for c1-c0 elements, used with row-major layouts.
+*/
+
+template<class M>
+void householderUpdate (M& A, int k, int r0, int r1, int c0, int c1,
+                        typename M::value_type* work) {
+   typedef typename M::value_type T;
+   int nr = r1 - r0;
+   int nc = c1 - c0;
+   if (nr <= 0 || nc <= 0) {
+      return;
+   }
+   const int cs = columnStride(A);
+   const T* v = address(A,r0,k);
+   if (cs == 1) {
+      // One dot product and one axpy per (contiguous) column.
+      for (int j = c0; j < c1; ++j) {
+         T* x = address(A,r0,j);
+         T s = dot(nr, v, 1, x, 1);
+         s = -s/v[0];
+         axpy(nr, s, v, 1, x, 1);
+      }
+   } else {
+      // Rows are contiguous: form w = v'*A(r0:r1-1,c0:c1-1) row by row,
+      // then apply the rank one update.
+      std::fill(work, work+nc, T(0));
+      for (int i = 0; i < nr; ++i) {
+         axpy(nc, v[i*cs], address(A,r0+i,c0), 1, work, 1);
+      }
+      for (int j = 0; j < nc; ++j) {
+         work[j] = -work[j]/v[0];
+      }
+      for (int i = 0; i < nr; ++i) {
+         axpy(nc, v[i*cs], work, 1, address(A,r0+i,c0), 1);
+      }
+   }
+}
+
+}}}}
+#endif
@@ -0,0 +1,74 @@
+/** AVX2/FMA kernels.
+    Built with -mavx2 -mfma (see the Makefile) and only called when the
+    CPU supports these instructions.
+*/
+
+#include "SimdKernelsImpl.hpp"
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+
+namespace boost { namespace numeric { namespace ublas { namespace kernels {
+
+namespace {
+
+struct AVX2Double {
+   typedef double T;
+   typedef __m256d R;
+   enum { width = 4 };
+   static R zero () { return _mm256_setzero_pd(); }
+   static R set1 (T a) { return _mm256_set1_pd(a); }
+   static R load (const T* p) { return _mm256_loadu_pd(p); }
+   static void store (T* p, R x) { _mm256_storeu_pd(p, x); }
+   static R add (R a, R b) { return _mm256_add_pd(a, b); }
+   static R mul (R a, R b) { return _mm256_mul_pd(a, b); }
+   static R fmadd (R a, R b, R c) { return _mm256_fmadd_pd(a, b, c); }
+   static R fnmadd (R a, R b, R c) { return _mm256_fnmadd_pd(a, b, c); }
+   static T sum (R x) {
+      __m128d s = _mm_add_pd(_mm256_castpd256_pd128(x), _mm256_extractf128_pd(x, 1));
+      s = _mm_add_sd(s, _mm_unpackhi_pd(s, s));
+      return _mm_cvtsd_f64(s);
+   }
+};
+
+struct AVX2Float {
+   typedef float T;
+   typedef __m256 R;
+   enum { width = 8 };
+   static R zero () { return _mm256_setzero_ps(); }
+   static R set1 (T a) { return _mm256_set1_ps(a); }
+   static R load (const T* p) { return _mm256_loadu_ps(p); }
+   static void store (T* p, R x) { _mm256_storeu_ps(p, x); }
+   static R add (R a, R b) { return _mm256_add_ps(a, b); }
+   static R mul (R a, R b) { return _mm256_mul_ps(a, b); }
+   static R fmadd (R a, R b, R c) { return _mm256_fmadd_ps(a, b, c); }
+   static R fnmadd (R a, R b, R c) { return _mm256_fnmadd_ps(a, b, c); }
+   static T sum (R x) {
+      __m128 s = _mm_add_ps(_mm256_castps256_ps128(x), _mm256_extractf128_ps(x, 1));
+      s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+      s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+      return _mm_cvtss_f32(s);
+   }
+};
+
+}
+
+bool avx2Kernels (KernelTable<float>& fk, KernelTable<double>& dk) {
+   detail::fillTable<AVX2Float>(fk);
+   detail::fillTable<AVX2Double>(dk);
+   return true;
+}
+
+}}}}
+
+#else
+
+namespace boost { namespace numeric { namespace ublas { namespace kernels {
+
+bool avx2Kernels (KernelTable<float>&, KernelTable<double>&) {
+   return false;
+}
+
+}}}}
+
+#endif
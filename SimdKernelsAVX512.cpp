@@ -0,0 +1,79 @@
+/** AVX-512 kernels.
+    Built with -mavx512f -mfma (see the Makefile) and only called when the
+    CPU supports these instructions.
+*/
+
+#include "SimdKernelsImpl.hpp"
+
+#if defined(__AVX512F__)
+#include <immintrin.h>
+
+namespace boost { namespace numeric { namespace ublas { namespace kernels {
+
+namespace {
+
+struct AVX512Double {
+   typedef double T;
+   typedef __m512d R;
+   enum { width = 8 };
+   static R zero () { return _mm512_setzero_pd(); }
+   static R set1 (T a) { return _mm512_set1_pd(a); }
+   static R load (const T* p) { return _mm512_loadu_pd(p); }
+   static void store (T* p, R x) { _mm512_storeu_pd(p, x); }
+   static R add (R a, R b) { return _mm512_add_pd(a, b); }
+   static R mul (R a, R b) { return _mm512_mul_pd(a, b); }
+   static R fmadd (R a, R b, R c) { return _mm512_fmadd_pd(a, b, c); }
+   static R fnmadd (R a, R b, R c) { return _mm512_fnmadd_pd(a, b, c); }
+   static T sum (R x) {
+      // Through memory: the 512-bit extracts and _mm512_reduce_add_pd
+      // trip -Wuninitialized in the intrinsics headers of gcc 12.
+      T v[width];
+      _mm512_storeu_pd(v, x);
+      return ((v[0] + v[4]) + (v[2] + v[6])) + ((v[1] + v[5]) + (v[3] + v[7]));
+   }
+};
+
+struct AVX512Float {
+   typedef float T;
+   typedef __m512 R;
+   enum { width = 16 };
+   static R zero () { return _mm512_setzero_ps(); }
+   static R set1 (T a) { return _mm512_set1_ps(a); }
+   static R load (const T* p) { return _mm512_loadu_ps(p); }
+   static void store (T* p, R x) { _mm512_storeu_ps(p, x); }
+   static R add (R a, R b) { return _mm512_add_ps(a, b); }
+   static R mul (R a, R b) { return _mm512_mul_ps(a, b); }
+   static R fmadd (R a, R b, R c) { return _mm512_fmadd_ps(a, b, c); }
+   static R fnmadd (R a, R b, R c) { return _mm512_fnmadd_ps(a, b, c); }
+   static T sum (R x) {
+      T v[width];
+      _mm512_storeu_ps(v, x);
+      T s = 0;
+      for (int i = 0; i < 8; ++i) {
+         s += v[i] + v[i+8];
+      }
+      return s;
+   }
+};
+
+}
+
+bool avx512Kernels (KernelTable<float>& fk, KernelTable<double>& dk) {
+   detail::fillTable<AVX512Float>(fk);
+   detail::fillTable<AVX512Double>(dk);
+   return true;
+}
+
+}}}}
+
+#else
+
+namespace boost { namespace numeric { namespace ublas { namespace kernels {
+
+bool avx512Kernels (KernelTable<float>&, KernelTable<double>&) {
+   return false;
+}
+
+}}}}
+
+#endif
@@ -0,0 +1,194 @@
+   /** SIMD kernel templates.
+   <P>
+   Private header of SimdKernels.cpp, SimdKernelsAVX2.cpp and
+   SimdKernelsAVX512.cpp.  The kernels are written once in terms of a
+   register traits class V, defined by each of these files for its
+   instruction set:
+<pre>
+   V::T, V::R, V::width        scalar type, register type, lanes per register
+   zero(), set1(a)             register of zeros, of a's
+   load(p), store(p,x)         unaligned load and store
+   add, mul, fmadd(a,b,c)      a+b, a*b, a*b+c
+   fnmadd(a,b,c)               c-a*b
+   sum(x)                      horizontal sum
+</pre>
+   Each traits class must have internal linkage (anonymous namespace), so
+   that the instantiations compiled with different instruction sets never
+   get merged by the linker.
+   */
+
+#ifndef _BOOST_UBLAS_SIMDKERNELSIMPL_
+#define _BOOST_UBLAS_SIMDKERNELSIMPL_
+
+#include "SimdKernels.hpp"
+
+namespace boost { namespace numeric { namespace ublas { namespace kernels {
+
+/** Fill the tables with the AVX2/FMA and AVX-512 kernels.
+@return     false if the library was built without the instruction set.
+*/
+
+bool avx2Kernels (KernelTable<float>& fk, KernelTable<double>& dk);
+bool avx512Kernels (KernelTable<float>& fk, KernelTable<double>& dk);
+
+namespace detail {
+
+template<class V>
+typename V::T simdDot (int n, const typename V::T* x, const typename V::T* y) {
+   typedef typename V::T T;
+   typedef typename V::R R;
+   const int w = V::width;
+   R acc0 = V::zero();
+   R acc1 = V::zero();
+   int i = 0;
+   for (; i + 2*w <= n; i += 2*w) {
+      acc0 = V::fmadd(V::load(x+i), V::load(y+i), acc0);
+      acc1 = V::fmadd(V::load(x+i+w), V::load(y+i+w), acc1);
+   }
+   for (; i + w <= n; i += w) {
+      acc0 = V::fmadd(V::load(x+i), V::load(y+i), acc0);
+   }
+   T s = V::sum(V::add(acc0, acc1));
+   for (; i < n; ++i) {
+      s += x[i]*y[i];
+   }
+   return s;
+}
+
+template<class V>
+void simdAxpy (int n, typename V::T a, const typename V::T* x, typename V::T* y) {
+   typedef typename V::R R;
+   const int w = V::width;
+   R va = V::set1(a);
+   int i = 0;
+   for (; i + w <= n; i += w) {
+      V::store(y+i, V::fmadd(va, V::load(x+i), V::load(y+i)));
+   }
+   for (; i < n; ++i) {
+      y[i] += a*x[i];
+   }
+}
+
+template<class V>
+void simdRot (int n, typename V::T* x, typename V::T* y, typename V::T c, typename V::T s) {
+   typedef typename V::T T;
+   typedef typename V::R R;
+   const int w = V::width;
+   R vc = V::set1(c);
+   R vs = V::set1(s);
+   int i = 0;
+   for (; i + w <= n; i += w) {
+      R h = V::load(x+i);
+      R g = V::load(y+i);
+      V::store(x+i, V::fmadd(vc, h, V::mul(vs, g)));
+      V::store(y+i, V::fnmadd(vs, h, V::mul(vc, g)));
+   }
+   for (; i < n; ++i) {
+      T h = x[i];
+      x[i] = c*h + s*y[i];
+      y[i] = c*y[i] - s*h;
+   }
+}
+
+template<class V>
+void simdRefl2 (int n, typename V::T* u, typename V::T* v,
+                typename V::T a, typename V::T b, typename V::T d, typename V::T e) {
+   typedef typename V::T T;
+   typedef typename V::R R;
+   const int w = V::width;
+   R va = V::set1(a), vb = V::set1(b), vd = V::set1(d), ve = V::set1(e);
+   int i = 0;
+   for (; i + w <= n; i += w) {
+      R x = V::load(u+i);
+      R y = V::load(v+i);
+      R p = V::fmadd(va, x, V::mul(vb, y));
+      V::store(u+i, V::fnmadd(p, vd, x));
+      V::store(v+i, V::fnmadd(p, ve, y));
+   }
+   for (; i < n; ++i) {
+      T p = a*u[i] + b*v[i];
+      u[i] -= p*d;
+      v[i] -= p*e;
+   }
+}
+
+template<class V>
+void simdRefl3 (int n, typename V::T* u, typename V::T* v, typename V::T* w,
+                typename V::T a, typename V::T b, typename V::T c,
+                typename V::T d, typename V::T e, typename V::T f) {
+   typedef typename V::T T;
+   typedef typename V::R R;
+   const int width = V::width;
+   R va = V::set1(a), vb = V::set1(b), vc = V::set1(c);
+   R vd = V::set1(d), ve = V::set1(e), vf = V::set1(f);
+   int i = 0;
+   for (; i + width <= n; i += width) {
+      R x = V::load(u+i);
+      R y = V::load(v+i);
+      R z = V::load(w+i);
+      R p = V::fmadd(va, x, V::fmadd(vb, y, V::mul(vc, z)));
+      V::store(u+i, V::fnmadd(p, vd, x));
+      V::store(v+i, V::fnmadd(p, ve, y));
+      V::store(w+i, V::fnmadd(p, vf, z));
+   }
+   for (; i < n; ++i) {
+      T p = a*u[i] + b*v[i] + c*w[i];
+      w[i] -= p*f;
+      u[i] -= p*d;
+      v[i] -= p*e;
+   }
+}
+
+template<class V>
+void simdGemv (int n, int k, const typename V::T* x, int ldx,
+               const typename V::T* a, typename V::T* y) {
+   typedef typename V::T T;
+   typedef typename V::R R;
+   const int w = V::width;
+   int i = 0;
+   // Four registers of y accumulate the k products.
+   for (; i + 4*w <= n; i += 4*w) {
+      R y0 = V::load(y+i), y1 = V::load(y+i+w), y2 = V::load(y+i+2*w), y3 = V::load(y+i+3*w);
+      const T* p = x+i;
+      for (int l = 0; l < k; ++l, p += ldx) {
+         R va = V::set1(a[l]);
+         y0 = V::fmadd(va, V::load(p), y0);
+         y1 = V::fmadd(va, V::load(p+w), y1);
+         y2 = V::fmadd(va, V::load(p+2*w), y2);
+         y3 = V::fmadd(va, V::load(p+3*w), y3);
+      }
+      V::store(y+i, y0);
+      V::store(y+i+w, y1);
+      V::store(y+i+2*w, y2);
+      V::store(y+i+3*w, y3);
+   }
+   for (; i + w <= n; i += w) {
+      R y0 = V::load(y+i);
+      for (int l = 0; l < k; ++l) {
+         y0 = V::fmadd(V::set1(a[l]), V::load(x+l*ldx+i), y0);
+      }
+      V::store(y+i, y0);
+   }
+   for (; i < n; ++i) {
+      T s = y[i];
+      for (int l = 0; l < k; ++l) {
+         s += a[l]*x[l*ldx+i];
+      }
+      y[i] = s;
+   }
+}
+
+template<class V>
+void fillTable (KernelTable<typename V::T>& k) {
+   k.dot = &simdDot<V>;
+   k.axpy = &simdAxpy<V>;
+   k.rot = &simdRot<V>;
+   k.refl2 = &simdRefl2<V>;
+   k.refl3 = &simdRefl3<V>;
+   k.gemv = &simdGemv<V>;
+}
+
+}
+
+}}}}
+#endif
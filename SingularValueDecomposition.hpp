@@ -30,14 +30,20 @@
 #include <boost/numeric/ublas/matrix_proxy.hpp>
 #include <boost/numeric/ublas/exception.hpp>
 #include <boost/math/special_functions/hypot.hpp>
+#include "SimdKernels.hpp"
+#include "Instrumentation.hpp"
+#include "Convergence.hpp"
+#include "Serialization.hpp"
 
 namespace boost { namespace numeric { namespace ublas {
             
-template<class T, class L = row_major>
+// T: type, L: layout (row_major/column_major),
+// ST: storage array of the internal matrices and vectors (e.g. unbounded_array<T, aligned_allocator<T> >)
+template<class T, class L = row_major, class ST = unbounded_array<T> >
 class SingularValueDecomposition {
 
-    typedef vector<T> vector_type;
-    typedef matrix<T,L> matrix_type;
+    typedef vector<T,ST> vector_type;
+    typedef matrix<T,L,ST> matrix_type;
 
 /* ------------------------
    Class variables
@@ -66,6 +72,31 @@ class SingularValueDecomposition {
    */
    
    bool thin;
+
+   /** Instrumentation counters of the last compute().
+   */
+   instrumentation::Stats stats;
+
+   /** Iteration limits of the QR sweep, and convergence of the last compute().
+   */
+   IterationLimits limits;
+   ConvergenceInfo convergence;
+
+public:
+   /** Working storage for the bidiagonalization and the QR sweep.
+       A workspace can be handed to compute() so that repeated decompositions
+       of same-sized matrices do not allocate; it may be shared by several
+       decompositions that are computed one after the other.
+   */
+   struct Workspace {
+      matrix_type A;
+      vector_type e, work, work2;
+   };
+
+private:
+   /** Working storage kept between calls to compute().
+   */
+   Workspace workspace;
    
    /** Construct the singular value decomposition
        Structure to access U, S and V.
@@ -73,10 +104,11 @@ class SingularValueDecomposition {
    @param thin  If true U is economy sized
    @param wantu If true generate the U matrix
    @param wantv If true generate the V matrix
+   @param ws    Working storage, reused if the dimensions match
    @return     Structure to access U, S and V.
    */
    template <class E>
-   void init (const matrix_expression<E> &Arg, bool thin, bool wantu, bool wantv);
+   void init (const matrix_expression<E> &Arg, bool thin, bool wantu, bool wantv, Workspace &ws);
 
    static matrix_vector_slice<matrix_type> subcolumn(matrix_type& M,size_t c,size_t start,size_t stop) {
       return matrix_vector_slice<matrix_type> (M, slice(start,1,stop-start), slice(c,0,stop-start));
@@ -96,13 +128,20 @@ public:
    
    template <class E>
    SingularValueDecomposition (const matrix_expression<E> &Arg) {
-      init(Arg,true,true,true);
+      Workspace ws;
+      init(Arg,true,true,true,ws);
    }
    
 /* ------------------------
    Constructor
  * ------------------------ */
 
+   /** Construct an empty decomposition, to be computed with compute()
+       or read with load().
+   */
+
+   SingularValueDecomposition () : m(0), n(0), ncu(0), thin(true) {}
+
    /** Construct the singular value decomposition
    @param A    Rectangular matrix
    @param thin  If true U is economy sized
@@ -112,7 +151,36 @@ public:
    */
 
    SingularValueDecomposition (const matrix_type &Arg, bool thin, bool wantu, bool wantv) {
-      init(Arg,thin,wantu,wantv);
+      Workspace ws;
+      init(Arg,thin,wantu,wantv,ws);
+   }
+
+   /** Recompute the singular value decomposition for a new matrix.
+       The storage of U, S, V and of the internal workspace is reused
+       when the dimensions match, so that refactoring same-sized matrices
+       does not allocate.
+   @param Arg   Rectangular matrix
+   @param thin  If true U is economy sized
+   @param wantu If true generate the U matrix
+   @param wantv If true generate the V matrix
+   */
+
+   template <class E>
+   void compute (const matrix_expression<E> &Arg, bool thin = true, bool wantu = true, bool wantv = true) {
+      init(Arg,thin,wantu,wantv,workspace);
+   }
+
+   /** Recompute the singular value decomposition using caller-supplied working storage.
+   @param Arg   Rectangular matrix
+   @param thin  If true U is economy sized
+   @param wantu If true generate the U matrix
+   @param wantv If true generate the V matrix
+   @param ws    Working storage, reused if the dimensions match
+   */
+
+   template <class E>
+   void compute (const matrix_expression<E> &Arg, bool thin, bool wantu, bool wantv, Workspace &ws) {
+      init(Arg,thin,wantu,wantv,ws);
    }
     
 /* ------------------------
@@ -143,6 +211,47 @@ public:
       return s;
    }
 
+   /** Return the instrumentation counters of the last compute()
+       (zero unless compiled with UBLASJAMA_INSTRUMENTATION).
+   @return     stats
+   */
+
+   const instrumentation::Stats& getStats () const {
+      return stats;
+   }
+
+   /** Set the iteration limits of the following calls of compute()
+       (see Convergence.hpp).
+   @param l    limits
+   */
+
+   void setIterationLimits (const IterationLimits& l) {
+      limits = l;
+   }
+
+   const IterationLimits& getIterationLimits () const {
+      return limits;
+   }
+
+   /** Did the last compute() converge?
+       If not, the singular values that had not converged are replaced by
+       the diagonal of the unfinished bidiagonal form, unordered and
+       possibly negative, and U and V are not singular vectors.
+   @return     true if all the singular values converged.
+   */
+
+   bool isConverged () const {
+      return convergence.converged();
+   }
+
+   /** Return the convergence of the last compute()
+   @return     status and iteration counts
+   */
+
+   const ConvergenceInfo& getConvergence () const {
+      return convergence;
+   }
+
    /** Return the diagonal matrix of singular values
    @return     S
    */
@@ -234,29 +343,138 @@ public:
       return r;
    }
 
+   /** Write the decomposition to a binary stream (see Serialization.hpp).
+   @param os   Output stream, opened in binary mode.
+   @param alignment  Alignment of the matrix elements (0: none;
+                     serialization::pageAlignment for a file to be mapped).
+   */
+
+   void save (std::ostream& os, std::size_t alignment = 0) const;
+
+   /** Replace the decomposition by one written by save().
+   @param is   Input stream, opened in binary mode.
+   @exception  external_logic  Not a singular value decomposition of this scalar type, or truncated.
+   */
+
+   void load (std::istream& is);
+
+   /** Replace the decomposition by one saved at the start of a mapped
+       file, binding its matrices to the file if ST is mapped_array.
+   @param file  Mapped file (see MappedStorage.hpp).
+   @exception  external_logic  As load(is).
+   */
+
+   void load (const MappedFile& file);
+
+private:
+   void restore (serialization::Reader<T,L>& in);
 };
 
-template<class T, class L> template<class E>
-void SingularValueDecomposition<T,L>::init (const matrix_expression<E> &Arg, bool thin, bool wantu, bool wantv) {
+   /** Write the decomposition to a binary stream.
+   @param os   Output stream, opened in binary mode.
+   */
+
+template<class T, class L, class ST>
+void SingularValueDecomposition<T,L,ST>::save (std::ostream& os, std::size_t alignment) const {
+   serialization::Writer<T,L> out(os, serialization::SingularValue, alignment);
+   out.integer(m);
+   out.integer(n);
+   out.integer(ncu);
+   out.integer(thin);
+   out.write(convergence);
+   out.write(s);
+   out.write(U);
+   out.write(V);
+}
+
+   /** Replace the decomposition by one written by save().
+   @param is   Input stream, opened in binary mode.
+   */
+
+template<class T, class L, class ST>
+void SingularValueDecomposition<T,L,ST>::load (std::istream& is) {
+   serialization::Reader<T,L> in(is, serialization::SingularValue);
+   restore(in);
+}
+
+   /** Replace the decomposition by one saved at the start of a mapped file.
+   @param file  Mapped file.
+   */
+
+template<class T, class L, class ST>
+void SingularValueDecomposition<T,L,ST>::load (const MappedFile& file) {
+   serialization::Reader<T,L> in(file, serialization::SingularValue);
+   restore(in);
+}
+
+   // Read the members of the decomposition.
+
+template<class T, class L, class ST>
+void SingularValueDecomposition<T,L,ST>::restore (serialization::Reader<T,L>& in) {
+   stats.clear();
+   m = in.size();
+   n = in.size();
+   ncu = in.size();
+   thin = in.integer() != 0;
+   // getS() allocates ncu columns (or rows) even when U is not stored.
+   if (ncu != (thin ? std::min(m,n) : m)) {
+      external_logic("serialization: inconsistent singular value decomposition").raise();
+   }
+   in.read(convergence);
+   in.read(s);
+   in.read(U);
+   in.read(V);
+   if ((int) s.size() != std::min(m+1,n) || (U.size1() != 0 && ((int) U.size1() != m || (int) U.size2() != ncu))
+       || (V.size1() != 0 && ((int) V.size1() != n || (int) V.size2() != n))) {
+      external_logic("serialization: inconsistent singular value decomposition").raise();
+   }
+}
+
+template<class T, class L, class ST> template<class E>
+void SingularValueDecomposition<T,L,ST>::init (const matrix_expression<E> &Arg, bool thin, bool wantu, bool wantv, Workspace &ws) {
 
    // Derived from LINPACK code.
    // Initialize.
-   matrix_type A = Arg();
-   m = A.size1();
-   n = A.size2();
+   // None of the resize() calls below reallocate if the dimensions
+   // are unchanged, and proxies are updated with assign()/plus_assign()
+   // to avoid the temporaries of the aliasing-safe operators.
+   stats.clear();
+   instrumentation::PhaseTimer bidiagonalization(stats, instrumentation::SVDBidiagonalization);
+   const double storage = instrumentation::storageBytes(U) + instrumentation::storageBytes(V)
+                        + instrumentation::storageBytes(s) + instrumentation::storageBytes(ws.A)
+                        + instrumentation::storageBytes(ws.e) + instrumentation::storageBytes(ws.work)
+                        + instrumentation::storageBytes(ws.work2);
+   m = Arg().size1();
+   n = Arg().size2();
+   matrix_type &A = ws.A;
+   A.resize(m,n,false);
+   noalias(A) = Arg();
    this->thin = thin;
 
    ncu = thin?std::min(m,n):m;
-   s = vector_type(std::min(m+1,n));
+   s.resize(std::min(m+1,n),false);
    if (wantu) {
-      U = matrix_type(m,ncu,T/*zero*/());
+      U.resize(m,ncu,false);
+      U.clear();
+   } else {
+      U.resize(0,0,false);
    }
    if (wantv) {
-      V = matrix_type(n,n,T/*zero*/());
+      V.resize(n,n,false);
+      V.clear();
+   } else {
+      V.resize(0,0,false);
    }
-   vector_type e(n);
-   vector_type work(m);
-   vector_type work2(n);
+   vector_type &e = ws.e;
+   vector_type &work = ws.work;
+   vector_type &work2 = ws.work2;
+   e.resize(n,false);
+   work.resize(m,false);
+   work2.resize(n,false);
+   bidiagonalization.allocated(storage, instrumentation::storageBytes(U) + instrumentation::storageBytes(V)
+                                        + instrumentation::storageBytes(s) + instrumentation::storageBytes(A)
+                                        + instrumentation::storageBytes(e) + instrumentation::storageBytes(work)
+                                        + instrumentation::storageBytes(work2));
 
    // Reduce A to bidiagonal form, storing the diagonal elements
    // in s and the super-diagonal elements in e.
@@ -282,17 +500,17 @@ void SingularValueDecomposition<T,L>::init (const matrix_expression<E> &Arg, boo
          }
          s(k) = -s(k);
       }
-      for (int j = k+1; j < n; j++) {
-         if ((k < nct) && (s(k) != T/*zero*/()))  {
+      if ((k < nct) && (s(k) != T/*zero*/()))  {
 
-            // Apply the transformation.
+         // Apply the transformation.
 
-            // t = dot-product of elements k..m-1 of columns k and j of A
-            T t = inner_prod(subcolumn(A,k,k,m),subcolumn(A,j,k,m));
-            t = -t/A(k,k);
-            // elements k..m-1 of column j of A +=  t*(elements k..m-1 of column k of A)
-            subcolumn(A,j,k,m) += t*subcolumn(A,k,k,m);
-         }
+         // for each column j > k of A:
+         // t = dot-product of elements k..m-1 of columns k and j of A
+         // elements k..m-1 of column j of A +=  -t/A(k,k)*(elements k..m-1 of column k of A)
+         kernels::householderUpdate(A, k, k, m, k+1, n, work2.data().begin());
+         bidiagonalization.flops(3.0*(m-k) + 4.0*(m-k)*(n-k-1));
+      }
+      for (int j = k+1; j < n; j++) {
 
          // Place the k-th row of A into e for the
          // subsequent calculation of the row transformation.
@@ -305,7 +523,7 @@ void SingularValueDecomposition<T,L>::init (const matrix_expression<E> &Arg, boo
          // multiplication.
 
          // elements k..m-1 of column k of U = elements k..m-1 of column k of A
-         subcolumn(U,k,k,m) = subcolumn(A,k,k,m);
+         subcolumn(U,k,k,m).assign(subcolumn(A,k,k,m));
       }
       if (k < nrt) {
 
@@ -334,10 +552,11 @@ void SingularValueDecomposition<T,L>::init (const matrix_expression<E> &Arg, boo
             // elements k+1..m-1 of work = A.submatrix(k+1..m-1,k+1..n-1)*elements k+1..n-1 of e
             noalias(subrange(work, k+1, m)) = prod(subrange(A,k+1,m,k+1,n),subrange(e,k+1,n));
             for (int j = k+1; j < n; j++) {
-               T t = -e(j)/e(k+1);
-               // elements k+1..m-1 of column j of A += t*elements k+1..m-1 of work
-               subcolumn(A,j,k+1,m) += t*subrange(work,k+1,m);
+               work2(j) = -e(j)/e(k+1);
             }
+            // elements k+1..m-1 of column j of A += work2(j)*elements k+1..m-1 of work
+            kernels::rank1Update(A, k+1, m, k+1, n, &work(k+1), &work2(k+1));
+            bidiagonalization.flops(4.0*(n-k-1) + 4.0*(m-k-1)*(n-k-1));
          }
          if (wantv) {
 
@@ -345,9 +564,10 @@ void SingularValueDecomposition<T,L>::init (const matrix_expression<E> &Arg, boo
             // back multiplication.
 
             // elements k+1..n-1 of column k of V = elements k+1..n-1 of e
-            subcolumn(V,k,k+1,n) = subrange(e,k+1,n);
+            subcolumn(V,k,k+1,n).assign(subrange(e,k+1,n));
          }
       }
+      bidiagonalization.iterations();
    }
 
    // Set up the final bidiagonal matrix or order p.
@@ -363,24 +583,24 @@ void SingularValueDecomposition<T,L>::init (const matrix_expression<E> &Arg, boo
       e(nrt) = A(nrt,p-1);
    }
    e(p-1) = 0.0;
+   bidiagonalization.finish();
 
    // If required, generate U.
 
+   instrumentation::PhaseTimer vectors(stats, instrumentation::SVDVectors);
    if (wantu) {
       for (int j = nct; j < ncu; j++) {
          // set column j of U to zero
-         column(U,j) = zero_vector<T>(m);
+         column(U,j).assign(scalar_vector<T>(m,T/*zero*/()));
          U(j,j) = 1.0;
       }
       for (int k = nct-1; k >= 0; k--) {
          if (s(k) != T/*zero*/()) {
-            for (int j = k+1; j < ncu; j++) {
-               // t = dot-product of elements k..m-1 of columns k and j of U
-               T t = inner_prod(subcolumn(U,k,k,m),subcolumn(U,j,k,m));
-               t /= -U(k,k);
-               // elements k..m-1 of column j of U +=  t*(elements k..m-1 of column k of U)
-               subcolumn(U,j,k,m) += t*subcolumn(U,k,k,m);
-            }
+            // for each column j > k of U:
+            // t = dot-product of elements k..m-1 of columns k and j of U
+            // elements k..m-1 of column j of U +=  -t/U(k,k)*(elements k..m-1 of column k of U)
+            kernels::householderUpdate(U, k, k, m, k+1, ncu, work.data().begin());
+            vectors.flops(4.0*(m-k)*(ncu-k-1) + (m-k));
             // elements k..m-1 of column k of U *= -1.
             subcolumn(U,k,k,m) *= -1.0;
             U(k,k) += 1.0;
@@ -389,11 +609,11 @@ void SingularValueDecomposition<T,L>::init (const matrix_expression<E> &Arg, boo
                 //for (int i = 0; i < k-1; i++) { 
                 //   U(i,k) = T/*zero*/();
                 //}
-                subcolumn(U, k, 0, k-1) = zero_vector<T>(k-1);
+                subcolumn(U, k, 0, k-1).assign(scalar_vector<T>(k-1,T/*zero*/()));
             }
          } else {
             // set column k of U to zero
-            column(U,k) = zero_vector<T>(m);
+            column(U,k).assign(scalar_vector<T>(m,T/*zero*/()));
             U(k,k) = 1.0;
          }
       }
@@ -404,31 +624,31 @@ void SingularValueDecomposition<T,L>::init (const matrix_expression<E> &Arg, boo
    if (wantv) {
       for (int k = n-1; k >= 0; k--) {
          if ((k < nrt) && (e(k) != T/*zero*/())) {
-            for (int j = k+1; j < n; j++) {
-               // t = dot-product of elements k+1..n-1 of columns k and j of V
-               T t = inner_prod(subcolumn(V,k,k+1,n),subcolumn(V,j,k+1,n));
-               t /= -V(k+1,k);
-               // elements k+1..n-1 of column j of V +=  t*(elements k+1..n-1 of column k of V)
-               subcolumn(V,j,k+1,n) += t*subcolumn(V,k,k+1,n);
-            }
+            // for each column j > k of V:
+            // t = dot-product of elements k+1..n-1 of columns k and j of V
+            // elements k+1..n-1 of column j of V +=  -t/V(k+1,k)*(elements k+1..n-1 of column k of V)
+            kernels::householderUpdate(V, k, k+1, n, k+1, n, work2.data().begin());
+            vectors.flops(4.0*(n-k-1)*(n-k-1));
          }
          // set column k of V to zero
-         column(V,k) = zero_vector<T>(n);
+         column(V,k).assign(scalar_vector<T>(n,T/*zero*/()));
          V(k,k) = 1.0;
       }
    }
 
+   vectors.finish();
+
    // Main iteration loop for the singular values.
 
+   instrumentation::PhaseTimer sweeps(stats, instrumentation::SVDSweeps);
    int pp = p-1;
    int iter = 0;
    T eps = std::numeric_limits<T>::epsilon();
    T tiny = std::numeric_limits<T>::min();
+   IterationGuard guard(limits, convergence, p);
    while (p > 0) {
       int k,kase;
 
-      // Here is where a test for too many iterations would go.
-
       // This section of the program inspects for
       // negligible elements in the s and e arrays.  On
       // completion the variables kase and k are set as follows.
@@ -499,10 +719,10 @@ void SingularValueDecomposition<T,L>::init (const matrix_expression<E> &Arg, boo
                   //   V(i,p-1) = -sn*V(i,j) + cs*V(i,p-1);
                   //   V(i,j) = t;
                   //}
-                  work2 = cs*column(V,j) + sn*column(V,p-1);
-                  column(V,p-1) = -sn*column(V,j) + cs*column(V,p-1);
-                  column(V,j) = work2;
+                  kernels::rot(n, kernels::address(V,0,j), kernels::columnStride(V),
+                               kernels::address(V,0,p-1), kernels::columnStride(V), cs, sn);
                }
+               sweeps.flops(10 + (wantv ? 6.0*n : 0.0));
             }
          }
             break;
@@ -525,10 +745,10 @@ void SingularValueDecomposition<T,L>::init (const matrix_expression<E> &Arg, boo
                   //   U(i,k-1) = -sn*U(i,j) + cs*U(i,k-1);
                   //   U(i,j) = t;
                   //}
-                  work = cs*column(U,j) + sn*column(U,k-1);
-                  column(U,k-1) = -sn*column(U,j) + cs*column(U,k-1);
-                  column(U,j) = work;
+                  kernels::rot(m, kernels::address(U,0,j), kernels::columnStride(U),
+                               kernels::address(U,0,k-1), kernels::columnStride(U), cs, sn);
                }
+               sweeps.flops(10 + (wantu ? 6.0*m : 0.0));
             }
          }
             break;
@@ -537,6 +757,13 @@ void SingularValueDecomposition<T,L>::init (const matrix_expression<E> &Arg, boo
 
          case 3: {
 
+            // Test for too many iterations.
+
+            if (!guard.next(iter+1)) {
+               guard.fail(p);
+               return;
+            }
+
             // Calculate the shift.
    
             T scale = std::max(std::max(std::max(std::max(
@@ -579,9 +806,8 @@ void SingularValueDecomposition<T,L>::init (const matrix_expression<E> &Arg, boo
                   //   V(i,j+1) = -sn*V(i,j) + cs*V(i,j+1);
                   //   V(i,j) = t;
                   //}
-                  work2 = cs*column(V,j) + sn*column(V,j+1);
-                  column(V,j+1) = -sn*column(V,j) + cs*column(V,j+1);
-                  column(V,j) = work2;
+                  kernels::rot(n, kernels::address(V,0,j), kernels::columnStride(V),
+                               kernels::address(V,0,j+1), kernels::columnStride(V), cs, sn);
                }
                t = boost::math::hypot(f,g);
                cs = f/t;
@@ -597,13 +823,14 @@ void SingularValueDecomposition<T,L>::init (const matrix_expression<E> &Arg, boo
                   //   U(i,j+1) = -sn*U(i,j) + cs*U(i,j+1);
                   //   U(i,j) = t;
                   //}
-                  work = cs*column(U,j) + sn*column(U,j+1);
-                  column(U,j+1) = -sn*column(U,j) + cs*column(U,j+1);
-                  column(U,j) = work;
+                  kernels::rot(m, kernels::address(U,0,j), kernels::columnStride(U),
+                               kernels::address(U,0,j+1), kernels::columnStride(U), cs, sn);
                }
+               sweeps.flops(30 + (wantv ? 6.0*n : 0.0) + (wantu && (j < m-1) ? 6.0*m : 0.0));
             }
             e(p-2) = f;
             iter++;
+            sweeps.iterations();
          }
             break;
 
@@ -0,0 +1,370 @@
+   /** Sparse Cholesky Decomposition.
+   <P>
+   For a sparse, symmetric, positive definite matrix A (compressed_matrix),
+   the sparse lower triangular L so that P*A*P' = L*L', where P is the
+   fill-reducing approximate minimum degree ordering of A (SparseOrdering.hpp).
+   <P>
+   The factorization has two phases, as in CHOLMOD: analyze() orders A and
+   computes the elimination tree and the number of nonzeros of each column
+   of L, from the pattern of A only, and factorize() computes L, row by
+   row (the up-looking algorithm of CSparse's cs_chol), in storage sized by
+   the analysis.  A sequence of matrices with the same pattern, such as
+   the Jacobians of a Newton iteration, is analyzed once:
+<pre>
+   SparseCholeskyDecomposition<double> chol;
+   chol.analyze(A);
+   for (...) {
+      chol.factorize(A);        // same pattern, new values
+      x = chol.solve(b);
+   }
+</pre>
+   Only the elements of A on and below the diagonal are used, so isSPD()
+   reports positive definiteness but not symmetry.  If A is not positive
+   definite, the factorization stops at the first nonpositive pivot.
+   */
+
+#ifndef _BOOST_UBLAS_SPARSECHOLESKYDECOMPOSITION_
+#define _BOOST_UBLAS_SPARSECHOLESKYDECOMPOSITION_
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <boost/numeric/ublas/vector.hpp>
+#include <boost/numeric/ublas/matrix.hpp>
+#include <boost/numeric/ublas/matrix_sparse.hpp>
+#include <boost/numeric/ublas/exception.hpp>
+#include <boost/numeric/ublas/matrix_proxy.hpp>
+#include "SparseOrdering.hpp"
+
+namespace boost { namespace numeric { namespace ublas {
+
+// T: type, F: layout of the right hand sides and solutions (row_major/column_major)
+template<class T, class F = row_major>
+class SparseCholeskyDecomposition {
+
+    typedef vector<T> Vector;
+    typedef matrix<T,F> Matrix;
+    typedef compressed_matrix<T> SparseMatrix;
+
+/* ------------------------
+   Class variables
+ * ------------------------ */
+
+   /** Row and column dimension (square matrix).
+   */
+   int n;
+
+   /** Fill-reducing permutation and its inverse: row k of P*A*P' is row
+       perm[k] of A.
+   */
+   std::vector<int> perm, pinv;
+
+   /** Pattern of the upper triangle of P*A*P', in compressed columns, of
+       the analyzed matrix.
+   */
+   std::vector<int> Cp, Ci;
+
+   /** Elimination tree (-1 for a root).
+   */
+   std::vector<int> parent;
+
+   /** L in compressed columns, the diagonal first in each column.
+   */
+   sparse::CompressedColumns<T> L;
+
+   /** Symmetric (assumed) and positive definite flag.
+   */
+   bool isspd;
+
+/* ------------------------
+   Private Methods
+ * ------------------------ */
+
+   // Upper triangle of P*A*P' from the lower triangle of A.
+
+   sparse::CompressedColumns<T> permute (const SparseMatrix& A) const {
+      const sparse::CompressedColumns<T> B = sparse::compressColumns(A);
+      sparse::CompressedColumns<T> C;
+      C.m = C.n = n;
+      C.p.assign(n+1, 0);
+      for (int j = 0; j < n; ++j) {
+         for (int q = B.p[j]; q < B.p[j+1]; ++q) {
+            if (B.i[q] >= j) {
+               ++C.p[std::max(pinv[B.i[q]], pinv[j])+1];
+            }
+         }
+      }
+      for (int k = 0; k < n; ++k) {
+         C.p[k+1] += C.p[k];
+      }
+      std::vector<int> next(C.p.begin(), C.p.end()-1);
+      C.i.resize(C.p[n]);
+      C.x.resize(C.p[n]);
+      for (int j = 0; j < n; ++j) {
+         for (int q = B.p[j]; q < B.p[j+1]; ++q) {
+            if (B.i[q] >= j) {
+               const int r = pinv[B.i[q]], c = pinv[j];
+               const int t = next[std::max(r,c)]++;
+               C.i[t] = std::min(r,c);
+               C.x[t] = B.x[q];
+            }
+         }
+      }
+      return C;
+   }
+
+   // Pattern of row k of L (without the diagonal) in s[top..n-1], in
+   // topological order, by the paths of the elimination tree from the
+   // elements of column k of C (CSparse's cs_ereach).
+
+   int ereach (const std::vector<int>& p, const std::vector<int>& i, int k,
+               std::vector<int>& s, std::vector<int>& mark) const {
+      int top = n;
+      mark[k] = k;
+      for (int q = p[k]; q < p[k+1]; ++q) {
+         int len = 0;
+         for (int r = i[q]; mark[r] != k; r = parent[r]) {
+            s[len++] = r;
+            mark[r] = k;
+         }
+         while (len > 0) {
+            s[--top] = s[--len];
+         }
+      }
+      return top;
+   }
+
+   // x = inv(L)*x and x = inv(L')*x.
+
+   void lowerSolve (T* x) const {
+      for (int j = 0; j < n; ++j) {
+         x[j] /= L.x[L.p[j]];
+         for (int q = L.p[j]+1; q < L.p[j+1]; ++q) {
+            x[L.i[q]] -= L.x[q]*x[j];
+         }
+      }
+   }
+
+   void transposeSolve (T* x) const {
+      for (int j = n-1; j >= 0; --j) {
+         for (int q = L.p[j]+1; q < L.p[j+1]; ++q) {
+            x[j] -= L.x[q]*x[L.i[q]];
+         }
+         x[j] /= L.x[L.p[j]];
+      }
+   }
+
+public:
+/* ------------------------
+   Constructor
+ * ------------------------ */
+
+   /** Construct an empty decomposition, to be computed with compute(),
+       or analyze() and factorize().
+   */
+
+   SparseCholeskyDecomposition () : n(0), isspd(false) {}
+
+   /** Sparse Cholesky algorithm for symmetric and positive definite matrix.
+   @param  A   Square, symmetric sparse matrix.
+   */
+
+   explicit SparseCholeskyDecomposition (const SparseMatrix& A) : n(0), isspd(false) {
+      compute(A);
+   }
+
+   /** Analyze and factor a new matrix.
+   @param  A   Square, symmetric sparse matrix.
+   @exception  bad_size  Matrix must be square.
+   */
+
+   void compute (const SparseMatrix& A) {
+      analyze(A);
+      factorize(A);
+   }
+
+   /** Symbolic factorization: ordering, elimination tree and column
+       counts of L, from the pattern of A.
+   @param  A   Square, symmetric sparse matrix (its values are not used).
+   @exception  bad_size  Matrix must be square.
+   */
+
+   void analyze (const SparseMatrix& A) {
+      BOOST_UBLAS_CHECK(A.size1() == A.size2(), bad_size("Matrix must be square."));
+      n = A.size1();
+      isspd = false;
+      {
+         const sparse::CompressedColumns<T> B = sparse::compressColumns(A);
+         perm = sparse::approximateMinimumDegree(n, B.p, B.i);
+      }
+      pinv = sparse::inverse(perm);
+      const sparse::CompressedColumns<T> C = permute(A);
+      Cp = C.p;
+      Ci = C.i;
+
+      // Elimination tree, with path compression (CSparse's cs_etree).
+      parent.assign(n, -1);
+      std::vector<int> ancestor(n, -1);
+      for (int k = 0; k < n; ++k) {
+         for (int q = Cp[k]; q < Cp[k+1]; ++q) {
+            int next;
+            for (int r = Ci[q]; r != -1 && r < k; r = next) {
+               next = ancestor[r];
+               ancestor[r] = k;
+               if (next == -1) {
+                  parent[r] = k;
+               }
+            }
+         }
+      }
+
+      // Column counts of L from the row patterns.
+      std::vector<int> count(n, 1), s(n), mark(n, -1);
+      for (int k = 0; k < n; ++k) {
+         for (int top = ereach(Cp, Ci, k, s, mark); top < n; ++top) {
+            ++count[s[top]];
+         }
+      }
+      L.m = L.n = n;
+      L.p.assign(n+1, 0);
+      for (int k = 0; k < n; ++k) {
+         L.p[k+1] = L.p[k] + count[k];
+      }
+      L.i.resize(L.p[n]);
+      L.x.resize(L.p[n]);
+   }
+
+   /** Numeric factorization of a matrix with the pattern of the matrix
+       given to analyze().
+   @param  A   Square, symmetric sparse matrix.
+   @exception  bad_argument  A has not the analyzed pattern.
+   */
+
+   void factorize (const SparseMatrix& A) {
+      BOOST_UBLAS_CHECK((int) A.size1() == n && (int) A.size2() == n, bad_size("Matrix dimensions must agree."));
+      const sparse::CompressedColumns<T> C = permute(A);
+      if (C.p != Cp || C.i != Ci) {
+         bad_argument("SparseCholeskyDecomposition: the pattern of A is not the analyzed one").raise();
+      }
+      isspd = true;
+      std::vector<int> next(L.p.begin(), L.p.end()-1), s(n), mark(n, -1);
+      std::vector<T> x(n, T(0));
+      for (int k = 0; k < n; ++k) {
+         // x = C(0:k,k), then the triangular solve with the rows of L.
+         const int top = ereach(Cp, Ci, k, s, mark);
+         for (int q = Cp[k]; q < Cp[k+1]; ++q) {
+            x[Ci[q]] = C.x[q];
+         }
+         T d = x[k];
+         x[k] = 0.0;
+         for (int t = top; t < n; ++t) {
+            const int j = s[t];
+            const T lkj = x[j]/L.x[L.p[j]];
+            x[j] = 0.0;
+            for (int q = L.p[j]+1; q < next[j]; ++q) {
+               x[L.i[q]] -= L.x[q]*lkj;
+            }
+            d -= lkj*lkj;
+            L.i[next[j]] = k;
+            L.x[next[j]++] = lkj;
+         }
+         if (!(d > 0.0)) {
+            isspd = false;
+            return;
+         }
+         L.i[next[k]] = k;
+         L.x[next[k]++] = std::sqrt(d);
+      }
+   }
+
+/* ------------------------
+   Public Methods
+ * ------------------------ */
+
+   /** Is the matrix symmetric and positive definite?
+   @return     true if A is positive definite (its symmetry is not checked).
+   */
+
+   bool isSPD () const {
+      return isspd;
+   }
+
+   /** Return the fill-reducing permutation
+   @return     perm, so that row k of P*A*P' is row perm[k] of A
+   */
+
+   const std::vector<int>& getPermutation () const {
+      return perm;
+   }
+
+   /** Return the triangular factor of P*A*P'.
+   @return     L, in compressed columns
+   */
+
+   const sparse::CompressedColumns<T>& getL () const {
+      return L;
+   }
+
+   /** Solve A*X = B
+   @param  B   A Matrix with as many rows as A and any number of columns.
+   @return     X so that L*L'*X(perm,:) = B(perm,:)
+   @exception  bad_size  Matrix row dimensions must agree.
+   @exception  singular  Matrix is not symmetric positive definite.
+   */
+
+   Matrix solve (const Matrix& B) const {
+      BOOST_UBLAS_CHECK((int) B.size1() == n, bad_size("Matrix row dimensions must agree."));
+      BOOST_UBLAS_CHECK(isspd, singular("Matrix is not symmetric positive definite."));
+      Matrix X(B.size1(), B.size2());
+      std::vector<T> x(n);
+      for (std::size_t j = 0; j < B.size2() && n > 0; ++j) {
+         for (int k = 0; k < n; ++k) {
+            x[k] = B(perm[k],j);
+         }
+         lowerSolve(&x[0]);
+         transposeSolve(&x[0]);
+         for (int k = 0; k < n; ++k) {
+            X(perm[k],j) = x[k];
+         }
+      }
+      return X;
+   }
+
+   /** Solve A*x = b
+   @param  b   A vector with as many elements as A has rows.
+   @return     x so that A*x = b
+   @exception  bad_size  Matrix row dimensions must agree.
+   @exception  singular  Matrix is not symmetric positive definite.
+   */
+
+   Vector solve (const Vector& b) const {
+      Vector x(b);
+      solveInPlace(x);
+      return x;
+   }
+
+   /** Solve A*x = b in place.
+   @param  b   Right hand side, replaced by x.
+   @exception  bad_size  Matrix row dimensions must agree.
+   @exception  singular  Matrix is not symmetric positive definite.
+   */
+
+   void solveInPlace (Vector& b) const {
+      BOOST_UBLAS_CHECK((int) b.size() == n, bad_size("Matrix row dimensions must agree."));
+      BOOST_UBLAS_CHECK(isspd, singular("Matrix is not symmetric positive definite."));
+      std::vector<T> x(n);
+      for (int k = 0; k < n; ++k) {
+         x[k] = b(perm[k]);
+      }
+      if (n > 0) {
+         lowerSolve(&x[0]);
+         transposeSolve(&x[0]);
+      }
+      for (int k = 0; k < n; ++k) {
+         b(perm[k]) = x[k];
+      }
+   }
+};
+
+}}}
+#endif
@@ -0,0 +1,440 @@
+   /** Sparse LU Decomposition.
+   <P>
+   For a sparse square matrix A (compressed_matrix), the sparse unit lower
+   triangular L and upper triangular U so that A(prow,q) = L*U, where the
+   column permutation q is the fill-reducing approximate minimum degree
+   ordering of A+A' (SparseOrdering.hpp) and the row permutation prow
+   comes from threshold partial pivoting: the diagonal element is kept as
+   the pivot when it is at least pivotTolerance times the largest
+   candidate, which preserves the ordering of matrices with a symmetric
+   pattern and a strong diagonal, such as finite element matrices (1.0
+   gives the partial pivoting of the dense decomposition).
+   <P>
+   analyze() computes the ordering from the pattern of A, and factorize()
+   computes L and U column by column with the left-looking algorithm of
+   Gilbert and Peierls (CSparse's cs_lu), in time proportional to the
+   floating point operations.  Since the pivots depend on the values, the
+   analysis of a pattern is reused, but the storage of the factors is
+   sized anew by each factorize().
+   <P>
+   As the dense LU decomposition, the factorization of a singular matrix
+   completes all the columns, with a zero on the diagonal of U for each
+   zero pivot, and sets a flag that may be queried by isNonsingular();
+   solve() then throws singular.
+   */
+
+#ifndef _BOOST_UBLAS_SPARSELUDECOMPOSITION_
+#define _BOOST_UBLAS_SPARSELUDECOMPOSITION_
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <boost/numeric/ublas/vector.hpp>
+#include <boost/numeric/ublas/matrix.hpp>
+#include <boost/numeric/ublas/matrix_sparse.hpp>
+#include <boost/numeric/ublas/exception.hpp>
+#include <boost/numeric/ublas/matrix_proxy.hpp>
+#include "SparseOrdering.hpp"
+
+namespace boost { namespace numeric { namespace ublas {
+
+// T: type, F: layout of the right hand sides and solutions (row_major/column_major)
+template<class T, class F = row_major>
+class SparseLUDecomposition {
+
+    typedef vector<T> Vector;
+    typedef matrix<T,F> Matrix;
+    typedef compressed_matrix<T> SparseMatrix;
+
+/* ------------------------
+   Class variables
+ * ------------------------ */
+
+   /** Row and column dimension (square matrix).
+   */
+   int n;
+
+   /** Threshold of the diagonal pivots.
+   */
+   T tol;
+
+   /** Column permutation q, and pattern of the analyzed matrix.
+   */
+   std::vector<int> q, Ap, Ai;
+
+   /** Row permutation: row i of A is row pinv[i] of L*U.
+   */
+   std::vector<int> pinv;
+
+   /** L (unit diagonal first in each column) and U (diagonal last), in
+       compressed columns.
+   */
+   sparse::CompressedColumns<T> L, U;
+
+   /** Nonsingularity flag.
+   */
+   bool nonsingular;
+
+/* ------------------------
+   Private Methods
+ * ------------------------ */
+
+   // Rows reachable from the elements of column k of A in the graph of
+   // the columns of L computed so far, in topological order in
+   // xi[top..n-1] (CSparse's cs_reach, without recursion).
+
+   int reach (const sparse::CompressedColumns<T>& A, int k, std::vector<int>& xi,
+              std::vector<int>& stack, std::vector<int>& next, std::vector<int>& mark, int stamp) const {
+      int top = n;
+      for (int p = A.p[k]; p < A.p[k+1]; ++p) {
+         if (mark[A.i[p]] == stamp) {
+            continue;
+         }
+         int head = 0;
+         stack[0] = A.i[p];
+         while (head >= 0) {
+            const int j = stack[head];
+            const int J = pinv[j];
+            if (mark[j] != stamp) {
+               mark[j] = stamp;
+               next[head] = J < 0 ? 0 : L.p[J];
+            }
+            bool done = true;
+            const int end = J < 0 ? 0 : L.p[J+1];
+            for (int r = next[head]; r < end; ++r) {
+               const int i = L.i[r];
+               if (mark[i] == stamp) {
+                  continue;
+               }
+               next[head] = r+1;
+               stack[++head] = i;
+               done = false;
+               break;
+            }
+            if (done) {
+               --head;
+               xi[--top] = j;
+            }
+         }
+      }
+      return top;
+   }
+
+   // x = inv(L)*x and x = inv(U)*x.
+
+   void lowerSolve (T* x) const {
+      for (int j = 0; j < n; ++j) {
+         for (int p = L.p[j]+1; p < L.p[j+1]; ++p) {
+            x[L.i[p]] -= L.x[p]*x[j];
+         }
+      }
+   }
+
+   void upperSolve (T* x) const {
+      for (int j = n-1; j >= 0; --j) {
+         x[j] /= U.x[U.p[j+1]-1];
+         for (int p = U.p[j]; p < U.p[j+1]-1; ++p) {
+            x[U.i[p]] -= U.x[p]*x[j];
+         }
+      }
+   }
+
+   // Sign of a permutation, from its cycles.
+
+   static int sign (const std::vector<int>& perm) {
+      std::vector<bool> seen(perm.size(), false);
+      int s = 1;
+      for (std::size_t k = 0; k < perm.size(); ++k) {
+         if (!seen[k]) {
+            for (int j = perm[k]; !seen[j]; j = perm[j]) {
+               seen[j] = true;
+               if (j != (int) k) {
+                  s = -s;
+               }
+            }
+            seen[k] = true;
+         }
+      }
+      return s;
+   }
+
+public:
+/* ------------------------
+   Constructor
+ * ------------------------ */
+
+   /** Construct an empty decomposition, to be computed with compute(),
+       or analyze() and factorize().
+   @param  pivotTolerance  Threshold of the diagonal pivots, in (0,1].
+   */
+
+   explicit SparseLUDecomposition (T pivotTolerance = 0.1) : n(0), tol(pivotTolerance), nonsingular(false) {}
+
+   /** Sparse LU Decomposition
+   @param  A   Square sparse matrix.
+   @param  pivotTolerance  Threshold of the diagonal pivots, in (0,1].
+   */
+
+   explicit SparseLUDecomposition (const SparseMatrix& A, T pivotTolerance = 0.1)
+   : n(0), tol(pivotTolerance), nonsingular(false) {
+      compute(A);
+   }
+
+   /** Analyze and factor a new matrix.
+   @param  A   Square sparse matrix.
+   @exception  bad_size  Matrix must be square.
+   */
+
+   void compute (const SparseMatrix& A) {
+      analyze(A);
+      factorize(A);
+   }
+
+   /** Symbolic analysis: the column ordering, from the pattern of A.
+   @param  A   Square sparse matrix (its values are not used).
+   @exception  bad_size  Matrix must be square.
+   */
+
+   void analyze (const SparseMatrix& A) {
+      BOOST_UBLAS_CHECK(A.size1() == A.size2(), bad_size("Matrix must be square."));
+      n = A.size1();
+      nonsingular = false;
+      const sparse::CompressedColumns<T> B = sparse::compressColumns(A);
+      Ap = B.p;
+      Ai = B.i;
+      q = sparse::approximateMinimumDegree(n, Ap, Ai);
+   }
+
+   /** Numeric factorization of a matrix with the pattern of the matrix
+       given to analyze().
+   @param  A   Square sparse matrix.
+   @exception  bad_argument  A has not the analyzed pattern.
+   */
+
+   void factorize (const SparseMatrix& A) {
+      BOOST_UBLAS_CHECK((int) A.size1() == n && (int) A.size2() == n, bad_size("Matrix dimensions must agree."));
+      const sparse::CompressedColumns<T> B = sparse::compressColumns(A);
+      if (B.p != Ap || B.i != Ai) {
+         bad_argument("SparseLUDecomposition: the pattern of A is not the analyzed one").raise();
+      }
+
+      // Columns of A in the order q, so that reach() sees column k.
+      sparse::CompressedColumns<T> C;
+      C.m = C.n = n;
+      C.p.resize(n+1);
+      C.p[0] = 0;
+      for (int k = 0; k < n; ++k) {
+         C.p[k+1] = C.p[k] + B.p[q[k]+1] - B.p[q[k]];
+      }
+      C.i.reserve(C.p[n]);
+      C.x.reserve(C.p[n]);
+      for (int k = 0; k < n; ++k) {
+         C.i.insert(C.i.end(), B.i.begin() + B.p[q[k]], B.i.begin() + B.p[q[k]+1]);
+         C.x.insert(C.x.end(), B.x.begin() + B.p[q[k]], B.x.begin() + B.p[q[k]+1]);
+      }
+
+      L = U = sparse::CompressedColumns<T>();
+      L.m = L.n = U.m = U.n = n;
+      L.p.assign(n+1, 0);
+      U.p.assign(n+1, 0);
+      L.i.reserve(2*C.p[n] + n);
+      L.x.reserve(2*C.p[n] + n);
+      U.i.reserve(2*C.p[n] + n);
+      U.x.reserve(2*C.p[n] + n);
+      pinv.assign(n, -1);
+      nonsingular = true;
+      std::vector<int> xi(n), stack(n), next(n), mark(n, -1);
+      std::vector<T> x(n, T(0));
+      for (int k = 0; k < n; ++k) {
+         // x = inv(L)*A(:,q[k]), sparse triangular solve on its pattern.
+         L.p[k] = L.i.size();
+         U.p[k] = U.i.size();
+         const int top = reach(C, k, xi, stack, next, mark, k);
+         for (int p = C.p[k]; p < C.p[k+1]; ++p) {
+            x[C.i[p]] = C.x[p];
+         }
+         for (int t = top; t < n; ++t) {
+            const int j = xi[t];
+            const int J = pinv[j];
+            if (J < 0) {
+               continue;
+            }
+            for (int p = L.p[J]+1; p < L.p[J+1]; ++p) {
+               x[L.i[p]] -= L.x[p]*x[j];
+            }
+         }
+
+         // The rows already pivotal go to U; the largest of the others, or
+         // the diagonal if it passes the threshold, is the pivot.
+         int ipiv = -1;
+         T a = -1;
+         for (int t = top; t < n; ++t) {
+            const int i = xi[t];
+            if (pinv[i] < 0) {
+               if (std::abs(x[i]) > a) {
+                  a = std::abs(x[i]);
+                  ipiv = i;
+               }
+            } else {
+               U.i.push_back(pinv[i]);
+               U.x.push_back(x[i]);
+            }
+         }
+         const int diag = q[k];
+         if (ipiv == -1 || a <= 0.0) {
+            // Zero pivot: as the dense decomposition, keep the zero on the
+            // diagonal of U and go on with the next columns.  The diagonal
+            // row, or else the first row not yet pivotal, is the pivot row.
+            nonsingular = false;
+            if (pinv[diag] < 0) {
+               ipiv = diag;
+            } else {
+               ipiv = std::find(pinv.begin(), pinv.end(), -1) - pinv.begin();
+            }
+         } else if (pinv[diag] < 0 && mark[diag] == k && std::abs(x[diag]) >= a*tol) {
+            ipiv = diag;
+         }
+         const T pivot = x[ipiv];
+         U.i.push_back(k);
+         U.x.push_back(pivot);
+         pinv[ipiv] = k;
+         L.i.push_back(ipiv);
+         L.x.push_back(1.0);
+         for (int t = top; t < n; ++t) {
+            const int i = xi[t];
+            if (pinv[i] < 0) {
+               L.i.push_back(i);
+               L.x.push_back(pivot != 0.0 ? x[i]/pivot : x[i]);
+            }
+            x[i] = 0.0;
+         }
+      }
+      L.p[n] = L.i.size();
+      U.p[n] = U.i.size();
+      for (std::size_t p = 0; p < L.i.size(); ++p) {
+         L.i[p] = pinv[L.i[p]];
+      }
+   }
+
+/* ------------------------
+   Public Methods
+ * ------------------------ */
+
+   /** Is the matrix nonsingular?
+   @return     true if U, and hence A, is nonsingular.
+   */
+
+   bool isNonsingular () const {
+      return nonsingular;
+   }
+
+   /** Return the column permutation
+   @return     q, so that column k of L*U is column q[k] of A
+   */
+
+   const std::vector<int>& getColumnPermutation () const {
+      return q;
+   }
+
+   /** Return the row permutation
+   @return     pinv, so that row i of A is row pinv[i] of L*U
+   */
+
+   const std::vector<int>& getRowPermutation () const {
+      return pinv;
+   }
+
+   /** Return lower triangular factor
+   @return     L, in compressed columns
+   */
+
+   const sparse::CompressedColumns<T>& getL () const {
+      return L;
+   }
+
+   /** Return upper triangular factor
+   @return     U, in compressed columns
+   */
+
+   const sparse::CompressedColumns<T>& getU () const {
+      return U;
+   }
+
+   /** Determinant
+   @return     det(A)
+   */
+
+   T det () const {
+      if (!nonsingular) {
+         return 0.0;
+      }
+      T d = (T) (sign(pinv)*sign(q));
+      for (int j = 0; j < n; ++j) {
+         d *= U.x[U.p[j+1]-1];
+      }
+      return d;
+   }
+
+   /** Solve A*X = B
+   @param  B   A Matrix with as many rows as A and any number of columns.
+   @return     X so that L*U*X(q,:) = B(prow,:)
+   @exception  bad_size Matrix row dimensions must agree.
+   @exception  singular  Matrix is singular.
+   */
+
+   Matrix solve (const Matrix& B) const {
+      BOOST_UBLAS_CHECK((int) B.size1() == n, bad_size("Matrix row dimensions must agree."));
+      BOOST_UBLAS_CHECK(nonsingular, singular("Matrix is singular."));
+      Matrix X(B.size1(), B.size2());
+      std::vector<T> x(n);
+      for (std::size_t j = 0; j < B.size2() && n > 0; ++j) {
+         for (int i = 0; i < n; ++i) {
+            x[pinv[i]] = B(i,j);
+         }
+         lowerSolve(&x[0]);
+         upperSolve(&x[0]);
+         for (int k = 0; k < n; ++k) {
+            X(q[k],j) = x[k];
+         }
+      }
+      return X;
+   }
+
+   /** Solve A*x = b
+   @param  b   A vector with as many elements as A has rows.
+   @return     x so that A*x = b
+   @exception  bad_size Matrix row dimensions must agree.
+   @exception  singular  Matrix is singular.
+   */
+
+   Vector solve (const Vector& b) const {
+      Vector x(b);
+      solveInPlace(x);
+      return x;
+   }
+
+   /** Solve A*x = b in place.
+   @param  b   Right hand side, replaced by x.
+   @exception  bad_size Matrix row dimensions must agree.
+   @exception  singular  Matrix is singular.
+   */
+
+   void solveInPlace (Vector& b) const {
+      BOOST_UBLAS_CHECK((int) b.size() == n, bad_size("Matrix row dimensions must agree."));
+      BOOST_UBLAS_CHECK(nonsingular, singular("Matrix is singular."));
+      std::vector<T> x(n);
+      for (int i = 0; i < n; ++i) {
+         x[pinv[i]] = b(i);
+      }
+      if (n > 0) {
+         lowerSolve(&x[0]);
+         upperSolve(&x[0]);
+      }
+      for (int k = 0; k < n; ++k) {
+         b(q[k]) = x[k];
+      }
+   }
+};
+
+}}}
+#endif
@@ -0,0 +1,294 @@
+   /** Sparse matrix storage and fill-reducing ordering.
+   <P>
+   The sparse decompositions copy their compressed_matrix input to
+   compressed columns (CompressedColumns, as CSparse and LAPACK-style
+   sparse codes do) and permute it with approximateMinimumDegree(), the
+   approximate minimum degree ordering of Amestoy, Davis and Duff (AMD):
+   the symmetric elimination is simulated on the quotient graph, where
+   each eliminated node becomes an element (a clique given by its list of
+   variables), and the next pivot is a variable of least approximate
+   external degree.  Indistinguishable variables are merged into
+   supervariables and elements contained in the new one are absorbed, so
+   that the ordering of an n-by-n finite element matrix takes about
+   O(nnz) operations per elimination front rather than the O(n^3) of the
+   explicit elimination graph.  Dense rows are not set aside.
+   */
+
+#ifndef _BOOST_UBLAS_SPARSEORDERING_
+#define _BOOST_UBLAS_SPARSEORDERING_
+
+#include <algorithm>
+#include <set>
+#include <utility>
+#include <vector>
+#include <boost/numeric/ublas/exception.hpp>
+
+namespace boost { namespace numeric { namespace ublas { namespace sparse {
+
+/** Compressed column storage of an m-by-n sparse matrix: the row indices
+    and values of column j are i[p[j]..p[j+1]-1] and x[p[j]..p[j+1]-1].
+*/
+
+template<class T>
+struct CompressedColumns {
+   int m, n;
+   std::vector<int> p, i;
+   std::vector<T> x;
+
+   CompressedColumns () : m(0), n(0), p(1,0) {}
+
+   int nonZeros () const { return p[n]; }
+};
+
+/** Copy the stored elements of a sparse matrix expression (e.g. a
+    compressed_matrix) to compressed columns, in the order of its
+    iterators; for a row major A the rows of each column are increasing.
+@param A    Sparse matrix.
+@return     A in compressed columns.
+*/
+
+template<class M>
+CompressedColumns<typename M::value_type> compressColumns (const M& A) {
+   CompressedColumns<typename M::value_type> C;
+   C.m = A.size1();
+   C.n = A.size2();
+   C.p.assign(C.n+1, 0);
+   for (typename M::const_iterator1 r = A.begin1(); r != A.end1(); ++r) {
+      for (typename M::const_iterator2 e = r.begin(); e != r.end(); ++e) {
+         ++C.p[e.index2()+1];
+      }
+   }
+   for (int j = 0; j < C.n; ++j) {
+      C.p[j+1] += C.p[j];
+   }
+   std::vector<int> next(C.p.begin(), C.p.end()-1);
+   C.i.resize(C.p[C.n]);
+   C.x.resize(C.p[C.n]);
+   for (typename M::const_iterator1 r = A.begin1(); r != A.end1(); ++r) {
+      for (typename M::const_iterator2 e = r.begin(); e != r.end(); ++e) {
+         const int q = next[e.index2()]++;
+         C.i[q] = e.index1();
+         C.x[q] = *e;
+      }
+   }
+   return C;
+}
+
+/** Approximate minimum degree ordering of the graph of A+A'.
+@param n    Order of A.
+@param p    Column pointers of A (n+1 elements).
+@param i    Row indices of A; the diagonal and duplicates are ignored.
+@return     Permutation perm: the k-th pivot is perm[k].
+*/
+
+inline std::vector<int> approximateMinimumDegree (int n, const std::vector<int>& p, const std::vector<int>& i) {
+   enum { Variable, Element, Dead };
+   std::vector<std::vector<int> > adjacent(n), elements(n), members(n), variables(n);
+   std::vector<int> status(n, Variable), nv(n, 1), degree(n), esize(n, 0);
+   std::vector<int> mark(n, -1), wext(n, -1), perm;
+   perm.reserve(n);
+
+   // Adjacency of A+A', without the diagonal and duplicates.
+   for (int j = 0; j < n; ++j) {
+      for (int q = p[j]; q < p[j+1]; ++q) {
+         if (i[q] != j) {
+            adjacent[i[q]].push_back(j);
+            adjacent[j].push_back(i[q]);
+         }
+      }
+   }
+   std::set<std::pair<int,int> > queue;
+   for (int v = 0; v < n; ++v) {
+      std::sort(adjacent[v].begin(), adjacent[v].end());
+      adjacent[v].erase(std::unique(adjacent[v].begin(), adjacent[v].end()), adjacent[v].end());
+      degree[v] = adjacent[v].size();
+      members[v].push_back(v);
+      queue.insert(std::make_pair(degree[v], v));
+   }
+
+   int stamp = 0;
+   for (int k = 0; k < n; ) {
+      const int pivot = queue.begin()->second;
+      queue.erase(queue.begin());
+
+      // The new element: the variables of the absorbed elements and of
+      // the pivot's own adjacency.
+      std::vector<int>& Lp = variables[pivot];
+      ++stamp;
+      mark[pivot] = stamp;
+      for (std::size_t a = 0; a < elements[pivot].size(); ++a) {
+         const int e = elements[pivot][a];
+         if (status[e] != Element) {
+            continue;
+         }
+         for (std::size_t b = 0; b < variables[e].size(); ++b) {
+            const int v = variables[e][b];
+            if (status[v] == Variable && mark[v] != stamp) {
+               mark[v] = stamp;
+               Lp.push_back(v);
+            }
+         }
+         status[e] = Dead;
+         std::vector<int>().swap(variables[e]);
+      }
+      for (std::size_t a = 0; a < adjacent[pivot].size(); ++a) {
+         const int v = adjacent[pivot][a];
+         if (status[v] == Variable && mark[v] != stamp) {
+            mark[v] = stamp;
+            Lp.push_back(v);
+         }
+      }
+      status[pivot] = Element;
+      std::vector<int>().swap(adjacent[pivot]);
+      std::vector<int>().swap(elements[pivot]);
+      k += nv[pivot];
+      perm.insert(perm.end(), members[pivot].begin(), members[pivot].end());
+      std::vector<int>().swap(members[pivot]);
+      esize[pivot] = 0;
+      for (std::size_t a = 0; a < Lp.size(); ++a) {
+         esize[pivot] += nv[Lp[a]];
+         queue.erase(std::make_pair(degree[Lp[a]], Lp[a]));
+      }
+
+      // |Le \ Lp| of the other elements of the variables of Lp; the
+      // elements it leaves empty are absorbed into the pivot.
+      std::vector<int> touched;
+      for (std::size_t a = 0; a < Lp.size(); ++a) {
+         const int v = Lp[a];
+         for (std::size_t b = 0; b < elements[v].size(); ++b) {
+            const int e = elements[v][b];
+            if (status[e] != Element) {
+               continue;
+            }
+            if (wext[e] < 0) {
+               wext[e] = esize[e];
+               touched.push_back(e);
+            }
+            wext[e] -= nv[v];
+         }
+      }
+      for (std::size_t a = 0; a < touched.size(); ++a) {
+         if (wext[touched[a]] == 0) {
+            status[touched[a]] = Dead;
+            std::vector<int>().swap(variables[touched[a]]);
+         }
+      }
+
+      // Prune the lists of the variables of Lp: the pivot covers the
+      // variables of Lp and the absorbed elements.
+      for (std::size_t a = 0; a < Lp.size(); ++a) {
+         const int v = Lp[a];
+         std::vector<int>& E = elements[v];
+         std::size_t ne = 0;
+         for (std::size_t b = 0; b < E.size(); ++b) {
+            if (status[E[b]] == Element) {
+               E[ne++] = E[b];
+            }
+         }
+         E.resize(ne);
+         E.push_back(pivot);
+         std::vector<int>& A = adjacent[v];
+         std::size_t na = 0;
+         for (std::size_t b = 0; b < A.size(); ++b) {
+            if (status[A[b]] == Variable && mark[A[b]] != stamp) {
+               A[na++] = A[b];
+            }
+         }
+         A.resize(na);
+      }
+
+      // Supervariables: variables of Lp with the same lists, found by hash.
+      std::vector<std::pair<long,int> > hashes;
+      for (std::size_t a = 0; a < Lp.size(); ++a) {
+         const int v = Lp[a];
+         long h = 0;
+         for (std::size_t b = 0; b < adjacent[v].size(); ++b) {
+            h += adjacent[v][b];
+         }
+         for (std::size_t b = 0; b < elements[v].size(); ++b) {
+            h += elements[v][b];
+         }
+         hashes.push_back(std::make_pair(h, v));
+      }
+      std::sort(hashes.begin(), hashes.end());
+      for (std::size_t a = 0; a < hashes.size(); ) {
+         std::size_t end = a;
+         while (end < hashes.size() && hashes[end].first == hashes[a].first) {
+            ++end;
+         }
+         for (std::size_t b = a; b < end; ++b) {
+            const int v = hashes[b].second;
+            if (status[v] != Variable || end-a == 1) {
+               continue;
+            }
+            std::sort(adjacent[v].begin(), adjacent[v].end());
+            std::sort(elements[v].begin(), elements[v].end());
+            for (std::size_t c = b+1; c < end; ++c) {
+               const int w = hashes[c].second;
+               if (status[w] != Variable) {
+                  continue;
+               }
+               std::sort(adjacent[w].begin(), adjacent[w].end());
+               std::sort(elements[w].begin(), elements[w].end());
+               if (adjacent[v] == adjacent[w] && elements[v] == elements[w]) {
+                  nv[v] += nv[w];
+                  nv[w] = 0;
+                  status[w] = Dead;
+                  members[v].insert(members[v].end(), members[w].begin(), members[w].end());
+                  std::vector<int>().swap(members[w]);
+                  std::vector<int>().swap(adjacent[w]);
+                  std::vector<int>().swap(elements[w]);
+               }
+            }
+         }
+         a = end;
+      }
+      std::size_t nl = 0;
+      for (std::size_t a = 0; a < Lp.size(); ++a) {
+         if (status[Lp[a]] == Variable) {
+            Lp[nl++] = Lp[a];
+         }
+      }
+      Lp.resize(nl);
+
+      // Approximate external degrees, bounded by the previous degree plus
+      // the new element and by the number of remaining variables.
+      for (std::size_t a = 0; a < Lp.size(); ++a) {
+         const int v = Lp[a];
+         long d = esize[pivot] - nv[v];
+         for (std::size_t b = 0; b < adjacent[v].size(); ++b) {
+            d += nv[adjacent[v][b]];
+         }
+         for (std::size_t b = 0; b < elements[v].size(); ++b) {
+            const int e = elements[v][b];
+            if (e != pivot) {
+               d += wext[e];
+            }
+         }
+         d = std::min(d, (long) degree[v] + esize[pivot] - nv[v]);
+         d = std::min(d, (long) n - k - nv[v]);
+         degree[v] = std::max(d, 0L);
+         queue.insert(std::make_pair(degree[v], v));
+      }
+      for (std::size_t a = 0; a < touched.size(); ++a) {
+         wext[touched[a]] = -1;
+      }
+   }
+   return perm;
+}
+
+/** Inverse of a permutation.
+@param perm  Permutation of 0..n-1.
+@return      pinv with pinv[perm[k]] = k.
+*/
+
+inline std::vector<int> inverse (const std::vector<int>& perm) {
+   std::vector<int> pinv(perm.size());
+   for (std::size_t k = 0; k < perm.size(); ++k) {
+      pinv[perm[k]] = k;
+   }
+   return pinv;
+}
+
+}}}}
+#endif
@@ -0,0 +1,262 @@
+   /** Tiled matrix in a file.
+   <P>
+   A TiledMatrix keeps an m-by-n matrix in a local file as square tiles of
+   b-by-b elements (smaller in the last tile row and column), for the
+   out-of-core decompositions of matrices larger than the memory.  Each
+   tile is stored column major in a slot of b*b elements, the slots being
+   ordered by tile columns, so that a tile is one contiguous read or write:
+<pre>
+   TiledMatrix<double> A("/scratch/A.tiles", n, n, TiledMatrix<double>::tileSize(n, budget));
+   for (int J = 0; J < A.tileCols(); ++J)
+      for (int I = 0; I < A.tileRows(); ++I)
+         A.setTile(I, J, tile(I,J));      // rows(I)-by-cols(J) matrix
+   OutOfCoreLUDecomposition<double> LU(A);
+</pre>
+   The tiles are read and written through a mutex, so that a tile can be
+   prefetched by another thread while the current one is used (stream()).
+   The file is created (or truncated) by the constructor and left in
+   place by the destructor.
+   */
+
+#ifndef _BOOST_UBLAS_TILEDMATRIX_
+#define _BOOST_UBLAS_TILEDMATRIX_
+
+#include <algorithm>
+#include <fstream>
+#include <future>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include <boost/noncopyable.hpp>
+#include <boost/numeric/ublas/matrix.hpp>
+#include <boost/numeric/ublas/exception.hpp>
+
+namespace boost { namespace numeric { namespace ublas {
+
+// T: type
+template<class T>
+class TiledMatrix : private boost::noncopyable {
+public:
+   typedef matrix<T,column_major> Tile;
+   typedef std::pair<int,int> TileIndex;
+
+private:
+/* ------------------------
+   Class variables
+ * ------------------------ */
+
+   /** Backing file, and the mutex serializing its accesses.
+   */
+   std::fstream file;
+   std::mutex io;
+
+   /** Dimensions, tile size and numbers of tile rows and columns.
+   */
+   int m, n, b, mt, nt;
+
+   /** Bytes read and written since the creation.
+   */
+   double bytesIn, bytesOut;
+
+   std::streamoff offset (int I, int J) const {
+      return (std::streamoff(J)*mt + I)*b*b*std::streamoff(sizeof(T));
+   }
+
+public:
+/* ------------------------
+   Constructor
+ * ------------------------ */
+
+   /** Create the file of an m-by-n matrix, with unspecified elements.
+   @param path  File name.
+   @param m     Number of rows.
+   @param n     Number of columns.
+   @param b     Tile size.
+   @exception   external_logic  The file cannot be created.
+   */
+
+   TiledMatrix (const std::string& path, int m, int n, int b)
+   : m(m), n(n), b(std::max(b,1)), bytesIn(0), bytesOut(0) {
+      mt = (m + this->b - 1)/this->b;
+      nt = (n + this->b - 1)/this->b;
+      file.open(path.c_str(), std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+      if (!file) {
+         external_logic("TiledMatrix: cannot create file").raise();
+      }
+   }
+
+   /** Largest tile size whose panel (n rows of b columns) and four tiles
+       fit in a memory budget, the working set of the out-of-core
+       decompositions of an n-by-n matrix: the panel, the block Y of the
+       updates, the current and the prefetched tiles of stream(), and the
+       tile written back.
+   @param n       Matrix dimension.
+   @param budget  Memory budget in bytes.
+   @return        Tile size, between 1 and n.
+   */
+
+   static int tileSize (int n, double budget) {
+      const double s = sizeof(T);
+      int t = 1;
+      while (t < n && (n + 4.0*(2*t))*(2*t)*s <= budget) {
+         t *= 2;
+      }
+      for (int step = t/2; step > 0; step /= 2) {
+         if (t+step <= n && (n + 4.0*(t+step))*(t+step)*s <= budget) {
+            t += step;
+         }
+      }
+      return std::min(t, std::max(n,1));
+   }
+
+/* ------------------------
+   Public Methods
+ * ------------------------ */
+
+   int size1 () const { return m; }
+   int size2 () const { return n; }
+
+   /** Tile size b.
+   */
+
+   int tileSize () const { return b; }
+
+   /** Numbers of tile rows and tile columns.
+   */
+
+   int tileRows () const { return mt; }
+   int tileCols () const { return nt; }
+
+   /** Number of rows of the tiles of tile row I.
+   */
+
+   int rows (int I) const { return std::min(b, m - I*b); }
+
+   /** Number of columns of the tiles of tile column J.
+   */
+
+   int cols (int J) const { return std::min(b, n - J*b); }
+
+   /** Read a tile.
+   @param I, J  Tile row and column.
+   @param t     Resized to rows(I)-by-cols(J).
+   @exception   external_logic  Read error, or a tile never written.
+   */
+
+   void getTile (int I, int J, Tile& t) {
+      BOOST_UBLAS_CHECK(I >= 0 && I < mt && J >= 0 && J < nt, bad_index());
+      t.resize(rows(I), cols(J), false);
+      std::lock_guard<std::mutex> lock(io);
+      file.seekg(offset(I,J));
+      file.read(reinterpret_cast<char*>(t.data().begin()), t.data().size()*sizeof(T));
+      if (!file) {
+         file.clear();
+         external_logic("TiledMatrix: read failed").raise();
+      }
+      bytesIn += t.data().size()*sizeof(T);
+   }
+
+   /** Write a tile.  The file buffer is not flushed: the tile reaches the
+       file at the next read or flush().
+   @param I, J  Tile row and column.
+   @param t     rows(I)-by-cols(J) matrix.
+   @exception   bad_size  Tile dimensions must agree.
+   @exception   external_logic  Write error.
+   */
+
+   void setTile (int I, int J, const Tile& t) {
+      BOOST_UBLAS_CHECK(I >= 0 && I < mt && J >= 0 && J < nt, bad_index());
+      BOOST_UBLAS_CHECK((int) t.size1() == rows(I) && (int) t.size2() == cols(J), bad_size("Tile dimensions must agree."));
+      std::lock_guard<std::mutex> lock(io);
+      file.seekp(offset(I,J));
+      file.write(reinterpret_cast<const char*>(t.data().begin()), t.data().size()*sizeof(T));
+      if (!file) {
+         file.clear();
+         external_logic("TiledMatrix: write failed").raise();
+      }
+      bytesOut += t.data().size()*sizeof(T);
+   }
+
+   /** Flush the tiles written since the last flush to the file, at the
+       end of a panel or of assign().
+   @exception   external_logic  Write error.
+   */
+
+   void flush () {
+      std::lock_guard<std::mutex> lock(io);
+      file.flush();
+      if (!file) {
+         file.clear();
+         external_logic("TiledMatrix: write failed").raise();
+      }
+   }
+
+   /** Call f(I,J,tile) for each tile of a list, in order, reading the next
+       tile in another thread while f runs, so that the file and the
+       processor work at the same time.  Two tiles are held in memory.
+   @param tiles  Tile indices.
+   @param f      Function of (int I, int J, Tile& t); t may be modified.
+   */
+
+   template<class Function>
+   void stream (const std::vector<TileIndex>& tiles, Function f) {
+      if (tiles.empty()) {
+         return;
+      }
+      Tile buffer[2];
+      std::future<void> next = std::async(std::launch::deferred, &TiledMatrix::getTile, this,
+                                          tiles[0].first, tiles[0].second, std::ref(buffer[0]));
+      for (std::size_t k = 0; k < tiles.size(); ++k) {
+         next.get();
+         if (k+1 < tiles.size()) {
+            next = std::async(std::launch::async, &TiledMatrix::getTile, this,
+                              tiles[k+1].first, tiles[k+1].second, std::ref(buffer[(k+1)%2]));
+         }
+         try {
+            f(tiles[k].first, tiles[k].second, buffer[k%2]);
+         } catch (...) {
+            if (next.valid()) {
+               next.wait();
+            }
+            throw;
+         }
+      }
+   }
+
+   /** Copy an in-memory matrix to the tiles.
+   @param A    m-by-n matrix.
+   @exception  bad_size  Matrix dimensions must agree.
+   */
+
+   template<class M>
+   void assign (const M& A) {
+      BOOST_UBLAS_CHECK((int) A.size1() == m && (int) A.size2() == n, bad_size("Matrix dimensions must agree."));
+      Tile t;
+      for (int J = 0; J < nt; ++J) {
+         for (int I = 0; I < mt; ++I) {
+            t.resize(rows(I), cols(J), false);
+            for (int j = 0; j < cols(J); ++j) {
+               for (int i = 0; i < rows(I); ++i) {
+                  t(i,j) = A(I*b+i, J*b+j);
+               }
+            }
+            setTile(I, J, t);
+         }
+      }
+      flush();
+   }
+
+   /** Bytes read from the file since its creation.
+   */
+
+   double bytesRead () const { return bytesIn; }
+
+   /** Bytes written to the file since its creation.
+   */
+
+   double bytesWritten () const { return bytesOut; }
+};
+
+}}}
+#endif
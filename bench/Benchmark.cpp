@@ -0,0 +1,852 @@
+/** Benchmark of the decompositions.
+<P>
+Times LU, QR, Cholesky, symmetric and nonsymmetric Eigen, and SVD (full,
+thin and values-only) over square, tall (m = 2n) and wide (n = 2m) matrices
+whose larger dimension goes from 4 to 4096, in float and double (the
+"macro" suite), and the SIMD kernels for each instruction set supported by
+the CPU (the "micro" suite).  Run it with
+<BLOCKQUOTE><PRE><CODE>
+ make bench
+ ./Benchmark --suite macro --types double --max-size 512 --output bench.json
+</CODE></PRE></BLOCKQUOTE>
+Options:
+<pre>
+   --suite macro|micro|all    benchmarks to run (all)
+   --types float,double       scalar types (float,double)
+   --filter S1,S2,...         only the benchmarks whose name contains one of S1, S2...
+   --min-size N, --max-size N range of the larger matrix dimension (4, 4096)
+   --min-time S               minimum measuring time per benchmark (0.2 s)
+   --max-time S               stop sampling a benchmark after S seconds (20 s)
+   --min-samples N            minimum number of samples per benchmark (5)
+   --runs N                   run the benchmarks N times (1)
+   --output FILE              JSON output (standard output)
+   --check BASELINE           compare with a previous output (see below)
+   --threshold R              tolerated slowdown in --check mode (0.10)
+   --mad-factor K             noise allowance in --check mode (4)
+   --retries N                remeasurements of a suspect benchmark (2)
+</pre>
+Each benchmark is warmed up by one call, then timed in samples of enough
+calls to last about a millisecond.  The JSON output gives, per benchmark,
+the median, minimum and median absolute deviation of the time per call,
+all the samples, the median of each run when the benchmarks are run
+several times (the statistics are then those of the runs, which also
+capture the noise between runs), the GFLOP/s of the median time based on the nominal
+(LAPACK-style) flop count of the algorithm, and the number of heap
+allocations and bytes allocated per call.  Decompositions are timed with
+compute() on an existing object, so that the allocations are those of
+the steady state.
+<P>
+In --check mode (make perfcheck) only the benchmarks of the baseline file
+are run (those matching --filter, if given, and only these are reported
+missing when the options exclude them), and a benchmark has regressed when its best run (the smallest
+median of the runs, as the noise of a machine only ever slows a run
+down) exceeds the best run of the baseline by more than the threshold
+and by more than K times the combined noise, sqrt(mad^2 + mad_baseline^2)
+* 1.4826 (the MAD of the run medians scaled to a standard deviation).
+Both the baseline and the check should therefore use several runs.
+Suspects are measured again up to --retries times, adding to their runs,
+before being reported; the exit status is 1 if any benchmark has
+regressed.
+<P>
+Build with NDEBUG=-DNDEBUG (see the Makefile) to time the code without
+the ublas debug checks; the baselines of make perfcheck are recorded so.
+**/
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <new>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <boost/random/normal_distribution.hpp>
+#include <boost/random/lagged_fibonacci.hpp>
+#include "QRDecomposition.hpp"
+#include "LUDecomposition.hpp"
+#include "SingularValueDecomposition.hpp"
+#include "CholeskyDecomposition.hpp"
+#include "EigenvalueDecomposition.hpp"
+#include "SimdKernels.hpp"
+
+using namespace boost::numeric::ublas;
+
+/* ------------------------
+   Allocation counting
+ * ------------------------ */
+
+// gcc 11+ sees the free() of the replaced operator delete as mismatched
+// with the operator new of the new-expressions it inlines into.
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+static std::size_t allocations = 0;
+static std::size_t allocatedBytes = 0;
+
+void* operator new (std::size_t bytes) {
+   ++allocations;
+   allocatedBytes += bytes;
+   void* p = std::malloc(bytes ? bytes : 1);
+   if (p == 0) {
+      throw std::bad_alloc();
+   }
+   return p;
+}
+
+void* operator new[] (std::size_t bytes) {
+   return operator new(bytes);
+}
+
+void operator delete (void* p) throw() {
+   std::free(p);
+}
+
+void operator delete[] (void* p) throw() {
+   std::free(p);
+}
+
+void operator delete (void* p, std::size_t) throw() {
+   std::free(p);
+}
+
+void operator delete[] (void* p, std::size_t) throw() {
+   std::free(p);
+}
+
+/* ------------------------
+   Options
+ * ------------------------ */
+
+struct Options {
+   bool macro, micro;
+   bool useFloat, useDouble;
+   std::string filter;
+   int minSize, maxSize;
+   double minTime, maxTime;
+   int minSamples;
+   int runs;
+   std::string output;
+   std::string baseline;
+   double threshold, madFactor;
+   int retries;
+
+   // If not empty, the only benchmarks to run.
+   std::set<std::string> only;
+
+   Options ()
+   : macro(true), micro(true), useFloat(true), useDouble(true),
+     minSize(4), maxSize(4096), minTime(0.2), maxTime(20.0), minSamples(5), runs(1), output("-"),
+     threshold(0.10), madFactor(4.0), retries(2) {}
+};
+
+static void usage () {
+   std::cerr << "usage: Benchmark [--suite macro|micro|all] [--types float,double] [--filter STRING]\n"
+                "                 [--min-size N] [--max-size N] [--min-time S] [--max-time S]\n"
+                "                 [--min-samples N] [--runs N] [--output FILE]\n"
+                "                 [--check BASELINE] [--threshold R] [--mad-factor K] [--retries N]\n";
+   std::exit(2);
+}
+
+static Options parseOptions (int argc, char* argv[]) {
+   Options o;
+   for (int i = 1; i < argc; ++i) {
+      std::string arg = argv[i];
+      if (i+1 >= argc) {
+         usage();
+      }
+      std::string val = argv[++i];
+      if (arg == "--suite") {
+         o.macro = (val == "macro" || val == "all");
+         o.micro = (val == "micro" || val == "all");
+      } else if (arg == "--types") {
+         o.useFloat = val.find("float") != std::string::npos;
+         o.useDouble = val.find("double") != std::string::npos;
+      } else if (arg == "--filter") {
+         o.filter = val;
+      } else if (arg == "--min-size") {
+         o.minSize = std::atoi(val.c_str());
+      } else if (arg == "--max-size") {
+         o.maxSize = std::atoi(val.c_str());
+      } else if (arg == "--min-time") {
+         o.minTime = std::atof(val.c_str());
+      } else if (arg == "--max-time") {
+         o.maxTime = std::atof(val.c_str());
+      } else if (arg == "--min-samples") {
+         o.minSamples = std::atoi(val.c_str());
+      } else if (arg == "--runs") {
+         o.runs = std::max(1, std::atoi(val.c_str()));
+      } else if (arg == "--output") {
+         o.output = val;
+      } else if (arg == "--check") {
+         o.baseline = val;
+      } else if (arg == "--threshold") {
+         o.threshold = std::atof(val.c_str());
+      } else if (arg == "--mad-factor") {
+         o.madFactor = std::atof(val.c_str());
+      } else if (arg == "--retries") {
+         o.retries = std::atoi(val.c_str());
+      } else {
+         usage();
+      }
+   }
+   return o;
+}
+
+/* ------------------------
+   Measurement
+ * ------------------------ */
+
+struct Result {
+   std::string name, suite, benchmark, type, shape, isa;
+   int m, n;
+   double flops;
+   long calls;
+   std::vector<double> samples;
+
+   // Median time per call of each run.
+   std::vector<double> runs;
+   double allocationsPerCall, bytesPerCall;
+};
+
+static double now () {
+   return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static double median (std::vector<double> v) {
+   std::sort(v.begin(), v.end());
+   std::size_t k = v.size();
+   return k == 0 ? 0.0 : (k % 2 ? v[k/2] : (v[k/2-1] + v[k/2])/2);
+}
+
+static double mad (const std::vector<double>& v) {
+   double med = median(v);
+   std::vector<double> dev(v.size());
+   for (std::size_t i = 0; i < v.size(); ++i) {
+      dev[i] = std::abs(v[i] - med);
+   }
+   return median(dev);
+}
+
+/** Times from which the statistics of a result are computed.
+*/
+
+static const std::vector<double>& times (const Result& r) {
+   return r.runs.size() > 1 ? r.runs : r.samples;
+}
+
+/** Time calls of a benchmark functor, already warmed up by its constructor.
+*/
+
+template<class B>
+static void measure (B& bench, const Options& o, Result& r) {
+   // Samples of about a millisecond, from the time of one call.
+   double t0 = now();
+   bench();
+   double t1 = now() - t0;
+   long batch = std::max(1L, std::min(1L << 20, (long) (1e-3 / std::max(t1, 1e-9))));
+
+   std::size_t allocs = 0, bytes = 0;
+   r.calls = 0;
+   r.samples.clear();
+   double start = now();
+   for (;;) {
+      std::size_t allocs0 = allocations, bytes0 = allocatedBytes;
+      double ts = now();
+      for (long i = 0; i < batch; ++i) {
+         bench();
+      }
+      double te = now();
+      allocs += allocations - allocs0;
+      bytes += allocatedBytes - bytes0;
+      r.samples.push_back((te - ts)/batch);
+      r.calls += batch;
+      double elapsed = te - start;
+      if ((elapsed >= o.minTime && (int) r.samples.size() >= o.minSamples) || elapsed >= o.maxTime) {
+         break;
+      }
+   }
+   r.runs.assign(1, median(r.samples));
+   r.allocationsPerCall = double(allocs)/r.calls;
+   r.bytesPerCall = double(bytes)/r.calls;
+}
+
+/* ------------------------
+   Decomposition benchmarks
+ * ------------------------ */
+
+template<class T> struct LUBench {
+   matrix<T> A;
+   LUDecomposition<T> d;
+   LUBench (const matrix<T>& A) : A(A), d(A) {}
+   void operator() () { d.compute(A); }
+};
+
+template<class T> struct QRBench {
+   matrix<T> A;
+   QRDecomposition<T> d;
+   QRBench (const matrix<T>& A) : A(A), d(A) {}
+   void operator() () { d.compute(A); }
+};
+
+template<class T> struct CholeskyBench {
+   matrix<T> A;
+   CholeskyDecomposition<T> d;
+   CholeskyBench (const matrix<T>& A) : A(A), d(A) {}
+   void operator() () { d.compute(A); }
+};
+
+template<class T> struct EigenBench {
+   matrix<T> A;
+   EigenvalueDecomposition<T> d;
+   EigenBench (const matrix<T>& A) : A(A), d(A) {}
+   void operator() () { d.compute(A); }
+};
+
+template<class T> struct SVDBench {
+   matrix<T> A;
+   bool thin, wantu, wantv;
+   SingularValueDecomposition<T> d;
+   SVDBench (const matrix<T>& A, bool thin, bool wantu, bool wantv)
+   : A(A), thin(thin), wantu(wantu), wantv(wantv), d(A, thin, wantu, wantv) {}
+   void operator() () { d.compute(A, thin, wantu, wantv); }
+};
+
+/** Nominal flop counts, as in LAPACK's and Golub and Van Loan's tables.
+*/
+
+static double luFlops (double m, double n) {
+   double k = std::min(m,n);
+   return 2*(m*n*k - (m+n)*k*k/2 + k*k*k/3);
+}
+
+static double svdFlops (double m, double n, bool thin, bool vectors) {
+   double mm = std::max(m,n), nn = std::min(m,n);
+   if (!vectors) {
+      return 4*mm*nn*nn - 4*nn*nn*nn/3;
+   }
+   if (thin) {
+      return 14*mm*nn*nn + 8*nn*nn*nn;
+   }
+   return 4*mm*mm*nn + 8*mm*nn*nn + 9*nn*nn*nn;
+}
+
+static std::vector<Result> results;
+
+static bool wanted (const Options& o, const std::string& name) {
+   bool match = o.filter.empty();
+   for (std::size_t b = 0; !match && b <= o.filter.size(); ) {
+      std::size_t e = std::min(o.filter.find(',', b), o.filter.size());
+      match = e > b && name.find(o.filter.substr(b, e-b)) != std::string::npos;
+      b = e+1;
+   }
+   return match && (o.only.empty() || o.only.count(name) != 0);
+}
+
+template<class B>
+static void run (const Options& o, B& bench, const std::string& benchmark, const std::string& type,
+                 const std::string& shape, int m, int n, double flops) {
+   Result r;
+   std::ostringstream name;
+   name << benchmark << "/" << type << "/" << shape << "/" << m << "x" << n;
+   r.name = name.str();
+   r.suite = "macro";
+   r.benchmark = benchmark;
+   r.type = type;
+   r.shape = shape;
+   r.isa = kernels::isaName(kernels::isa());
+   r.m = m;
+   r.n = n;
+   r.flops = flops;
+   std::cerr << r.name << std::flush;
+   measure(bench, o, r);
+   std::cerr << "  " << median(r.samples) << " s\n";
+   results.push_back(r);
+}
+
+template<class T>
+static void macroSuite (const Options& o, const std::string& type) {
+   boost::normal_distribution<double> dist(0.0, 1.0);
+   boost::lagged_fibonacci19937 engine;
+   const char* shapes[] = { "square", "tall", "wide" };
+   for (int size = 4; size <= o.maxSize; size *= 2) {
+      if (size < o.minSize) {
+         continue;
+      }
+      for (int sh = 0; sh < 3; ++sh) {
+         std::string shape = shapes[sh];
+         int m = (sh == 2) ? size/2 : size;
+         int n = (sh == 1) ? size/2 : size;
+         matrix<T> A(m,n);
+         for (int i = 0; i < m; ++i) {
+            for (int j = 0; j < n; ++j) {
+               A(i,j) = (T) dist(engine);
+            }
+         }
+         std::string dims;
+         {
+            std::ostringstream d;
+            d << "/" << type << "/" << shape << "/" << m << "x" << n;
+            dims = d.str();
+         }
+
+         if (wanted(o, "LU" + dims)) {
+            LUBench<T> b(A);
+            run(o, b, "LU", type, shape, m, n, luFlops(m,n));
+         }
+         if (m >= n && wanted(o, "QR" + dims)) {
+            QRBench<T> b(A);
+            run(o, b, "QR", type, shape, m, n, 2.0*m*n*n - 2.0*n*n*n/3);
+         }
+         if (sh == 0) {
+            // Symmetric, and positive definite by diagonal dominance.
+            matrix<T> S(n,n);
+            for (int i = 0; i < n; ++i) {
+               for (int j = 0; j <= i; ++j) {
+                  S(i,j) = S(j,i) = A(i,j) + A(j,i);
+               }
+               S(i,i) = 4*n;
+            }
+            if (wanted(o, "Cholesky" + dims)) {
+               CholeskyBench<T> b(S);
+               run(o, b, "Cholesky", type, shape, m, n, 1.0*n*n*n/3);
+            }
+            if (wanted(o, "SymmetricEigen" + dims)) {
+               EigenBench<T> b(S);
+               run(o, b, "SymmetricEigen", type, shape, m, n, 9.0*n*n*n);
+            }
+            if (wanted(o, "Eigen" + dims)) {
+               EigenBench<T> b(A);
+               run(o, b, "Eigen", type, shape, m, n, 25.0*n*n*n);
+            }
+         }
+         if (wanted(o, "SVD" + dims)) {
+            SVDBench<T> b(A, false, true, true);
+            run(o, b, "SVD", type, shape, m, n, svdFlops(m,n,false,true));
+         }
+         if (wanted(o, "SVDThin" + dims)) {
+            SVDBench<T> b(A, true, true, true);
+            run(o, b, "SVDThin", type, shape, m, n, svdFlops(m,n,true,true));
+         }
+         if (wanted(o, "SVDValues" + dims)) {
+            SVDBench<T> b(A, true, false, false);
+            run(o, b, "SVDValues", type, shape, m, n, svdFlops(m,n,true,false));
+         }
+      }
+   }
+}
+
+/* ------------------------
+   Kernel benchmarks
+ * ------------------------ */
+
+template<class T> struct DotBench {
+   std::vector<T> x, y;
+   T sink;
+   DotBench (int n) : x(n, T(1)), y(n, T(0.5)), sink(0) {}
+   void operator() () { sink += kernels::dot((int) x.size(), &x[0], 1, &y[0], 1); }
+};
+
+template<class T> struct AxpyBench {
+   std::vector<T> x, y;
+   AxpyBench (int n) : x(n, T(1)), y(n, T(0.5)) {}
+   void operator() () { kernels::axpy((int) x.size(), T(1e-3), &x[0], 1, &y[0], 1); }
+};
+
+template<class T> struct RotBench {
+   std::vector<T> x, y;
+   RotBench (int n) : x(n, T(1)), y(n, T(0.5)) {}
+   void operator() () { kernels::rot((int) x.size(), &x[0], 1, &y[0], 1, T(0.6), T(0.8)); }
+};
+
+template<class T> struct Refl3Bench {
+   std::vector<T> u, v, w;
+   Refl3Bench (int n) : u(n, T(1)), v(n, T(0.5)), w(n, T(0.25)) {}
+   void operator() () {
+      kernels::refl3((int) u.size(), &u[0], &v[0], &w[0], 1, T(0.1), T(0.2), T(0.3), T(1), T(0.4), T(0.5));
+   }
+};
+
+template<class B>
+static void runKernel (const Options& o, const std::string& benchmark, const std::string& type,
+                       int n, double flopsPerElement) {
+   std::ostringstream name;
+   name << "kernel:" << benchmark << "/" << type << "/" << kernels::isaName(kernels::isa()) << "/" << n;
+   if (!wanted(o, name.str())) {
+      return;
+   }
+   Result r;
+   r.name = name.str();
+   r.suite = "micro";
+   r.benchmark = benchmark;
+   r.type = type;
+   r.shape = "vector";
+   r.isa = kernels::isaName(kernels::isa());
+   r.m = 1;
+   r.n = n;
+   r.flops = flopsPerElement*n;
+   std::cerr << r.name << std::flush;
+   B bench(n);
+   bench();
+   measure(bench, o, r);
+   std::cerr << "  " << median(r.samples) << " s\n";
+   results.push_back(r);
+}
+
+template<class T>
+static void microSuite (const Options& o, const std::string& type) {
+   kernels::Isa saved = kernels::isa();
+   for (int i = kernels::Scalar; i <= kernels::supportedIsa(); ++i) {
+      if (!kernels::select(kernels::Isa(i))) {
+         continue;
+      }
+      for (int n = 16; n <= (1 << 20); n *= 16) {
+         runKernel<DotBench<T> >(o, "dot", type, n, 2);
+         runKernel<AxpyBench<T> >(o, "axpy", type, n, 2);
+         runKernel<RotBench<T> >(o, "rot", type, n, 6);
+         runKernel<Refl3Bench<T> >(o, "refl3", type, n, 11);
+      }
+   }
+   kernels::select(saved);
+}
+
+/* ------------------------
+   JSON output
+ * ------------------------ */
+
+static void writeJson (std::ostream& out) {
+   char date[32];
+   std::time_t t = std::time(0);
+   std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&t));
+   out.precision(9);
+   out << "{\n";
+   out << "  \"format\": \"ublasJama-bench\",\n";
+   out << "  \"version\": 1,\n";
+   out << "  \"context\": {\n";
+   out << "    \"date\": \"" << date << "\",\n";
+#ifdef __VERSION__
+   out << "    \"compiler\": \"" << __VERSION__ << "\",\n";
+#endif
+#ifdef NDEBUG
+   out << "    \"ndebug\": true,\n";
+#else
+   out << "    \"ndebug\": false,\n";
+#endif
+   out << "    \"isa\": \"" << kernels::isaName(kernels::isa()) << "\"\n";
+   out << "  },\n";
+   out << "  \"results\": [";
+   for (std::size_t i = 0; i < results.size(); ++i) {
+      const Result& r = results[i];
+      double med = median(times(r));
+      out << (i ? ",\n" : "\n");
+      out << "    {\"name\": \"" << r.name << "\", \"suite\": \"" << r.suite
+          << "\", \"benchmark\": \"" << r.benchmark << "\", \"type\": \"" << r.type
+          << "\", \"shape\": \"" << r.shape << "\", \"isa\": \"" << r.isa
+          << "\", \"m\": " << r.m << ", \"n\": " << r.n
+          << ", \"calls\": " << r.calls
+          << ", \"time_per_call_s\": " << med
+          << ", \"min_time_per_call_s\": " << *std::min_element(r.samples.begin(), r.samples.end())
+          << ", \"mad_s\": " << mad(times(r))
+          << ", \"gflops\": " << (med > 0 ? r.flops/med*1e-9 : 0.0)
+          << ", \"allocations_per_call\": " << r.allocationsPerCall
+          << ", \"bytes_per_call\": " << r.bytesPerCall
+          << ", \"samples_s\": [";
+      for (std::size_t k = 0; k < r.samples.size(); ++k) {
+         out << (k ? ", " : "") << r.samples[k];
+      }
+      out << "], \"runs_s\": [";
+      for (std::size_t k = 0; k < r.runs.size(); ++k) {
+         out << (k ? ", " : "") << r.runs[k];
+      }
+      out << "]}";
+   }
+   out << "\n  ]\n}\n";
+}
+
+/* ------------------------
+   Baseline comparison
+ * ------------------------ */
+
+/** Minimal reader of the JSON written above: returns the times of each
+    result by name (the medians of the runs if there were several runs,
+    otherwise the samples).
+*/
+
+class BaselineReader {
+   std::string text;
+   std::size_t pos;
+
+   void fail () {
+      throw std::runtime_error("malformed baseline file");
+   }
+   void skipSpace () {
+      while (pos < text.size() && std::isspace((unsigned char) text[pos])) {
+         ++pos;
+      }
+   }
+   bool accept (char c) {
+      skipSpace();
+      if (pos < text.size() && text[pos] == c) {
+         ++pos;
+         return true;
+      }
+      return false;
+   }
+   void expect (char c) {
+      if (!accept(c)) {
+         fail();
+      }
+   }
+   std::string parseString () {
+      expect('"');
+      std::string s;
+      while (pos < text.size() && text[pos] != '"') {
+         if (text[pos] == '\\') {
+            ++pos;
+         }
+         s += text[pos++];
+      }
+      expect('"');
+      return s;
+   }
+   double parseNumber () {
+      skipSpace();
+      const char* begin = text.c_str() + pos;
+      char* end;
+      double x = std::strtod(begin, &end);
+      if (end == begin) {
+         fail();
+      }
+      pos += end - begin;
+      return x;
+   }
+
+   // Parse any value; the samples and name of result objects are collected.
+   void parseValue (std::map<std::string, std::vector<double> >& out) {
+      skipSpace();
+      if (pos >= text.size()) {
+         fail();
+      }
+      char c = text[pos];
+      if (c == '{') {
+         ++pos;
+         std::string name;
+         std::vector<double> samples, runs;
+         bool isResult = false;
+         if (!accept('}')) {
+            do {
+               std::string key = parseString();
+               expect(':');
+               skipSpace();
+               if (key == "name" && text[pos] == '"') {
+                  name = parseString();
+               } else if (key == "samples_s" || key == "runs_s") {
+                  isResult = true;
+                  std::vector<double>& v = (key == "runs_s") ? runs : samples;
+                  expect('[');
+                  if (!accept(']')) {
+                     do {
+                        v.push_back(parseNumber());
+                     } while (accept(','));
+                     expect(']');
+                  }
+               } else {
+                  parseValue(out);
+               }
+            } while (accept(','));
+            expect('}');
+         }
+         if (isResult) {
+            out[name] = runs.size() > 1 ? runs : samples;
+         }
+      } else if (c == '[') {
+         ++pos;
+         if (!accept(']')) {
+            do {
+               parseValue(out);
+            } while (accept(','));
+            expect(']');
+         }
+      } else if (c == '"') {
+         parseString();
+      } else if (text.compare(pos, 4, "true") == 0 || text.compare(pos, 4, "null") == 0) {
+         pos += 4;
+      } else if (text.compare(pos, 5, "false") == 0) {
+         pos += 5;
+      } else {
+         parseNumber();
+      }
+   }
+
+public:
+   std::map<std::string, std::vector<double> > read (const std::string& file) {
+      std::ifstream in(file.c_str());
+      if (!in) {
+         throw std::runtime_error("cannot read " + file);
+      }
+      std::ostringstream buf;
+      buf << in.rdbuf();
+      text = buf.str();
+      pos = 0;
+      std::map<std::string, std::vector<double> > out;
+      parseValue(out);
+      return out;
+   }
+};
+
+/** Best time: the smallest of the run medians (or samples).
+*/
+
+static double best (const std::vector<double>& v) {
+   return v.empty() ? 0 : *std::min_element(v.begin(), v.end());
+}
+
+/** Has the benchmark regressed with respect to the baseline times?
+*/
+
+static bool regressed (const Options& o, const std::vector<double>& base, const std::vector<double>& cur) {
+   if (base.empty() || cur.empty()) {
+      return false;
+   }
+   double b = best(base), c = best(cur);
+   double noise = 1.4826 * std::sqrt(mad(base)*mad(base) + mad(cur)*mad(cur));
+   return c > b * (1 + o.threshold) && c - b > o.madFactor * noise;
+}
+
+/** Run the selected suites o.runs times, merging the runs of each benchmark.
+*/
+
+static void runSuites (const Options& o) {
+   std::vector<Result> merged;
+   for (int run = 0; run < o.runs; ++run) {
+      results.clear();
+      if (o.micro) {
+         if (o.useFloat) microSuite<float>(o, "float");
+         if (o.useDouble) microSuite<double>(o, "double");
+      }
+      if (o.macro) {
+         if (o.useFloat) macroSuite<float>(o, "float");
+         if (o.useDouble) macroSuite<double>(o, "double");
+      }
+      if (run == 0) {
+         merged = results;
+         continue;
+      }
+      for (std::size_t i = 0; i < results.size() && i < merged.size(); ++i) {
+         Result& m = merged[i];
+         const Result& r = results[i];
+         long calls = m.calls + r.calls;
+         m.allocationsPerCall = (m.allocationsPerCall*m.calls + r.allocationsPerCall*r.calls)/calls;
+         m.bytesPerCall = (m.bytesPerCall*m.calls + r.bytesPerCall*r.calls)/calls;
+         m.calls = calls;
+         m.samples.insert(m.samples.end(), r.samples.begin(), r.samples.end());
+         m.runs.push_back(r.runs[0]);
+      }
+   }
+   results.swap(merged);
+}
+
+/** Run the benchmarks of the baseline and report the regressions.
+@return     number of regressions.
+*/
+
+static int check (Options o) {
+   std::map<std::string, std::vector<double> > base = BaselineReader().read(o.baseline);
+   for (std::map<std::string, std::vector<double> >::const_iterator i = base.begin(); i != base.end(); ++i) {
+      o.only.insert(i->first);
+   }
+   runSuites(o);
+
+   // Measure the suspects again, adding to their runs.
+   for (int retry = 0; retry < o.retries; ++retry) {
+      std::set<std::string> suspects;
+      for (std::size_t i = 0; i < results.size(); ++i) {
+         if (regressed(o, base[results[i].name], times(results[i]))) {
+            suspects.insert(results[i].name);
+         }
+      }
+      if (suspects.empty()) {
+         break;
+      }
+      std::cerr << "remeasuring " << suspects.size() << " suspect benchmark(s)\n";
+      std::vector<Result> previous;
+      previous.swap(results);
+      Options again = o;
+      again.only = suspects;
+      runSuites(again);
+      std::map<std::string, Result> more;
+      for (std::size_t i = 0; i < results.size(); ++i) {
+         more[results[i].name] = results[i];
+      }
+      for (std::size_t i = 0; i < previous.size(); ++i) {
+         std::map<std::string, Result>::const_iterator r = more.find(previous[i].name);
+         if (r != more.end()) {
+            previous[i].samples.insert(previous[i].samples.end(), r->second.samples.begin(), r->second.samples.end());
+            previous[i].runs.insert(previous[i].runs.end(), r->second.runs.begin(), r->second.runs.end());
+         }
+      }
+      results.swap(previous);
+   }
+
+   int regressions = 0;
+   std::cout << std::left;
+   for (std::size_t i = 0; i < results.size(); ++i) {
+      const Result& r = results[i];
+      double b = best(base[r.name]), c = best(times(r));
+      bool bad = regressed(o, base[r.name], times(r));
+      regressions += bad;
+      std::cout << (bad ? "REGRESSION " : "ok         ") << r.name
+                << "  " << b << " s -> " << c << " s  (" << (c/b - 1)*100 << "%)\n";
+   }
+   for (std::set<std::string>::const_iterator i = o.only.begin(); i != o.only.end(); ++i) {
+      if (!wanted(o, *i)) {
+         continue;
+      }
+      bool found = false;
+      for (std::size_t k = 0; k < results.size() && !found; ++k) {
+         found = results[k].name == *i;
+      }
+      if (!found) {
+         std::cout << "missing    " << *i << "\n";
+      }
+   }
+   std::cout << regressions << " regression(s) in " << results.size() << " benchmarks\n";
+   return regressions;
+}
+
+int main (int argc, char* argv[]) {
+   Options o = parseOptions(argc, argv);
+   int regressions = 0;
+   if (!o.baseline.empty()) {
+      try {
+         regressions = check(o);
+      } catch (std::exception& e) {
+         std::cerr << "Benchmark: " << e.what() << "\n";
+         return 2;
+      }
+   } else {
+      runSuites(o);
+   }
+   if (o.output == "-") {
+      if (o.baseline.empty()) {
+         writeJson(std::cout);
+      }
+   } else {
+      std::ofstream out(o.output.c_str());
+      writeJson(out);
+      if (!out) {
+         std::cerr << "Benchmark: cannot write " << o.output << "\n";
+         return 2;
+      }
+   }
+   return regressions ? 1 : 0;
+}
@@ -159,7 +159,7 @@ int main (int argc, char **argv) {
          print(c < 1/eps ? fixedWidthDoubletoString(c,12,3) :
             "         Inf");
 
-         LUDecomposition LU(M);
+         LUDecomposition<double> LU(M);
          Matrix L = LU.getL();
          Matrix U = LU.getU();
          PivotVector p = LU.getPivot();
@@ -173,7 +173,7 @@ int main (int argc, char **argv) {
          double res = norm_1(R)/(n*eps);
          print(fixedWidthDoubletoString(res,12,3));
 
-         QRDecomposition QR(M);
+         QRDecomposition<double> QR(M);
          Matrix Q = QR.getQ();
          R = QR.getR();
          R = prod(Q,R) - M;
@@ -19,9 +19,17 @@ If the test does not run to completion, this indicates that there is a
 substantial problem within the implementation that was not anticipated in the test design.  
 The stopping point should give an indication of where the problem exists.
 **/
+#include <atomic>
+#include <cstdlib>
 #include <iostream>
 #include <iomanip>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
 #include <limits>
+#include <new>
+#include <sstream>
+#include <thread>
 #include <boost/numeric/ublas/io.hpp>
 #include <boost/random/normal_distribution.hpp>
 #include <boost/random/lagged_fibonacci.hpp>
@@ -30,6 +38,22 @@ The stopping point should give an indication of where the problem exists.
 #include "SingularValueDecomposition.hpp"
 #include "CholeskyDecomposition.hpp"
 #include "EigenvalueDecomposition.hpp"
+#include "GeneralizedEigenvalueDecomposition.hpp"
+#include "MixedPrecisionLUDecomposition.hpp"
+#include "AlignedAllocator.hpp"
+#include "ArenaAllocator.hpp"
+#include "SimdKernels.hpp"
+#include "Instrumentation.hpp"
+#include "Convergence.hpp"
+#include "Parallel.hpp"
+#include "MappedStorage.hpp"
+#include "Serialization.hpp"
+#include "OutOfCoreLUDecomposition.hpp"
+#include "OutOfCoreCholeskyDecomposition.hpp"
+#include "SparseCholeskyDecomposition.hpp"
+#include "SparseLUDecomposition.hpp"
+#include "KrylovEigenSolver.hpp"
+#include "KrylovLinearSolver.hpp"
 
 using namespace boost::numeric::ublas;
 using std::cout;
@@ -94,6 +118,59 @@ static void check(const Matrix& X, const Matrix& Y) {
     }
 }
 
+/** Count the heap allocations, to check the steady state of compute(). **/
+
+// gcc 11+ sees the free() of the replaced operator delete as mismatched
+// with the operator new of the new-expressions it inlines into.
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+static std::atomic<long> allocations(0);
+
+void* operator new (std::size_t bytes) {
+    ++allocations;
+    void* p = std::malloc(bytes ? bytes : 1);
+    if (p == 0) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new[] (std::size_t bytes) {
+    return operator new(bytes);
+}
+
+void operator delete (void* p) throw() {
+    std::free(p);
+}
+
+void operator delete[] (void* p) throw() {
+    std::free(p);
+}
+
+void operator delete (void* p, std::size_t) throw() {
+    std::free(p);
+}
+
+void operator delete[] (void* p, std::size_t) throw() {
+    std::free(p);
+}
+
+/** Check that a refactorization of the same size does not allocate. **/
+
+template<class Decomposition, class M>
+static void check_noalloc(Decomposition& D, const M& A) {
+    D.compute(A);
+    long before = allocations;
+    D.compute(A);
+    if (allocations != before) {
+        std::ostringstream oss;
+        oss << "compute() allocated " << allocations - before << " times at size " << A.size1();
+        throw internal_logic(oss.str().c_str());
+    }
+}
+
 /** Print appropriate messages for successful outcome try **/
 
 static void try_success (string s,string e) {
@@ -186,7 +263,7 @@ int main (int argc, char **argv) {
             A(i,j) = columnwise[i+j*4];
          }
       }
-      QRDecomposition QR(A);
+      QRDecomposition<double> QR(A);
       R = QR.getR();
       try {
          check(A,prod(QR.getQ(),R));
@@ -296,7 +373,7 @@ int main (int argc, char **argv) {
       int n = A.size2();
       A.resize(n,n,true);
       A(0,0) = 0.;
-      LUDecomposition LU(A);
+      LUDecomposition<double> LU(A);
       try {
          // Compute the pivoted A
          B = Matrix(A.size1(),A.size2());
@@ -310,7 +387,7 @@ int main (int argc, char **argv) {
          errorCount = try_failure(errorCount,"LUDecomposition...","incorrect LU decomposition calculation");
       }
       
-      QR = QRDecomposition(A);
+      QR = QRDecomposition<double>(A);
       X = QR.inverse();
       try {
          check(prod(A,X),IdentityMatrix(3,3));
@@ -333,7 +410,7 @@ int main (int argc, char **argv) {
       }
       SQ = subrange(SUB,0,SUB.size1(),0,SUB.size1());
       try {
-         check(QRDecomposition(SQ).solve(SOL),O); 
+         check(QRDecomposition<double>(SQ).solve(SOL),O); 
          try_success("solve()...","");
       } catch ( std::exception e ) {
          errorCount = try_failure(errorCount,"solve()...",e.what());
@@ -344,7 +421,7 @@ int main (int argc, char **argv) {
             A(i,j) = pvals[i][j];
          }
       }
-      CholeskyDecomposition Chol(A); 
+      CholeskyDecomposition<double> Chol(A); 
       Matrix L = Chol.getL();
       try {
          check(A,prod(L,trans(L)));
@@ -561,6 +638,1279 @@ int main (int argc, char **argv) {
         try_success("EigenvalueDecomposition(special3)...","");
     } catch ( std::exception e ) {
         errorCount = try_failure(errorCount,"EigenvalueDecomposition(special3)...","incorrect nonsymmetric Eigenvalue decomposition calculation");
+    }
+    try {
+        // refactoring with compute() must give the same result as a fresh decomposition
+        const double mean = 0.0;
+        const double sigma = 1.0;
+        boost::normal_distribution<double> norm_dist(mean, sigma);
+        boost::lagged_fibonacci19937 engine;
+        Matrix A1(6,6), A2(6,6);
+        for(unsigned i=0; i<A1.size1(); i++) {
+            for(unsigned j=0; j<A1.size2(); j++) {
+                A1(i,j) = norm_dist.operator () <boost::lagged_fibonacci19937>((engine));
+                A2(i,j) = norm_dist.operator () <boost::lagged_fibonacci19937>((engine));
+            }
+        }
+        LUDecomposition<double> LU2(A1);
+        LU2.compute(A2);
+        check(LU2.getU(),LUDecomposition<double>(A2).getU());
+        QRDecomposition<double> QR2(A1);
+        QR2.compute(A2);
+        check(QR2.getR(),QRDecomposition<double>(A2).getR());
+        Matrix S2 = prod(A2,trans(A2));
+        CholeskyDecomposition<double> Chol2(prod(A1,trans(A1)));
+        Chol2.compute(S2);
+        check(Chol2.getL(),CholeskyDecomposition<double>(S2).getL());
+        SingularValueDecomposition<double> SVD2(A1);
+        SingularValueDecomposition<double>::Workspace work;
+        SVD2.compute(A2,false,true,true,work);
+        SVD2.compute(A1,false,true,true,work);
+        SVD2.compute(A2,false,true,true,work);
+        Matrix US = prod(SVD2.getU(),SVD2.getS());
+        check(A2,prod(US,trans(SVD2.getV())));
+        EigenvalueDecomposition<double> Eig2(S2);
+        Eig2.compute(A2);
+        check(prod(A2,Eig2.getV()),prod(Eig2.getV(),Eig2.getD()));
+        Eig2.compute(S2);
+        check(prod(S2,Eig2.getV()),prod(Eig2.getV(),Eig2.getD()));
+        // the steady state does not allocate, at the sizes of the blocked
+        // eigenvalue paths too, whose updates run in the thread pool
+        check_noalloc(LU2, A2);
+        check_noalloc(QR2, A2);
+        check_noalloc(Chol2, S2);
+        check_noalloc(Eig2, A2);
+        check_noalloc(Eig2, S2);
+        const int threads = parallel::threads();
+        parallel::setThreads(3);
+        for(int nb=256; nb<=512; nb*=2) {
+            Matrix AB(nb,nb);
+            for(int i=0; i<nb; i++) {
+                for(int j=0; j<nb; j++) {
+                    AB(i,j) = std::sin(1.0 + 3*i + 7*j*j) + (i == j ? 2.0 : 0.0);
+                }
+            }
+            EigenvalueDecomposition<double> EigB;
+            check_noalloc(EigB, AB);
+            Matrix SB = AB + trans(AB);
+            check_noalloc(EigB, SB);
+        }
+        parallel::setThreads(threads);
+        try_success("compute()...","");
+    } catch ( const std::exception& ) {
+        errorCount = try_failure(errorCount,"compute()...","incorrect refactorization");
+    }
+    try {
+        // decompositions with aligned and arena storage policies
+        typedef unbounded_array<double, aligned_allocator<double> > AlignedStorage;
+        typedef unbounded_array<double, arena_allocator<double> > ArenaStorage;
+        Matrix A1(5,4);
+        for(unsigned i=0; i<A1.size1(); i++) {
+            for(unsigned j=0; j<A1.size2(); j++) {
+                A1(i,j) = 1./(i+j+1) + (i == j);
+            }
+        }
+        SingularValueDecomposition<double,row_major,AlignedStorage> SVDa(A1);
+        if (reinterpret_cast<std::size_t>(&SVDa.getV()(0,0)) % 64 != 0) {
+            throw internal_logic("storage is not aligned");
+        }
+        Matrix US = prod(SVDa.getU(),SVDa.getS());
+        check(A1,prod(US,trans(SVDa.getV())));
+        MonotonicArena arena(1024);
+        {
+            ArenaScope scope(arena);
+            Matrix S2 = prod(trans(A1),A1);
+            EigenvalueDecomposition<double,column_major,ArenaStorage> Eiga(S2);
+            Matrix V2 = Eiga.getV();
+            Matrix D2 = Eiga.getD();
+            check(prod(S2,V2),prod(V2,D2));
+            SingularValueDecomposition<double,row_major,ArenaStorage> SVDr(A1);
+            check(SVDa.getSingularValues()(0),SVDr.getSingularValues()(0));
+            if (arena.bytesUsed() == 0) {
+                throw internal_logic("arena was not used");
+            }
+        }
+        arena.release();
+        try_success("storage policies...","");
+    } catch ( const std::exception& ) {
+        errorCount = try_failure(errorCount,"storage policies...","incorrect decomposition with custom storage");
+    }
+    try {
+        // single precision and column-major factorizations
+        typedef matrix<float> FloatMatrix;
+        typedef matrix<double,column_major> ColumnMatrix;
+        ColumnMatrix Ac(4,4);
+        FloatMatrix Af(4,4);
+        for(unsigned i=0; i<Ac.size1(); i++) {
+            for(unsigned j=0; j<Ac.size2(); j++) {
+                Ac(i,j) = 1./(i+j+1) + 2*(i == j);
+                Af(i,j) = (float)Ac(i,j);
+            }
+        }
+        LUDecomposition<double,column_major> LUc(Ac);
+        Matrix Xc = LUc.solve(IdentityMatrix(4,4));
+        check(prod(Ac,Xc),IdentityMatrix(4,4));
+        QRDecomposition<double,column_major> QRc(Ac);
+        check(Ac,prod(QRc.getQ(),QRc.getR()));
+        CholeskyDecomposition<double,column_major> Cholc(Ac);
+        check(Ac,prod(Cholc.getL(),trans(Cholc.getL())));
+        float feps = std::numeric_limits<float>::epsilon();
+        LUDecomposition<float> LUf(Af);
+        FloatMatrix Xf = LUf.solve(identity_matrix<float>(4,4));
+        FloatMatrix Ef = prod(Af,Xf) - identity_matrix<float>(4,4);
+        check_lessthan(norm_1(Ef), 100*feps);
+        QRDecomposition<float> QRf(Af);
+        Ef = Af - prod(QRf.getQ(),QRf.getR());
+        check_lessthan(norm_1(Ef), 100*feps*norm_1(Af));
+        CholeskyDecomposition<float> Cholf(Af);
+        Ef = Af - prod(Cholf.getL(),trans(Cholf.getL()));
+        check_lessthan(norm_1(Ef), 100*feps*norm_1(Af));
+        try_success("LU, QR, Cholesky (float, column_major)...","");
+    } catch ( const std::exception& ) {
+        errorCount = try_failure(errorCount,"LU, QR, Cholesky (float, column_major)...","incorrect templated decomposition");
+    }
+    try {
+        // mixed precision solve: well-conditioned systems are refined to double
+        // accuracy, ill-conditioned ones fall back to a double factorization
+        const double mean = 0.0;
+        const double sigma = 1.0;
+        boost::normal_distribution<double> norm_dist(mean, sigma);
+        boost::lagged_fibonacci19937 engine;
+        const unsigned nm = 50;
+        Matrix AM(nm,nm), BM(nm,2);
+        for(unsigned i=0; i<nm; i++) {
+            for(unsigned j=0; j<nm; j++) {
+                AM(i,j) = norm_dist.operator () <boost::lagged_fibonacci19937>((engine)) + (i == j)*nm;
+            }
+            BM(i,0) = i;
+            BM(i,1) = 1.;
+        }
+        MixedPrecisionLUDecomposition<> MP(AM);
+        Matrix XM = MP.solve(BM);
+        check(prod(AM,XM),BM);
+        if (MP.isFallback() || MP.getIterations() == 0) {
+            throw internal_logic("no refinement was done");
+        }
+        Matrix HM(12,12);
+        for(unsigned i=0; i<HM.size1(); i++) {
+            for(unsigned j=0; j<HM.size2(); j++) {
+                HM(i,j) = 1./(i+j+1);
+            }
+        }
+        MixedPrecisionLUDecomposition<> MPH(HM);
+        Matrix XH = MPH.solve(IdentityMatrix(12,12));
+        if (!MPH.isFallback()) {
+            throw internal_logic("refinement of an ill-conditioned matrix did not fall back");
+        }
+        check(XH,LUDecomposition<double>(HM).solve(IdentityMatrix(12,12)));
+        try_success("MixedPrecisionLUDecomposition...","");
+    } catch ( const std::exception& ) {
+        errorCount = try_failure(errorCount,"MixedPrecisionLUDecomposition...","incorrect mixed precision solve");
+    }
+    try {
+        // every instruction set supported by the CPU gives the results of
+        // the generic kernels, and correct decompositions
+        kernels::Isa saved = kernels::isa();
+        const double mean = 0.0;
+        const double sigma = 1.0;
+        boost::normal_distribution<double> norm_dist(mean, sigma);
+        boost::lagged_fibonacci19937 engine;
+        const int nk = 37;
+        Matrix AK(nk,nk), XK(nk,3), YK(nk,3);
+        for(int i=0; i<nk; i++) {
+            for(int j=0; j<nk; j++) {
+                AK(i,j) = norm_dist.operator () <boost::lagged_fibonacci19937>((engine));
+            }
+        }
+        matrix<double,column_major> ACK(AK);
+        Matrix AS = AK + trans(AK);
+        for (int i = kernels::Scalar; i <= kernels::supportedIsa(); ++i) {
+            if (!kernels::select(kernels::Isa(i))) {
+                throw internal_logic("supported instruction set not selected");
+            }
+            noalias(XK) = subrange(AK,0,nk,0,3);
+            noalias(YK) = XK;
+            double* x = &XK(0,0);
+            double* y = &YK(0,0);
+            check(kernels::dot(nk, x, 1, x+1, 1), kernels::dot<double>(nk, x, 1, x+1, 1));
+            kernels::axpy(nk, 0.5, x, 1, x+nk, 1);
+            kernels::axpy<double>(nk, 0.5, y, 1, y+nk, 1);
+            kernels::rot(nk, x, 1, x+2*nk, 1, 0.6, 0.8);
+            kernels::rot<double>(nk, y, 1, y+2*nk, 1, 0.6, 0.8);
+            kernels::refl3(nk, x, x+nk, x+2*nk, 1, 0.1, 0.2, 0.3, 1.0, 0.4, 0.5);
+            kernels::refl3<double>(nk, y, y+nk, y+2*nk, 1, 0.1, 0.2, 0.3, 1.0, 0.4, 0.5);
+            const double g[2] = { 0.3, -0.7 };
+            kernels::gemv(nk, 2, x, nk, g, x+2*nk);
+            kernels::gemv<double>(nk, 2, y, nk, g, y+2*nk);
+            check(XK,YK);
+            float xf[nk], yf[nk];
+            for (int k = 0; k < nk; ++k) {
+                xf[k] = (float) AK(0,k);
+                yf[k] = (float) AK(1,k);
+            }
+            check_lessthan(std::abs(kernels::dot(nk, xf, 1, yf, 1) - kernels::dot<float>(nk, xf, 1, yf, 1)),
+                           100*std::numeric_limits<float>::epsilon()*nk);
+            LUDecomposition<double> LUK(AK);
+            check(prod(AK,LUK.solve(IdentityMatrix(nk,nk))),IdentityMatrix(nk,nk));
+            QRDecomposition<double,column_major> QRK(ACK);
+            check(AK,prod(QRK.getQ(),QRK.getR()));
+            QRDecomposition<double> QRRK(AK);
+            check(AK,prod(QRRK.getQ(),QRRK.getR()));
+            EigenvalueDecomposition<double> EK(AK);
+            check(prod(AK,EK.getV()),prod(EK.getV(),EK.getD()));
+            EigenvalueDecomposition<double> ESK(AS);
+            check(prod(AS,ESK.getV()),prod(ESK.getV(),ESK.getD()));
+            SingularValueDecomposition<double,column_major> SK(ACK);
+            check(AK,prod(SK.getU(),Matrix(prod(SK.getS(),trans(SK.getV())))));
+            SingularValueDecomposition<double> SRK(AK);
+            check(AK,prod(SRK.getU(),Matrix(prod(SRK.getS(),trans(SRK.getV())))));
+        }
+        kernels::select(saved);
+        try_success("SIMD kernels...",kernels::isaName(saved));
+    } catch ( const std::exception& ) {
+        errorCount = try_failure(errorCount,"SIMD kernels...","results differ between instruction sets");
+    }
+    try {
+        // with UBLASJAMA_INSTRUMENTATION every phase records its counters in
+        // the decomposition and in the registry, otherwise they stay zero
+        using namespace instrumentation;
+        const int ni = 24;
+        Matrix AI(ni,ni);
+        for(int i=0; i<ni; i++) {
+            for(int j=0; j<ni; j++) {
+                AI(i,j) = 1./(i+2*j+1) + (i == j) - (i == j+1);
+            }
+        }
+        Matrix ASI = AI + trans(AI);
+        registry().reset();
+        LUDecomposition<double> LUI(AI);
+        QRDecomposition<double> QRI(AI);
+        CholeskyDecomposition<double> CI(ASI + 2*ni*IdentityMatrix(ni,ni));
+        EigenvalueDecomposition<double> EI(AI);
+        EigenvalueDecomposition<double> ESI(ASI);
+        SingularValueDecomposition<double> SI(AI);
+        Stats total = registry().snapshot();
+#ifdef UBLASJAMA_INSTRUMENTATION
+        const Phase phases[] = { LUPanels, QRReflectors, CholeskyFactor, Orthes, Hqr2,
+                                 Tred2, Tql2, SVDBidiagonalization, SVDVectors, SVDSweeps };
+        const Stats* owners[] = { &LUI.getStats(), &QRI.getStats(), &CI.getStats(), &EI.getStats(), &EI.getStats(),
+                                  &ESI.getStats(), &ESI.getStats(), &SI.getStats(), &SI.getStats(), &SI.getStats() };
+        for (int k = 0; k < 10; ++k) {
+            const PhaseStats& ps = (*owners[k])[phases[k]];
+            if (ps.calls != 1 || ps.flops <= 0 || ps.seconds < 0 ||
+                total[phases[k]].calls != 1 || total[phases[k]].flops != ps.flops) {
+                throw internal_logic(phaseName(phases[k]));
+            }
+        }
+        check(LUI.getStats()[LUPanels].iterations, ni);
+        check(QRI.getStats()[QRReflectors].iterations, ni);
+        check_lessthan(0, EI.getStats()[Hqr2].iterations);
+        check_lessthan(0, ESI.getStats()[Tql2].iterations);
+        check_lessthan(0, SI.getStats()[SVDSweeps].iterations);
+        check(LUI.getStats().total().bytes, ni*ni*sizeof(double) + 2*ni*sizeof(std::size_t) + ni*sizeof(double));
+        // recomputing a same-sized matrix reuses the storage
+        LUI.compute(ASI);
+        check(LUI.getStats().total().bytes, 0);
+        check(registry().snapshot()[LUPanels].calls, 2);
+#else
+        if (LUI.getStats().total().calls != 0 || EI.getStats().total().calls != 0 ||
+            SI.getStats().total().calls != 0 || total.total().calls != 0) {
+            throw internal_logic("counters recorded without UBLASJAMA_INSTRUMENTATION");
+        }
+#endif
+        try_success("Instrumentation...","");
+    } catch ( const std::exception& ) {
+        errorCount = try_failure(errorCount,"Instrumentation...","incorrect instrumentation counters");
+    }
+    try {
+        // the cyclic permutation stalls the double shift QR step until the
+        // exceptional shift; tight limits stop the iterations with a status
+        Matrix PC(4,4);
+        PC.clear();
+        PC(0,3) = PC(1,0) = PC(2,1) = PC(3,2) = 1;
+        EigenvalueDecomposition<double> EPC(PC);
+        if (!EPC.isConverged() || EPC.getConvergence().exceptionalShifts == 0) {
+            throw internal_logic("no exceptional shift");
+        }
+        check(prod(PC,EPC.getV()),prod(EPC.getV(),EPC.getD()));
+        const int nl = 12;
+        Matrix AL(nl,nl);
+        for(int i=0; i<nl; i++) {
+            for(int j=0; j<nl; j++) {
+                AL(i,j) = std::sin(1.0 + i + 3*j);
+            }
+        }
+        Matrix ASL = AL + trans(AL);
+        EigenvalueDecomposition<double> EL(AL), ESL(ASL);
+        SingularValueDecomposition<double> SL(AL);
+        if (!EL.isConverged() || !ESL.isConverged() || !SL.isConverged() ||
+            EL.getConvergence().iterations == 0 || SL.getConvergence().unconverged != 0) {
+            throw internal_logic("no convergence with the default limits");
+        }
+        IterationLimits once;
+        once.perValue = 1;
+        EL.setIterationLimits(once);
+        EL.compute(AL);
+        ESL.setIterationLimits(once);
+        ESL.compute(ASL);
+        SL.setIterationLimits(once);
+        SL.compute(AL);
+        if (EL.getConvergence().status != PerValueLimitReached || EL.getConvergence().unconverged == 0 ||
+            ESL.getConvergence().status != PerValueLimitReached || ESL.getConvergence().unconverged == 0 ||
+            SL.getConvergence().status != PerValueLimitReached || SL.getConvergence().unconverged == 0) {
+            throw internal_logic("per value limit not enforced");
+        }
+        IterationLimits few;
+        few.total = 3;
+        EL.setIterationLimits(few);
+        EL.compute(AL);
+        check(EL.getConvergence().iterations, 4);
+        if (EL.getConvergence().status != TotalLimitReached) {
+            throw internal_logic("total limit not enforced");
+        }
+        SL.setIterationLimits(IterationLimits::until(IterationLimits::Clock::now()));
+        SL.compute(AL);
+        if (SL.getConvergence().status != TimeLimitReached) {
+            throw internal_logic("deadline not enforced");
+        }
+        SL.setIterationLimits(IterationLimits());
+        SL.compute(AL);
+        check(AL,prod(SL.getU(),Matrix(prod(SL.getS(),trans(SL.getV())))));
+        try_success("Iteration limits...","");
+    } catch ( const std::exception& ) {
+        errorCount = try_failure(errorCount,"Iteration limits...","incorrect convergence control");
+    }
+    try {
+        // balancing: a badly scaled similarity transform of a matrix has
+        // its eigenvalues; isolated eigenvalues shrink the active block
+        const int nb = 10;
+        Matrix BB(nb,nb), AB(nb,nb);
+        for(int i=0; i<nb; i++) {
+            for(int j=0; j<nb; j++) {
+                BB(i,j) = std::cos(2.0 + 5*i + j);
+                AB(i,j) = BB(i,j) * std::pow(10.0, 2*(i-j));
+            }
+        }
+        EigenvalueDecomposition<double> EB(BB), EAB(AB);
+        Vector db(EB.getRealEigenvalues()), dab(EAB.getRealEigenvalues());
+        std::sort(db.begin(), db.end());
+        std::sort(dab.begin(), dab.end());
+        check_lessthan(norm_inf(db - dab), 1e-10*norm_inf(db));
+        check(prod(AB,EAB.getV()),prod(EAB.getV(),EAB.getD()));
+        check(EAB.getLow(), 0);
+        check(EAB.getHigh(), nb-1);
+        Matrix AT(BB);
+        for(int j=0; j<nb; j++) {
+            AT(3,j) = (j == 3 ? 7.0 : 0.0);     // row 3 isolates 7
+            AT(j,6) = (j == 6 ? -2.0 : 0.0);    // column 6 isolates -2
+        }
+        EigenvalueDecomposition<double> EAT(AT);
+        check(EAT.getLow(), 1);
+        check(EAT.getHigh(), nb-2);
+        check(prod(AT,EAT.getV()),prod(EAT.getV(),EAT.getD()));
+        EAT.setBalancing(false);
+        EAT.compute(AT);
+        check(EAT.getHigh(), nb-1);
+        check(prod(AT,EAT.getV()),prod(EAT.getV(),EAT.getD()));
+        try_success("Balancing...","");
+    } catch ( const std::exception& ) {
+        errorCount = try_failure(errorCount,"Balancing...","incorrect balanced eigenvalue decomposition");
+    }
+    try {
+        // blocked Hessenberg reduction: small panels and crossover so that
+        // most columns are reduced by panels, with several threads
+        const int nh = 120;
+        Matrix AH(nh,nh);
+        matrix<double,column_major> AHC(nh,nh);
+        for(int i=0; i<nh; i++) {
+            for(int j=0; j<nh; j++) {
+                AH(i,j) = AHC(i,j) = std::sin(1.0 + 3*i + 7*j*j) + (i == j ? 2.0 : 0.0);
+            }
+        }
+        const int threads = parallel::threads();
+        parallel::setThreads(3);
+        EigenvalueDecomposition<double> EH(AH);
+        EH.setBlocking(1);
+        EH.compute(AH);
+        Vector dh(EH.getRealEigenvalues()), eh(EH.getImagEigenvalues());
+        EH.setBlocking(8, 16);
+        EH.compute(AH);
+        EigenvalueDecomposition<double,column_major> EHC(AHC);
+        EHC.setBlocking(8, 16);
+        EHC.compute(AHC);
+        // an exception of any range reaches the caller once all are joined
+        for(int k=0; k<3; k++) {
+            std::atomic<int> done(0);
+            try {
+                parallel::parallelFor(0, 30, 10, [&] (int b, int e) {
+                    if (b/10 == k) {
+                        throw bad_argument();
+                    }
+                    ++done;
+                });
+                throw internal_logic("parallelFor exception lost");
+            } catch ( bad_argument& ) {
+            }
+            check(done, 2);
+        }
+        parallel::setThreads(threads);
+        check(prod(AH,EH.getV()),prod(EH.getV(),EH.getD()));
+        check(prod(AHC,EHC.getV()),prod(EHC.getV(),EHC.getD()));
+        check_lessthan(norm_inf(EH.getRealEigenvalues() - dh) + norm_inf(EH.getImagEigenvalues() - eh), 1e-10*norm_inf(dh));
+        check_lessthan(norm_inf(EHC.getRealEigenvalues() - dh) + norm_inf(EHC.getImagEigenvalues() - eh), 1e-10*norm_inf(dh));
+        try_success("Blocked Hessenberg reduction...","");
+    } catch ( const std::exception& ) {
+        errorCount = try_failure(errorCount,"Blocked Hessenberg reduction...","incorrect blocked Hessenberg reduction");
+    }
+    try {
+        // blocked tridiagonalization, with and without eigenvectors
+        const int nt = 110;
+        Matrix AS(nt,nt);
+        matrix<double,column_major> ASC(nt,nt);
+        for(int i=0; i<nt; i++) {
+            for(int j=0; j<=i; j++) {
+                AS(i,j) = AS(j,i) = ASC(i,j) = ASC(j,i) = std::cos(0.5 + 3*i*j + 7*(i+j));
+            }
+        }
+        const int threads = parallel::threads();
+        parallel::setThreads(3);
+        EigenvalueDecomposition<double> ES;
+        ES.setBlocking(1);
+        ES.compute(AS);
+        Vector ds(ES.getRealEigenvalues());
+        ES.setBlocking(8, 16);
+        ES.compute(AS);
+        check(prod(AS,ES.getV()),prod(ES.getV(),ES.getD()));
+        check(prod(trans(ES.getV()),ES.getV()),IdentityMatrix(nt,nt));
+        check_lessthan(norm_inf(ES.getRealEigenvalues() - ds), 1e-12*norm_inf(ds));
+        EigenvalueDecomposition<double,column_major> ESC;
+        ESC.setBlocking(8, 16);
+        ESC.compute(ASC);
+        check(prod(ASC,ESC.getV()),prod(ESC.getV(),ESC.getD()));
+        check_lessthan(norm_inf(ESC.getRealEigenvalues() - ds), 1e-12*norm_inf(ds));
+        const double* storageV = &ES.getV()(0,0);
+        ES.setEigenvectors(false);
+        ES.compute(AS);
+        check(ES.getV().size1(), 0);
+        check_lessthan(norm_inf(ES.getRealEigenvalues() - ds), 1e-12*norm_inf(ds));
+        ES.setBlocking(1);
+        ES.compute(AS);
+        check_lessthan(norm_inf(ES.getRealEigenvalues() - ds), 1e-12*norm_inf(ds));
+        // the storage of V is kept for the next compute() with eigenvectors
+        ES.setEigenvectors(true);
+        ES.compute(AS);
+        if (&ES.getV()(0,0) != storageV) {
+            throw internal_logic("eigenvectors reallocated");
+        }
+        check(prod(AS,ES.getV()),prod(ES.getV(),ES.getD()));
+        parallel::setThreads(threads);
+        try_success("Blocked tridiagonalization...","");
+    } catch ( const std::exception& ) {
+        errorCount = try_failure(errorCount,"Blocked tridiagonalization...","incorrect blocked tridiagonalization");
+    }
+    try {
+        // multishift QR with aggressive early deflation: same eigenvalues
+        // (in another order) as the double shift iteration of Jama
+        const int nm = 120;
+        Matrix AM(nm,nm);
+        matrix<double,column_major> AMC(nm,nm);
+        for(int i=0; i<nm; i++) {
+            for(int j=0; j<nm; j++) {
+                AM(i,j) = AMC(i,j) = std::sin(2.0 + 5*i*j + 3*j) + (j == i+1 ? 1.0 : 0.0);
+            }
+        }
+        EigenvalueDecomposition<double> EM;
+        EM.setMultishift(0);
+        EM.compute(AM);
+        std::vector<std::pair<double,double> > jama, multi, multic;
+        for(int i=0; i<nm; i++) {
+            jama.push_back(std::make_pair(EM.getRealEigenvalues()(i), EM.getImagEigenvalues()(i)));
+        }
+        const long jamaIterations = EM.getConvergence().iterations;
+        EM.setMultishift(100);
+        EM.compute(AM);
+        if (!EM.getConvergence().converged() || EM.getConvergence().iterations >= jamaIterations) {
+            throw internal_logic("multishift iteration not used");
+        }
+        check(prod(AM,EM.getV()),prod(EM.getV(),EM.getD()));
+        EigenvalueDecomposition<double,column_major> EMC;
+        EMC.setMultishift(100);
+        EMC.compute(AMC);
+        check(prod(AMC,EMC.getV()),prod(EMC.getV(),EMC.getD()));
+        for(int i=0; i<nm; i++) {
+            multi.push_back(std::make_pair(EM.getRealEigenvalues()(i), EM.getImagEigenvalues()(i)));
+            multic.push_back(std::make_pair(EMC.getRealEigenvalues()(i), EMC.getImagEigenvalues()(i)));
+        }
+        std::sort(jama.begin(), jama.end());
+        std::sort(multi.begin(), multi.end());
+        std::sort(multic.begin(), multic.end());
+        double diff = 0.0;
+        for(int i=0; i<nm; i++) {
+            diff = std::max(diff, std::abs(multi[i].first - jama[i].first) + std::abs(multi[i].second - jama[i].second));
+            diff = std::max(diff, std::abs(multic[i].first - jama[i].first) + std::abs(multic[i].second - jama[i].second));
+        }
+        check_lessthan(diff, 1e-10*norm_inf(AM));
+        try_success("Multishift QR...","");
+    } catch ( const std::exception& ) {
+        errorCount = try_failure(errorCount,"Multishift QR...","incorrect multishift Schur form");
+    }
+    try {
+        // Schur-only mode: A*Z = Z*T with Z orthogonal and T quasi upper
+        // triangular, with Jama's iteration and the multishift one; and
+        // the complex eigenvectors of the full decomposition
+        const int nz = 120;
+        Matrix AZ(nz,nz);
+        matrix<double,column_major> AZC(nz,nz);
+        for(int i=0; i<nz; i++) {
+            for(int j=0; j<nz; j++) {
+                AZ(i,j) = AZC(i,j) = std::cos(1.0 + 2*i*j + 5*i) * (i == 0 || j == 1 ? 0.0 : 1.0);
+            }
+        }
+        EigenvalueDecomposition<double> EZ;
+        EZ.setSchurOnly(true);
+        for (int ms = 0; ms <= 100; ms += 100) {
+            EZ.setMultishift(ms);
+            EZ.compute(AZ);
+            const Matrix& T = EZ.getSchurForm();
+            const Matrix& Z = EZ.getSchurVectors();
+            check(prod(AZ,Z),prod(Z,T));
+            check(prod(trans(Z),Z),IdentityMatrix(nz,nz));
+            for(int i=1; i<nz; i++) {
+                for(int j=0; j<i-1; j++) {
+                    check(T(i,j), 0.0);
+                }
+                if (T(i,i-1) != 0.0 && (EZ.getImagEigenvalues()(i) == 0.0 || (i > 1 && T(i-1,i-2) != 0.0))) {
+                    throw internal_logic("not a real Schur form");
+                }
+            }
+        }
+        // reordering: the selected eigenvalues (of the second half, and the
+        // other value of a pair) lead T, whose 2x2 blocks are standardized
+        std::vector<bool> sel(nz, false);
+        std::vector<std::pair<double,double> > lead, expected;
+        for(int j=nz/2-1; j<nz; j++) {
+            sel[j] = j >= nz/2 || EZ.getImagEigenvalues()(j) > 0.0;
+            if (sel[j]) {
+                expected.push_back(std::make_pair(EZ.getRealEigenvalues()(j), EZ.getImagEigenvalues()(j)));
+            }
+        }
+        const int ks = EZ.reorderSchur(sel);
+        check(ks, (int) expected.size());
+        const Matrix& TR = EZ.getSchurForm();
+        check(prod(AZ,EZ.getSchurVectors()),prod(EZ.getSchurVectors(),TR));
+        check(prod(trans(EZ.getSchurVectors()),EZ.getSchurVectors()),IdentityMatrix(nz,nz));
+        int pairs = 0;
+        for(int i=0; i+1<nz; i++) {
+            if (TR(i+1,i) != 0.0) {
+                check(TR(i,i), TR(i+1,i+1));
+                if (TR(i,i+1)*TR(i+1,i) >= 0.0) {
+                    throw internal_logic("2x2 block not standardized");
+                }
+                pairs += i < ks;
+            }
+        }
+        if (pairs < 2) {
+            throw internal_logic("too few complex pairs moved");
+        }
+        for(int j=0; j<ks; j++) {
+            lead.push_back(std::make_pair(EZ.getRealEigenvalues()(j), EZ.getImagEigenvalues()(j)));
+        }
+        std::sort(lead.begin(), lead.end());
+        std::sort(expected.begin(), expected.end());
+        for(int j=0; j<ks; j++) {
+            check_lessthan(std::abs(lead[j].first - expected[j].first) + std::abs(lead[j].second - expected[j].second), 1e-10*norm_inf(AZ));
+        }
+        EigenvalueDecomposition<double,column_major> EZC;
+        EZC.setSchurOnly(true);
+        EZC.compute(AZC);
+        check(prod(AZC,EZC.getSchurVectors()),prod(EZC.getSchurVectors(),EZC.getSchurForm()));
+        // the getters follow the mode of the last compute(), not the setting
+        EZ.setSchurOnly(false);
+        check(prod(AZ,EZ.getSchurVectors()),prod(EZ.getSchurVectors(),EZ.getSchurForm()));
+        try {
+            EZ.getComplexEigenvectors();
+            throw internal_logic("complex eigenvectors of a Schur form");
+        } catch ( external_logic& ) {
+        }
+        EZ.compute(AZ);
+        try {
+            EZ.setSchurOnly(true);
+            EZ.getSchurForm();
+            throw internal_logic("Schur form of eigenvectors");
+        } catch ( external_logic& ) {
+        }
+        EZ.setSchurOnly(false);
+        EigenvalueDecomposition<double>::ComplexEigenvectors X = EZ.getComplexEigenvectors();
+        vector<std::complex<double> > x(nz);
+        int complexCount = 0;
+        for(int j=0; j<nz; j++) {
+            X.column(j, x);
+            const std::complex<double> lambda = EZ.getEigenvalue(j);
+            complexCount += (lambda.imag() != 0.0);
+            double r = 0.0;
+            for(int i=0; i<nz; i++) {
+                std::complex<double> ax = 0.0;
+                for(int k=0; k<nz; k++) {
+                    ax += AZ(i,k)*X(k,j);
+                }
+                r = std::max(r, std::abs(ax - lambda*x(i)));
+            }
+            check_lessthan(r, 1e-10*norm_inf(AZ)*norm_inf(EZ.getV()));
+        }
+        if (complexCount == 0) {
+            throw internal_logic("no complex eigenvalue");
+        }
+        try_success("Schur form and complex eigenvectors...","");
+    } catch ( const std::exception& ) {
+        errorCount = try_failure(errorCount,"Schur form and complex eigenvectors...","incorrect Schur form or complex eigenvectors");
+    }
+    try {
+        // generalized symmetric-definite problem: A*X = B*X*D, X'*B*X = I,
+        // and the eigenvalues of inv(B)*A
+        const int ng = 60;
+        Matrix AG(ng,ng), MG(ng,ng);
+        for(int i=0; i<ng; i++) {
+            for(int j=0; j<=i; j++) {
+                AG(i,j) = AG(j,i) = std::sin(1.0 + 2*i + 3*j*i);
+            }
+            for(int j=0; j<ng; j++) {
+                MG(i,j) = std::cos(0.5 + i*j + 4*j);
+            }
+        }
+        Matrix BG = prod(MG,trans(MG)) + IdentityMatrix(ng,ng);
+        GeneralizedEigenvalueDecomposition<double> GE(AG,BG);
+        if (!GE.isSPD() || !GE.isConverged()) {
+            throw internal_logic("generalized decomposition not computed");
+        }
+        const Matrix& XG = GE.getV();
+        check(prod(AG,XG),prod(BG,Matrix(prod(XG,GE.getD()))));
+        check(prod(trans(XG),Matrix(prod(BG,XG))),IdentityMatrix(ng,ng));
+        for(int i=1; i<ng; i++) {
+            check_lessthan(GE.getRealEigenvalues()(i-1), GE.getRealEigenvalues()(i) + 1e-14);
+        }
+        matrix<double,column_major> AGC(AG), BGC(BG);
+        GeneralizedEigenvalueDecomposition<double,column_major> GEC(AGC,BGC);
+        check(prod(AGC,GEC.getV()),prod(BGC,matrix<double,column_major>(prod(GEC.getV(),GEC.getD()))));
+        const Vector dg(GE.getRealEigenvalues());
+        check_lessthan(norm_inf(GEC.getRealEigenvalues() - dg), 1e-12*norm_inf(dg));
+        GE.setEigenvectors(false);
+        GE.compute(AG,BG);
+        check_lessthan(norm_inf(GE.getRealEigenvalues() - dg), 1e-12*norm_inf(dg));
+        GE.compute(AG,AG);
+        if (GE.isSPD()) {
+            throw internal_logic("indefinite B accepted");
+        }
+        try_success("GeneralizedEigenvalueDecomposition...","");
+    } catch ( const std::exception& ) {
+        errorCount = try_failure(errorCount,"GeneralizedEigenvalueDecomposition...","incorrect generalized eigenvalue decomposition");
+    }
+    try {
+        // binary save and load of every decomposition, across layouts,
+        // and rejection of other kinds and truncated files
+        const int ns = 12;
+        Matrix AS(ns,ns), BS(ns,2);
+        for(int i=0; i<ns; i++) {
+            for(int j=0; j<ns; j++) {
+                AS(i,j) = std::sin(0.3 + 2*i + 7*j*j) + (i == j ? 4.0 : 0.0);
+            }
+            BS(i,0) = i;
+            BS(i,1) = 1.0;
+        }
+        Matrix SS = prod(AS,trans(AS));
+        std::stringstream lus, qrs, chs, eis, svs;
+        LUDecomposition<double>(AS).save(lus);
+        QRDecomposition<double>(AS).save(qrs);
+        CholeskyDecomposition<double>(SS).save(chs);
+        EigenvalueDecomposition<double>(AS).save(eis);
+        SingularValueDecomposition<double>(AS).save(svs);
+        const std::string lubytes = lus.str();
+        LUDecomposition<double> LUS;
+        LUS.load(lus);
+        check(LUS.solve(BS),LUDecomposition<double>(AS).solve(BS));
+        std::istringstream luc(lubytes);
+        LUDecomposition<double,column_major> LUC;
+        LUC.load(luc);
+        check(Matrix(LUC.getL()),LUS.getL());
+        QRDecomposition<double> QRS;
+        QRS.load(qrs);
+        check(QRS.solve(BS),QRDecomposition<double>(AS).solve(BS));
+        CholeskyDecomposition<double> CHS;
+        CHS.load(chs);
+        if (!CHS.isSPD()) {
+            throw internal_logic("Cholesky flag not restored");
+        }
+        check(prod(SS,CHS.solve(BS)),BS);
+        EigenvalueDecomposition<double> EIS;
+        EIS.load(eis);
+        check(prod(AS,EIS.getV()),prod(EIS.getV(),EIS.getD()));
+        SingularValueDecomposition<double> SVS;
+        SVS.load(svs);
+        check(AS,prod(SVS.getU(),Matrix(prod(SVS.getS(),trans(SVS.getV())))));
+        bool rejected = false;
+        try {
+            std::istringstream other(lubytes);
+            QRS.load(other);
+        } catch ( std::exception& ) {
+            rejected = true;
+        }
+        try {
+            std::istringstream truncated(lubytes.substr(0, lubytes.size()-8));
+            LUS.load(truncated);
+            rejected = false;
+        } catch ( std::exception& ) {
+        }
+        if (!rejected) {
+            throw internal_logic("invalid file accepted");
+        }
+        // corrupt sizes, balancing range and number of columns of U are
+        // rejected before allocating
+        std::stringstream ms;
+        serialization::saveMatrix(ms, AS);
+        std::string corrupt = ms.str();
+        const boost::int64_t huge = 1 << 30;
+        std::memcpy(&corrupt[sizeof(serialization::Header)], &huge, sizeof(huge));
+        std::memcpy(&corrupt[sizeof(serialization::Header) + sizeof(huge)], &huge, sizeof(huge));
+        std::string eibytes = eis.str();
+        const boost::int64_t badRange[2] = { ns-1, 0 };
+        std::memcpy(&eibytes[sizeof(serialization::Header) + 4*sizeof(huge)], badRange, sizeof(badRange));
+        std::stringstream svn;
+        SingularValueDecomposition<double>(AS,true,false,true).save(svn);
+        std::string svbytes = svn.str();
+        std::memcpy(&svbytes[sizeof(serialization::Header) + 2*sizeof(huge)], &huge, sizeof(huge));
+        for(int k=0; k<3; k++) {
+            try {
+                std::istringstream in(k == 0 ? corrupt : k == 1 ? eibytes : svbytes);
+                Matrix MS;
+                if (k == 0) {
+                    serialization::loadMatrix(in, MS);
+                } else if (k == 1) {
+                    EIS.load(in);
+                } else {
+                    SVS.load(in);
+                }
+                throw internal_logic("corrupt file accepted");
+            } catch ( external_logic& ) {
+            }
+        }
+        try_success("Serialization...","");
+    } catch ( const std::exception& ) {
+        errorCount = try_failure(errorCount,"Serialization...","incorrect save or load");
+    }
+    try {
+        // page-aligned files mapped without copy: a matrix and an LU
+        // decomposition stored in mapped_array, and the same files read
+        // by copy into other layouts
+        const int nm = 40;
+        Matrix AM(nm,nm), BM(nm,3);
+        for(int i=0; i<nm; i++) {
+            for(int j=0; j<nm; j++) {
+                AM(i,j) = std::cos(0.7 + 3*i + 5*j*i) + (i == j ? 3.0 : 0.0);
+            }
+            for(int j=0; j<3; j++) {
+                BM(i,j) = i - j;
+            }
+        }
+        const char* matrixFile = "TestMatrix.matrix";
+        const char* luFile = "TestMatrix.lu";
+        {
+            std::ofstream out(matrixFile, std::ios::binary);
+            serialization::saveMatrix(out, AM, serialization::pageAlignment);
+            std::ofstream lout(luFile, std::ios::binary);
+            LUDecomposition<double>(AM).save(lout, serialization::pageAlignment);
+        }
+        typedef mapped_array<double> MappedStorage;
+        {
+            MappedFile file(matrixFile);
+            matrix<double,row_major,MappedStorage> MM;
+            serialization::loadMatrix(file, MM);
+            const char* p = reinterpret_cast<const char*>(&MM(0,0));
+            if (!MM.data().mapped() || p < file.data() || p >= file.data() + file.size()
+                || (p - file.data()) % serialization::pageAlignment != 0) {
+                throw internal_logic("matrix not mapped");
+            }
+            check(Matrix(MM),AM);
+            MM(0,0) = 42.0;
+            matrix<double,column_major> MC;
+            serialization::loadMatrix(MappedFile(matrixFile), MC);
+            check(Matrix(MC),AM);
+        }
+        {
+            LUDecomposition<double,row_major,MappedStorage> LUM;
+            LUM.load(MappedFile(luFile));
+            check(Matrix(LUM.solve(BM)),LUDecomposition<double>(AM).solve(BM));
+            std::ifstream in(luFile, std::ios::binary);
+            LUDecomposition<double,column_major> LUC;
+            LUC.load(in);
+            check(Matrix(LUC.solve(BM)),LUDecomposition<double>(AM).solve(BM));
+        }
+        std::remove(matrixFile);
+        std::remove(luFile);
+        try_success("Mapped storage...","");
+    } catch ( const std::exception& ) {
+        errorCount = try_failure(errorCount,"Mapped storage...","incorrect mapped loading");
+    }
+    try {
+        // tiled factorizations with edge tiles, against the in-memory ones
+        const int no = 45, bo = 16;
+        Matrix AO(no,no), SO(no,no), BO(no,2);
+        for(int i=0; i<no; i++) {
+            for(int j=0; j<no; j++) {
+                AO(i,j) = std::sin(1.3*i*i + 2.1*j + 0.37*i*j) + (i == j ? 2.0 : 0.0);
+                SO(i,j) = std::cos(double(i - j)) + (i == j ? no : 0.0);
+            }
+            BO(i,0) = i;
+            BO(i,1) = 1.0/(i+1);
+        }
+        if (TiledMatrix<double>::tileSize(no, (no + 4.0*bo)*bo*sizeof(double)) != bo) {
+            throw internal_logic("tile size for a budget");
+        }
+        const char* tileFile = "TestMatrix.tiles";
+        {
+            TiledMatrix<double> tiled(tileFile, no, no, bo);
+            tiled.assign(AO);
+            OutOfCoreLUDecomposition<double> LUO(tiled);
+            LUDecomposition<double> LUA(AO);
+            if (!LUO.isNonsingular() || tiled.bytesRead() == 0) {
+                throw internal_logic("out-of-core LU");
+            }
+            Matrix XO = LUO.solve(BO);
+            check_lessthan(norm_inf(XO - LUA.solve(BO)), 1e-10*norm_inf(XO));
+            check_lessthan(std::abs(LUO.det() - LUA.det()), 1e-10*std::abs(LUA.det()));
+            check_lessthan(norm_inf(prod(AO,XO) - BO), 1e-10*norm_inf(BO));
+            if (!std::equal(LUO.getPivot().begin(), LUO.getPivot().end(), LUA.getPivot().begin())) {
+                throw internal_logic("out-of-core pivots");
+            }
+
+            tiled.assign(SO);
+            OutOfCoreCholeskyDecomposition<double,column_major> CHO(tiled);
+            if (!CHO.isSPD()) {
+                throw internal_logic("out-of-core Cholesky");
+            }
+            matrix<double,column_major> BC(BO);
+            check(Matrix(CHO.solve(BC)),CholeskyDecomposition<double>(SO).solve(BO));
+        }
+        std::remove(tileFile);
+        try_success("Out-of-core decompositions...","");
+    } catch ( const std::exception& ) {
+        errorCount = try_failure(errorCount,"Out-of-core decompositions...","incorrect tiled factorization");
+    }
+    try {
+        // const solves of shared decompositions, from concurrent threads
+        // and split by parallel::solve
+        const int np = 30, nxp = 40;
+        Matrix AP(np,np), BP(np,nxp);
+        for(int i=0; i<np; i++) {
+            for(int j=0; j<np; j++) {
+                AP(i,j) = std::cos(2.0*i + 0.3*j*j) + (i == j ? 4.0 : 0.0);
+            }
+            for(int j=0; j<nxp; j++) {
+                BP(i,j) = std::sin(double(i*nxp + j));
+            }
+        }
+        const LUDecomposition<double> LUP(AP);
+        const QRDecomposition<double> QRP(AP);
+        const Matrix XP = LUP.solve(BP);
+        const int threads = parallel::threads();
+        parallel::setThreads(3);
+        check(parallel::solve(LUP,BP),XP);
+        check(parallel::solve(QRP,BP),QRP.solve(BP));
+        parallel::setThreads(threads);
+        Matrix XT[4];
+        std::vector<std::thread> readers;
+        for(int t=0; t<4; t++) {
+            readers.push_back(std::thread([&,t] () {
+                XT[t] = t%2 == 0 ? LUP.solve(BP) : QRP.solve(BP);
+            }));
+        }
+        for(int t=0; t<4; t++) {
+            readers[t].join();
+        }
+        check(XT[0],XP);
+        check(XT[1],QRP.solve(BP));
+        check(XT[2],XP);
+        check(QRP.inverse(),LUP.pseudoinverse());
+        try_success("Concurrent and parallel solves...","");
+    } catch ( const std::exception& ) {
+        errorCount = try_failure(errorCount,"Concurrent and parallel solves...","incorrect solution");
+    }
+    try {
+        // vector and in-place solves against the matrix solves, in both
+        // layouts, with an overdetermined system for QR
+        const int nv = 25, mv = 31, nxv = 3;
+        Matrix AV(nv,nv), SV(nv,nv), QV(mv,nv), BV(nv,nxv), CV(mv,nxv);
+        for(int i=0; i<mv; i++) {
+            for(int j=0; j<nv; j++) {
+                QV(i,j) = std::sin(0.5*i + 1.7*j*j) + (i == j ? 2.0 : 0.0);
+                if (i < nv) {
+                    AV(i,j) = std::cos(1.1*i*j + j) + (i == j ? 3.0 : 0.0);
+                    SV(i,j) = std::cos(double(i - j)) + (i == j ? nv : 0.0);
+                }
+            }
+            for(int j=0; j<nxv; j++) {
+                CV(i,j) = std::cos(3.0*i + j);
+                if (i < nv) {
+                    BV(i,j) = i - 2.0*j;
+                }
+            }
+        }
+        const LUDecomposition<double> LUV(AV);
+        const QRDecomposition<double> QRV(QV);
+        const CholeskyDecomposition<double> CHV(SV);
+        Vector bv = column(BV,0), cv = column(CV,0);
+        check_lessthan(norm_inf(LUV.solve(bv) - column(LUV.solve(BV),0)), 1e-12);
+        check_lessthan(norm_inf(CHV.solve(bv) - column(CHV.solve(BV),0)), 1e-12);
+        check_lessthan(norm_inf(QRV.solve(cv) - column(QRV.solve(CV),0)), 1e-12);
+        Matrix XV(BV), YV(BV), ZV(CV);
+        LUV.solveInPlace(XV);
+        CHV.solveInPlace(YV);
+        QRV.solveInPlace(ZV);
+        check(XV,LUV.solve(BV));
+        check(YV,CHV.solve(BV));
+        check(Matrix(subrange(ZV,0,nv,0,nxv)),QRV.solve(CV));
+        LUV.solveInPlace(bv);
+        check_lessthan(norm_inf(prod(AV,bv) - column(BV,0)), 1e-12);
+
+        typedef matrix<double,column_major> CMatrix;
+        const LUDecomposition<double,column_major> LUC(AV);
+        const QRDecomposition<double,column_major> QRC(QV);
+        const CholeskyDecomposition<double,column_major> CHC(SV);
+        CMatrix XC(BV), YC(BV), ZC(CV);
+        LUC.solveInPlace(XC);
+        CHC.solveInPlace(YC);
+        QRC.solveInPlace(ZC);
+        check(Matrix(XC),LUV.solve(BV));
+        check(Matrix(YC),CHV.solve(BV));
+        check(Matrix(subrange(ZC,0,nv,0,nxv)),QRV.solve(CV));
+        check_lessthan(norm_inf(LUC.solve(Vector(column(BV,1))) - column(XC,1)), 1e-12);
+        check_lessthan(norm_inf(QRC.solve(Vector(column(CV,2))) - column(subrange(ZC,0,nv,0,nxv),2)), 1e-12);
+
+        // interchanges rebuilt from the pivots of a saved decomposition
+        std::stringstream lus;
+        LUV.save(lus);
+        LUDecomposition<double> LUL;
+        LUL.load(lus);
+        Matrix XL(BV);
+        LUL.solveInPlace(XL);
+        check(XL,XV);
+        try_success("Vector and in-place solves...","");
+    } catch ( const std::exception& ) {
+        errorCount = try_failure(errorCount,"Vector and in-place solves...","incorrect solution");
+    }
+    try {
+        // transpose solves with the factors of A, in both layouts
+        const int nt = 20, mt = 27, nxt = 3;
+        Matrix AT(nt,nt), QT(mt,nt), BT(nt,nxt);
+        for(int i=0; i<mt; i++) {
+            for(int j=0; j<nt; j++) {
+                QT(i,j) = std::cos(0.9*i*j + 0.4*i) + (i == j ? 1.5 : 0.0);
+                if (i < nt) {
+                    AT(i,j) = std::sin(2.3*i + 0.7*j*j) + (i == j ? 2.0 : 0.0);
+                }
+            }
+        }
+        for(int i=0; i<nt; i++) {
+            for(int j=0; j<nxt; j++) {
+                BT(i,j) = 1.0 + i*j - j;
+            }
+        }
+        const Matrix ATT = trans(AT);
+        const Matrix XT = LUDecomposition<double>(ATT).solve(BT);
+        check(LUDecomposition<double>(AT).solveTranspose(BT),XT);
+        check(Matrix(LUDecomposition<double,column_major>(AT).solveTranspose(BT)),XT);
+        check_lessthan(norm_inf(LUDecomposition<double>(AT).solveTranspose(Vector(column(BT,1))) - column(XT,1)), 1e-12);
+
+        // minimum norm solution: A'*X = B with X in the range of A
+        const Matrix QTT = trans(QT);
+        const Matrix XM = prod(QT, CholeskyDecomposition<double>(Matrix(prod(QTT,QT))).solve(BT));
+        const Matrix XR = QRDecomposition<double>(QT).solveTranspose(BT);
+        const Matrix XC = QRDecomposition<double,column_major>(QT).solveTranspose(BT);
+        check_lessthan(norm_inf(Matrix(prod(QTT,XR)) - BT), 1e-12);
+        check_lessthan(norm_inf(XR - XM), 1e-10);
+        check_lessthan(norm_inf(XC - XM), 1e-10);
+        check_lessthan(norm_inf(QRDecomposition<double>(QT).solveTranspose(Vector(column(BT,2))) - column(XR,2)), 1e-12);
+        try_success("Transpose solves...","");
+    } catch ( const std::exception& ) {
+        errorCount = try_failure(errorCount,"Transpose solves...","incorrect solution");
+    }
+    try {
+        // estimates against the exact 1-norm condition numbers
+        const int nc = 12;
+        Matrix AC(nc,nc), HC(nc,nc);
+        for(int i=0; i<nc; i++) {
+            for(int j=0; j<nc; j++) {
+                AC(i,j) = std::sin(1.7*i + 0.3*j*j) + (i == j ? 0.5 : 0.0);
+                HC(i,j) = 1.0/(i+j+1) + (i == j ? 1e-6 : 0.0);
+            }
+        }
+        const Matrix IC = identity_matrix<double>(nc);
+        const double ra = 1/(norm_1(AC)*norm_1(LUDecomposition<double>(AC).solve(IC)));
+        const double rh = 1/(norm_1(HC)*norm_1(LUDecomposition<double>(HC).solve(IC)));
+        const Matrix RC = QRDecomposition<double>(AC).getR();
+        const double rr = 1/(norm_1(RC)*norm_1(LUDecomposition<double>(RC).solve(IC)));
+        const double estimates[] = {
+           LUDecomposition<double>(AC).rcond(), ra,
+           LUDecomposition<double,column_major>(AC).rcond(), ra,
+           LUDecomposition<double>(HC).rcond(), rh,
+           CholeskyDecomposition<double>(HC).rcond(), rh,
+           CholeskyDecomposition<double,column_major>(HC).rcond(), rh,
+           QRDecomposition<double>(AC).rcond(), rr,
+           QRDecomposition<double,column_major>(AC).rcond(), rr };
+        for(int k=0; k<7; k++) {
+            if (!(estimates[2*k] >= estimates[2*k+1]*(1-1e-6) && estimates[2*k] <= 10*estimates[2*k+1])) {
+                throw internal_logic("rcond estimate");
+            }
+        }
+        // the norms accumulated by the factorizations, and the upper
+        // triangle of L, which holds the column sums of Cholesky
+        Matrix DC = IC;
+        for(int i=0; i<nc; i++) {
+            DC(i,i) = i+1;
+        }
+        check(LUDecomposition<double>(DC).rcond(),1.0/nc);
+        check(CholeskyDecomposition<double>(DC).rcond(),1.0/nc);
+        const Matrix LC = CholeskyDecomposition<double>(HC).getL();
+        check(prod(LC,trans(LC)),HC);
+
+        // singular matrices, and a decomposition that only has its factors
+        Matrix SC(AC);
+        column(SC,3) = zero_vector<double>(nc);
+        check(LUDecomposition<double>(SC).rcond(),0.0);
+        check(QRDecomposition<double>(SC).rcond(),0.0);
+        check(CholeskyDecomposition<double>(Matrix(-IC)).rcond(),0.0);
+        std::stringstream lus;
+        LUDecomposition<double>(AC).save(lus);
+        LUDecomposition<double> LUL;
+        LUL.load(lus);
+        check_lessthan(LUL.rcond(), 3*ra);
+        check_lessthan(ra*(1-1e-6), LUL.rcond());
+        try_success("Condition estimates...","");
+    } catch ( const std::exception& ) {
+        errorCount = try_failure(errorCount,"Condition estimates...","incorrect estimate");
+    }
+    try {
+        // finite difference matrices of a g-by-g grid: the Laplacian, and
+        // a convection-diffusion operator with a nonsymmetric pattern
+        const int g = 12, ng = g*g;
+        compressed_matrix<double> AS(ng,ng), AU(ng,ng);
+        for(int i=0; i<ng; i++) {
+            AS(i,i) = 4.0;
+            AU(i,i) = 4.0 + 0.01*i;
+            if (i % g > 0) { AS(i,i-1) = -1.0; AU(i,i-1) = -1.3; }
+            if (i % g < g-1) { AS(i,i+1) = -1.0; AU(i,i+1) = -0.7; }
+            if (i >= g) { AS(i,i-g) = -1.0; AU(i,i-g) = -1.0; }
+            if (i < ng-g) { AS(i,i+g) = -1.0; }
+            if (i < ng-2*g) { AU(i,i+2*g) = 0.5; }
+        }
+        Matrix BS(ng,2);
+        for(int i=0; i<ng; i++) {
+            BS(i,0) = 1.0;
+            BS(i,1) = std::sin(0.1*i);
+        }
+        const Matrix DS(AS), DU(AU);
+        SparseCholeskyDecomposition<double> SCH(AS);
+        SparseLUDecomposition<double> SLU(AU);
+        if (!SCH.isSPD() || !SLU.isNonsingular()) {
+            throw internal_logic("sparse decompositions");
+        }
+        check(SCH.solve(BS),CholeskyDecomposition<double>(DS).solve(BS));
+        check(SLU.solve(BS),LUDecomposition<double>(DU).solve(BS));
+        check(SLU.det(),LUDecomposition<double>(DU).det());
+        check_lessthan(norm_inf(Vector(prod(AS,SCH.solve(Vector(column(BS,1))))) - column(BS,1)), 1e-12);
+        check_lessthan(norm_inf(Vector(prod(AU,SLU.solve(Vector(column(BS,1))))) - column(BS,1)), 1e-12);
+        check(Matrix(SparseLUDecomposition<double,column_major>(AU,1.0).solve(BS)),LUDecomposition<double>(DU).solve(BS));
+
+        // the minimum degree ordering against the band of the grid order
+        if (SCH.getL().nonZeros() >= (g+1)*ng*3/4) {
+            throw internal_logic("sparse ordering");
+        }
+
+        // numeric factorization of new values with the symbolic one
+        compressed_matrix<double> AS2(AS*2.0), AU2(AU*2.0);
+        SCH.factorize(AS2);
+        SLU.factorize(AU2);
+        check(Matrix(2.0*SCH.solve(BS)),CholeskyDecomposition<double>(DS).solve(BS));
+        check(Matrix(2.0*SLU.solve(BS)),LUDecomposition<double>(DU).solve(BS));
+
+        // singular and indefinite matrices, and a new pattern
+        compressed_matrix<double> AZ(AU);
+        for(int i=0; i<ng; i++) {
+            if (AZ.find_element(i,5)) {
+                AZ.erase_element(i,5);
+            }
+        }
+        try {
+            SCH.factorize(AZ);
+            throw internal_logic("pattern not checked");
+        } catch ( bad_argument& ) {
+        }
+        SparseLUDecomposition<double> SLUZ(AZ);
+        if (SLUZ.isNonsingular()
+            || SparseCholeskyDecomposition<double>(compressed_matrix<double>(-AS)).isSPD()) {
+            throw internal_logic("sparse singular");
+        }
+        // the factors of a singular matrix still cover all the columns
+        std::vector<int> prow(SLUZ.getRowPermutation());
+        std::sort(prow.begin(), prow.end());
+        for(int i=0; i<ng; i++) {
+            check(prow[i], i);
+        }
+        check((int) SLUZ.getL().p.size(), ng+1);
+        check((int) SLUZ.getU().p.size(), ng+1);
+        check(SLUZ.det(), 0.0);
+        try_success("Sparse decompositions...","");
+    } catch ( const std::exception& ) {
+        errorCount = try_failure(errorCount,"Sparse decompositions...","incorrect solution");
+    }
+    try {
+        // matrix-free 1D Laplacian, whose eigenvalues are 2-2cos(j*pi/(n+1))
+        const int nk = 100;
+        const double pi = std::acos(-1.0);
+        auto laplacian = [nk] (const Vector& x, Vector& y) {
+            for(int i=0; i<nk; i++) {
+                y(i) = 2*x(i) - (i > 0 ? x(i-1) : 0.0) - (i < nk-1 ? x(i+1) : 0.0);
+            }
+        };
+        LanczosEigenSolver<double> LZ(4, SmallestReal);
+        LZ.compute(laplacian, nk);
+        if (!LZ.isConverged() || LZ.getEigenvalues().size() != 4) {
+            throw internal_logic("Lanczos convergence");
+        }
+        Vector xk(nk), yk(nk);
+        for(int j=0; j<4; j++) {
+            check_lessthan(std::abs(LZ.getEigenvalues()(j) - (2-2*std::cos((j+1)*pi/(nk+1)))), 1e-13);
+            xk = column(LZ.getV(),j);
+            laplacian(xk,yk);
+            check_lessthan(norm_2(yk - LZ.getEigenvalues()(j)*xk), 1e-12);
+        }
+
+        // the eigenvalues of largest modulus of a nonsymmetric matrix
+        const int na = 60;
+        Matrix AK(na,na);
+        for(int i=0; i<na; i++) {
+            for(int j=0; j<na; j++) {
+                AK(i,j) = std::sin(1.3*i*j + 0.7*i + 0.2*j)/std::sqrt(double(na)) + (i == j ? 0.05*i : 0.0);
+            }
+        }
+        ArnoldiEigenSolver<double> AR(5);
+        AR.compute(AK);
+        const Matrix VK = AR.getV();
+        if (!AR.isConverged() || VK.size2() < 5) {
+            throw internal_logic("Arnoldi convergence");
+        }
+        check_lessthan(norm_1(Matrix(prod(AK,VK) - prod(VK,AR.getD()))), 1e-11);
+        const EigenvalueDecomposition<double> EK(AK);
+        double largest = 0;
+        for(int j=0; j<na; j++) {
+            largest = std::max(largest, std::hypot(EK.getRealEigenvalues()(j), EK.getImagEigenvalues()(j)));
+        }
+        check_lessthan(std::abs(std::hypot(AR.getRealEigenvalues()(0), AR.getImagEigenvalues()(0)) - largest), 1e-13*largest);
+
+        // the highly nonnormal Grcar matrix, restarted from Schur vectors
+        const int ng = 200;
+        compressed_matrix<double> GK(ng,ng);
+        for(int i=0; i<ng; i++) {
+            GK(i,i) = 1;
+            if (i > 0) {
+                GK(i,i-1) = -1;
+            }
+            for(int j=i+1; j<=i+3 && j<ng; j++) {
+                GK(i,j) = 1;
+            }
+        }
+        ArnoldiEigenSolver<double> AG(4, LargestMagnitude, 40);
+        AG.compute(GK);
+        const Matrix VG = AG.getV();
+        if (!AG.isConverged() || VG.size2() < 4) {
+            throw internal_logic("Arnoldi convergence (Grcar)");
+        }
+        check_lessthan(norm_1(Matrix(prod(GK,VG) - prod(VG,AG.getD()))), 1e-11);
+        try_success("Krylov eigensolvers...","");
+    } catch ( const std::exception& ) {
+        errorCount = try_failure(errorCount,"Krylov eigensolvers...","incorrect eigenpairs");
+    }
+    try {
+        // 2D Laplacian (symmetric positive definite), shifted (indefinite),
+        // and with a convection term (nonsymmetric)
+        const int ni = 20, nl = ni*ni;
+        compressed_matrix<double> AL(nl,nl), AC(nl,nl);
+        for(int i=0; i<ni; i++) {
+            for(int j=0; j<ni; j++) {
+                const int k = i*ni + j;
+                AL(k,k) = 4;
+                AC(k,k) = 4;
+                if (j > 0) { AL(k,k-1) = -1; AC(k,k-1) = -1.4; }
+                if (j < ni-1) { AL(k,k+1) = -1; AC(k,k+1) = -0.6; }
+                if (i > 0) { AL(k,k-ni) = -1; AC(k,k-ni) = -1; }
+                if (i < ni-1) { AL(k,k+ni) = -1; AC(k,k+ni) = -1; }
+            }
+        }
+        Vector bl(nl), xl;
+        for(int k=0; k<nl; k++) {
+            bl(k) = std::sin(0.1*k) + 1;
+        }
+        const double tl = 1e-10;
+        ConjugateGradientSolver<double> CG;
+        CG.setTolerance(tl);
+        if (!CG.solve(AL, bl, xl)
+            || CG.getResidualHistory().size() != (std::size_t) CG.getConvergence().iterations + 1) {
+            throw internal_logic("CG convergence");
+        }
+        check_lessthan(norm_2(bl - prod(AL,xl)), 10*tl*norm_2(bl));
+        const long plain = CG.getConvergence().iterations;
+        xl.resize(0);
+        BlockJacobiPreconditioner<double> BJ(AL, ni);
+        if (!CG.solve(linearOperator(AL), bl, xl, BJ) || CG.getConvergence().iterations >= plain) {
+            throw internal_logic("block Jacobi");
+        }
+        check_lessthan(norm_2(bl - prod(AL,xl)), 10*tl*norm_2(bl));
+
+        // MINRES on an indefinite matrix, as a function object
+        const compressed_matrix<double> AI(AL - 1.05*identity_matrix<double>(nl));
+        auto indefinite = [&AI] (const Vector& x, Vector& y) { y = prod(AI,x); };
+        MinresSolver<double> MR;
+        MR.setTolerance(tl);
+        xl.resize(0);
+        if (!MR.solve(indefinite, bl, xl)) {
+            throw internal_logic("MINRES convergence");
+        }
+        check_lessthan(norm_2(bl - prod(AI,xl)), 100*tl*norm_2(bl));
+        xl.resize(0);
+        if (CG.solve(AI, bl, xl) || CG.getConvergence().unconverged != 1) {
+            throw internal_logic("CG breakdown");
+        }
+
+        // GMRES, restarted, with ILU(0) and with a dense LU
+        GmresSolver<double> GM(10);
+        GM.setTolerance(tl);
+        xl.resize(0);
+        if (!GM.solve(AC, bl, xl)) {
+            throw internal_logic("GMRES convergence");
+        }
+        check_lessthan(norm_2(bl - prod(AC,xl)), 10*tl*norm_2(bl));
+        const long restarted = GM.getConvergence().iterations;
+        IncompleteLUPreconditioner<double> IL(AC);
+        xl.resize(0);
+        if (!GM.solve(AC, bl, xl, IL) || GM.getConvergence().iterations >= restarted) {
+            throw internal_logic("ILU");
+        }
+        check_lessthan(norm_2(bl - prod(AC,xl)), 10*tl*norm_2(bl));
+        const LUDecomposition<double> LC{Matrix(AC)};
+        xl.resize(0);
+        if (!GM.solve(AC, bl, xl, factorizationPreconditioner(LC)) || GM.getConvergence().iterations > 2) {
+            throw internal_logic("LU preconditioner");
+        }
+
+        // iteration limit
+        IterationLimits few;
+        few.perValue = 5;
+        GM.setIterationLimits(few);
+        xl.resize(0);
+        if (GM.solve(AC, bl, xl) || GM.getConvergence().status != PerValueLimitReached) {
+            throw internal_logic("iteration limit");
+        }
+        try_success("Krylov linear solvers...","");
+    } catch ( const std::exception& ) {
+        errorCount = try_failure(errorCount,"Krylov linear solvers...","incorrect solution");
     }
       cout << "\nTestMatrix completed.\n";
       cout << "Total errors reported: " << errorCount << "\n";